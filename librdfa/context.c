@@ -174,7 +174,7 @@ void rdfa_setup_initial_context(rdfacontext* context)
 #else
    char* key = NULL;
    void* value = NULL;
-   void** mptr = context->uri_mappings;
+   size_t position = 0;
 #endif
 
    /* Setup the base RDFa 1.1 prefix and term mappings */
@@ -345,10 +345,8 @@ void rdfa_setup_initial_context(rdfacontext* context)
    /* Raptor does this elsewhere */
 #else
    /* Generate namespace triples for all values in the uri_mapping */
-   while(*mptr != NULL)
+   while(rdfa_next_mapping(context->uri_mappings, &position, &key, &value))
    {
-      rdfa_next_mapping(mptr++, &key, &value);
-      mptr++;
       rdfa_generate_namespace_triple(context, key, value);
    }
 #endif
@@ -393,17 +391,17 @@ rdfacontext* rdfa_create_new_element_context(rdfalist* context_stack)
    /* Raptor does this automatically for URIs */
 #else
    rval->uri_mappings =
-      rdfa_copy_mapping((void**)parent_context->uri_mappings,
+      rdfa_copy_mapping(parent_context->uri_mappings,
          (copy_mapping_value_fp)rdfa_replace_string);
 #endif
    rval->term_mappings =
-      rdfa_copy_mapping((void**)parent_context->term_mappings,
+      rdfa_copy_mapping(parent_context->term_mappings,
          (copy_mapping_value_fp)rdfa_replace_string);
    rval->list_mappings =
-      rdfa_copy_mapping((void**)parent_context->local_list_mappings,
+      rdfa_copy_mapping(parent_context->local_list_mappings,
          (copy_mapping_value_fp)rdfa_replace_list);
    rval->local_list_mappings =
-      rdfa_copy_mapping((void**)parent_context->local_list_mappings,
+      rdfa_copy_mapping(parent_context->local_list_mappings,
          (copy_mapping_value_fp)rdfa_replace_list);
 
    /* inherit the parent context's host language and RDFa processor mode */
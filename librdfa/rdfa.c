@@ -311,7 +311,7 @@ static void start_element(void *parser_context, const char* name,
       raptor_namespace** ns_list = NULL;
       size_t ns_size;
 #else
-      void** umap = context->uri_mappings;
+      size_t umap_position = 0;
 #endif
       const char* umap_key = NULL;
       void* umap_value = NULL;
@@ -327,7 +327,8 @@ static void start_element(void *parser_context, const char* name,
 
       while(ns_size > 0)
 #else
-      while(*umap != NULL)
+      while(rdfa_next_mapping(context->uri_mappings, &umap_position,
+         (char**)&umap_key, &umap_value))
 #endif
       {
          unsigned char insert_xmlns_definition = 1;
@@ -341,9 +342,6 @@ static void start_element(void *parser_context, const char* name,
          if(!umap_key)
            umap_key=(const char*)XMLNS_DEFAULT_MAPPING;
          umap_value = (char*)raptor_uri_as_string(raptor_namespace_get_uri(ns));
-#else
-         rdfa_next_mapping(umap++, &umap_key, &umap_value);
-         umap++;
 #endif
 
          /* check to make sure that the namespace isn't already
@@ -1186,7 +1184,7 @@ static void end_element(void* parser_context, const char* name,
          rdfa_free_mapping(parent_context->local_list_mappings,
             (free_mapping_value_fp)rdfa_free_list);
          parent_context->local_list_mappings = rdfa_copy_mapping(
-            (void**)context->local_list_mappings,
+            context->local_list_mappings,
             (copy_mapping_value_fp)rdfa_replace_list);
 
 #if defined(DEBUG) && DEBUG > 0
@@ -191,6 +191,48 @@ typedef struct rdfalist
    unsigned int user_data;
 } rdfalist;
 
+/**
+ * An RDFa mapping entry holds a key and its value. Entries are shared
+ * by every copy of a mapping that holds them and are only copied when
+ * the value is changed in one of the copies.
+ */
+typedef struct rdfamappingentry
+{
+   unsigned int references;
+   unsigned int hash;
+   char* key;
+   void* value;
+} rdfamappingentry;
+
+/**
+ * The entries of an RDFa mapping, kept in the order they were added
+ * with a hash index over them. The entries are shared by every copy
+ * of a mapping until one of the copies is changed.
+ */
+typedef struct rdfamappingdata
+{
+   unsigned int references;
+   /* NULL where an entry has been deleted */
+   rdfamappingentry** entries;
+   size_t num_entries;
+   size_t max_entries;
+   /* entry position + 1 for each hash slot or 0 if unused */
+   size_t* index;
+   size_t index_size;
+   /* used to copy a value when a shared entry is changed */
+   void* (*copy_value)(void*, void*);
+} rdfamappingdata;
+
+/**
+ * An RDFa mapping is used to store key-value pairs such as URI,
+ * term and list mappings. Copying a mapping is cheap since the copy
+ * shares the entries of the original (copy-on-write).
+ */
+typedef struct rdfamapping
+{
+   rdfamappingdata* data;
+} rdfamapping;
+
 /**
  * The RDFa Parser structure is responsible for keeping track of the state of
  * the current RDFa parser. Things such as the default namespace,
@@ -204,11 +246,11 @@ typedef struct rdfacontext
    char* parent_object;
    char* default_vocabulary;
 #ifndef LIBRDFA_IN_RAPTOR
-   void** uri_mappings;
+   rdfamapping* uri_mappings;
 #endif
-   void** term_mappings;
-   void** list_mappings;
-   void** local_list_mappings;
+   rdfamapping* term_mappings;
+   rdfamapping* list_mappings;
+   rdfamapping* local_list_mappings;
    rdfalist* incomplete_triples;
    rdfalist* local_incomplete_triples;
    char* language;
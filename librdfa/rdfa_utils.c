@@ -309,22 +309,233 @@ void rdfa_add_item(rdfalist* list, void* data, liflag_t flags)
    ++list->num_items;
 }
 
-void** rdfa_create_mapping(size_t elements)
+/* initial number of entries allocated for a mapping */
+#define RDFA_MAPPING_INITIAL_ENTRIES 8
+
+static unsigned int rdfa_mapping_hash(const char* key)
+{
+   /* FNV-1a */
+   unsigned int hash = 2166136261U;
+
+   while(*key != '\0')
+   {
+      hash ^= (unsigned char)*key++;
+      hash *= 16777619U;
+   }
+
+   return hash;
+}
+
+/* Returns the position + 1 of the entry for key or 0 if not found. */
+static size_t rdfa_find_mapping(
+   rdfamappingdata* data, const char* key, unsigned int hash)
+{
+   size_t mask;
+   size_t i;
+
+   if(data == NULL || data->index == NULL)
+      return 0;
+
+   mask = data->index_size - 1;
+   for(i = hash & mask; data->index[i] != 0; i = (i + 1) & mask)
+   {
+      rdfamappingentry* entry = data->entries[data->index[i] - 1];
+
+      if(entry != NULL && entry->hash == hash &&
+         strcmp(entry->key, key) == 0)
+      {
+         return data->index[i];
+      }
+   }
+
+   return 0;
+}
+
+static rdfamappingentry* rdfa_create_mapping_entry(
+   const char* key, unsigned int hash)
+{
+   rdfamappingentry* entry =
+      (rdfamappingentry*)malloc(sizeof(rdfamappingentry));
+
+   if(entry != NULL)
+   {
+      entry->references = 1;
+      entry->hash = hash;
+      entry->key = rdfa_strdup(key);
+      entry->value = NULL;
+   }
+
+   return entry;
+}
+
+static void rdfa_free_mapping_entry(
+   rdfamappingentry* entry, free_mapping_value_fp free_value)
+{
+   if(--entry->references == 0)
+   {
+      free(entry->key);
+      free_value(entry->value);
+      free(entry);
+   }
+}
+
+/* Makes sure the mapping has an entry array that is not shared with
+ * any other copy of the mapping; the entries themselves stay shared.
+ * Returns non-zero on failure. */
+static int rdfa_unshare_mapping(rdfamapping* mapping)
+{
+   rdfamappingdata* data = mapping->data;
+   rdfamappingdata* rval;
+   size_t i;
+
+   if(data != NULL && data->references == 1)
+      return 0;
+
+   rval = (rdfamappingdata*)calloc(1, sizeof(rdfamappingdata));
+   if(rval == NULL)
+      return 1;
+   rval->references = 1;
+
+   if(data != NULL && data->entries != NULL)
+   {
+      rval->entries = (rdfamappingentry**)malloc(
+         sizeof(rdfamappingentry*) * data->max_entries);
+      rval->index = (size_t*)malloc(sizeof(size_t) * data->index_size);
+      if(rval->entries == NULL || rval->index == NULL)
+      {
+         free(rval->entries);
+         free(rval->index);
+         free(rval);
+         return 1;
+      }
+
+      /* keep every entry at the same position so that the positions
+       * used by rdfa_next_mapping() stay valid */
+      for(i = 0; i < data->num_entries; i++)
+      {
+         rval->entries[i] = data->entries[i];
+         if(rval->entries[i] != NULL)
+            rval->entries[i]->references++;
+      }
+      rval->num_entries = data->num_entries;
+      rval->max_entries = data->max_entries;
+      memcpy(rval->index, data->index, sizeof(size_t) * data->index_size);
+      rval->index_size = data->index_size;
+   }
+
+   if(data != NULL)
+   {
+      rval->copy_value = data->copy_value;
+      data->references--;
+   }
+
+   mapping->data = rval;
+
+   return 0;
+}
+
+/* Makes sure the entry at the given position + 1 is not shared with
+ * any other copy of the mapping, copying the value if needed. Returns
+ * the entry or NULL on failure. */
+static rdfamappingentry* rdfa_unshare_mapping_entry(
+   rdfamapping* mapping, size_t found)
+{
+   rdfamappingentry* entry;
+   rdfamappingentry* rval;
+
+   if(rdfa_unshare_mapping(mapping))
+      return NULL;
+
+   entry = mapping->data->entries[found - 1];
+   if(entry->references == 1)
+      return entry;
+
+   rval = rdfa_create_mapping_entry(entry->key, entry->hash);
+   if(rval == NULL)
+      return NULL;
+   rval->value = mapping->data->copy_value(NULL, entry->value);
+
+   /* the other copies still hold the old entry */
+   entry->references--;
+   mapping->data->entries[found - 1] = rval;
+
+   return rval;
+}
+
+/* Makes room for one more entry, dropping deleted entries. Returns
+ * non-zero on failure. */
+static int rdfa_grow_mapping(rdfamappingdata* data)
+{
+   rdfamappingentry** entries;
+   size_t* index;
+   size_t max_entries = RDFA_MAPPING_INITIAL_ENTRIES;
+   size_t index_size;
+   size_t count = 0;
+   size_t i;
+
+   for(i = 0; i < data->num_entries; i++)
+   {
+      if(data->entries[i] != NULL)
+         count++;
+   }
+   while(max_entries <= count)
+      max_entries <<= 1;
+
+   /* keep the index at most half full */
+   for(index_size = 1; index_size < max_entries * 2; index_size <<= 1)
+      ;
+
+   entries = (rdfamappingentry**)malloc(
+      sizeof(rdfamappingentry*) * max_entries);
+   index = (size_t*)calloc(index_size, sizeof(size_t));
+   if(entries == NULL || index == NULL)
+   {
+      free(entries);
+      free(index);
+      return 1;
+   }
+
+   count = 0;
+   for(i = 0; i < data->num_entries; i++)
+   {
+      size_t j;
+
+      if(data->entries[i] == NULL)
+         continue;
+
+      entries[count] = data->entries[i];
+      for(j = entries[count]->hash & (index_size - 1); index[j] != 0;
+          j = (j + 1) & (index_size - 1))
+         ;
+      index[j] = ++count;
+   }
+
+   free(data->entries);
+   free(data->index);
+   data->entries = entries;
+   data->num_entries = count;
+   data->max_entries = max_entries;
+   data->index = index;
+   data->index_size = index_size;
+
+   return 0;
+}
+
+rdfamapping* rdfa_create_mapping(size_t elements)
 {
-   size_t mapping_size = sizeof(void*) * MAX_URI_MAPPINGS * 2;
-   void** mapping = (void**)malloc(mapping_size);
+   rdfamapping* mapping = (rdfamapping*)malloc(sizeof(rdfamapping));
 
-   /* only initialize the mapping if it is not null. */
+   /* the entries are created when the first key is added */
    if(mapping != NULL)
    {
-      memset(mapping, 0, mapping_size);
+      mapping->data = NULL;
    }
 
    return mapping;
 }
 
 void rdfa_create_list_mapping(
-   rdfacontext* context, void** mapping,
+   rdfacontext* context, rdfamapping* mapping,
    const char* subject, const char* key)
 {
    char* realkey = NULL;
@@ -362,93 +573,135 @@ void rdfa_create_list_mapping(
 }
 
 void rdfa_append_to_list_mapping(
-   void** mapping, const char* subject, const char* key, void* value)
+   rdfamapping* mapping, const char* subject, const char* key, void* value)
 {
-   rdfalist* list = (rdfalist*)rdfa_get_list_mapping(mapping, subject, key);
+   rdfalist* list;
+   char* realkey = NULL;
+   size_t str_size = strlen(subject);
+
+   /* the list is changed in place so it must not be shared */
+   realkey = rdfa_strdup(subject);
+   realkey = rdfa_n_append_string(realkey, &str_size, " ", 1);
+   realkey = rdfa_n_append_string(realkey, &str_size, key, strlen(key));
+   list = (rdfalist*)rdfa_get_mapping_for_update(mapping, realkey);
+   free(realkey);
+
    rdfa_add_item(list, value, RDFALIST_FLAG_TRIPLE);
 }
 
-void** rdfa_copy_mapping(
-   void** mapping, copy_mapping_value_fp copy_mapping_value)
+rdfamapping* rdfa_copy_mapping(
+   rdfamapping* mapping, copy_mapping_value_fp copy_mapping_value)
 {
-   void** rval = (void**)calloc(MAX_URI_MAPPINGS * 2, sizeof(void*));
-   void** mptr = mapping;
-   void** rptr = rval;
+   rdfamapping* rval = (rdfamapping*)malloc(sizeof(rdfamapping));
+
+   if(rval == NULL)
+      return NULL;
 
-   /* copy each element of the old mapping to the new mapping. */
-   while(*mptr != NULL)
+   /* share the entries; they are copied when either mapping changes */
+   rval->data = (mapping != NULL) ? mapping->data : NULL;
+   if(rval->data != NULL)
    {
-      /* copy the key */
-      *rptr = rdfa_replace_string((char*)*rptr, (const char*)*mptr);
-      rptr++;
-      mptr++;
-
-      /* copy the value */
-      *rptr = copy_mapping_value(*rptr, *mptr);
-      rptr++;
-      mptr++;
+      rval->data->references++;
+      rval->data->copy_value = copy_mapping_value;
    }
 
    return rval;
 }
 
-void rdfa_update_mapping(void** mapping, const char* key, const void* value,
-   update_mapping_value_fp update_mapping_value)
+void rdfa_update_mapping(rdfamapping* mapping, const char* key,
+   const void* value, update_mapping_value_fp update_mapping_value)
 {
-   int found = 0;
-   void** mptr = mapping;
+   rdfamappingdata* data;
+   rdfamappingentry* entry;
+   unsigned int hash = rdfa_mapping_hash(key);
+   size_t found;
+   size_t i;
+
+   if(rdfa_unshare_mapping(mapping))
+      return;
+   data = mapping->data;
 
    /* search the current mapping to see if the key exists in the mapping */
-   while(!found && (*mptr != NULL))
+   found = rdfa_find_mapping(data, key, hash);
+   if(found)
    {
-      if(strcmp((char*)*mptr, key) == 0)
-      {
-         mptr++;
-         *mptr = update_mapping_value(*mptr, value);
-         found = 1;
-      }
-      else
+      entry = data->entries[found - 1];
+      if(entry->references == 1)
       {
-         mptr++;
+         entry->value = update_mapping_value(entry->value, value);
+         return;
       }
-      mptr++;
-   }
 
-   /* if we made it through the entire URI mapping and the key was not
-    * found, create a new key-value pair. */
-   if(!found)
-   {
-     *mptr = rdfa_replace_string((char*)*mptr, key);
-      mptr++;
-      *mptr = update_mapping_value(*mptr, value);
+      /* replace the entry shared with other copies of the mapping */
+      entry->references--;
+      entry = rdfa_create_mapping_entry(key, hash);
+      data->entries[found - 1] = entry;
+      if(entry != NULL)
+         entry->value = update_mapping_value(NULL, value);
+      return;
    }
+
+   /* if the key was not found, create a new key-value pair. */
+   if(data->num_entries == data->max_entries && rdfa_grow_mapping(data))
+      return;
+
+   entry = rdfa_create_mapping_entry(key, hash);
+   if(entry == NULL)
+      return;
+   entry->value = update_mapping_value(NULL, value);
+   data->entries[data->num_entries++] = entry;
+
+   for(i = hash & (data->index_size - 1); data->index[i] != 0;
+       i = (i + 1) & (data->index_size - 1))
+      ;
+   data->index[i] = data->num_entries;
 }
 
-const void* rdfa_get_mapping(void** mapping, const char* key)
+const void* rdfa_get_mapping(rdfamapping* mapping, const char* key)
 {
-   const void* rval = NULL;
-   char** mptr = (char**)mapping;
+   rdfamappingdata* data = mapping->data;
+   size_t found;
 
    /* search the current mapping to see if the key exists in the mapping. */
-   while(*mptr != NULL)
-   {
-      if(strcmp(*mptr, key) == 0)
-      {
-         mptr++;
-         rval = *mptr;
-      }
-      else
-      {
-         mptr++;
-      }
-      mptr++;
-   }
+   found = rdfa_find_mapping(data, key, rdfa_mapping_hash(key));
 
-   return rval;
+   return found ? data->entries[found - 1]->value : NULL;
+}
+
+void* rdfa_get_mapping_for_update(rdfamapping* mapping, const char* key)
+{
+   rdfamappingentry* entry;
+   size_t found;
+
+   found = rdfa_find_mapping(mapping->data, key, rdfa_mapping_hash(key));
+   if(found == 0)
+      return NULL;
+
+   entry = rdfa_unshare_mapping_entry(mapping, found);
+
+   return entry ? entry->value : NULL;
+}
+
+void rdfa_delete_mapping(rdfamapping* mapping, const char* key,
+   free_mapping_value_fp free_value)
+{
+   size_t found;
+
+   found = rdfa_find_mapping(mapping->data, key, rdfa_mapping_hash(key));
+   if(found == 0)
+      return;
+
+   if(rdfa_unshare_mapping(mapping))
+      return;
+
+   /* the index still refers to the position, which is skipped by
+    * lookups, until the entries are next grown */
+   rdfa_free_mapping_entry(mapping->data->entries[found - 1], free_value);
+   mapping->data->entries[found - 1] = NULL;
 }
 
 const void* rdfa_get_list_mapping(
-   void** mapping, const char* subject, const char* key)
+   rdfamapping* mapping, const char* subject, const char* key)
 {
    void* rval;
    char* realkey = NULL;
@@ -464,40 +717,57 @@ const void* rdfa_get_list_mapping(
    return (const void*)rval;
 }
 
-void rdfa_next_mapping(void** mapping, char** key, void** value)
+int rdfa_next_mapping(rdfamapping* mapping, size_t* position,
+   char** key, void** value)
 {
+   rdfamappingdata* data = mapping->data;
+
    *key = NULL;
    *value = NULL;
 
-   if(*mapping != NULL)
+   if(data == NULL)
+      return 0;
+
+   /* skip deleted entries */
+   while(*position < data->num_entries && data->entries[*position] == NULL)
+   {
+      (*position)++;
+   }
+
+   if(*position < data->num_entries)
    {
-      *key = *(char**)mapping++;
-      *value = *mapping++;
+      *key = data->entries[*position]->key;
+      *value = data->entries[*position]->value;
+      (*position)++;
+      return 1;
    }
+
+   return 0;
 }
 
-void rdfa_print_mapping(void** mapping, print_mapping_value_fp print_value)
+void rdfa_print_mapping(rdfamapping* mapping,
+   print_mapping_value_fp print_value)
 {
-   void** mptr = mapping;
+   size_t position = 0;
+   char* key;
+   void* value;
+   int first = 1;
+
    printf("{\n");
-   while(*mptr != NULL)
+   while(rdfa_next_mapping(mapping, &position, &key, &value))
    {
-      char* key;
-      void* value;
-      key = (char*)*mptr++;
-      value = *mptr++;
-
-      printf("   %s : ", key);
-      print_value(value);
-
-      if(*mptr != NULL)
+      if(!first)
       {
          printf(",\n");
       }
-      else
-      {
-         printf("\n");
-      }
+      first = 0;
+
+      printf("   %s : ", key);
+      print_value(value);
+   }
+   if(!first)
+   {
+      printf("\n");
    }
    printf("}\n");
 }
@@ -507,19 +777,27 @@ void rdfa_print_string(const char* str)
    printf("%s", str);
 }
 
-void rdfa_free_mapping(void** mapping, free_mapping_value_fp free_value)
+void rdfa_free_mapping(rdfamapping* mapping, free_mapping_value_fp free_value)
 {
-   void** mptr = mapping;
+   rdfamappingdata* data;
+   size_t i;
 
    if(mapping != NULL)
    {
-      /* free all of the memory in the mapping */
-      while(*mptr != NULL)
+      data = mapping->data;
+
+      /* free all of the memory in the mapping once no copy uses it */
+      if(data != NULL && --data->references == 0)
       {
-         free(*mptr);
-         mptr++;
-         free_value(*mptr);
-         mptr++;
+         for(i = 0; i < data->num_entries; i++)
+         {
+            if(data->entries[i] != NULL)
+               rdfa_free_mapping_entry(data->entries[i], free_value);
+         }
+
+         free(data->entries);
+         free(data->index);
+         free(data);
       }
 
       free(mapping);
@@ -79,9 +79,6 @@ typedef enum
 #define RDFA_PROCESSOR_WARNING "http://www.w3.org/ns/rdfa#Warning"
 #define RDFA_PROCESSOR_ERROR "http://www.w3.org/ns/rdfa#Error"
 
-/* key establishing a deleted mapping entry */
-#define RDFA_MAPPING_DELETED_KEY "<DELETED-KEY>"
-
 /**
  * A function pointer that will be used to copy mapping values.
  */
@@ -104,14 +101,15 @@ typedef void (*free_mapping_value_fp)(void*);
 
 /**
  * Initializes a mapping given the number of elements the mapping is
- * expected to hold.
+ * expected to hold. No entries are allocated until the first key is
+ * added.
  *
- * @param elements the maximum number of elements the mapping is
- *                 supposed to hold.
+ * @param elements the number of elements the mapping is expected to
+ *                 hold.
  *
- * @return an initialized void**, with all of the elements set to NULL.
+ * @return an initialized, empty mapping.
  */
-void** rdfa_create_mapping(size_t elements);
+rdfamapping* rdfa_create_mapping(size_t elements);
 
 /**
  * Adds a list to a mapping given a key to create. The result will be a
@@ -124,7 +122,8 @@ void** rdfa_create_mapping(size_t elements);
  * @param user_data the user-defined data to store with the list information.
  */
 void rdfa_create_list_mapping(
-   rdfacontext* context, void** mapping, const char* subject, const char* key);
+   rdfacontext* context, rdfamapping* mapping,
+   const char* subject, const char* key);
 
 /**
  * Adds an item to the end of the list that is associated with the given
@@ -136,7 +135,7 @@ void rdfa_create_list_mapping(
  * @param value the value to append to the end of the list.
  */
 void rdfa_append_to_list_mapping(
-   void** mapping, const char* subject, const char* key, void* value);
+   rdfamapping* mapping, const char* subject, const char* key, void* value);
 
 /**
  * Gets the value for a given list mapping when presented with a subject
@@ -150,20 +149,22 @@ void rdfa_append_to_list_mapping(
  * @return value the value in the mapping for the given key.
  */
 const void* rdfa_get_list_mapping(
-   void** mapping, const char* subject, const char* key);
+   rdfamapping* mapping, const char* subject, const char* key);
 
 /**
- * Copies the entire contents of a mapping verbatim and returns a
- * pointer to the copied mapping.
+ * Copies a mapping and returns a pointer to the copied mapping. The
+ * copy shares the entries of the given mapping; they are only copied,
+ * using copy_mapping_value for the values, when either mapping is
+ * changed.
  *
  * @param mapping the mapping to copy
+ * @param copy_mapping_value the function used to copy mapping values.
  *
- * @return the copied mapping, with all of the memory newly
- *         allocated. You MUST free the returned mapping when you are
- *         done with it.
+ * @return the copied mapping. You MUST free the returned mapping when
+ *         you are done with it.
  */
-void** rdfa_copy_mapping(
-   void** mapping, copy_mapping_value_fp copy_mapping_value);
+rdfamapping* rdfa_copy_mapping(
+   rdfamapping* mapping, copy_mapping_value_fp copy_mapping_value);
 
 /**
  * Updates the given mapping when presented with a key and a value. If
@@ -175,8 +176,8 @@ void** rdfa_copy_mapping(
  * @param replace_mapping_value a pointer to a function that will replace the
  *    old
  */
-void rdfa_update_mapping(void** mapping, const char* key, const void* value,
-   update_mapping_value_fp update_mapping_value);
+void rdfa_update_mapping(rdfamapping* mapping, const char* key,
+   const void* value, update_mapping_value_fp update_mapping_value);
 
 /**
  * Gets the value for a given mapping when presented with a key. If
@@ -187,19 +188,48 @@ void rdfa_update_mapping(void** mapping, const char* key, const void* value,
  *
  * @return value the value in the mapping for the given key.
  */
-const void* rdfa_get_mapping(void** mapping, const char* key);
+const void* rdfa_get_mapping(rdfamapping* mapping, const char* key);
+
+/**
+ * Gets the value for a given mapping when presented with a key so
+ * that the value can be modified in place. Entries shared with other
+ * copies of the mapping are copied first. If the key doesn't exist in
+ * the mapping, NULL is returned.
+ *
+ * @param mapping the mapping to search.
+ * @param key the key.
+ *
+ * @return value the value in the mapping for the given key.
+ */
+void* rdfa_get_mapping_for_update(rdfamapping* mapping, const char* key);
+
+/**
+ * Removes a key and its value from the given mapping.
+ *
+ * @param mapping the mapping to update.
+ * @param key the key.
+ * @param free_value the function to free the mapping value.
+ */
+void rdfa_delete_mapping(rdfamapping* mapping, const char* key,
+   free_mapping_value_fp free_value);
 
 /**
- * Gets the current mapping for the given mapping and increments the
- * mapping to the next value in the chain. 
+ * Gets the mapping at the given position and moves the position to
+ * the next mapping. Mappings are returned in the order they were
+ * added.
  *
- * @param mapping the mapping to use and increment.
+ * @param mapping the mapping to iterate over.
+ * @param position the position to use and increment, 0 for the first
+ *                 mapping.
  * @param key the key that will be retrieved, NULL if the mapping is
  *            blank or you are at the end of the mapping.
  * @param value the value that is associated with the key. NULL if the
  *              mapping is blank or you are at the end of the mapping.
+ *
+ * @return 1 if a mapping was retrieved, 0 at the end of the mapping.
  */
-void rdfa_next_mapping(void** mapping, char** key, void** value);
+int rdfa_next_mapping(rdfamapping* mapping, size_t* position,
+   char** key, void** value);
 
 /**
  * Prints the mapping to the screen in a human-readable way.
@@ -207,15 +237,17 @@ void rdfa_next_mapping(void** mapping, char** key, void** value);
  * @param mapping the mapping to print to the screen.
  * @param print_value the function pointer to use to print the mapping values.
  */
-void rdfa_print_mapping(void** mapping, print_mapping_value_fp print_value);
+void rdfa_print_mapping(rdfamapping* mapping,
+   print_mapping_value_fp print_value);
 
 /**
- * Frees all memory associated with a mapping.
+ * Frees all memory associated with a mapping. Entries shared with
+ * other copies of the mapping are kept until the last copy is freed.
  *
  * @param mapping the mapping to free.
  * @param free_value the function to free mapping values.
  */
-void rdfa_free_mapping(void** mapping, free_mapping_value_fp free_value);
+void rdfa_free_mapping(rdfamapping* mapping, free_mapping_value_fp free_value);
 
 /**
  * Creates a list and initializes it to the given size.
@@ -40,6 +40,10 @@
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define RAPTOR_NTRIPLES_PARALLEL 1
+#endif
 
 /* Raptor includes */
 #include "raptor2.h"
@@ -59,9 +63,11 @@ static void raptor_ntriples_generate_statement(raptor_parser* parser, raptor_ter
  * NTriples parser object
  */
 struct raptor_ntriples_parser_context_s {
-  /* current line */
+  /* line buffer: content not yet parsed plus space to append to */
   unsigned char *line;
-  /* current line length */
+  /* allocated size of line buffer */
+  size_t line_size;
+  /* length of content in line buffer */
   size_t line_length;
   /* current char in line buffer */
   size_t offset;
@@ -75,6 +81,22 @@ struct raptor_ntriples_parser_context_s {
   int is_nquads;
 
   int literal_graph_warning;
+
+  /* writable copy of one line for raptor_ntriples_parse_buffer() */
+  unsigned char *scratch;
+  /* allocated size of scratch */
+  size_t scratch_size;
+
+  /* statement term arena if RAPTOR_OPTION_STATEMENT_ARENA is set */
+  raptor_term_arena* arena;
+
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  /* line and scratch buffer (re)allocations */
+  int buffer_allocs;
+  /* moves of unparsed content to the start of the line buffer */
+  int buffer_moves;
+  size_t buffer_moved_bytes;
+#endif
 };
 
 
@@ -118,8 +140,12 @@ raptor_ntriples_parse_terminate(raptor_parser* rdf_parser)
 {
   raptor_ntriples_parser_context *ntriples_parser;
   ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
-  if(ntriples_parser->line_length)
+  if(ntriples_parser->line)
     RAPTOR_FREE(cdata, ntriples_parser->line);
+  if(ntriples_parser->scratch)
+    RAPTOR_FREE(cdata, ntriples_parser->scratch);
+  if(ntriples_parser->arena)
+    raptor_free_term_arena(ntriples_parser->arena);
 }
 
 
@@ -148,11 +174,11 @@ raptor_ntriples_generate_statement(raptor_parser* parser,
     goto cleanup;
 
   /* If there is no statement handler - there is nothing else to do */
-  if(!parser->statement_handler)
+  if(!parser->statement_handler && !parser->statement_batch_handler)
     goto cleanup;
 
   /* Generate the statement */
-  (*parser->statement_handler)(parser->user_data, statement);
+  raptor_parser_emit_statement(parser, statement);
 
   cleanup:
   raptor_free_statement(statement);
@@ -258,7 +284,8 @@ raptor_ntriples_parse_line(raptor_parser* rdf_parser,
 
 
     term_len = raptor_ntriples_parse_term(rdf_parser->world, &rdf_parser->locator,
-                                          p, &len, &terms[i], 0);
+                                          p, &len, &terms[i], 0,
+                                          ntriples_parser->arena);
     if(!term_len) {
       rc = 1;
       goto cleanup;
@@ -371,6 +398,121 @@ raptor_ntriples_parse_line(raptor_parser* rdf_parser,
 }
 
 
+/*
+ * raptor_ntriples_line_end:
+ * @ptr: start of line
+ * @end_ptr: end of buffer
+ *
+ * INTERNAL - Find the end of an N-Triples line
+ *
+ * Newlines inside quoted literals or escaped by '\\' do not end the
+ * line.
+ *
+ * Return value: pointer to the '\n' or '\r' ending the line or @end_ptr
+ */
+static const unsigned char*
+raptor_ntriples_line_end(const unsigned char *ptr,
+                         const unsigned char *end_ptr)
+{
+  int quote = '\0';
+  int in_uri = '\0';
+  int bq = 0;
+
+  while(ptr < end_ptr) {
+    if(!bq) {
+      /* skip bytes that cannot change the scanning state */
+      ptr += raptor_ntriples_span(ptr, end_ptr - ptr, "\\<>\"'\n\r", 0x00, 0xff);
+      if(ptr == end_ptr)
+        break;
+
+      if(*ptr == '\\') {
+        bq = 1;
+        ptr++;
+        continue;
+      }
+
+      if(*ptr == '<')
+        in_uri = 1;
+      else if (in_uri && *ptr == '>')
+        in_uri = 0;
+
+      if(!quote) {
+        if((!in_uri && *ptr == '\'') || *ptr == '"')
+          quote = *ptr;
+        if(*ptr == '\n' || *ptr == '\r')
+          break;
+      } else {
+        if(*ptr == quote)
+          quote = 0;
+      }
+    }
+    ptr++;
+    bq = 0;
+  }
+
+  return ptr;
+}
+
+
+/*
+ * raptor_ntriples_line_buffer_reserve:
+ * @rdf_parser: parser
+ * @len: number of bytes needed after the current content
+ *
+ * INTERNAL - Make room at the end of the line buffer
+ *
+ * The unparsed content is first moved to the start of the buffer and
+ * the buffer only grown (doubling) if that does not free enough space,
+ * so for a stream of lines the buffer settles at a size independent of
+ * the total input length.
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_ntriples_line_buffer_reserve(raptor_parser* rdf_parser, size_t len)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+  size_t tail_len = ntriples_parser->line_length - ntriples_parser->offset;
+
+  if(ntriples_parser->offset) {
+    if(tail_len)
+      memmove(ntriples_parser->line,
+              ntriples_parser->line + ntriples_parser->offset, tail_len);
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    ntriples_parser->buffer_moves++;
+    ntriples_parser->buffer_moved_bytes += tail_len;
+    RAPTOR_DEBUG3("moved %ld bytes to start of %ld byte buffer\n",
+                  tail_len, ntriples_parser->line_size);
+#endif
+    ntriples_parser->line_length = tail_len;
+    ntriples_parser->offset = 0;
+  }
+
+  if(tail_len + len > ntriples_parser->line_size) {
+    size_t new_size = ntriples_parser->line_size ?
+                      ntriples_parser->line_size : RAPTOR_READ_BUFFER_SIZE;
+    unsigned char *new_line;
+
+    while(new_size < tail_len + len)
+      new_size <<= 1;
+
+    new_line = RAPTOR_REALLOC(unsigned char*, ntriples_parser->line, new_size);
+    if(!new_line)
+      return 1;
+
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    ntriples_parser->buffer_allocs++;
+    RAPTOR_DEBUG3("grew buffer from %ld to %ld bytes\n",
+                  ntriples_parser->line_size, new_size);
+#endif
+    ntriples_parser->line = new_line;
+    ntriples_parser->line_size = new_size;
+  }
+
+  return 0;
+}
+
+
 static int
 raptor_ntriples_parse_chunk(raptor_parser* rdf_parser, 
                             const unsigned char *s, size_t len,
@@ -382,45 +524,39 @@ raptor_ntriples_parse_chunk(raptor_parser* rdf_parser,
   raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
   int max_terms = ntriples_parser->is_nquads ? 4 : 3;
   unsigned char* end_ptr;
+  int rc;
 
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
   RAPTOR_DEBUG2("adding %d bytes to buffer\n", (unsigned int)len);
 #endif
 
   if(len) {
-    buffer = RAPTOR_MALLOC(unsigned char*, ntriples_parser->line_length + len + 1);
-    if(!buffer) {
+    if(ntriples_parser->line_length + len + 1 > ntriples_parser->line_size &&
+       raptor_ntriples_line_buffer_reserve(rdf_parser, len + 1)) {
       raptor_parser_fatal_error(rdf_parser, "Out of memory");
       return 1;
     }
 
-    if(ntriples_parser->line_length) {
-      memcpy(buffer, ntriples_parser->line, ntriples_parser->line_length);
-      RAPTOR_FREE(char*, ntriples_parser->line);
-    }
-
-    ntriples_parser->line = buffer;
-
-    /* move pointer to end of cdata buffer */
-    ptr = buffer + ntriples_parser->line_length;
+    /* now write new stuff at end of line buffer */
+    ptr = ntriples_parser->line + ntriples_parser->line_length;
+    memcpy(ptr, s, len);
+    ptr[len] = '\0';
 
-    /* adjust stored length */
     ntriples_parser->line_length += len;
+  }
 
-    /* now write new stuff at end of cdata buffer */
-    memcpy(ptr, s, len);
-    ptr += len;
-    *ptr = '\0';
-  } else
-    buffer = ntriples_parser->line;
+  buffer = ntriples_parser->line;
 
 
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
   RAPTOR_DEBUG2("buffer now %ld bytes\n", ntriples_parser->line_length);
 #endif
 
-  if(!ntriples_parser->line_length)
-    return 0;
+  if(!ntriples_parser->line_length) {
+    if(!is_end)
+      return 0;
+    goto end_of_input;
+  }
 
   ptr = buffer + ntriples_parser->offset;
   end_ptr = buffer + ntriples_parser->line_length;
@@ -442,37 +578,7 @@ raptor_ntriples_parse_chunk(raptor_parser* rdf_parser,
       start = line_start = ptr;
     }
 
-    if(1) {
-      int quote = '\0';
-      int in_uri = '\0';
-      int bq = 0;
-      while(ptr < end_ptr) {
-        if(!bq) {
-          if(*ptr == '\\') {
-            bq = 1;
-            ptr++;
-            continue;
-          }
-
-          if(*ptr == '<')
-            in_uri = 1;
-          else if (in_uri && *ptr == '>')
-            in_uri = 0;
-
-          if(!quote) {
-            if((!in_uri && *ptr == '\'') || *ptr == '"')
-              quote = *ptr;
-            if(*ptr == '\n' || *ptr == '\r')
-              break;
-          } else {
-            if(*ptr == quote)
-              quote = 0;
-          }
-        }
-        ptr++;
-        bq = 0;
-      }
-    }
+    ptr = (unsigned char*)raptor_ntriples_line_end(ptr, end_ptr);
 
     if(ptr == end_ptr) {
       if(!is_end)
@@ -495,7 +601,10 @@ raptor_ntriples_parse_chunk(raptor_parser* rdf_parser,
     fputs("<<<\n", stderr);
 #endif
     *ptr = '\0';
-    if(raptor_ntriples_parse_line(rdf_parser, line_start, len, max_terms))
+    rc = raptor_ntriples_parse_line(rdf_parser, line_start, len, max_terms);
+    if(ntriples_parser->arena)
+      raptor_term_arena_reset(ntriples_parser->arena);
+    if(rc)
       return 1;
     
     rdf_parser->locator.line++;
@@ -517,36 +626,13 @@ raptor_ntriples_parse_chunk(raptor_parser* rdf_parser,
 
   ntriples_parser->offset = start - buffer;
 
-  len = ntriples_parser->line_length - ntriples_parser->offset;
-    
-  if(len && ntriples_parser->line_length != len) {
-    /* collapse buffer */
-
-#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-    RAPTOR_DEBUG3("collapsing buffer from %ld to %ld bytes\n", ntriples_parser->line_length, len);
-#endif
-    buffer = RAPTOR_MALLOC(unsigned char*, len + 1);
-    if(!buffer) {
-      raptor_parser_fatal_error(rdf_parser, "Out of memory");
-      return 1;
-    }
-
-    memcpy(buffer, 
-           ntriples_parser->line + ntriples_parser->line_length - len,
-           len);
-    buffer[len] = '\0';
-
-    RAPTOR_FREE(char*, ntriples_parser->line);
-
-    ntriples_parser->line = buffer;
-    ntriples_parser->line_length -= ntriples_parser->offset;
+  if(ntriples_parser->offset == ntriples_parser->line_length) {
+    /* all content used: start again at the beginning of the buffer */
+    ntriples_parser->line_length = 0;
     ntriples_parser->offset = 0;
-
-#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-    RAPTOR_DEBUG3("buffer now '%s' (%ld bytes)\n", ntriples_parser->line, ntriples_parser->line_length);
-#endif    
   }
 
+  end_of_input:
   /* exit now, no more input */
   if(is_end) {
     if(ntriples_parser->offset != ntriples_parser->line_length) {
@@ -566,6 +652,777 @@ raptor_ntriples_parse_chunk(raptor_parser* rdf_parser,
 }
 
 
+/*
+ * raptor_ntriples_parse_line_copy:
+ * @rdf_parser: parser
+ * @line: read-only line
+ * @len: length of @line
+ *
+ * INTERNAL - Parse a line of read-only content
+ *
+ * The term parser decodes escapes in place so the line is copied
+ * into a reusable scratch buffer first.
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_ntriples_parse_line_copy(raptor_parser* rdf_parser,
+                                const unsigned char *line, size_t len)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+  int rc;
+
+  if(len >= ntriples_parser->scratch_size) {
+    size_t new_size = ntriples_parser->scratch_size ?
+                      ntriples_parser->scratch_size : 256;
+    unsigned char *new_scratch;
+
+    while(new_size <= len)
+      new_size <<= 1;
+
+    new_scratch = RAPTOR_MALLOC(unsigned char*, new_size);
+    if(!new_scratch) {
+      raptor_parser_fatal_error(rdf_parser, "Out of memory");
+      return 1;
+    }
+    if(ntriples_parser->scratch)
+      RAPTOR_FREE(cdata, ntriples_parser->scratch);
+    ntriples_parser->scratch = new_scratch;
+    ntriples_parser->scratch_size = new_size;
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    ntriples_parser->buffer_allocs++;
+#endif
+  }
+
+  memcpy(ntriples_parser->scratch, line, len);
+  ntriples_parser->scratch[len] = '\0';
+
+  rc = raptor_ntriples_parse_line(rdf_parser, ntriples_parser->scratch, len,
+                                  ntriples_parser->is_nquads ? 4 : 3);
+  if(ntriples_parser->arena)
+    raptor_term_arena_reset(ntriples_parser->arena);
+
+  return rc;
+}
+
+
+#ifdef RAPTOR_NTRIPLES_PARALLEL
+/*
+ * Parallel parsing of one buffer
+ *
+ * The calling thread splits the content into blocks of whole lines
+ * with raptor_ntriples_line_end(), the same way
+ * raptor_ntriples_parse_buffer() does, so every line keeps its
+ * document line number.  Worker threads scan the lines of each block
+ * into tokens with raptor_ntriples_scan_term(), which needs no world
+ * and reports nothing.  The calling thread then makes terms from the
+ * tokens and returns the statements, either in document order or in
+ * the order the blocks finish.  Lines that cannot be scanned, such as
+ * ones with escapes or errors, are parsed on the calling thread by
+ * raptor_ntriples_parse_line() so they give the same statements,
+ * errors and warnings as parsing without threads.  Blank node IDs
+ * are used as written in the document so they are shared between
+ * blocks.
+ *
+ * If the world is thread-safe (RAPTOR_WORLD_FLAG_THREAD_SAFE) and
+ * no statement arena is used, the workers also make the terms,
+ * leaving the calling thread only returning statements.
+ */
+
+/* most content in a block */
+#define RAPTOR_NTRIPLES_BLOCK_SIZE (1 << 20)
+
+/* most worker threads */
+#define RAPTOR_NTRIPLES_MAX_THREADS 64
+
+typedef enum {
+  /* blank or comment line */
+  RAPTOR_NTRIPLES_LINE_EMPTY,
+  /* statement scanned into tokens */
+  RAPTOR_NTRIPLES_LINE_TOKENS,
+  /* use raptor_ntriples_parse_line() */
+  RAPTOR_NTRIPLES_LINE_PARSE
+} raptor_ntriples_line_kind;
+
+typedef struct {
+  const unsigned char *start;
+  size_t length;
+  /* locator line and byte of the start of the line */
+  int line;
+  int byte;
+  raptor_ntriples_line_kind kind;
+  int tokens_count;
+  raptor_ntriples_token tokens[MAX_NTRIPLES_TERMS];
+  /* terms made by a worker or NULL */
+  raptor_term* terms[MAX_NTRIPLES_TERMS];
+} raptor_ntriples_line;
+
+typedef enum {
+  RAPTOR_NTRIPLES_BLOCK_FREE,
+  RAPTOR_NTRIPLES_BLOCK_QUEUED,
+  RAPTOR_NTRIPLES_BLOCK_SCANNING,
+  RAPTOR_NTRIPLES_BLOCK_SCANNED
+} raptor_ntriples_block_state;
+
+typedef struct {
+  raptor_ntriples_block_state state;
+  /* position of block in the content */
+  unsigned long sequence;
+  raptor_ntriples_line *lines;
+  int lines_count;
+  int lines_size;
+} raptor_ntriples_block;
+
+typedef struct {
+  raptor_world* world;
+  int is_nquads;
+  /* non-0 if workers make terms from the tokens */
+  int make_terms;
+
+  /* protects block states and finished */
+  pthread_mutex_t lock;
+  /* signalled when a block is queued or when finished */
+  pthread_cond_t queued_cond;
+  /* signalled when a block is scanned */
+  pthread_cond_t scanned_cond;
+
+  raptor_ntriples_block *blocks;
+  int blocks_count;
+
+  /* non-0 when workers should exit */
+  int finished;
+
+  /* splitting state: the next line number, byte and previous
+   * line end character */
+  int line;
+  int byte;
+  char last_char;
+} raptor_ntriples_pool;
+
+
+/*
+ * raptor_ntriples_scan_line:
+ * @line: line
+ * @is_nquads: non-0 for N-Quads
+ *
+ * INTERNAL - Scan a line into tokens the way raptor_ntriples_parse_line() parses it
+ *
+ * Return value: kind of line
+ */
+static raptor_ntriples_line_kind
+raptor_ntriples_scan_line(raptor_ntriples_line* line, int is_nquads)
+{
+  const unsigned char *p = line->start;
+  const unsigned char *end = p + line->length;
+  int max_terms = is_nquads ? 4 : 3;
+  int i;
+
+  /* a NUL would end a term early in raptor_ntriples_parse_term() */
+  if(memchr(p, '\0', line->length))
+    return RAPTOR_NTRIPLES_LINE_PARSE;
+
+  while(p < end && isspace((int)*p))
+    p++;
+
+  if(p == end || *p == '#')
+    return RAPTOR_NTRIPLES_LINE_EMPTY;
+
+  while(isspace((int)end[-1]))
+    end--;
+
+  for(i = 0; i < max_terms; i++) {
+    size_t term_len;
+
+    if(p == end) {
+      /* graph is optional in N-Quads */
+      if(i == 3)
+        break;
+      return RAPTOR_NTRIPLES_LINE_PARSE;
+    }
+
+    if(!(*p == '<' ||
+         (*p == '_' && i != 1) ||
+         (*p == '"' && i == 2)))
+      return RAPTOR_NTRIPLES_LINE_PARSE;
+
+    term_len = raptor_ntriples_scan_term(p, end - p, &line->tokens[i]);
+    if(!term_len)
+      return RAPTOR_NTRIPLES_LINE_PARSE;
+    p += term_len;
+
+    while(p < end && isspace((int)*p))
+      p++;
+
+    if(p < end && *p == '.') {
+      p++;
+      while(p < end && isspace((int)*p))
+        p++;
+
+      /* Only a comment is allowed here */
+      if(p < end && *p != '#')
+        return RAPTOR_NTRIPLES_LINE_PARSE;
+      p = end;
+    }
+  }
+
+  /* too many terms */
+  if(p != end)
+    return RAPTOR_NTRIPLES_LINE_PARSE;
+
+  line->tokens_count = i;
+  return RAPTOR_NTRIPLES_LINE_TOKENS;
+}
+
+
+/*
+ * raptor_ntriples_token_term:
+ * @world: world
+ * @arena: statement arena or NULL
+ * @token: token
+ *
+ * INTERNAL - Make a term from a scanned token
+ *
+ * Return value: new term or NULL on failure
+ */
+static raptor_term*
+raptor_ntriples_token_term(raptor_world* world, raptor_term_arena* arena,
+                           const raptor_ntriples_token* token)
+{
+  raptor_term* term = NULL;
+  raptor_uri* uri = NULL;
+  unsigned char language[256];
+  unsigned char* language_p = NULL;
+  int i;
+
+  switch(token->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      uri = raptor_new_uri_from_counted_string(world, token->string,
+                                               token->length);
+      if(!uri)
+        break;
+      if(arena)
+        term = raptor_term_arena_new_uri(arena, uri);
+      else
+        term = raptor_new_term_from_uri(world, uri);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      if(token->datatype) {
+        uri = raptor_new_uri_from_counted_string(world, token->datatype,
+                                                 token->datatype_len);
+        if(!uri)
+          break;
+      }
+
+      if(token->language) {
+        /* Normalize language to lowercase as raptor_ntriples_parse_term() */
+        for(i = 0; i < token->language_len; i++) {
+          unsigned char c = token->language[i];
+
+          if(c >= 'A' && c <= 'Z')
+            c = RAPTOR_GOOD_CAST(unsigned char, c - 'A' + 'a');
+          else if(c == '_')
+            c = '-';
+          language[i] = c;
+        }
+        language[i] = '\0';
+        language_p = language;
+      }
+
+      if(arena)
+        term = raptor_term_arena_new_literal(arena,
+                                             token->string, token->length,
+                                             uri, language_p,
+                                             token->language_len);
+      else
+        term = raptor_new_term_from_counted_literal(world,
+                                                    token->string,
+                                                    token->length,
+                                                    uri, language_p,
+                                                    token->language_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      if(arena)
+        term = raptor_term_arena_new_blank(arena, token->string,
+                                           token->length);
+      else
+        term = raptor_new_term_from_counted_blank(world, token->string,
+                                                  token->length);
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      break;
+  }
+
+  if(uri)
+    raptor_free_uri(uri);
+
+  return term;
+}
+
+
+static void*
+raptor_ntriples_scan_worker(void* arg)
+{
+  raptor_ntriples_pool* pool = (raptor_ntriples_pool*)arg;
+
+  pthread_mutex_lock(&pool->lock);
+  while(!pool->finished) {
+    raptor_ntriples_block* block = NULL;
+    int i;
+
+    /* take the earliest queued block */
+    for(i = 0; i < pool->blocks_count; i++) {
+      raptor_ntriples_block* b = &pool->blocks[i];
+
+      if(b->state == RAPTOR_NTRIPLES_BLOCK_QUEUED &&
+         (!block || b->sequence < block->sequence))
+        block = b;
+    }
+
+    if(!block) {
+      pthread_cond_wait(&pool->queued_cond, &pool->lock);
+      continue;
+    }
+
+    block->state = RAPTOR_NTRIPLES_BLOCK_SCANNING;
+    pthread_mutex_unlock(&pool->lock);
+
+    for(i = 0; i < block->lines_count; i++) {
+      raptor_ntriples_line* line = &block->lines[i];
+
+      line->kind = raptor_ntriples_scan_line(line, pool->is_nquads);
+
+      if(line->kind == RAPTOR_NTRIPLES_LINE_TOKENS && pool->make_terms) {
+        int j;
+
+        for(j = 0; j < line->tokens_count; j++) {
+          line->terms[j] = raptor_ntriples_token_term(pool->world, NULL,
+                                                      &line->tokens[j]);
+          if(!line->terms[j]) {
+            /* leave it to the calling thread to report */
+            while(--j >= 0) {
+              raptor_free_term(line->terms[j]);
+              line->terms[j] = NULL;
+            }
+            line->kind = RAPTOR_NTRIPLES_LINE_PARSE;
+            break;
+          }
+        }
+      }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    block->state = RAPTOR_NTRIPLES_BLOCK_SCANNED;
+    pthread_cond_signal(&pool->scanned_cond);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+
+/*
+ * raptor_ntriples_split_block:
+ * @pool: parallel parse state
+ * @block: free block
+ * @ptr_p: pointer to the start of the content to split (in/out)
+ * @end_ptr: end of content
+ * @block_size: content size to split after
+ *
+ * INTERNAL - Fill a block with the next whole lines of the content
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_ntriples_split_block(raptor_ntriples_pool* pool,
+                            raptor_ntriples_block* block,
+                            const unsigned char **ptr_p,
+                            const unsigned char *end_ptr,
+                            size_t block_size)
+{
+  const unsigned char *ptr = *ptr_p;
+  const unsigned char *block_end = ptr + block_size;
+
+  if(block_end > end_ptr)
+    block_end = end_ptr;
+
+  block->lines_count = 0;
+
+  while(ptr < block_end) {
+    raptor_ntriples_line* line;
+
+    /* skip \n when just seen \r - i.e. \r\n or CR LF */
+    if(pool->last_char == '\r' && *ptr == '\n') {
+      ptr++;
+      pool->byte++;
+      pool->last_char = '\0';
+      continue;
+    }
+
+    if(block->lines_count == block->lines_size) {
+      int new_size = block->lines_size ? (block->lines_size << 1) : 1024;
+      raptor_ntriples_line* new_lines;
+
+      new_lines = RAPTOR_REALLOC(raptor_ntriples_line*, block->lines,
+                                 sizeof(*new_lines) * RAPTOR_GOOD_CAST(size_t, new_size));
+      if(!new_lines)
+        return 1;
+      block->lines = new_lines;
+      block->lines_size = new_size;
+    }
+
+    line = &block->lines[block->lines_count++];
+    memset(line->terms, '\0', sizeof(line->terms));
+    line->start = ptr;
+    line->line = pool->line;
+    line->byte = pool->byte;
+
+    ptr = raptor_ntriples_line_end(ptr, end_ptr);
+    pool->last_char = (char)((ptr < end_ptr) ? *ptr : '\0');
+    line->length = ptr - line->start;
+
+    pool->line++;
+    pool->byte += RAPTOR_BAD_CAST(int, line->length);
+
+    /* go past newline */
+    if(ptr < end_ptr) {
+      ptr++;
+      pool->byte++;
+    }
+  }
+
+  *ptr_p = ptr;
+
+  return 0;
+}
+
+
+/*
+ * raptor_ntriples_parse_block:
+ * @rdf_parser: parser
+ * @block: scanned block
+ *
+ * INTERNAL - Return the statements of a scanned block
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_ntriples_parse_block(raptor_parser* rdf_parser,
+                            raptor_ntriples_block* block)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+  int i;
+
+  for(i = 0; i < block->lines_count; i++) {
+    raptor_ntriples_line* line = &block->lines[i];
+    raptor_term* terms[MAX_NTRIPLES_TERMS] = {NULL, NULL, NULL, NULL};
+    int j;
+
+    if(line->kind == RAPTOR_NTRIPLES_LINE_EMPTY)
+      continue;
+
+    rdf_parser->locator.line = line->line;
+    rdf_parser->locator.column = 0;
+    rdf_parser->locator.byte = line->byte;
+
+    if(line->kind == RAPTOR_NTRIPLES_LINE_PARSE) {
+      if(raptor_ntriples_parse_line_copy(rdf_parser, line->start,
+                                         line->length))
+        return 1;
+      continue;
+    }
+
+    if(line->terms[0]) {
+      /* made by a worker */
+      memcpy(terms, line->terms, sizeof(terms));
+      memset(line->terms, '\0', sizeof(line->terms));
+      j = line->tokens_count;
+    } else
+      j = 0;
+
+    for(; j < line->tokens_count; j++) {
+      terms[j] = raptor_ntriples_token_term(rdf_parser->world,
+                                            ntriples_parser->arena,
+                                            &line->tokens[j]);
+      if(!terms[j]) {
+        while(--j >= 0)
+          raptor_free_term(terms[j]);
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+        return 1;
+      }
+    }
+
+    raptor_ntriples_generate_statement(rdf_parser, terms[0], terms[1],
+                                       terms[2], terms[3]);
+    if(ntriples_parser->arena)
+      raptor_term_arena_reset(ntriples_parser->arena);
+  }
+
+  return 0;
+}
+
+
+/*
+ * raptor_ntriples_parse_buffer_parallel:
+ * @rdf_parser: parser
+ * @buffer: read-only content
+ * @len: length of @buffer
+ *
+ * INTERNAL - Parse all N-Triples / N-Quads content in one buffer with threads
+ *
+ * Return value: non 0 on failure, <0 if no threads could be started
+ */
+static int
+raptor_ntriples_parse_buffer_parallel(raptor_parser* rdf_parser,
+                                      const unsigned char *buffer,
+                                      size_t len)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+  raptor_ntriples_pool pool;
+  pthread_t workers[RAPTOR_NTRIPLES_MAX_THREADS];
+  int workers_count = 0;
+  int threads;
+  int unordered;
+  const unsigned char *ptr = buffer;
+  const unsigned char *end_ptr = buffer + len;
+  size_t block_size;
+  unsigned long queued = 0;
+  unsigned long parsed = 0;
+  int rc = 0;
+  int i;
+
+  threads = RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser, RAPTOR_OPTION_PARSE_THREADS);
+  if(threads > RAPTOR_NTRIPLES_MAX_THREADS)
+    threads = RAPTOR_NTRIPLES_MAX_THREADS;
+  unordered = RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser,
+                                         RAPTOR_OPTION_PARSE_UNORDERED);
+
+  /* give every thread a block of small content */
+  block_size = len / RAPTOR_GOOD_CAST(size_t, threads) + 1;
+  if(block_size > RAPTOR_NTRIPLES_BLOCK_SIZE)
+    block_size = RAPTOR_NTRIPLES_BLOCK_SIZE;
+
+  memset(&pool, '\0', sizeof(pool));
+  pool.world = rdf_parser->world;
+  pool.is_nquads = ntriples_parser->is_nquads;
+  pool.make_terms = rdf_parser->world->thread_safe && !ntriples_parser->arena;
+  pool.line = rdf_parser->locator.line;
+  pool.byte = rdf_parser->locator.byte;
+  pool.last_char = ntriples_parser->last_char;
+
+  /* enough blocks to keep the workers busy while others are returned */
+  pool.blocks_count = threads * 2;
+  pool.blocks = RAPTOR_CALLOC(raptor_ntriples_block*,
+                              RAPTOR_GOOD_CAST(size_t, pool.blocks_count),
+                              sizeof(raptor_ntriples_block));
+  if(!pool.blocks) {
+    raptor_parser_fatal_error(rdf_parser, "Out of memory");
+    return 1;
+  }
+
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_cond_init(&pool.queued_cond, NULL);
+  pthread_cond_init(&pool.scanned_cond, NULL);
+
+  for(i = 0; i < threads; i++) {
+    if(pthread_create(&workers[workers_count], NULL,
+                      raptor_ntriples_scan_worker, &pool))
+      break;
+    workers_count++;
+  }
+
+  if(!workers_count) {
+    rc = -1;
+    goto tidy;
+  }
+
+  pthread_mutex_lock(&pool.lock);
+  while(1) {
+    raptor_ntriples_block* block = NULL;
+
+    if(ptr < end_ptr) {
+      for(i = 0; i < pool.blocks_count; i++) {
+        if(pool.blocks[i].state == RAPTOR_NTRIPLES_BLOCK_FREE) {
+          block = &pool.blocks[i];
+          break;
+        }
+      }
+    }
+
+    if(block) {
+      /* split the next lines into a free block */
+      pthread_mutex_unlock(&pool.lock);
+      rc = raptor_ntriples_split_block(&pool, block, &ptr, end_ptr,
+                                       block_size);
+      pthread_mutex_lock(&pool.lock);
+      if(rc) {
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+        break;
+      }
+
+      block->sequence = queued++;
+      block->state = RAPTOR_NTRIPLES_BLOCK_QUEUED;
+      pthread_cond_signal(&pool.queued_cond);
+      continue;
+    }
+
+    if(parsed == queued && ptr == end_ptr)
+      break;
+
+    /* find the next block in order or any scanned block if unordered */
+    for(i = 0; i < pool.blocks_count; i++) {
+      raptor_ntriples_block* b = &pool.blocks[i];
+
+      if(b->state == RAPTOR_NTRIPLES_BLOCK_SCANNED &&
+         (unordered || b->sequence == parsed)) {
+        block = b;
+        break;
+      }
+    }
+
+    if(!block) {
+      pthread_cond_wait(&pool.scanned_cond, &pool.lock);
+      continue;
+    }
+
+    pthread_mutex_unlock(&pool.lock);
+    rc = raptor_ntriples_parse_block(rdf_parser, block);
+    pthread_mutex_lock(&pool.lock);
+    if(rc)
+      break;
+
+    block->state = RAPTOR_NTRIPLES_BLOCK_FREE;
+    parsed++;
+  }
+
+  pool.finished = 1;
+  pthread_cond_broadcast(&pool.queued_cond);
+  pthread_mutex_unlock(&pool.lock);
+
+  tidy:
+  for(i = 0; i < workers_count; i++)
+    pthread_join(workers[i], NULL);
+
+  pthread_cond_destroy(&pool.scanned_cond);
+  pthread_cond_destroy(&pool.queued_cond);
+  pthread_mutex_destroy(&pool.lock);
+
+  for(i = 0; i < pool.blocks_count; i++) {
+    raptor_ntriples_block* block = &pool.blocks[i];
+    int j;
+
+    if(!block->lines)
+      continue;
+
+    /* terms of lines not returned after a failure */
+    if(block->state == RAPTOR_NTRIPLES_BLOCK_SCANNED) {
+      for(j = 0; j < block->lines_count; j++) {
+        int k;
+
+        for(k = 0; k < MAX_NTRIPLES_TERMS; k++) {
+          if(block->lines[j].terms[k])
+            raptor_free_term(block->lines[j].terms[k]);
+        }
+      }
+    }
+    RAPTOR_FREE(raptor_ntriples_line*, block->lines);
+  }
+  RAPTOR_FREE(raptor_ntriples_block*, pool.blocks);
+
+  if(rc)
+    return rc;
+
+  rdf_parser->locator.line = pool.line;
+  rdf_parser->locator.column = 0;
+  rdf_parser->locator.byte = pool.byte;
+  ntriples_parser->last_char = pool.last_char;
+
+  if(rdf_parser->emitted_default_graph) {
+    raptor_parser_end_graph(rdf_parser, NULL, 0);
+    rdf_parser->emitted_default_graph--;
+  }
+
+  return 0;
+}
+#endif
+
+
+/*
+ * raptor_ntriples_parse_buffer:
+ * @rdf_parser: parser
+ * @buffer: read-only content
+ * @len: length of @buffer
+ *
+ * INTERNAL - Parse all N-Triples / N-Quads content in one buffer
+ *
+ * Used for memory mapped files so the content is never gathered into
+ * the growing chunk buffer.  With #RAPTOR_OPTION_PARSE_THREADS the
+ * lines are scanned by several threads.
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_ntriples_parse_buffer(raptor_parser* rdf_parser,
+                             const unsigned char *buffer, size_t len)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+  const unsigned char *ptr = buffer;
+  const unsigned char *end_ptr = buffer + len;
+
+#ifdef RAPTOR_NTRIPLES_PARALLEL
+  if(RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser, RAPTOR_OPTION_PARSE_THREADS) > 1) {
+    int rc = raptor_ntriples_parse_buffer_parallel(rdf_parser, buffer, len);
+
+    /* <0 if no threads could be started */
+    if(rc >= 0)
+      return rc;
+  }
+#endif
+
+  while(ptr < end_ptr) {
+    const unsigned char *line_start;
+    size_t line_len;
+
+    /* skip \n when just seen \r - i.e. \r\n or CR LF */
+    if(ntriples_parser->last_char == '\r' && *ptr == '\n') {
+      ptr++;
+      rdf_parser->locator.byte++;
+      rdf_parser->locator.column = 0;
+      ntriples_parser->last_char = '\0';
+      continue;
+    }
+
+    line_start = ptr;
+    ptr = raptor_ntriples_line_end(ptr, end_ptr);
+    ntriples_parser->last_char = (char)((ptr < end_ptr) ? *ptr : '\0');
+
+    line_len = ptr - line_start;
+    rdf_parser->locator.column = 0;
+
+    if(raptor_ntriples_parse_line_copy(rdf_parser, line_start, line_len))
+      return 1;
+
+    rdf_parser->locator.line++;
+
+    /* go past newline */
+    if(ptr < end_ptr) {
+      ptr++;
+      rdf_parser->locator.byte++;
+    }
+  }
+
+  if(rdf_parser->emitted_default_graph) {
+    raptor_parser_end_graph(rdf_parser, NULL, 0);
+    rdf_parser->emitted_default_graph--;
+  }
+
+  return 0;
+}
+
+
 static int
 raptor_ntriples_parse_start(raptor_parser* rdf_parser) 
 {
@@ -577,11 +1434,39 @@ raptor_ntriples_parse_start(raptor_parser* rdf_parser)
   locator->byte = 0;
 
   ntriples_parser->last_char = '\0';
+  ntriples_parser->line_length = 0;
+  ntriples_parser->offset = 0;
+
+  if(RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser, RAPTOR_OPTION_STATEMENT_ARENA)) {
+    if(!ntriples_parser->arena) {
+      ntriples_parser->arena = raptor_new_term_arena(rdf_parser->world);
+      if(!ntriples_parser->arena)
+        return 1;
+    }
+  } else if(ntriples_parser->arena) {
+    raptor_free_term_arena(ntriples_parser->arena);
+    ntriples_parser->arena = NULL;
+  }
 
   return 0;
 }
 
 
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+void
+raptor_ntriples_parser_stats_print(raptor_parser* rdf_parser, FILE *stream)
+{
+  raptor_ntriples_parser_context *ntriples_parser = (raptor_ntriples_parser_context*)rdf_parser->context;
+
+  fprintf(stream,
+          "line buffer size: %ld allocs: %d moves: %d moved bytes: %ld\n",
+          (long)ntriples_parser->line_size, ntriples_parser->buffer_allocs,
+          ntriples_parser->buffer_moves,
+          (long)ntriples_parser->buffer_moved_bytes);
+}
+#endif
+
+
 #if defined RAPTOR_PARSER_NTRIPLES || defined RAPTOR_PARSER_NQUADS
 static int
 raptor_ntriples_parse_recognise_syntax(raptor_parser_factory* factory, 
@@ -695,6 +1580,7 @@ raptor_ntriples_parser_register_factory(raptor_parser_factory *factory)
   factory->terminate = raptor_ntriples_parse_terminate;
   factory->start     = raptor_ntriples_parse_start;
   factory->chunk     = raptor_ntriples_parse_chunk;
+  factory->parse_buffer = raptor_ntriples_parse_buffer;
   factory->recognise_syntax = raptor_ntriples_parse_recognise_syntax;
 
   return rc;
@@ -784,6 +1670,7 @@ raptor_nquads_parser_register_factory(raptor_parser_factory *factory)
   factory->terminate = raptor_ntriples_parse_terminate;
   factory->start     = raptor_ntriples_parse_start;
   factory->chunk     = raptor_ntriples_parse_chunk;
+  factory->parse_buffer = raptor_ntriples_parse_buffer;
   factory->recognise_syntax = raptor_nquads_parse_recognise_syntax;
 
   return rc;
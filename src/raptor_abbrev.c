@@ -51,6 +51,29 @@
 
 static raptor_abbrev_subject* raptor_new_abbrev_subject(raptor_abbrev_node* node);
 
+#define RAPTOR_ABBREV_NODE_BLOCK_SIZE 256
+#define RAPTOR_ABBREV_TABLE_INITIAL_SIZE 256
+
+typedef struct raptor_abbrev_node_block_s {
+  struct raptor_abbrev_node_block_s* next;
+  raptor_abbrev_node nodes[RAPTOR_ABBREV_NODE_BLOCK_SIZE];
+} raptor_abbrev_node_block;
+
+struct raptor_abbrev_node_table_s {
+  raptor_world* world;
+
+  /* hash chains of size @size (a power of 2) */
+  raptor_abbrev_node** buckets;
+  unsigned int size;
+  unsigned int count;
+
+  /* node storage: blocks (most recent first) and recycled nodes */
+  raptor_abbrev_node_block* blocks;
+  unsigned int block_used;
+  raptor_abbrev_node* free_nodes;
+};
+
+
 /**
  * raptor_new_abbrev_node:
  * @world: raptor world
@@ -98,6 +121,14 @@ raptor_free_abbrev_node(raptor_abbrev_node* node)
   if(node->term)
     raptor_free_term(node->term);
 
+  if(node->table) {
+    /* return pooled storage to the owning table */
+    node->term = NULL;
+    node->next = node->table->free_nodes;
+    node->table->free_nodes = node;
+    return;
+  }
+
   RAPTOR_FREE(raptor_abbrev_node, node);
 }
 
@@ -141,42 +172,275 @@ raptor_abbrev_node_equals(raptor_abbrev_node* node1, raptor_abbrev_node* node2)
 }
 
 
+/*
+ * raptor_abbrev_node_table implementation
+ *
+ * Hash index of unique nodes keyed on term identity.  Node storage is
+ * carved out of fixed-size blocks and recycled through a free list
+ * so that steady-state lookups and removals do not touch malloc.
+ *
+ */
+
+static unsigned int
+raptor_abbrev_hash_bytes(unsigned int hash, const unsigned char* string,
+                         size_t length)
+{
+  while(length--) {
+    hash ^= *string++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+/*
+ * raptor_abbrev_term_hash:
+ * @term: term
+ *
+ * INTERNAL - Hash a term consistently with raptor_term_equals()
+ *
+ * URIs reuse the hash computed when the URI was constructed.
+ *
+ * Return value: hash value
+ */
+static unsigned int
+raptor_abbrev_term_hash(raptor_term* term)
+{
+  unsigned int hash = 2166136261U;
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      hash = raptor_uri_get_hash(term->value.uri);
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      hash = raptor_abbrev_hash_bytes(hash, term->value.blank.string,
+                                      term->value.blank.string_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      hash = raptor_abbrev_hash_bytes(hash, term->value.literal.string,
+                                      term->value.literal.string_len);
+      if(term->value.literal.datatype)
+        hash = (hash ^ raptor_uri_get_hash(term->value.literal.datatype))
+               * 16777619U;
+      if(term->value.literal.language)
+        hash = raptor_abbrev_hash_bytes(hash, term->value.literal.language,
+                                        term->value.literal.language_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      break;
+  }
+
+  return hash;
+}
+
+
+/**
+ * raptor_new_abbrev_node_table:
+ * @world: raptor world
+ *
+ * INTERNAL - Constructor for a hash table of unique raptor_abbrev_node
+ *
+ * Return value: new node table or NULL on failure
+ **/
+raptor_abbrev_node_table*
+raptor_new_abbrev_node_table(raptor_world* world)
+{
+  raptor_abbrev_node_table* nodes;
+
+  nodes = RAPTOR_CALLOC(raptor_abbrev_node_table*, 1, sizeof(*nodes));
+  if(!nodes)
+    return NULL;
+
+  nodes->world = world;
+  nodes->size = RAPTOR_ABBREV_TABLE_INITIAL_SIZE;
+  nodes->buckets = RAPTOR_CALLOC(raptor_abbrev_node**, nodes->size,
+                                 sizeof(raptor_abbrev_node*));
+  if(!nodes->buckets) {
+    RAPTOR_FREE(raptor_abbrev_node_table, nodes);
+    return NULL;
+  }
+
+  return nodes;
+}
+
+
+/**
+ * raptor_free_abbrev_node_table:
+ * @nodes: node table
+ *
+ * INTERNAL - Destructor for raptor_abbrev_node_table
+ *
+ * All subjects referring to nodes of this table must have been
+ * freed already since the node storage is released here.
+ **/
+void
+raptor_free_abbrev_node_table(raptor_abbrev_node_table* nodes)
+{
+  unsigned int i;
+
+  RAPTOR_ASSERT_OBJECT_POINTER_RETURN(nodes, raptor_abbrev_node_table);
+
+  for(i = 0; i < nodes->size; i++) {
+    raptor_abbrev_node* node = nodes->buckets[i];
+    while(node) {
+      raptor_abbrev_node* next = node->next;
+      raptor_free_abbrev_node(node);
+      node = next;
+    }
+  }
+  RAPTOR_FREE(raptor_abbrev_node**, nodes->buckets);
+
+  while(nodes->blocks) {
+    raptor_abbrev_node_block* next = nodes->blocks->next;
+    RAPTOR_FREE(raptor_abbrev_node_block, nodes->blocks);
+    nodes->blocks = next;
+  }
+
+  RAPTOR_FREE(raptor_abbrev_node_table, nodes);
+}
+
+
+static raptor_abbrev_node*
+raptor_abbrev_node_table_alloc(raptor_abbrev_node_table* nodes)
+{
+  raptor_abbrev_node* node;
+
+  if(nodes->free_nodes) {
+    node = nodes->free_nodes;
+    nodes->free_nodes = node->next;
+  } else {
+    if(!nodes->blocks || nodes->block_used == RAPTOR_ABBREV_NODE_BLOCK_SIZE) {
+      raptor_abbrev_node_block* block;
+
+      block = RAPTOR_MALLOC(raptor_abbrev_node_block*, sizeof(*block));
+      if(!block)
+        return NULL;
+      block->next = nodes->blocks;
+      nodes->blocks = block;
+      nodes->block_used = 0;
+    }
+    node = &nodes->blocks->nodes[nodes->block_used++];
+  }
+
+  memset(node, '\0', sizeof(*node));
+  node->table = nodes;
+
+  return node;
+}
+
+
+static int
+raptor_abbrev_node_table_grow(raptor_abbrev_node_table* nodes)
+{
+  raptor_abbrev_node** buckets;
+  unsigned int size = nodes->size << 1;
+  unsigned int i;
+
+  buckets = RAPTOR_CALLOC(raptor_abbrev_node**, size,
+                          sizeof(raptor_abbrev_node*));
+  if(!buckets)
+    return 1;
+
+  for(i = 0; i < nodes->size; i++) {
+    raptor_abbrev_node* node = nodes->buckets[i];
+    while(node) {
+      raptor_abbrev_node* next = node->next;
+      unsigned int bucket = node->hash & (size - 1);
+      node->next = buckets[bucket];
+      buckets[bucket] = node;
+      node = next;
+    }
+  }
+
+  RAPTOR_FREE(raptor_abbrev_node**, nodes->buckets);
+  nodes->buckets = buckets;
+  nodes->size = size;
+
+  return 0;
+}
+
+
 /**
  * raptor_abbrev_node_lookup:
- * @nodes: Tree of nodes to search
- * @node: Node value to search for
+ * @nodes: Table of nodes to search
+ * @term: Term value to search for
  *
- * INTERNAL - Look in an avltree of nodes for a node described by parameters
- *   and if present create it, add it and return it
+ * INTERNAL - Look in a table of nodes for a node with the given term
+ *   and if not present create it, add it and return it
+ *
+ * The table holds one reference to each node it contains.
  *
  * Return value: the node found/created or NULL on failure
  */
 raptor_abbrev_node* 
-raptor_abbrev_node_lookup(raptor_avltree* nodes, raptor_term* term)
+raptor_abbrev_node_lookup(raptor_abbrev_node_table* nodes, raptor_term* term)
 {
-  raptor_abbrev_node *lookup_node;
-  raptor_abbrev_node *rv_node;
+  raptor_abbrev_node *node;
+  unsigned int hash;
+  unsigned int bucket;
 
-  /* Create a temporary node for search comparison. */
-  lookup_node = raptor_new_abbrev_node(term->world, term);
-  
-  if(!lookup_node)
+  if(term->type == RAPTOR_TERM_TYPE_UNKNOWN)
     return NULL;
 
-  rv_node = (raptor_abbrev_node*)raptor_avltree_search(nodes, lookup_node);
-  
-  /* If not found, insert/return a new one */
-  if(!rv_node) {
-    
-    if(raptor_avltree_add(nodes, lookup_node))
+  hash = raptor_abbrev_term_hash(term);
+  bucket = hash & (nodes->size - 1);
+
+  for(node = nodes->buckets[bucket]; node; node = node->next) {
+    if(node->hash == hash && raptor_term_equals(node->term, term))
+      return node;
+  }
+
+  /* Not found - insert/return a new one */
+  if(nodes->count >= nodes->size) {
+    if(raptor_abbrev_node_table_grow(nodes))
       return NULL;
-    else
-      return lookup_node;
+    bucket = hash & (nodes->size - 1);
+  }
 
-  /* Found */
-  } else {
-    raptor_free_abbrev_node(lookup_node);
-    return rv_node;
+  node = raptor_abbrev_node_table_alloc(nodes);
+  if(!node)
+    return NULL;
+
+  node->world = nodes->world;
+  node->ref_count = 1;
+  node->hash = hash;
+  node->term = raptor_term_copy(term);
+
+  node->next = nodes->buckets[bucket];
+  nodes->buckets[bucket] = node;
+  nodes->count++;
+
+  return node;
+}
+
+
+/**
+ * raptor_abbrev_node_table_remove:
+ * @nodes: Table of nodes
+ * @node: node to remove
+ *
+ * INTERNAL - Remove a node from the table and drop the table's reference
+ */
+void
+raptor_abbrev_node_table_remove(raptor_abbrev_node_table* nodes,
+                                raptor_abbrev_node* node)
+{
+  raptor_abbrev_node** prev;
+
+  for(prev = &nodes->buckets[node->hash & (nodes->size - 1)];
+      *prev; prev = &(*prev)->next) {
+    if(*prev == node) {
+      *prev = node->next;
+      node->next = NULL;
+      nodes->count--;
+      raptor_free_abbrev_node(node);
+      return;
+    }
   }
 }
 
@@ -355,6 +619,14 @@ raptor_abbrev_subject_add_property(raptor_abbrev_subject* subject,
 {
   int err;
   raptor_abbrev_node** nodes;
+  raptor_abbrev_node* key[2];
+
+  key[0] = predicate;
+  key[1] = object;
+  if(raptor_avltree_search(subject->properties, key)) {
+    /* Already present - do not add a duplicate triple (s->[p o]) */
+    return 1;
+  }
   
   nodes = raptor_new_abbrev_po(predicate, object);
   if(!nodes)
@@ -363,12 +635,7 @@ raptor_abbrev_subject_add_property(raptor_abbrev_subject* subject,
   predicate->ref_count++;
   object->ref_count++;
 
-  if(raptor_avltree_search(subject->properties, nodes)) {
-    /* Already present - do not add a duplicate triple (s->[p o]) */
-    raptor_free_abbrev_po(nodes);
-    return 1;
-  }
-  
+
 #if 0
   fprintf(stderr, "Adding P,O ");
   raptor_print_abbrev_po(stderr, nodes);
@@ -401,65 +668,262 @@ raptor_abbrev_subject_compare(raptor_abbrev_subject* subject1,
 }
 
 
-/**
- * raptor_abbrev_subject_find:
- * @subjects: AVL-Tree of subject nodes
- * @term: node to find
+/*
+ * raptor_abbrev_subject_table implementation
  *
- * INTERNAL - Find a subject node in an AVL-Tree of subject nodes
+ * Hash index of subjects keyed on the hash of the subject node.
+ * Ordering is only needed when subjects are written so it is done
+ * once at that point by raptor_abbrev_subject_table_sorted().
  *
- * Return value: node or NULL if not found or failure
  */
-raptor_abbrev_subject*
-raptor_abbrev_subject_find(raptor_avltree *subjects, raptor_term* node)
+
+struct raptor_abbrev_subject_table_s {
+  /* hash chains of size @size (a power of 2) */
+  raptor_abbrev_subject** buckets;
+  unsigned int size;
+  unsigned int count;
+};
+
+
+/**
+ * raptor_new_abbrev_subject_table:
+ *
+ * INTERNAL - Constructor for a hash table of raptor_abbrev_subject
+ *
+ * Return value: new subject table or NULL on failure
+ **/
+raptor_abbrev_subject_table*
+raptor_new_abbrev_subject_table(void)
 {
-  raptor_abbrev_subject* rv_subject = NULL;
-  raptor_abbrev_node* lookup_node = NULL;
-  raptor_abbrev_subject* lookup = NULL;
+  raptor_abbrev_subject_table* subjects;
 
-  /* datatype and language are both NULL for a subject node */
-  
-  lookup_node = raptor_new_abbrev_node(node->world, node);
-  if(!lookup_node)
+  subjects = RAPTOR_CALLOC(raptor_abbrev_subject_table*, 1, sizeof(*subjects));
+  if(!subjects)
     return NULL;
-  
-  lookup = raptor_new_abbrev_subject(lookup_node);
-  if(!lookup) {
-    raptor_free_abbrev_node(lookup_node);
+
+  subjects->size = RAPTOR_ABBREV_TABLE_INITIAL_SIZE;
+  subjects->buckets = RAPTOR_CALLOC(raptor_abbrev_subject**, subjects->size,
+                                    sizeof(raptor_abbrev_subject*));
+  if(!subjects->buckets) {
+    RAPTOR_FREE(raptor_abbrev_subject_table, subjects);
     return NULL;
   }
 
-  rv_subject = (raptor_abbrev_subject*) raptor_avltree_search(subjects, lookup);
+  return subjects;
+}
 
-  raptor_free_abbrev_subject(lookup);
-  raptor_free_abbrev_node(lookup_node);
 
-  return rv_subject;
+/**
+ * raptor_free_abbrev_subject_table:
+ * @subjects: subject table
+ *
+ * INTERNAL - Destructor for raptor_abbrev_subject_table
+ *
+ * All subjects in the table are freed.
+ **/
+void
+raptor_free_abbrev_subject_table(raptor_abbrev_subject_table* subjects)
+{
+  unsigned int i;
+
+  RAPTOR_ASSERT_OBJECT_POINTER_RETURN(subjects, raptor_abbrev_subject_table);
+
+  for(i = 0; i < subjects->size; i++) {
+    raptor_abbrev_subject* subject = subjects->buckets[i];
+    while(subject) {
+      raptor_abbrev_subject* next = subject->next;
+      raptor_free_abbrev_subject(subject);
+      subject = next;
+    }
+  }
+
+  RAPTOR_FREE(raptor_abbrev_subject**, subjects->buckets);
+  RAPTOR_FREE(raptor_abbrev_subject_table, subjects);
+}
+
+
+/**
+ * raptor_abbrev_subject_table_size:
+ * @subjects: subject table
+ *
+ * INTERNAL - Get the number of subjects in a table
+ *
+ * Return value: number of subjects
+ **/
+int
+raptor_abbrev_subject_table_size(raptor_abbrev_subject_table* subjects)
+{
+  return RAPTOR_GOOD_CAST(int, subjects->count);
+}
+
+
+static int
+raptor_abbrev_subject_table_add(raptor_abbrev_subject_table* subjects,
+                                raptor_abbrev_subject* subject)
+{
+  unsigned int bucket;
+
+  if(subjects->count >= subjects->size) {
+    raptor_abbrev_subject** buckets;
+    unsigned int size = subjects->size << 1;
+    unsigned int i;
+
+    buckets = RAPTOR_CALLOC(raptor_abbrev_subject**, size,
+                            sizeof(raptor_abbrev_subject*));
+    if(!buckets)
+      return 1;
+
+    for(i = 0; i < subjects->size; i++) {
+      raptor_abbrev_subject* s = subjects->buckets[i];
+      while(s) {
+        raptor_abbrev_subject* next = s->next;
+        bucket = s->node->hash & (size - 1);
+        s->next = buckets[bucket];
+        buckets[bucket] = s;
+        s = next;
+      }
+    }
+
+    RAPTOR_FREE(raptor_abbrev_subject**, subjects->buckets);
+    subjects->buckets = buckets;
+    subjects->size = size;
+  }
+
+  bucket = subject->node->hash & (subjects->size - 1);
+  subject->next = subjects->buckets[bucket];
+  subjects->buckets[bucket] = subject;
+  subjects->count++;
+
+  return 0;
+}
+
+
+/**
+ * raptor_abbrev_subject_table_delete:
+ * @subjects: subject table
+ * @subject: subject to delete
+ *
+ * INTERNAL - Remove a subject from a table and free it
+ *
+ * Return value: non-0 if @subject was not in the table
+ **/
+int
+raptor_abbrev_subject_table_delete(raptor_abbrev_subject_table* subjects,
+                                   raptor_abbrev_subject* subject)
+{
+  raptor_abbrev_subject** prev;
+
+  for(prev = &subjects->buckets[subject->node->hash & (subjects->size - 1)];
+      *prev; prev = &(*prev)->next) {
+    if(*prev == subject) {
+      *prev = subject->next;
+      subjects->count--;
+      raptor_free_abbrev_subject(subject);
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+
+static int
+raptor_abbrev_subject_compare_ptr(const void* a, const void* b)
+{
+  return raptor_abbrev_subject_compare(*(raptor_abbrev_subject**)a,
+                                       *(raptor_abbrev_subject**)b);
+}
+
+
+/**
+ * raptor_abbrev_subject_table_sorted:
+ * @subjects: subject table
+ *
+ * INTERNAL - Get the subjects of a table in subject order for writing
+ *
+ * The returned sequence shares the subjects with the table and must
+ * be freed before any of them are deleted from it.
+ *
+ * Return value: new sequence or NULL on failure
+ **/
+raptor_sequence*
+raptor_abbrev_subject_table_sorted(raptor_abbrev_subject_table* subjects)
+{
+  raptor_sequence* seq;
+  unsigned int i;
+
+  seq = raptor_new_sequence(NULL, NULL);
+  if(!seq)
+    return NULL;
+
+  for(i = 0; i < subjects->size; i++) {
+    raptor_abbrev_subject* subject;
+    for(subject = subjects->buckets[i]; subject; subject = subject->next) {
+      if(raptor_sequence_push(seq, subject)) {
+        /* sequence is freed by push on failure */
+        return NULL;
+      }
+    }
+  }
+
+  raptor_sequence_sort(seq, raptor_abbrev_subject_compare_ptr);
+
+  return seq;
+}
+
+
+/**
+ * raptor_abbrev_subject_find:
+ * @subjects: Table of subject nodes
+ * @term: node to find
+ *
+ * INTERNAL - Find a subject node in a table of subject nodes
+ *
+ * Return value: node or NULL if not found
+ */
+raptor_abbrev_subject*
+raptor_abbrev_subject_find(raptor_abbrev_subject_table *subjects,
+                           raptor_term* node)
+{
+  raptor_abbrev_subject* subject;
+  unsigned int hash;
+
+  hash = raptor_abbrev_term_hash(node);
+
+  for(subject = subjects->buckets[hash & (subjects->size - 1)];
+      subject; subject = subject->next) {
+    if(subject->node->hash == hash &&
+       raptor_term_equals(subject->node->term, node))
+      return subject;
+  }
+
+  return NULL;
 }
 
 
 /**
  * raptor_abbrev_subject_lookup:
- * @nodes: AVL-Tree of subject nodes
- * @subjects: AVL-Tree of URI-subject nodes
- * @blanks: AVL-Tree of blank-subject nodes
+ * @nodes: Table of nodes
+ * @subjects: Table of URI-subject nodes
+ * @blanks: Table of blank-subject nodes
  * @term: node to find
  *
- * INTERNAL - Find a subject node in the appropriate uri/blank AVL-Tree of subject nodes or add it
+ * INTERNAL - Find a subject node in the appropriate uri/blank table of subject nodes or add it
  *
  * Return value: node or NULL on failure
  */
 raptor_abbrev_subject* 
-raptor_abbrev_subject_lookup(raptor_avltree* nodes,
-                             raptor_avltree* subjects, raptor_avltree* blanks,
+raptor_abbrev_subject_lookup(raptor_abbrev_node_table* nodes,
+                             raptor_abbrev_subject_table* subjects,
+                             raptor_abbrev_subject_table* blanks,
                              raptor_term* term)
 {
-  raptor_avltree *tree;
+  raptor_abbrev_subject_table *table;
   raptor_abbrev_subject* rv_subject;
 
   /* Search for specified resource. */
-  tree = (term->type == RAPTOR_TERM_TYPE_BLANK) ? blanks : subjects;
-  rv_subject = raptor_abbrev_subject_find(tree, term);
+  table = (term->type == RAPTOR_TERM_TYPE_BLANK) ? blanks : subjects;
+  rv_subject = raptor_abbrev_subject_find(table, term);
 
   /* If not found, create one and insert it */
   if(!rv_subject) {
@@ -467,7 +931,8 @@ raptor_abbrev_subject_lookup(raptor_avltree* nodes,
     if(node) {      
       rv_subject = raptor_new_abbrev_subject(node);
       if(rv_subject) {
-        if(raptor_avltree_add(tree, rv_subject)) {
+        if(raptor_abbrev_subject_table_add(table, rv_subject)) {
+          raptor_free_abbrev_subject(rv_subject);
           rv_subject = NULL;
         }
       }
@@ -478,31 +943,104 @@ raptor_abbrev_subject_lookup(raptor_avltree* nodes,
 }
 
 
-#ifdef ABBREV_DEBUG
+/**
+ * raptor_abbrev_subject_remove:
+ * @nodes: Table of nodes
+ * @subjects: Table of URI-subject nodes
+ * @blanks: Table of blank-subject nodes
+ * @subject: subject to remove
+ *
+ * INTERNAL - Remove and free a subject that has been written along with
+ * any nodes in @nodes that are no longer used by other subjects
+ */
 void
-raptor_print_subject(raptor_abbrev_subject* subject) 
+raptor_abbrev_subject_remove(raptor_abbrev_node_table* nodes,
+                             raptor_abbrev_subject_table* subjects,
+                             raptor_abbrev_subject_table* blanks,
+                             raptor_abbrev_subject* subject)
 {
+  raptor_sequence* used;
+  raptor_avltree_iterator* iter;
+  raptor_abbrev_node* node;
   int i;
-  unsigned char *subj;
-  unsigned char *pred;
-  unsigned char *obj;
-  raptor_avltree_iterator* iter = NULL;
 
-  /* Note: The raptor_abbrev_node field passed as the first argument for
-   * raptor_term_to_string() is somewhat arbitrary, since as
-   * the data structure is designed, the first word in the value union
-   * is what was passed as the subject/predicate/object of the
-   * statement.
-   */
-  subj = raptor_term_to_string(subject);
+  used = raptor_new_sequence(NULL, NULL);
+  if(!used)
+    return;
 
-  if(subject->type) {
-    obj = raptor_term_to_string(subject);
-    fprintf(stderr,"[%s, http://www.w3.org/1999/02/22-rdf-syntax-ns#type, %s]\n", subj, obj);      
-    RAPTOR_FREE(char*, obj);
+  /* hold a reference to each node so they survive the subject */
+  subject->node->ref_count++;
+  raptor_sequence_push(used, subject->node);
+
+  if(subject->node_type) {
+    subject->node_type->ref_count++;
+    raptor_sequence_push(used, subject->node_type);
   }
-  
-  for(i = 0; i < raptor_sequence_size(subject->elements); i++) {
+
+  for(i = 0; i < raptor_sequence_size(subject->list_items); i++) {
+    node = (raptor_abbrev_node*)raptor_sequence_get_at(subject->list_items, i);
+    if(node) {
+      node->ref_count++;
+      raptor_sequence_push(used, node);
+    }
+  }
+
+  iter = raptor_new_avltree_iterator(subject->properties, NULL, NULL, 1);
+  while(iter) {
+    raptor_abbrev_node** po;
+
+    po = (raptor_abbrev_node**)raptor_avltree_iterator_get(iter);
+    if(po) {
+      po[0]->ref_count++;
+      raptor_sequence_push(used, po[0]);
+      po[1]->ref_count++;
+      raptor_sequence_push(used, po[1]);
+    }
+    if(raptor_avltree_iterator_next(iter))
+      break;
+  }
+  if(iter)
+    raptor_free_avltree_iterator(iter);
+
+  raptor_abbrev_subject_table_delete((subject->node->term->type == RAPTOR_TERM_TYPE_BLANK) ?
+                                     blanks : subjects, subject);
+
+  /* drop nodes now only held by the nodes table */
+  while((node = (raptor_abbrev_node*)raptor_sequence_pop(used))) {
+    if(node->ref_count == 2)
+      raptor_abbrev_node_table_remove(nodes, node);
+    raptor_free_abbrev_node(node);
+  }
+
+  raptor_free_sequence(used);
+}
+
+
+#ifdef ABBREV_DEBUG
+void
+raptor_print_subject(raptor_abbrev_subject* subject) 
+{
+  int i;
+  unsigned char *subj;
+  unsigned char *pred;
+  unsigned char *obj;
+  raptor_avltree_iterator* iter = NULL;
+
+  /* Note: The raptor_abbrev_node field passed as the first argument for
+   * raptor_term_to_string() is somewhat arbitrary, since as
+   * the data structure is designed, the first word in the value union
+   * is what was passed as the subject/predicate/object of the
+   * statement.
+   */
+  subj = raptor_term_to_string(subject);
+
+  if(subject->type) {
+    obj = raptor_term_to_string(subject);
+    fprintf(stderr,"[%s, http://www.w3.org/1999/02/22-rdf-syntax-ns#type, %s]\n", subj, obj);      
+    RAPTOR_FREE(char*, obj);
+  }
+  
+  for(i = 0; i < raptor_sequence_size(subject->elements); i++) {
 
     raptor_abbrev_node* o = raptor_sequence_get_at(subject->elements, i);
     if(o) {
@@ -638,3 +1176,836 @@ raptor_new_qname_from_resource(raptor_sequence* namespaces,
 
   return qname;
 }
+
+
+/*
+ * raptor_abbrev_spill implementation
+ *
+ * Holds the statements given to an abbreviating serializer under a
+ * memory limit.  When the estimated size of the buffered statements
+ * passes the limit they are sorted and written as a run to a single
+ * temporary file, recording the offsets of the run.  Once
+ * RAPTOR_ABBREV_SPILL_MAX_RUNS runs of one level are written they are
+ * merged into one run of the next level, so the number of runs and the
+ * memory needed to merge them stay small.  Replaying returns the
+ * statements in the order they were added if nothing was spilled,
+ * otherwise merged in sorted order so that all statements about one
+ * subject are delivered together.
+ */
+
+/* most runs of one level kept before they are merged into one run */
+#define RAPTOR_ABBREV_SPILL_MAX_RUNS 64
+
+/* bytes written or read from the temporary file at a time */
+#define RAPTOR_ABBREV_SPILL_IO_SIZE 8192
+
+/* offsets in the temporary file, which may pass 2GB where long is
+ * 32 bits (LLP64 Windows and 32 bit systems) */
+#if defined(HAVE__FSEEKI64)
+typedef __int64 raptor_abbrev_spill_offset;
+#define raptor_abbrev_spill_seek(fh, offset) _fseeki64(fh, offset, SEEK_SET)
+#elif defined(HAVE_FSEEKO)
+typedef off_t raptor_abbrev_spill_offset;
+#define raptor_abbrev_spill_seek(fh, offset) fseeko(fh, offset, SEEK_SET)
+#else
+typedef long raptor_abbrev_spill_offset;
+#define raptor_abbrev_spill_seek(fh, offset) fseek(fh, offset, SEEK_SET)
+#endif
+
+typedef struct {
+  /* offsets of the run in the temporary file */
+  raptor_abbrev_spill_offset start;
+  raptor_abbrev_spill_offset end;
+
+  /* number of merges the statements in the run went through */
+  int level;
+} raptor_abbrev_spill_run;
+
+/* reading position in a run while merging */
+typedef struct {
+  /* offset of the next bytes to read and of the end of the run */
+  raptor_abbrev_spill_offset offset;
+  raptor_abbrev_spill_offset end;
+
+  unsigned char* buffer;
+  size_t buffer_len;
+  size_t buffer_pos;
+
+  /* next statement of the run or NULL at the end */
+  raptor_statement* head;
+} raptor_abbrev_spill_cursor;
+
+struct raptor_abbrev_spill_s {
+  raptor_world* world;
+
+  /* memory limit in bytes */
+  size_t limit;
+
+  /* estimated bytes used by @statements */
+  size_t size;
+
+  /* buffered statements */
+  raptor_sequence* statements;
+
+  /* temporary file holding all runs, created for the first run, and
+   * the offset of its end */
+  FILE* fh;
+  raptor_abbrev_spill_offset file_end;
+
+  /* runs in the order written; levels never increase along the array */
+  raptor_abbrev_spill_run* runs;
+  int runs_count;
+  int runs_size;
+
+  /* bytes waiting to be appended to the file */
+  unsigned char* out;
+  size_t out_len;
+
+  /* buffer for reading strings from runs */
+  unsigned char* buffer;
+  size_t buffer_size;
+
+  /* non-0 once writing or reading the file failed; the error is
+   * reported once and statements are refused until the next replay */
+  int failed;
+};
+
+
+/**
+ * raptor_new_abbrev_spill:
+ * @world: raptor world
+ * @limit: memory limit in bytes
+ *
+ * INTERNAL - Constructor for a statement spill with a memory limit
+ *
+ * Return value: new spill or NULL on failure
+ */
+raptor_abbrev_spill*
+raptor_new_abbrev_spill(raptor_world* world, size_t limit)
+{
+  raptor_abbrev_spill* spill;
+
+  spill = RAPTOR_CALLOC(raptor_abbrev_spill*, 1, sizeof(*spill));
+  if(!spill)
+    return NULL;
+
+  spill->world = world;
+  spill->limit = limit;
+  spill->statements =
+    raptor_new_sequence((raptor_data_free_handler)raptor_free_statement, NULL);
+  if(!spill->statements) {
+    raptor_free_abbrev_spill(spill);
+    return NULL;
+  }
+
+  return spill;
+}
+
+
+/* close and remove the temporary file and forget all runs */
+static void
+raptor_abbrev_spill_clear_runs(raptor_abbrev_spill* spill)
+{
+  if(spill->fh) {
+    fclose(spill->fh);
+    spill->fh = NULL;
+  }
+  spill->file_end = 0;
+  spill->runs_count = 0;
+  spill->out_len = 0;
+}
+
+
+/**
+ * raptor_free_abbrev_spill:
+ * @spill: spill
+ *
+ * INTERNAL - Destructor - closes and removes any temporary file
+ */
+void
+raptor_free_abbrev_spill(raptor_abbrev_spill* spill)
+{
+  if(!spill)
+    return;
+
+  raptor_abbrev_spill_clear_runs(spill);
+
+  if(spill->statements)
+    raptor_free_sequence(spill->statements);
+  if(spill->runs)
+    RAPTOR_FREE(raptor_abbrev_spill_run*, spill->runs);
+  if(spill->out)
+    RAPTOR_FREE(char*, spill->out);
+  if(spill->buffer)
+    RAPTOR_FREE(char*, spill->buffer);
+
+  RAPTOR_FREE(raptor_abbrev_spill, spill);
+}
+
+
+static size_t
+raptor_abbrev_spill_term_size(raptor_term* term)
+{
+  size_t size = sizeof(*term);
+  size_t len;
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      (void)raptor_uri_as_counted_string(term->value.uri, &len);
+      size += len;
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      size += term->value.literal.string_len + term->value.literal.language_len;
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      size += term->value.blank.string_len;
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      break;
+  }
+
+  return size;
+}
+
+
+/* append the buffered output bytes to the end of the temporary file */
+static int
+raptor_abbrev_spill_flush(raptor_abbrev_spill* spill)
+{
+  if(!spill->out_len)
+    return 0;
+
+  if(raptor_abbrev_spill_seek(spill->fh, spill->file_end) ||
+     fwrite(spill->out, 1, spill->out_len, spill->fh) != spill->out_len)
+    return 1;
+
+  spill->file_end += (raptor_abbrev_spill_offset)spill->out_len;
+  spill->out_len = 0;
+
+  return 0;
+}
+
+
+static int
+raptor_abbrev_spill_write_bytes(raptor_abbrev_spill* spill,
+                                const void* bytes, size_t len)
+{
+  if(spill->out_len + len > RAPTOR_ABBREV_SPILL_IO_SIZE) {
+    if(raptor_abbrev_spill_flush(spill))
+      return 1;
+
+    /* too big to buffer: write it straight after the flushed bytes */
+    if(len > RAPTOR_ABBREV_SPILL_IO_SIZE) {
+      if(raptor_abbrev_spill_seek(spill->fh, spill->file_end) ||
+         fwrite(bytes, 1, len, spill->fh) != len)
+        return 1;
+      spill->file_end += (raptor_abbrev_spill_offset)len;
+      return 0;
+    }
+  }
+
+  memcpy(spill->out + spill->out_len, bytes, len);
+  spill->out_len += len;
+
+  return 0;
+}
+
+
+static int
+raptor_abbrev_spill_write_string(raptor_abbrev_spill* spill,
+                                 const unsigned char* string, size_t len)
+{
+  if(raptor_abbrev_spill_write_bytes(spill, &len, sizeof(len)))
+    return 1;
+  if(len && raptor_abbrev_spill_write_bytes(spill, string, len))
+    return 1;
+  return 0;
+}
+
+
+static int
+raptor_abbrev_spill_write_term(raptor_abbrev_spill* spill, raptor_term* term)
+{
+  unsigned char type = term ? (unsigned char)term->type : 0;
+  const unsigned char* str;
+  size_t len;
+
+  if(raptor_abbrev_spill_write_bytes(spill, &type, 1))
+    return 1;
+
+  if(!term)
+    return 0;
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      str = raptor_uri_as_counted_string(term->value.uri, &len);
+      return raptor_abbrev_spill_write_string(spill, str, len);
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      if(raptor_abbrev_spill_write_string(spill, term->value.literal.string,
+                                          term->value.literal.string_len))
+        return 1;
+      if(term->value.literal.datatype)
+        str = raptor_uri_as_counted_string(term->value.literal.datatype, &len);
+      else {
+        str = NULL;
+        len = 0;
+      }
+      if(raptor_abbrev_spill_write_string(spill, str, len))
+        return 1;
+      return raptor_abbrev_spill_write_string(spill,
+                                              term->value.literal.language,
+                                              term->value.literal.language_len);
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      return raptor_abbrev_spill_write_string(spill, term->value.blank.string,
+                                              term->value.blank.string_len);
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      return 1;
+  }
+}
+
+
+/* write a statement to the end of the run being written */
+static int
+raptor_abbrev_spill_write_statement(void* user_data,
+                                    raptor_statement* statement)
+{
+  raptor_abbrev_spill* spill = (raptor_abbrev_spill*)user_data;
+
+  if(raptor_abbrev_spill_write_term(spill, statement->subject) ||
+     raptor_abbrev_spill_write_term(spill, statement->predicate) ||
+     raptor_abbrev_spill_write_term(spill, statement->object) ||
+     raptor_abbrev_spill_write_term(spill, statement->graph)) {
+    raptor_log_error_formatted(spill->world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                               "Cannot write to temporary file - %s",
+                               strerror(errno));
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/* read @len bytes of a run into @bytes */
+static int
+raptor_abbrev_spill_read_bytes(raptor_abbrev_spill* spill,
+                               raptor_abbrev_spill_cursor* cursor,
+                               void* bytes, size_t len)
+{
+  unsigned char* p = (unsigned char*)bytes;
+
+  while(len) {
+    size_t avail = cursor->buffer_len - cursor->buffer_pos;
+
+    if(!avail) {
+      raptor_abbrev_spill_offset left = cursor->end - cursor->offset;
+      size_t want;
+
+      if(!left)
+        return 1;
+      /* compare before casting: the run may be larger than size_t */
+      if(left > RAPTOR_ABBREV_SPILL_IO_SIZE)
+        want = RAPTOR_ABBREV_SPILL_IO_SIZE;
+      else
+        want = (size_t)left;
+      if(raptor_abbrev_spill_seek(spill->fh, cursor->offset) ||
+         fread(cursor->buffer, 1, want, spill->fh) != want)
+        return 1;
+      cursor->offset += (raptor_abbrev_spill_offset)want;
+      cursor->buffer_len = want;
+      cursor->buffer_pos = 0;
+      avail = want;
+    }
+
+    if(avail > len)
+      avail = len;
+    memcpy(p, cursor->buffer + cursor->buffer_pos, avail);
+    cursor->buffer_pos += avail;
+    p += avail;
+    len -= avail;
+  }
+
+  return 0;
+}
+
+
+/* read a string into spill->buffer at @offset; returns length or -1 */
+static ptrdiff_t
+raptor_abbrev_spill_read_string(raptor_abbrev_spill* spill,
+                                raptor_abbrev_spill_cursor* cursor,
+                                size_t offset)
+{
+  size_t len;
+
+  if(raptor_abbrev_spill_read_bytes(spill, cursor, &len, sizeof(len)))
+    return -1;
+
+  if(offset + len + 1 > spill->buffer_size) {
+    size_t new_size = (offset + len + 1) * 2;
+    unsigned char* new_buffer;
+
+    new_buffer = RAPTOR_REALLOC(unsigned char*, spill->buffer, new_size);
+    if(!new_buffer)
+      return -1;
+    spill->buffer = new_buffer;
+    spill->buffer_size = new_size;
+  }
+
+  if(len && raptor_abbrev_spill_read_bytes(spill, cursor,
+                                           spill->buffer + offset, len))
+    return -1;
+  spill->buffer[offset + len] = '\0';
+
+  return (ptrdiff_t)len;
+}
+
+
+/* read a term; sets *term_p to NULL for an absent term */
+static int
+raptor_abbrev_spill_read_term(raptor_abbrev_spill* spill,
+                              raptor_abbrev_spill_cursor* cursor,
+                              raptor_term** term_p)
+{
+  raptor_world* world = spill->world;
+  raptor_uri* datatype = NULL;
+  ptrdiff_t len;
+  ptrdiff_t dt_len;
+  ptrdiff_t lang_len;
+  unsigned char type;
+
+  *term_p = NULL;
+
+  if(raptor_abbrev_spill_read_bytes(spill, cursor, &type, 1))
+    return 1;
+
+  switch(type) {
+    case 0:
+      return 0;
+
+    case RAPTOR_TERM_TYPE_URI:
+      len = raptor_abbrev_spill_read_string(spill, cursor, 0);
+      if(len < 0)
+        return 1;
+      *term_p = raptor_new_term_from_counted_uri_string(world, spill->buffer,
+                                                        (size_t)len);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      /* value, datatype and language are read one after another */
+      len = raptor_abbrev_spill_read_string(spill, cursor, 0);
+      if(len < 0)
+        return 1;
+      dt_len = raptor_abbrev_spill_read_string(spill, cursor,
+                                               (size_t)len + 1);
+      if(dt_len < 0)
+        return 1;
+      lang_len = raptor_abbrev_spill_read_string(spill, cursor,
+                                                 (size_t)(len + dt_len) + 2);
+      if(lang_len < 0)
+        return 1;
+
+      if(dt_len) {
+        datatype = raptor_new_uri_from_counted_string(world,
+                                                      spill->buffer + len + 1,
+                                                      (size_t)dt_len);
+        if(!datatype)
+          return 1;
+      }
+      *term_p = raptor_new_term_from_counted_literal(world, spill->buffer,
+                                                     (size_t)len, datatype,
+                                                     lang_len ? spill->buffer + len + dt_len + 2 : NULL,
+                                                     (unsigned char)lang_len);
+      if(datatype)
+        raptor_free_uri(datatype);
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      len = raptor_abbrev_spill_read_string(spill, cursor, 0);
+      if(len < 0)
+        return 1;
+      *term_p = raptor_new_term_from_counted_blank(world, spill->buffer,
+                                                   (size_t)len);
+      break;
+
+    default:
+      return 1;
+  }
+
+  return (*term_p == NULL);
+}
+
+
+/* read the next statement of a run into cursor->head; NULL at the end */
+static int
+raptor_abbrev_spill_read_statement(raptor_abbrev_spill* spill,
+                                   raptor_abbrev_spill_cursor* cursor)
+{
+  raptor_statement* statement;
+
+  cursor->head = NULL;
+
+  if(cursor->buffer_pos == cursor->buffer_len &&
+     cursor->offset == cursor->end)
+    return 0;
+
+  statement = raptor_new_statement(spill->world);
+  if(!statement)
+    goto failed;
+
+  if(raptor_abbrev_spill_read_term(spill, cursor, &statement->subject) ||
+     raptor_abbrev_spill_read_term(spill, cursor, &statement->predicate) ||
+     raptor_abbrev_spill_read_term(spill, cursor, &statement->object) ||
+     raptor_abbrev_spill_read_term(spill, cursor, &statement->graph))
+    goto failed;
+
+  cursor->head = statement;
+
+  return 0;
+
+  failed:
+  if(statement)
+    raptor_free_statement(statement);
+  raptor_log_error(spill->world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                   "Cannot read statements back from temporary file");
+  return 1;
+}
+
+
+static int
+raptor_abbrev_spill_compare(const void *a, const void *b)
+{
+  return raptor_statement_compare(*(raptor_statement* const*)a,
+                                  *(raptor_statement* const*)b);
+}
+
+
+/* restore the heap order of cursors by their head below @i */
+static void
+raptor_abbrev_spill_sift_down(raptor_abbrev_spill_cursor** heap, int count,
+                              int i)
+{
+  raptor_abbrev_spill_cursor* cursor = heap[i];
+
+  while(1) {
+    int child = 2 * i + 1;
+
+    if(child >= count)
+      break;
+    if(child + 1 < count &&
+       raptor_statement_compare(heap[child + 1]->head, heap[child]->head) < 0)
+      child++;
+    if(raptor_statement_compare(cursor->head, heap[child]->head) <= 0)
+      break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = cursor;
+}
+
+
+/*
+ * raptor_abbrev_spill_merge:
+ * @spill: spill
+ * @first: index of the first run to merge; all later runs are merged
+ * @statements: sorted statements to merge with the runs or NULL
+ * @handler: function to call with each statement in order
+ * @user_data: user data for @handler
+ *
+ * INTERNAL - k-way merge of runs using a heap of their next statements
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_abbrev_spill_merge(raptor_abbrev_spill* spill, int first,
+                          raptor_sequence* statements,
+                          raptor_abbrev_spill_handler handler,
+                          void* user_data)
+{
+  raptor_abbrev_spill_cursor* cursors;
+  raptor_abbrev_spill_cursor** heap;
+  int ncursors = spill->runs_count - first;
+  int count = 0;
+  int next = 0;
+  int rc = 0;
+  int i;
+
+  cursors = RAPTOR_CALLOC(raptor_abbrev_spill_cursor*, (size_t)ncursors,
+                          sizeof(*cursors));
+  heap = RAPTOR_CALLOC(raptor_abbrev_spill_cursor**, (size_t)ncursors,
+                       sizeof(*heap));
+  if(!cursors || !heap) {
+    rc = 1;
+    goto tidy;
+  }
+
+  for(i = 0; !rc && i < ncursors; i++) {
+    raptor_abbrev_spill_cursor* cursor = &cursors[i];
+
+    cursor->offset = spill->runs[first + i].start;
+    cursor->end = spill->runs[first + i].end;
+    cursor->buffer = RAPTOR_MALLOC(unsigned char*, RAPTOR_ABBREV_SPILL_IO_SIZE);
+    if(!cursor->buffer)
+      rc = 1;
+    else
+      rc = raptor_abbrev_spill_read_statement(spill, cursor);
+    if(cursor->head)
+      heap[count++] = cursor;
+  }
+
+  for(i = count / 2; i-- > 0; )
+    raptor_abbrev_spill_sift_down(heap, count, i);
+
+  while(!rc) {
+    raptor_statement* buffered = NULL;
+    raptor_abbrev_spill_cursor* cursor;
+
+    if(statements && next < raptor_sequence_size(statements))
+      buffered = (raptor_statement*)raptor_sequence_get_at(statements, next);
+
+    if(buffered &&
+       (!count || raptor_statement_compare(buffered, heap[0]->head) <= 0)) {
+      rc = handler(user_data, buffered);
+      next++;
+      continue;
+    }
+
+    if(!count)
+      break;
+
+    cursor = heap[0];
+    rc = handler(user_data, cursor->head);
+    raptor_free_statement(cursor->head);
+    cursor->head = NULL;
+    if(!rc)
+      rc = raptor_abbrev_spill_read_statement(spill, cursor);
+    if(!cursor->head)
+      heap[0] = heap[--count];
+    if(count)
+      raptor_abbrev_spill_sift_down(heap, count, 0);
+  }
+
+  tidy:
+  if(cursors) {
+    for(i = 0; i < ncursors; i++) {
+      if(cursors[i].head)
+        raptor_free_statement(cursors[i].head);
+      if(cursors[i].buffer)
+        RAPTOR_FREE(char*, cursors[i].buffer);
+    }
+    RAPTOR_FREE(raptor_abbrev_spill_cursor*, cursors);
+  }
+  if(heap)
+    RAPTOR_FREE(raptor_abbrev_spill_cursor**, heap);
+
+  return rc;
+}
+
+
+/* record a run written from @start to the end of the file */
+static int
+raptor_abbrev_spill_add_run(raptor_abbrev_spill* spill,
+                            raptor_abbrev_spill_offset start, int level)
+{
+  raptor_abbrev_spill_run* run;
+
+  if(spill->runs_count == spill->runs_size) {
+    int new_size = spill->runs_size ? spill->runs_size * 2 : 16;
+    raptor_abbrev_spill_run* new_runs;
+
+    new_runs = RAPTOR_REALLOC(raptor_abbrev_spill_run*, spill->runs,
+                              (size_t)new_size * sizeof(*new_runs));
+    if(!new_runs)
+      return 1;
+    spill->runs = new_runs;
+    spill->runs_size = new_size;
+  }
+
+  run = &spill->runs[spill->runs_count++];
+  run->start = start;
+  run->end = spill->file_end;
+  run->level = level;
+
+  return 0;
+}
+
+
+/* sort the buffered statements and write them as a new run, merging
+ * the newest runs while RAPTOR_ABBREV_SPILL_MAX_RUNS share a level */
+static int
+raptor_abbrev_spill_write_run(raptor_abbrev_spill* spill)
+{
+  raptor_statement* statement;
+  raptor_abbrev_spill_offset start;
+  int i;
+
+  if(!spill->fh) {
+    spill->fh = tmpfile();
+    if(!spill->fh) {
+      raptor_log_error_formatted(spill->world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                                 "Cannot create temporary file - %s",
+                                 strerror(errno));
+      return 1;
+    }
+  }
+
+  if(!spill->out) {
+    spill->out = RAPTOR_MALLOC(unsigned char*, RAPTOR_ABBREV_SPILL_IO_SIZE);
+    if(!spill->out)
+      return 1;
+  }
+
+  raptor_sequence_sort(spill->statements, raptor_abbrev_spill_compare);
+
+  start = spill->file_end;
+  for(i = 0; i < raptor_sequence_size(spill->statements); i++) {
+    statement = (raptor_statement*)raptor_sequence_get_at(spill->statements, i);
+    if(raptor_abbrev_spill_write_statement(spill, statement))
+      return 1;
+  }
+  if(raptor_abbrev_spill_flush(spill) ||
+     raptor_abbrev_spill_add_run(spill, start, 0))
+    return 1;
+
+  while((statement = (raptor_statement*)raptor_sequence_pop(spill->statements)))
+    raptor_free_statement(statement);
+  spill->size = 0;
+
+  /* levels never increase along the runs so the newest
+   * RAPTOR_ABBREV_SPILL_MAX_RUNS share one if the first of them has it */
+  while(spill->runs_count >= RAPTOR_ABBREV_SPILL_MAX_RUNS) {
+    int first = spill->runs_count - RAPTOR_ABBREV_SPILL_MAX_RUNS;
+    int level = spill->runs[first].level;
+
+    if(spill->runs[spill->runs_count - 1].level != level)
+      break;
+
+    start = spill->file_end;
+    if(raptor_abbrev_spill_merge(spill, first, NULL,
+                                 raptor_abbrev_spill_write_statement, spill) ||
+       raptor_abbrev_spill_flush(spill))
+      return 1;
+
+    spill->runs_count = first;
+    if(raptor_abbrev_spill_add_run(spill, start, level + 1))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/**
+ * raptor_abbrev_spill_add_statement:
+ * @spill: spill
+ * @statement: statement to add (copied)
+ *
+ * INTERNAL - Add a statement, writing a sorted run to a temporary file
+ * if the memory limit is passed.
+ *
+ * If writing the temporary file fails the error is reported once, the
+ * buffered statements are dropped and all further statements are
+ * refused until raptor_abbrev_spill_replay() is called.
+ *
+ * Return value: non-0 on failure
+ */
+int
+raptor_abbrev_spill_add_statement(raptor_abbrev_spill* spill,
+                                  raptor_statement* statement)
+{
+  raptor_statement* copy;
+  size_t size = sizeof(*statement) + sizeof(void*);
+
+  if(spill->failed)
+    return 1;
+
+  copy = raptor_statement_copy(statement);
+  if(!copy || raptor_sequence_push(spill->statements, copy))
+    return 1;
+
+  size += raptor_abbrev_spill_term_size(statement->subject);
+  size += raptor_abbrev_spill_term_size(statement->predicate);
+  size += raptor_abbrev_spill_term_size(statement->object);
+  if(statement->graph)
+    size += raptor_abbrev_spill_term_size(statement->graph);
+  spill->size += size;
+
+  if(spill->size > spill->limit && raptor_abbrev_spill_write_run(spill)) {
+    spill->failed = 1;
+    while((copy = (raptor_statement*)raptor_sequence_pop(spill->statements)))
+      raptor_free_statement(copy);
+    spill->size = 0;
+    raptor_abbrev_spill_clear_runs(spill);
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/**
+ * raptor_abbrev_spill_is_spilled:
+ * @spill: spill
+ *
+ * INTERNAL - Check if any runs were written to the temporary file
+ *
+ * Return value: non-0 if replaying will return sorted statements
+ */
+int
+raptor_abbrev_spill_is_spilled(raptor_abbrev_spill* spill)
+{
+  return spill->runs_count > 0;
+}
+
+
+/**
+ * raptor_abbrev_spill_replay:
+ * @spill: spill
+ * @handler: function to call with each statement
+ * @user_data: user data for @handler
+ *
+ * INTERNAL - Return all statements and empty the spill
+ *
+ * If no runs were written, the statements are returned in the order
+ * they were added.  Otherwise the runs and any buffered statements
+ * are merged and returned sorted by subject, predicate and object.
+ *
+ * Return value: non-0 on failure, including an earlier failure to
+ * write the temporary file
+ */
+int
+raptor_abbrev_spill_replay(raptor_abbrev_spill* spill,
+                           raptor_abbrev_spill_handler handler,
+                           void* user_data)
+{
+  raptor_statement* statement;
+  int rc = 0;
+  int i;
+
+  if(spill->failed)
+    rc = 1;
+  else if(!spill->runs_count) {
+    for(i = 0; !rc && i < raptor_sequence_size(spill->statements); i++) {
+      statement = (raptor_statement*)raptor_sequence_get_at(spill->statements, i);
+      rc = handler(user_data, statement);
+    }
+  } else {
+    raptor_sequence_sort(spill->statements, raptor_abbrev_spill_compare);
+    rc = raptor_abbrev_spill_merge(spill, 0, spill->statements, handler,
+                                   user_data);
+  }
+
+  while((statement = (raptor_statement*)raptor_sequence_pop(spill->statements)))
+    raptor_free_statement(statement);
+  spill->size = 0;
+  raptor_abbrev_spill_clear_runs(spill);
+  spill->failed = 0;
+
+  return rc;
+}
@@ -63,6 +63,16 @@
 /* raptor_avltree.c */
 typedef struct raptor_avltree_node_s raptor_avltree_node;
 
+/* Block of node storage: the header is followed by the nodes */
+typedef struct raptor_avltree_block_s {
+  struct raptor_avltree_block_s* next;
+} raptor_avltree_block;
+
+#define RAPTOR_AVLTREE_BLOCK_NODES(block) ((raptor_avltree_node*)((block) + 1))
+
+/* Blocks start at one node and double up to this many nodes */
+#define RAPTOR_AVLTREE_BLOCK_MAX_SIZE 1024
+
 /* AVL-tree */
 struct raptor_avltree_s {
   /* root node of tree */
@@ -82,6 +92,16 @@ struct raptor_avltree_s {
 
   /* number of nodes in tree */
   unsigned int size;
+
+  /* node storage blocks, most recent first */
+  raptor_avltree_block* blocks;
+
+  /* number of nodes in the most recent block and how many are used */
+  unsigned int block_size;
+  unsigned int block_used;
+
+  /* deleted nodes available for reuse, linked by right pointer */
+  raptor_avltree_node* free_nodes;
 };
 
 
@@ -122,6 +142,8 @@ static void raptor_avltree_balance_right(raptor_avltree* tree, raptor_avltree_no
 static raptor_avltree_node* raptor_avltree_search_internal(raptor_avltree* tree, raptor_avltree_node* node, const void* p_data);
 static int raptor_avltree_visit_internal(raptor_avltree* tree, raptor_avltree_node* node, int depth, raptor_avltree_visit_handler visit_fn, void* user_data);
 static void raptor_free_avltree_internal(raptor_avltree* tree, raptor_avltree_node* node);
+static raptor_avltree_node* raptor_avltree_node_alloc(raptor_avltree* tree);
+static void raptor_avltree_node_release(raptor_avltree* tree, raptor_avltree_node* node);
 #ifdef RAPTOR_DEBUG
 static void raptor_avltree_check_internal(raptor_avltree* tree, raptor_avltree_node* node, unsigned int* count_p);
 #endif
@@ -154,11 +176,115 @@ raptor_new_avltree(raptor_data_compare_handler compare_handler,
   tree->print_handler = NULL;
   tree->flags = flags;
   tree->size = 0;
+  tree->blocks = NULL;
+  tree->block_size = 0;
+  tree->block_used = 0;
+  tree->free_nodes = NULL;
   
   return tree;
 }
 
 
+static raptor_avltree_node*
+raptor_avltree_build_sorted(raptor_avltree_node* nodes, int count,
+                            raptor_avltree_node* parent, int* height_p)
+{
+  raptor_avltree_node* node;
+  int mid = count / 2;
+  int left_height = 0;
+  int right_height = 0;
+
+  if(count <= 0) {
+    *height_p = 0;
+    return NULL;
+  }
+
+  node = &nodes[mid];
+  node->parent = parent;
+  node->left = raptor_avltree_build_sorted(nodes, mid, node, &left_height);
+  node->right = raptor_avltree_build_sorted(nodes + mid + 1, count - mid - 1,
+                                            node, &right_height);
+  node->balance = RAPTOR_GOOD_CAST(signed char, right_height - left_height);
+
+  *height_p = (left_height > right_height ? left_height : right_height) + 1;
+  return node;
+}
+
+
+/**
+ * raptor_new_avltree_from_sorted:
+ * @compare_handler: item comparison handler for ordering
+ * @free_handler: item free handler (or NULL)
+ * @flags: AVLTree flags - bitmask of #raptor_avltree_bitflags flags.
+ * @items: array of items in ascending order of @compare_handler
+ * @count: number of items in @items
+ *
+ * AVL Tree Constructor from sorted items
+ *
+ * Builds a balanced tree in O(@count) time with the nodes in a single
+ * block of storage.  Items with an equivalent key to the previous item
+ * are handled as by raptor_avltree_add() according to @flags.
+ *
+ * The tree takes ownership of the items on success.  If @items is not
+ * in ascending order, NULL is returned and the items are not touched.
+ *
+ * Return value: new AVL Tree or NULL on failure
+ */
+raptor_avltree*
+raptor_new_avltree_from_sorted(raptor_data_compare_handler compare_handler,
+                               raptor_data_free_handler free_handler,
+                               unsigned int flags,
+                               void** items, int count)
+{
+  raptor_avltree* tree;
+  raptor_avltree_block* block;
+  raptor_avltree_node* nodes;
+  int height;
+  int i;
+  int n = 0;
+
+  for(i = 1; i < count; i++) {
+    if(compare_handler(items[i - 1], items[i]) > 0)
+      return NULL;
+  }
+
+  tree = raptor_new_avltree(compare_handler, free_handler, flags);
+  if(!tree || count <= 0)
+    return tree;
+
+  block = RAPTOR_MALLOC(raptor_avltree_block*, sizeof(*block) +
+                        RAPTOR_GOOD_CAST(size_t, count) * sizeof(raptor_avltree_node));
+  if(!block) {
+    raptor_free_avltree(tree);
+    return NULL;
+  }
+  block->next = NULL;
+  tree->blocks = block;
+  tree->block_size = RAPTOR_GOOD_CAST(unsigned int, count);
+
+  nodes = RAPTOR_AVLTREE_BLOCK_NODES(block);
+  for(i = 0; i < count; i++) {
+    if(n && !compare_handler(nodes[n - 1].data, items[i])) {
+      /* equivalent key */
+      if(flags & RAPTOR_AVLTREE_FLAG_REPLACE_DUPLICATES) {
+        if(free_handler)
+          free_handler(nodes[n - 1].data);
+        nodes[n - 1].data = items[i];
+      } else if(free_handler)
+        free_handler(items[i]);
+      continue;
+    }
+    nodes[n++].data = items[i];
+  }
+
+  tree->block_used = RAPTOR_GOOD_CAST(unsigned int, n);
+  tree->size = RAPTOR_GOOD_CAST(unsigned int, n);
+  tree->root = raptor_avltree_build_sorted(nodes, n, NULL, &height);
+
+  return tree;
+}
+
+
 /**
  * raptor_free_avltree:
  * @tree: AVLTree object
@@ -171,7 +297,16 @@ raptor_free_avltree(raptor_avltree* tree)
   if(!tree)
     return;
   
-  raptor_free_avltree_internal(tree, tree->root);
+  /* items only need visiting if they are to be freed; node storage
+   * is released a block at a time below */
+  if(tree->free_handler)
+    raptor_free_avltree_internal(tree, tree->root);
+
+  while(tree->blocks) {
+    raptor_avltree_block* next = tree->blocks->next;
+    RAPTOR_FREE(raptor_avltree_block, tree->blocks);
+    tree->blocks = next;
+  }
 
   RAPTOR_FREE(raptor_avltree, tree);
 }
@@ -185,14 +320,69 @@ raptor_free_avltree_internal(raptor_avltree* tree, raptor_avltree_node* node)
 
     raptor_free_avltree_internal(tree, node->right);
 
-    if(tree->free_handler)
-      tree->free_handler(node->data);
+    tree->free_handler(node->data);
     tree->size--;
-    RAPTOR_FREE(raptor_avltree_node, node);
   }
 }
 
 
+/*
+ * raptor_avltree_node_alloc:
+ * @tree: AVLTree object
+ *
+ * INTERNAL - Get storage for a node from the free list or current block
+ *
+ * Return value: uninitialized node or NULL on failure
+ */
+static raptor_avltree_node*
+raptor_avltree_node_alloc(raptor_avltree* tree)
+{
+  raptor_avltree_node* node;
+
+  if(tree->free_nodes) {
+    node = tree->free_nodes;
+    tree->free_nodes = node->right;
+    return node;
+  }
+
+  if(!tree->blocks || tree->block_used == tree->block_size) {
+    raptor_avltree_block* block;
+    unsigned int block_size;
+
+    block_size = tree->block_size ? tree->block_size << 1 : 1;
+    if(block_size > RAPTOR_AVLTREE_BLOCK_MAX_SIZE)
+      block_size = RAPTOR_AVLTREE_BLOCK_MAX_SIZE;
+
+    block = RAPTOR_MALLOC(raptor_avltree_block*, sizeof(*block) +
+                          block_size * sizeof(raptor_avltree_node));
+    if(!block)
+      return NULL;
+
+    block->next = tree->blocks;
+    tree->blocks = block;
+    tree->block_size = block_size;
+    tree->block_used = 0;
+  }
+
+  return &RAPTOR_AVLTREE_BLOCK_NODES(tree->blocks)[tree->block_used++];
+}
+
+
+/*
+ * raptor_avltree_node_release:
+ * @tree: AVLTree object
+ * @node: node no longer in the tree
+ *
+ * INTERNAL - Return node storage to the free list for reuse
+ */
+static void
+raptor_avltree_node_release(raptor_avltree* tree, raptor_avltree_node* node)
+{
+  node->right = tree->free_nodes;
+  tree->free_nodes = node;
+}
+
+
 /* methods */
 
 static raptor_avltree_node*
@@ -684,7 +874,7 @@ raptor_avltree_sprout(raptor_avltree* tree, raptor_avltree_node* parent,
   /* If grounded, add the node here, set the rebalance flag and return */
   if(!*node_pp) {
     RAPTOR_AVLTREE_DEBUG1("grounded. adding new node, setting rebalancing flag true\n");
-    *node_pp = RAPTOR_MALLOC(raptor_avltree_node*, sizeof(**node_pp));
+    *node_pp = raptor_avltree_node_alloc(tree);
     if(!*node_pp) {
       if(tree->free_handler)
         tree->free_handler(p_data);
@@ -806,7 +996,7 @@ raptor_avltree_delete_internal(raptor_avltree* tree,
         raptor_avltree_balance_left(tree, node_pp, rebalancing_p);
     }
 
-    RAPTOR_FREE(raptor_avltree_node, pr_q);
+    raptor_avltree_node_release(tree, pr_q);
   }
 
   return rdata;
@@ -1628,6 +1818,7 @@ main(int argc, char *argv[])
   raptor_avltree* tree;
   raptor_avltree_iterator* iter;
   visit_state vs;
+  void* sorted_items[RESULT_COUNT + 1];
   int i;
 
   world = raptor_new_world();
@@ -1755,6 +1946,21 @@ main(int argc, char *argv[])
       exit(1);
     }
   }
+
+
+  /* add again to reuse the node storage of the removed items */
+  for(i = 0; results[i]; i++) {
+    if(raptor_avltree_add(tree, (void*)results[i])) {
+      fprintf(stderr, "%s: Re-adding tree item %d '%s' failed\n", program,
+              i, results[i]);
+      exit(1);
+    }
+  }
+  if(raptor_avltree_size(tree) != RESULT_COUNT) {
+    fprintf(stderr, "%s: Re-added tree has size %d not %d as expected\n",
+            program, raptor_avltree_size(tree), RESULT_COUNT);
+    exit(1);
+  }
   
 
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
@@ -1762,6 +1968,55 @@ main(int argc, char *argv[])
 #endif
   raptor_free_avltree(tree);
 
+
+  /* bulk load from sorted items with a duplicate */
+  if(raptor_new_avltree_from_sorted(compare_strings, NULL, 0,
+                                    (void**)items, ITEM_COUNT)) {
+    fprintf(stderr, "%s: Tree from unsorted items did not fail\n", program);
+    exit(1);
+  }
+
+  for(i = 0; i < RESULT_COUNT; i++)
+    sorted_items[i] = (void*)results[i];
+  sorted_items[RESULT_COUNT] = (void*)results[RESULT_COUNT - 1];
+
+  tree = raptor_new_avltree_from_sorted(compare_strings, NULL, 0,
+                                        sorted_items, RESULT_COUNT + 1);
+  if(!tree) {
+    fprintf(stderr, "%s: Failed to create tree from sorted items\n", program);
+    exit(1);
+  }
+#ifdef RAPTOR_DEBUG
+  raptor_avltree_check(tree);
+#endif
+  vs.count = 0;
+  vs.results = results;
+  vs.failed = 0;
+  raptor_avltree_visit(tree, check_string, &vs);
+  if(vs.failed || raptor_avltree_size(tree) != RESULT_COUNT) {
+    fprintf(stderr, "%s: Checking tree from sorted items failed\n", program);
+    exit(1);
+  }
+
+  for(i = 0; delete_items[i]; i++) {
+    if(raptor_avltree_add(tree, (void*)delete_items[i])) {
+      fprintf(stderr, "%s: Adding item '%s' to sorted tree failed\n",
+              program, delete_items[i]);
+      exit(1);
+    }
+  }
+  for(i = 0; items[i]; i++) {
+    if(!raptor_avltree_search(tree, (void*)items[i])) {
+      fprintf(stderr, "%s: Sorted tree did NOT contain item '%s'\n",
+              program, items[i]);
+      exit(1);
+    }
+  }
+#ifdef RAPTOR_DEBUG
+  raptor_avltree_check(tree);
+#endif
+  raptor_free_avltree(tree);
+
   raptor_free_world(world);
 
   /* keep gcc -Wall happy */
@@ -0,0 +1,938 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_binary.c - Raptor binary RDF parser
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Reads the binary RDF syntax written by raptor_serialize_binary.c.
+ * The record layout is described in raptor_internal.h.  Strings are
+ * used as they are: there is no unescaping or UTF-8 checking.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+/* dictionary string */
+typedef struct {
+  unsigned char *string;
+  size_t length;
+} raptor_binary_string;
+
+
+/* a term as read from a record, before it is made */
+typedef struct {
+  int kind;
+  /* literal kind */
+  int literal_kind;
+  /* IRI or blank node ID or literal language or datatype ID */
+  unsigned long id;
+  /* literal string */
+  const unsigned char *string;
+  size_t length;
+} raptor_binary_term_ref;
+
+
+typedef enum {
+  /* record read */
+  RAPTOR_BINARY_READ_OK,
+  /* record is incomplete */
+  RAPTOR_BINARY_READ_MORE,
+  /* record is not valid; error already reported */
+  RAPTOR_BINARY_READ_BAD
+} raptor_binary_read_status;
+
+
+/*
+ * Binary RDF parser object
+ */
+typedef struct {
+  /* dictionaries; prefix 0 is no prefix and is unused */
+  raptor_term** iris;
+  unsigned long iris_count;
+  unsigned long iris_size;
+
+  raptor_term** blanks;
+  unsigned long blanks_count;
+  unsigned long blanks_size;
+
+  raptor_binary_string* prefixes;
+  unsigned long prefixes_count;
+  unsigned long prefixes_size;
+
+  raptor_binary_string* languages;
+  unsigned long languages_count;
+  unsigned long languages_size;
+
+  /* namespaces declared by 'n' records */
+  raptor_namespace_stack namespaces;
+
+  /* non-0 once the stream header has been read */
+  int header_seen;
+
+  /* bytes of input read in whole records */
+  unsigned long offset;
+
+  /* start of a record that was split between chunks */
+  unsigned char *buffer;
+  size_t buffer_length;
+  size_t buffer_size;
+
+  /* IRI made from prefix and suffix */
+  unsigned char *scratch;
+  size_t scratch_size;
+} raptor_binary_parser_context;
+
+
+static void
+raptor_binary_parse_clear_dictionaries(raptor_binary_parser_context* binary_parser)
+{
+  unsigned long i;
+
+  for(i = 0; i < binary_parser->iris_count; i++)
+    raptor_free_term(binary_parser->iris[i]);
+  binary_parser->iris_count = 0;
+
+  for(i = 0; i < binary_parser->blanks_count; i++)
+    raptor_free_term(binary_parser->blanks[i]);
+  binary_parser->blanks_count = 0;
+
+  for(i = 1; i < binary_parser->prefixes_count; i++)
+    RAPTOR_FREE(char*, binary_parser->prefixes[i].string);
+  binary_parser->prefixes_count = 1;
+
+  for(i = 0; i < binary_parser->languages_count; i++)
+    RAPTOR_FREE(char*, binary_parser->languages[i].string);
+  binary_parser->languages_count = 0;
+}
+
+
+static int
+raptor_binary_parse_init(raptor_parser* rdf_parser, const char *name)
+{
+  raptor_binary_parser_context *binary_parser;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  binary_parser->prefixes_count = 1;
+
+  return raptor_namespaces_init(rdf_parser->world, &binary_parser->namespaces,
+                                0);
+}
+
+
+static void
+raptor_binary_parse_terminate(raptor_parser* rdf_parser)
+{
+  raptor_binary_parser_context *binary_parser;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  raptor_binary_parse_clear_dictionaries(binary_parser);
+
+  if(binary_parser->iris)
+    RAPTOR_FREE(raptor_term**, binary_parser->iris);
+  if(binary_parser->blanks)
+    RAPTOR_FREE(raptor_term**, binary_parser->blanks);
+  if(binary_parser->prefixes)
+    RAPTOR_FREE(raptor_binary_string*, binary_parser->prefixes);
+  if(binary_parser->languages)
+    RAPTOR_FREE(raptor_binary_string*, binary_parser->languages);
+  if(binary_parser->buffer)
+    RAPTOR_FREE(cdata, binary_parser->buffer);
+  if(binary_parser->scratch)
+    RAPTOR_FREE(cdata, binary_parser->scratch);
+
+  raptor_namespaces_clear(&binary_parser->namespaces);
+}
+
+
+static int
+raptor_binary_parse_start(raptor_parser* rdf_parser)
+{
+  raptor_binary_parser_context *binary_parser;
+  raptor_locator *locator = &rdf_parser->locator;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  /* records have no lines */
+  locator->line = -1;
+  locator->column = -1;
+  locator->byte = 0;
+
+  raptor_binary_parse_clear_dictionaries(binary_parser);
+  binary_parser->header_seen = 0;
+  binary_parser->offset = 0;
+  binary_parser->buffer_length = 0;
+
+  return 0;
+}
+
+
+/*
+ * raptor_binary_grow:
+ * @array_p: pointer to array
+ * @size_p: pointer to number of items allocated
+ * @count: number of items used
+ * @item_size: size of an item
+ *
+ * INTERNAL - Make room for one more item in a dictionary array
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_binary_grow(void** array_p, unsigned long* size_p, unsigned long count,
+                   size_t item_size)
+{
+  unsigned long size;
+  void* array;
+
+  if(count < *size_p)
+    return 0;
+
+  size = *size_p ? *size_p << 1 : 64;
+  array = RAPTOR_REALLOC(void*, *array_p, size * item_size);
+  if(!array)
+    return 1;
+
+  *array_p = array;
+  *size_p = size;
+  return 0;
+}
+
+
+static raptor_binary_read_status
+raptor_binary_read_varint(const unsigned char **ptr_p,
+                          const unsigned char *end_ptr,
+                          unsigned long *value_p)
+{
+  const unsigned char *ptr = *ptr_p;
+  unsigned long value = 0;
+  unsigned int shift = 0;
+
+  while(1) {
+    unsigned long bits;
+
+    if(ptr == end_ptr)
+      return RAPTOR_BINARY_READ_MORE;
+
+    bits = (unsigned long)(*ptr & 0x7f);
+    if(shift >= sizeof(value) * 8 || ((bits << shift) >> shift) != bits)
+      return RAPTOR_BINARY_READ_BAD;
+
+    value |= bits << shift;
+    if(!(*ptr++ & 0x80))
+      break;
+    shift += 7;
+  }
+
+  *ptr_p = ptr;
+  *value_p = value;
+  return RAPTOR_BINARY_READ_OK;
+}
+
+
+static raptor_binary_read_status
+raptor_binary_read_string(const unsigned char **ptr_p,
+                          const unsigned char *end_ptr,
+                          const unsigned char **string_p, size_t *length_p)
+{
+  const unsigned char *ptr = *ptr_p;
+  unsigned long length;
+  raptor_binary_read_status status;
+
+  status = raptor_binary_read_varint(&ptr, end_ptr, &length);
+  if(status != RAPTOR_BINARY_READ_OK)
+    return status;
+
+  if(length > RAPTOR_GOOD_CAST(unsigned long, end_ptr - ptr))
+    return RAPTOR_BINARY_READ_MORE;
+
+  *string_p = ptr;
+  *length_p = RAPTOR_BAD_CAST(size_t, length);
+  *ptr_p = ptr + length;
+  return RAPTOR_BINARY_READ_OK;
+}
+
+
+static raptor_binary_read_status
+raptor_binary_read_term(const unsigned char **ptr_p,
+                        const unsigned char *end_ptr,
+                        raptor_binary_term_ref* ref)
+{
+  const unsigned char *ptr = *ptr_p;
+  unsigned long value;
+  raptor_binary_read_status status;
+
+  status = raptor_binary_read_varint(&ptr, end_ptr, &value);
+  if(status != RAPTOR_BINARY_READ_OK)
+    return status;
+
+  ref->kind = (int)(value & RAPTOR_BINARY_TERM_KIND_MASK);
+  ref->id = value >> RAPTOR_BINARY_TERM_KIND_BITS;
+
+  if(ref->kind == RAPTOR_BINARY_TERM_LITERAL) {
+    ref->literal_kind = (int)ref->id;
+    ref->id = 0;
+
+    if(ref->literal_kind == RAPTOR_BINARY_LITERAL_LANGUAGE ||
+       ref->literal_kind == RAPTOR_BINARY_LITERAL_DATATYPE) {
+      status = raptor_binary_read_varint(&ptr, end_ptr, &ref->id);
+      if(status != RAPTOR_BINARY_READ_OK)
+        return status;
+    } else if(ref->literal_kind != RAPTOR_BINARY_LITERAL_PLAIN)
+      return RAPTOR_BINARY_READ_BAD;
+
+    status = raptor_binary_read_string(&ptr, end_ptr,
+                                       &ref->string, &ref->length);
+    if(status != RAPTOR_BINARY_READ_OK)
+      return status;
+  } else if(ref->kind != RAPTOR_BINARY_TERM_IRI &&
+            ref->kind != RAPTOR_BINARY_TERM_BLANK)
+    return RAPTOR_BINARY_READ_BAD;
+
+  *ptr_p = ptr;
+  return RAPTOR_BINARY_READ_OK;
+}
+
+
+/*
+ * raptor_binary_make_term:
+ * @rdf_parser: parser
+ * @ref: term read from a record
+ * @owned_p: pointer to flag set if the caller must free the term
+ *
+ * INTERNAL - Get the term for a term reference
+ *
+ * IRIs and blank nodes are shared with the dictionary; literals are new.
+ *
+ * Return value: term or NULL on failure
+ */
+static raptor_term*
+raptor_binary_make_term(raptor_parser* rdf_parser, raptor_binary_term_ref* ref,
+                        int* owned_p)
+{
+  raptor_binary_parser_context *binary_parser;
+  raptor_uri* datatype = NULL;
+  const unsigned char* language = NULL;
+  size_t language_len = 0;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+  *owned_p = 0;
+
+  if(ref->kind == RAPTOR_BINARY_TERM_IRI) {
+    if(ref->id >= binary_parser->iris_count) {
+      raptor_parser_error(rdf_parser, "Undefined IRI %lu", ref->id);
+      return NULL;
+    }
+    return binary_parser->iris[ref->id];
+  }
+
+  if(ref->kind == RAPTOR_BINARY_TERM_BLANK) {
+    if(ref->id >= binary_parser->blanks_count) {
+      raptor_parser_error(rdf_parser, "Undefined blank node %lu", ref->id);
+      return NULL;
+    }
+    return binary_parser->blanks[ref->id];
+  }
+
+  if(ref->literal_kind == RAPTOR_BINARY_LITERAL_LANGUAGE) {
+    if(ref->id >= binary_parser->languages_count) {
+      raptor_parser_error(rdf_parser, "Undefined language %lu", ref->id);
+      return NULL;
+    }
+    language = binary_parser->languages[ref->id].string;
+    language_len = binary_parser->languages[ref->id].length;
+  } else if(ref->literal_kind == RAPTOR_BINARY_LITERAL_DATATYPE) {
+    if(ref->id >= binary_parser->iris_count) {
+      raptor_parser_error(rdf_parser, "Undefined datatype IRI %lu", ref->id);
+      return NULL;
+    }
+    datatype = binary_parser->iris[ref->id]->value.uri;
+  }
+
+  *owned_p = 1;
+  return raptor_new_term_from_counted_literal(rdf_parser->world,
+                                              ref->string, ref->length,
+                                              datatype, language,
+                                              (unsigned char)language_len);
+}
+
+
+static int
+raptor_binary_parse_statement(raptor_parser* rdf_parser,
+                              raptor_binary_term_ref* refs, int count)
+{
+  raptor_statement *statement = &rdf_parser->statement;
+  raptor_term* terms[4] = { NULL, NULL, NULL, NULL };
+  int owned[4] = { 0, 0, 0, 0 };
+  int rc = 0;
+  int i;
+
+  for(i = 0; i < count; i++) {
+    terms[i] = raptor_binary_make_term(rdf_parser, &refs[i], &owned[i]);
+    if(!terms[i]) {
+      if(owned[i])
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+      rc = 1;
+      goto tidy;
+    }
+  }
+
+  if(!rdf_parser->emitted_default_graph) {
+    raptor_parser_start_graph(rdf_parser, NULL, 0);
+    rdf_parser->emitted_default_graph++;
+  }
+
+  if(rdf_parser->statement_handler || rdf_parser->statement_batch_handler) {
+    statement->subject = terms[0];
+    statement->predicate = terms[1];
+    statement->object = terms[2];
+    statement->graph = terms[3];
+
+    raptor_parser_emit_statement(rdf_parser, statement);
+
+    /* the terms are not owned by the statement */
+    statement->subject = NULL;
+    statement->predicate = NULL;
+    statement->object = NULL;
+    statement->graph = NULL;
+  }
+
+  tidy:
+  for(i = 0; i < count; i++) {
+    if(owned[i] && terms[i])
+      raptor_free_term(terms[i]);
+  }
+
+  return rc;
+}
+
+
+static int
+raptor_binary_parse_iri(raptor_parser* rdf_parser, unsigned long prefix_id,
+                        const unsigned char* suffix, size_t suffix_len)
+{
+  raptor_binary_parser_context *binary_parser;
+  const unsigned char* string = suffix;
+  size_t len = suffix_len;
+  raptor_uri* uri;
+  raptor_term* term;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  if(prefix_id >= binary_parser->prefixes_count) {
+    raptor_parser_error(rdf_parser, "Undefined IRI prefix %lu", prefix_id);
+    return 1;
+  }
+
+  if(prefix_id) {
+    raptor_binary_string* prefix = &binary_parser->prefixes[prefix_id];
+
+    len = prefix->length + suffix_len;
+    if(len > binary_parser->scratch_size) {
+      unsigned char* scratch = RAPTOR_REALLOC(unsigned char*,
+                                              binary_parser->scratch, len);
+      if(!scratch)
+        goto oom;
+      binary_parser->scratch = scratch;
+      binary_parser->scratch_size = len;
+    }
+    memcpy(binary_parser->scratch, prefix->string, prefix->length);
+    memcpy(binary_parser->scratch + prefix->length, suffix, suffix_len);
+    string = binary_parser->scratch;
+  }
+
+  if(raptor_binary_grow((void**)&binary_parser->iris,
+                        &binary_parser->iris_size, binary_parser->iris_count,
+                        sizeof(raptor_term*)))
+    goto oom;
+
+  uri = raptor_new_uri_from_counted_string(rdf_parser->world, string, len);
+  if(!uri)
+    goto oom;
+  term = raptor_new_term_from_uri(rdf_parser->world, uri);
+  raptor_free_uri(uri);
+  if(!term)
+    goto oom;
+
+  binary_parser->iris[binary_parser->iris_count++] = term;
+  return 0;
+
+  oom:
+  raptor_parser_fatal_error(rdf_parser, "Out of memory");
+  return 1;
+}
+
+
+static int
+raptor_binary_parse_namespace(raptor_parser* rdf_parser,
+                              const unsigned char* prefix, size_t prefix_len,
+                              unsigned long iri_id)
+{
+  raptor_binary_parser_context *binary_parser;
+  unsigned char* prefix_string = NULL;
+  raptor_namespace* ns;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  if(iri_id >= binary_parser->iris_count) {
+    raptor_parser_error(rdf_parser, "Undefined namespace IRI %lu", iri_id);
+    return 1;
+  }
+
+  /* empty prefix is the default namespace */
+  if(prefix_len) {
+    prefix_string = RAPTOR_MALLOC(unsigned char*, prefix_len + 1);
+    if(!prefix_string) {
+      raptor_parser_fatal_error(rdf_parser, "Out of memory");
+      return 1;
+    }
+    memcpy(prefix_string, prefix, prefix_len);
+    prefix_string[prefix_len] = '\0';
+  }
+
+  ns = raptor_new_namespace_from_uri(&binary_parser->namespaces, prefix_string,
+                                     binary_parser->iris[iri_id]->value.uri, 0);
+  if(ns) {
+    raptor_namespaces_start_namespace(&binary_parser->namespaces, ns);
+    raptor_parser_start_namespace(rdf_parser, ns);
+  }
+
+  if(prefix_string)
+    RAPTOR_FREE(char*, prefix_string);
+
+  return 0;
+}
+
+
+/* copy a string into the next entry of a string dictionary */
+static int
+raptor_binary_parse_add_string(raptor_parser* rdf_parser,
+                               raptor_binary_string** array_p,
+                               unsigned long* size_p, unsigned long* count_p,
+                               const unsigned char* string, size_t length)
+{
+  raptor_binary_string* entry;
+
+  if(raptor_binary_grow((void**)array_p, size_p, *count_p,
+                        sizeof(raptor_binary_string)))
+    goto oom;
+
+  entry = &(*array_p)[*count_p];
+  entry->string = RAPTOR_MALLOC(unsigned char*, length + 1);
+  if(!entry->string)
+    goto oom;
+  memcpy(entry->string, string, length);
+  entry->string[length] = '\0';
+  entry->length = length;
+
+  (*count_p)++;
+  return 0;
+
+  oom:
+  raptor_parser_fatal_error(rdf_parser, "Out of memory");
+  return 1;
+}
+
+
+/*
+ * raptor_binary_parse_record:
+ * @rdf_parser: parser
+ * @ptr_p: pointer to start of record; moved past it if read
+ * @end_ptr: end of input
+ *
+ * INTERNAL - Read one record and act on it
+ *
+ * Return value: read status
+ */
+static raptor_binary_read_status
+raptor_binary_parse_record(raptor_parser* rdf_parser,
+                           const unsigned char **ptr_p,
+                           const unsigned char *end_ptr)
+{
+  raptor_binary_parser_context *binary_parser;
+  const unsigned char *ptr = *ptr_p;
+  raptor_binary_term_ref refs[4];
+  const unsigned char* string = NULL;
+  size_t length = 0;
+  unsigned long id = 0;
+  raptor_binary_read_status status = RAPTOR_BINARY_READ_OK;
+  int tag;
+  int count = 0;
+  int rc = 0;
+  int i;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  tag = *ptr++;
+
+  /* read the whole record before acting on it */
+  switch(tag) {
+    case 'p':
+    case 'b':
+    case 'l':
+      status = raptor_binary_read_string(&ptr, end_ptr, &string, &length);
+      break;
+
+    case 'i':
+      status = raptor_binary_read_varint(&ptr, end_ptr, &id);
+      if(status == RAPTOR_BINARY_READ_OK)
+        status = raptor_binary_read_string(&ptr, end_ptr, &string, &length);
+      break;
+
+    case 'n':
+      status = raptor_binary_read_string(&ptr, end_ptr, &string, &length);
+      if(status == RAPTOR_BINARY_READ_OK)
+        status = raptor_binary_read_varint(&ptr, end_ptr, &id);
+      break;
+
+    case 't':
+    case 'q':
+      count = (tag == 'q') ? 4 : 3;
+      for(i = 0; i < count && status == RAPTOR_BINARY_READ_OK; i++)
+        status = raptor_binary_read_term(&ptr, end_ptr, &refs[i]);
+      break;
+
+    case 'r':
+      break;
+
+    default:
+      raptor_parser_error(rdf_parser, "Unknown binary RDF record type 0x%02x",
+                          tag);
+      return RAPTOR_BINARY_READ_BAD;
+  }
+
+  if(status == RAPTOR_BINARY_READ_BAD) {
+    raptor_parser_error(rdf_parser, "Bad binary RDF record '%c'", tag);
+    return status;
+  }
+  if(status == RAPTOR_BINARY_READ_MORE)
+    return status;
+
+  switch(tag) {
+    case 'p':
+      rc = raptor_binary_parse_add_string(rdf_parser,
+                                          &binary_parser->prefixes,
+                                          &binary_parser->prefixes_size,
+                                          &binary_parser->prefixes_count,
+                                          string, length);
+      break;
+
+    case 'i':
+      rc = raptor_binary_parse_iri(rdf_parser, id, string, length);
+      break;
+
+    case 'b':
+      if(raptor_binary_grow((void**)&binary_parser->blanks,
+                            &binary_parser->blanks_size,
+                            binary_parser->blanks_count,
+                            sizeof(raptor_term*)) ||
+         !(binary_parser->blanks[binary_parser->blanks_count] =
+           raptor_new_term_from_counted_blank(rdf_parser->world,
+                                              string, length))) {
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+        rc = 1;
+      } else
+        binary_parser->blanks_count++;
+      break;
+
+    case 'l':
+      /* terms keep language lengths in an unsigned char */
+      if(!length || length > 255) {
+        raptor_parser_error(rdf_parser, "Bad language tag length %lu",
+                            (unsigned long)length);
+        rc = 1;
+        break;
+      }
+      rc = raptor_binary_parse_add_string(rdf_parser,
+                                          &binary_parser->languages,
+                                          &binary_parser->languages_size,
+                                          &binary_parser->languages_count,
+                                          string, length);
+      break;
+
+    case 'n':
+      rc = raptor_binary_parse_namespace(rdf_parser, string, length, id);
+      break;
+
+    case 't':
+    case 'q':
+      rc = raptor_binary_parse_statement(rdf_parser, refs, count);
+      break;
+
+    case 'r':
+      raptor_binary_parse_clear_dictionaries(binary_parser);
+      break;
+
+    default:
+      break;
+  }
+
+  if(rc)
+    return RAPTOR_BINARY_READ_BAD;
+
+  *ptr_p = ptr;
+  return RAPTOR_BINARY_READ_OK;
+}
+
+
+/*
+ * raptor_binary_parse_records:
+ * @rdf_parser: parser
+ * @ptr_p: pointer to start of input; moved past the whole records read
+ * @end_ptr: end of input
+ *
+ * INTERNAL - Read the header and all whole records in some input
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_binary_parse_records(raptor_parser* rdf_parser,
+                            const unsigned char **ptr_p,
+                            const unsigned char *end_ptr)
+{
+  raptor_binary_parser_context *binary_parser;
+  const unsigned char *ptr = *ptr_p;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  if(!binary_parser->header_seen) {
+    if(end_ptr - ptr < RAPTOR_BINARY_MAGIC_LEN + 1)
+      return 0;
+
+    if(memcmp(ptr, RAPTOR_BINARY_MAGIC, RAPTOR_BINARY_MAGIC_LEN)) {
+      raptor_parser_error(rdf_parser, "Not binary RDF content");
+      return 1;
+    }
+    if(ptr[RAPTOR_BINARY_MAGIC_LEN] != RAPTOR_BINARY_VERSION) {
+      raptor_parser_error(rdf_parser, "Unsupported binary RDF version %d",
+                          ptr[RAPTOR_BINARY_MAGIC_LEN]);
+      return 1;
+    }
+
+    ptr += RAPTOR_BINARY_MAGIC_LEN + 1;
+    binary_parser->offset += RAPTOR_BINARY_MAGIC_LEN + 1;
+    binary_parser->header_seen = 1;
+  }
+
+  while(ptr < end_ptr && !rdf_parser->failed) {
+    const unsigned char *start = ptr;
+    raptor_binary_read_status status;
+
+    rdf_parser->locator.byte = RAPTOR_BAD_CAST(int, binary_parser->offset);
+
+    status = raptor_binary_parse_record(rdf_parser, &ptr, end_ptr);
+    if(status == RAPTOR_BINARY_READ_BAD)
+      return 1;
+    if(status == RAPTOR_BINARY_READ_MORE)
+      break;
+
+    binary_parser->offset += RAPTOR_BAD_CAST(unsigned long, ptr - start);
+  }
+
+  *ptr_p = ptr;
+  return 0;
+}
+
+
+static int
+raptor_binary_parse_end(raptor_parser* rdf_parser, size_t remaining)
+{
+  raptor_binary_parser_context *binary_parser;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  if(remaining) {
+    rdf_parser->locator.byte = RAPTOR_BAD_CAST(int, binary_parser->offset);
+    raptor_parser_error(rdf_parser, binary_parser->header_seen ?
+                        "Truncated binary RDF record" :
+                        "Truncated binary RDF header");
+    return 1;
+  }
+
+  if(rdf_parser->emitted_default_graph) {
+    raptor_parser_end_graph(rdf_parser, NULL, 0);
+    rdf_parser->emitted_default_graph--;
+  }
+
+  return 0;
+}
+
+
+static int
+raptor_binary_parse_chunk(raptor_parser* rdf_parser,
+                          const unsigned char *s, size_t len,
+                          int is_end)
+{
+  raptor_binary_parser_context *binary_parser;
+  const unsigned char *ptr;
+  const unsigned char *end_ptr;
+  size_t remaining;
+
+  binary_parser = (raptor_binary_parser_context*)rdf_parser->context;
+
+  if(binary_parser->buffer_length) {
+    /* complete a record left over from an earlier chunk */
+    if(binary_parser->buffer_length + len > binary_parser->buffer_size) {
+      size_t size = binary_parser->buffer_length + len;
+      unsigned char *buffer;
+
+      if(size < binary_parser->buffer_size << 1)
+        size = binary_parser->buffer_size << 1;
+      buffer = RAPTOR_REALLOC(unsigned char*, binary_parser->buffer, size);
+      if(!buffer) {
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+        return 1;
+      }
+      binary_parser->buffer = buffer;
+      binary_parser->buffer_size = size;
+    }
+    if(len)
+      memcpy(binary_parser->buffer + binary_parser->buffer_length, s, len);
+    binary_parser->buffer_length += len;
+
+    s = binary_parser->buffer;
+    len = binary_parser->buffer_length;
+  }
+
+  ptr = s;
+  end_ptr = s + len;
+  if(len && raptor_binary_parse_records(rdf_parser, &ptr, end_ptr))
+    return 1;
+
+  remaining = RAPTOR_BAD_CAST(size_t, end_ptr - ptr);
+  if(is_end)
+    return raptor_binary_parse_end(rdf_parser, remaining);
+
+  /* keep the start of an incomplete record */
+  if(s == binary_parser->buffer) {
+    if(remaining)
+      memmove(binary_parser->buffer, ptr, remaining);
+  } else if(remaining) {
+    if(remaining > binary_parser->buffer_size) {
+      unsigned char *buffer;
+
+      buffer = RAPTOR_REALLOC(unsigned char*, binary_parser->buffer,
+                              remaining);
+      if(!buffer) {
+        raptor_parser_fatal_error(rdf_parser, "Out of memory");
+        return 1;
+      }
+      binary_parser->buffer = buffer;
+      binary_parser->buffer_size = remaining;
+    }
+    memcpy(binary_parser->buffer, ptr, remaining);
+  }
+  binary_parser->buffer_length = remaining;
+
+  return 0;
+}
+
+
+static int
+raptor_binary_parse_buffer(raptor_parser* rdf_parser,
+                           const unsigned char *buffer, size_t len)
+{
+  const unsigned char *ptr = buffer;
+
+  if(raptor_binary_parse_records(rdf_parser, &ptr, buffer + len))
+    return 1;
+
+  return raptor_binary_parse_end(rdf_parser,
+                                 RAPTOR_BAD_CAST(size_t, buffer + len - ptr));
+}
+
+
+static int
+raptor_binary_parse_recognise_syntax(raptor_parser_factory* factory,
+                                     const unsigned char *buffer, size_t len,
+                                     const unsigned char *identifier,
+                                     const unsigned char *suffix,
+                                     const char *mime_type)
+{
+  int score = 0;
+
+  if(suffix && !strcmp((const char*)suffix, "rbf"))
+    score = 7;
+
+  if(mime_type && strstr((const char*)mime_type, "raptor-binary"))
+    score += 6;
+
+  if(buffer && len >= RAPTOR_BINARY_MAGIC_LEN &&
+     !memcmp(buffer, RAPTOR_BINARY_MAGIC, RAPTOR_BINARY_MAGIC_LEN))
+    score = 10;
+
+  return score;
+}
+
+
+static const char* const binary_names[2] = { "binary", NULL };
+
+#define BINARY_TYPES_COUNT 1
+static const raptor_type_q binary_types[BINARY_TYPES_COUNT + 1] = {
+  { "application/x-raptor-binary-rdf", 31, 10},
+  { NULL, 0, 0}
+};
+
+static int
+raptor_binary_parser_register_factory(raptor_parser_factory *factory)
+{
+  int rc = 0;
+
+  factory->desc.names = binary_names;
+
+  factory->desc.mime_types = binary_types;
+
+  factory->desc.label = "Raptor binary RDF";
+  factory->desc.uri_strings = NULL;
+
+  factory->desc.flags = 0;
+
+  factory->context_length     = sizeof(raptor_binary_parser_context);
+
+  factory->init      = raptor_binary_parse_init;
+  factory->terminate = raptor_binary_parse_terminate;
+  factory->start     = raptor_binary_parse_start;
+  factory->chunk     = raptor_binary_parse_chunk;
+  factory->parse_buffer = raptor_binary_parse_buffer;
+  factory->recognise_syntax = raptor_binary_parse_recognise_syntax;
+
+  return rc;
+}
+
+
+int
+raptor_init_parser_binary(raptor_world* world)
+{
+  return !raptor_world_register_parser_factory(world,
+                                               &raptor_binary_parser_register_factory);
+}
@@ -0,0 +1,1358 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_btree.c - B+ Tree ordered container
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * An ordered container with the same handlers, flags and iterator
+ * semantics as raptor_avltree so that users can be switched between
+ * the two.  Items are kept in wide leaves that are linked in order so
+ * searches touch few cache lines and iteration never walks back up
+ * the tree.
+ *
+ * Each separator key in an inner node is the smallest item of the
+ * child to its right so keys always point at items still in the tree.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+#ifndef STANDALONE
+
+#define RAPTOR_BTREE_ENOMEM -1
+#define RAPTOR_BTREE_EXISTS 1
+/* internal: equivalent item was replaced */
+#define RAPTOR_BTREE_REPLACED 2
+
+/* maximum items in a leaf and children of an inner node */
+#define RAPTOR_BTREE_LEAF_MAX 64
+#define RAPTOR_BTREE_INNER_MAX 64
+
+#define RAPTOR_BTREE_LEAF_MIN (RAPTOR_BTREE_LEAF_MAX / 2)
+#define RAPTOR_BTREE_INNER_MIN (RAPTOR_BTREE_INNER_MAX / 2)
+
+
+/* node header shared by leaves and inner nodes */
+typedef struct {
+  /* number of items (leaf) or children (inner node) */
+  int count;
+
+  int is_leaf;
+} raptor_btree_node;
+
+typedef struct raptor_btree_leaf_s {
+  raptor_btree_node node;
+
+  /* neighbouring leaves in item order */
+  struct raptor_btree_leaf_s* prev;
+  struct raptor_btree_leaf_s* next;
+
+  void* items[RAPTOR_BTREE_LEAF_MAX];
+} raptor_btree_leaf;
+
+typedef struct {
+  raptor_btree_node node;
+
+  /* keys[i] is the smallest item under children[i]; keys[0] is unused */
+  void* keys[RAPTOR_BTREE_INNER_MAX];
+
+  raptor_btree_node* children[RAPTOR_BTREE_INNER_MAX];
+} raptor_btree_inner;
+
+
+struct raptor_btree_s {
+  /* root node or NULL when empty */
+  raptor_btree_node* root;
+
+  /* item comparison function */
+  raptor_data_compare_handler compare_handler;
+
+  /* item deletion function (optional) */
+  raptor_data_free_handler free_handler;
+
+  /* item print function (optional) */
+  raptor_data_print_handler print_handler;
+
+  /* tree bitflags - bitmask of #raptor_avltree_bitflags flags */
+  unsigned int flags;
+
+  /* number of items in tree */
+  unsigned int size;
+
+  /* number of levels of inner nodes */
+  int height;
+
+  /* nodes reserved before an add so that splitting cannot fail */
+  raptor_btree_leaf* spare_leaf;
+  raptor_btree_inner* spare_inners;
+  int spare_inners_count;
+};
+
+
+struct raptor_btree_iterator_s {
+  raptor_btree* tree;
+  raptor_btree_leaf* leaf;
+  int index;
+  void* range;
+  raptor_data_free_handler range_free_handler;
+  int direction;
+  int is_finished;
+};
+
+
+/**
+ * raptor_new_btree:
+ * @compare_handler: item comparison handler for ordering
+ * @free_handler: item free handler (or NULL)
+ * @flags: bitmask of #raptor_avltree_bitflags flags.
+ *
+ * INTERNAL - B+ Tree Constructor
+ *
+ * Return value: new B+ Tree or NULL on failure
+ */
+raptor_btree*
+raptor_new_btree(raptor_data_compare_handler compare_handler,
+                 raptor_data_free_handler free_handler,
+                 unsigned int flags)
+{
+  raptor_btree* tree;
+
+  tree = RAPTOR_CALLOC(raptor_btree*, 1, sizeof(*tree));
+  if(!tree)
+    return NULL;
+
+  tree->compare_handler = compare_handler;
+  tree->free_handler = free_handler;
+  tree->flags = flags;
+
+  return tree;
+}
+
+
+static void
+raptor_free_btree_node(raptor_btree* tree, raptor_btree_node* node)
+{
+  if(node->is_leaf) {
+    raptor_btree_leaf* leaf = (raptor_btree_leaf*)node;
+    int i;
+
+    if(tree->free_handler) {
+      for(i = 0; i < node->count; i++)
+        tree->free_handler(leaf->items[i]);
+    }
+    RAPTOR_FREE(raptor_btree_leaf, leaf);
+  } else {
+    raptor_btree_inner* inner = (raptor_btree_inner*)node;
+    int i;
+
+    for(i = 0; i < node->count; i++)
+      raptor_free_btree_node(tree, inner->children[i]);
+    RAPTOR_FREE(raptor_btree_inner, inner);
+  }
+}
+
+
+/**
+ * raptor_free_btree:
+ * @tree: B+ Tree object
+ *
+ * INTERNAL - B+ Tree destructor
+ */
+void
+raptor_free_btree(raptor_btree* tree)
+{
+  if(!tree)
+    return;
+
+  if(tree->root)
+    raptor_free_btree_node(tree, tree->root);
+
+  if(tree->spare_leaf)
+    RAPTOR_FREE(raptor_btree_leaf, tree->spare_leaf);
+
+  while(tree->spare_inners) {
+    raptor_btree_inner* next;
+    next = (raptor_btree_inner*)tree->spare_inners->children[0];
+    RAPTOR_FREE(raptor_btree_inner, tree->spare_inners);
+    tree->spare_inners = next;
+  }
+
+  RAPTOR_FREE(raptor_btree, tree);
+}
+
+
+/* index of first item in @leaf not less than @data */
+static int
+raptor_btree_leaf_lower_bound(raptor_btree* tree, raptor_btree_leaf* leaf,
+                              const void* data)
+{
+  int lo = 0;
+  int hi = leaf->node.count;
+
+  while(lo < hi) {
+    int mid = (lo + hi) / 2;
+    if(tree->compare_handler(data, leaf->items[mid]) > 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+/* index of first item in @leaf greater than @data */
+static int
+raptor_btree_leaf_upper_bound(raptor_btree* tree, raptor_btree_leaf* leaf,
+                              const void* data)
+{
+  int lo = 0;
+  int hi = leaf->node.count;
+
+  while(lo < hi) {
+    int mid = (lo + hi) / 2;
+    if(tree->compare_handler(data, leaf->items[mid]) >= 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+
+/*
+ * raptor_btree_inner_child:
+ * @tree: B+ Tree object
+ * @inner: inner node
+ * @data: item
+ * @strict: non-0 to find the child of the first item equal to @data
+ *
+ * INTERNAL - Find the child of @inner that may hold @data
+ *
+ * Return value: child index
+ */
+static int
+raptor_btree_inner_child(raptor_btree* tree, raptor_btree_inner* inner,
+                         const void* data, int strict)
+{
+  int lo = 1;
+  int hi = inner->node.count;
+
+  /* find the first key above (or not below if @strict) @data */
+  while(lo < hi) {
+    int mid = (lo + hi) / 2;
+    int cmp = tree->compare_handler(data, inner->keys[mid]);
+    if(cmp > 0 || (!strict && !cmp))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo - 1;
+}
+
+
+static void*
+raptor_btree_subtree_min(raptor_btree_node* node)
+{
+  while(!node->is_leaf)
+    node = ((raptor_btree_inner*)node)->children[0];
+
+  return ((raptor_btree_leaf*)node)->items[0];
+}
+
+
+static raptor_btree_leaf*
+raptor_btree_first_leaf(raptor_btree* tree)
+{
+  raptor_btree_node* node = tree->root;
+
+  if(!node)
+    return NULL;
+
+  while(!node->is_leaf)
+    node = ((raptor_btree_inner*)node)->children[0];
+
+  return (raptor_btree_leaf*)node;
+}
+
+
+static raptor_btree_leaf*
+raptor_btree_leaf_for(raptor_btree* tree, const void* data, int strict)
+{
+  raptor_btree_node* node = tree->root;
+
+  if(!node)
+    return NULL;
+
+  while(!node->is_leaf) {
+    raptor_btree_inner* inner = (raptor_btree_inner*)node;
+    node = inner->children[raptor_btree_inner_child(tree, inner, data, strict)];
+  }
+
+  return (raptor_btree_leaf*)node;
+}
+
+
+/**
+ * raptor_btree_search:
+ * @tree: B+ Tree object
+ * @p_data: pointer to data item
+ *
+ * INTERNAL - Find an item in a B+ Tree
+ *
+ * Return value: the item or NULL if not found
+ */
+void*
+raptor_btree_search(raptor_btree* tree, const void* p_data)
+{
+  raptor_btree_leaf* leaf;
+  int i;
+
+  leaf = raptor_btree_leaf_for(tree, p_data, 0);
+  if(!leaf)
+    return NULL;
+
+  i = raptor_btree_leaf_lower_bound(tree, leaf, p_data);
+  if(i < leaf->node.count && !tree->compare_handler(p_data, leaf->items[i]))
+    return leaf->items[i];
+
+  return NULL;
+}
+
+
+/*
+ * raptor_btree_reserve:
+ * @tree: B+ Tree object
+ *
+ * INTERNAL - Make sure there are enough spare nodes for an add to
+ * split a leaf and every inner node above it including a new root
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_btree_reserve(raptor_btree* tree)
+{
+  if(!tree->spare_leaf) {
+    tree->spare_leaf = RAPTOR_MALLOC(raptor_btree_leaf*,
+                                     sizeof(*tree->spare_leaf));
+    if(!tree->spare_leaf)
+      return 1;
+  }
+
+  while(tree->spare_inners_count < tree->height + 1) {
+    raptor_btree_inner* inner;
+
+    inner = RAPTOR_MALLOC(raptor_btree_inner*, sizeof(*inner));
+    if(!inner)
+      return 1;
+    inner->children[0] = (raptor_btree_node*)tree->spare_inners;
+    tree->spare_inners = inner;
+    tree->spare_inners_count++;
+  }
+
+  return 0;
+}
+
+
+static raptor_btree_inner*
+raptor_btree_take_spare_inner(raptor_btree* tree)
+{
+  raptor_btree_inner* inner = tree->spare_inners;
+
+  tree->spare_inners = (raptor_btree_inner*)inner->children[0];
+  tree->spare_inners_count--;
+
+  return inner;
+}
+
+
+static int
+raptor_btree_add_internal(raptor_btree* tree, raptor_btree_node* node,
+                          void* p_data,
+                          raptor_btree_node** split_p, void** split_key_p)
+{
+  *split_p = NULL;
+
+  if(node->is_leaf) {
+    raptor_btree_leaf* leaf = (raptor_btree_leaf*)node;
+    raptor_btree_leaf* right;
+    int i;
+
+    i = raptor_btree_leaf_lower_bound(tree, leaf, p_data);
+    if(i < node->count && !tree->compare_handler(p_data, leaf->items[i])) {
+      /* equivalent key */
+      if(tree->flags & RAPTOR_AVLTREE_FLAG_REPLACE_DUPLICATES) {
+        if(tree->free_handler)
+          tree->free_handler(leaf->items[i]);
+        leaf->items[i] = p_data;
+        return RAPTOR_BTREE_REPLACED;
+      }
+      if(tree->free_handler)
+        tree->free_handler(p_data);
+      return RAPTOR_BTREE_EXISTS;
+    }
+
+    if(node->count < RAPTOR_BTREE_LEAF_MAX) {
+      memmove(&leaf->items[i + 1], &leaf->items[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(void*));
+      leaf->items[i] = p_data;
+      node->count++;
+      return 0;
+    }
+
+    /* split full leaf into two halves */
+    right = tree->spare_leaf;
+    tree->spare_leaf = NULL;
+    right->node.is_leaf = 1;
+    right->node.count = RAPTOR_BTREE_LEAF_MAX - RAPTOR_BTREE_LEAF_MIN;
+    memcpy(right->items, &leaf->items[RAPTOR_BTREE_LEAF_MIN],
+           RAPTOR_GOOD_CAST(size_t, right->node.count) * sizeof(void*));
+    node->count = RAPTOR_BTREE_LEAF_MIN;
+
+    right->prev = leaf;
+    right->next = leaf->next;
+    if(leaf->next)
+      leaf->next->prev = right;
+    leaf->next = right;
+
+    if(i <= RAPTOR_BTREE_LEAF_MIN) {
+      memmove(&leaf->items[i + 1], &leaf->items[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(void*));
+      leaf->items[i] = p_data;
+      node->count++;
+    } else {
+      i -= RAPTOR_BTREE_LEAF_MIN;
+      memmove(&right->items[i + 1], &right->items[i],
+              RAPTOR_GOOD_CAST(size_t, right->node.count - i) * sizeof(void*));
+      right->items[i] = p_data;
+      right->node.count++;
+    }
+
+    *split_p = (raptor_btree_node*)right;
+    *split_key_p = right->items[0];
+    return 0;
+  } else {
+    raptor_btree_inner* inner = (raptor_btree_inner*)node;
+    raptor_btree_inner* right;
+    raptor_btree_node* child_split;
+    void* child_key;
+    int i;
+    int rc;
+
+    i = raptor_btree_inner_child(tree, inner, p_data, 0);
+    rc = raptor_btree_add_internal(tree, inner->children[i], p_data,
+                                   &child_split, &child_key);
+    if(rc == RAPTOR_BTREE_REPLACED && i > 0)
+      inner->keys[i] = raptor_btree_subtree_min(inner->children[i]);
+    if(!child_split)
+      return rc;
+
+    /* insert new child after child i */
+    i++;
+    if(node->count < RAPTOR_BTREE_INNER_MAX) {
+      memmove(&inner->keys[i + 1], &inner->keys[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(void*));
+      memmove(&inner->children[i + 1], &inner->children[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(raptor_btree_node*));
+      inner->keys[i] = child_key;
+      inner->children[i] = child_split;
+      node->count++;
+      return rc;
+    }
+
+    /* split full inner node into two halves */
+    right = raptor_btree_take_spare_inner(tree);
+    right->node.is_leaf = 0;
+    right->node.count = RAPTOR_BTREE_INNER_MAX - RAPTOR_BTREE_INNER_MIN;
+    memcpy(right->keys, &inner->keys[RAPTOR_BTREE_INNER_MIN],
+           RAPTOR_GOOD_CAST(size_t, right->node.count) * sizeof(void*));
+    memcpy(right->children, &inner->children[RAPTOR_BTREE_INNER_MIN],
+           RAPTOR_GOOD_CAST(size_t, right->node.count) * sizeof(raptor_btree_node*));
+    node->count = RAPTOR_BTREE_INNER_MIN;
+
+    if(i <= RAPTOR_BTREE_INNER_MIN) {
+      memmove(&inner->keys[i + 1], &inner->keys[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(void*));
+      memmove(&inner->children[i + 1], &inner->children[i],
+              RAPTOR_GOOD_CAST(size_t, node->count - i) * sizeof(raptor_btree_node*));
+      inner->keys[i] = child_key;
+      inner->children[i] = child_split;
+      node->count++;
+    } else {
+      i -= RAPTOR_BTREE_INNER_MIN;
+      memmove(&right->keys[i + 1], &right->keys[i],
+              RAPTOR_GOOD_CAST(size_t, right->node.count - i) * sizeof(void*));
+      memmove(&right->children[i + 1], &right->children[i],
+              RAPTOR_GOOD_CAST(size_t, right->node.count - i) * sizeof(raptor_btree_node*));
+      right->keys[i] = child_key;
+      right->children[i] = child_split;
+      right->node.count++;
+    }
+
+    *split_p = (raptor_btree_node*)right;
+    *split_key_p = right->keys[0];
+    return rc;
+  }
+}
+
+
+/**
+ * raptor_btree_add:
+ * @tree: B+ Tree object
+ * @p_data: pointer to data item
+ *
+ * INTERNAL - add an item to a B+ Tree
+ *
+ * The item added becomes owned by the B+ Tree and will be freed by
+ * the free_handler argument given to raptor_new_btree().
+ *
+ * Return value: 0 on success, >0 if equivalent item exists (and the old element remains in the tree), <0 on failure
+ */
+int
+raptor_btree_add(raptor_btree* tree, void* p_data)
+{
+  raptor_btree_node* split;
+  void* split_key;
+  int rc;
+
+  if(raptor_btree_reserve(tree)) {
+    if(tree->free_handler)
+      tree->free_handler(p_data);
+    return RAPTOR_BTREE_ENOMEM;
+  }
+
+  if(!tree->root) {
+    raptor_btree_leaf* leaf = tree->spare_leaf;
+
+    tree->spare_leaf = NULL;
+    memset(leaf, '\0', sizeof(*leaf));
+    leaf->node.is_leaf = 1;
+    tree->root = (raptor_btree_node*)leaf;
+  }
+
+  rc = raptor_btree_add_internal(tree, tree->root, p_data, &split, &split_key);
+
+  if(split) {
+    raptor_btree_inner* root = raptor_btree_take_spare_inner(tree);
+
+    root->node.is_leaf = 0;
+    root->node.count = 2;
+    root->keys[0] = NULL;
+    root->children[0] = tree->root;
+    root->keys[1] = split_key;
+    root->children[1] = split;
+    tree->root = (raptor_btree_node*)root;
+    tree->height++;
+  }
+
+  if(!rc)
+    tree->size++;
+
+  return (rc == RAPTOR_BTREE_REPLACED) ? 0 : rc;
+}
+
+
+/*
+ * raptor_btree_rebalance:
+ * @tree: B+ Tree object
+ * @parent: inner node
+ * @i: index of child of @parent with too few entries
+ *
+ * INTERNAL - Refill child @i of @parent from a sibling or merge them
+ */
+static void
+raptor_btree_rebalance(raptor_btree* tree, raptor_btree_inner* parent, int i)
+{
+  raptor_btree_node* child = parent->children[i];
+  raptor_btree_node* left = (i > 0) ? parent->children[i - 1] : NULL;
+  raptor_btree_node* right = (i + 1 < parent->node.count) ?
+                             parent->children[i + 1] : NULL;
+  int min = child->is_leaf ? RAPTOR_BTREE_LEAF_MIN : RAPTOR_BTREE_INNER_MIN;
+  int merge_into;
+
+  if(left && left->count > min) {
+    /* move last entry of left sibling to the front of child */
+    if(child->is_leaf) {
+      raptor_btree_leaf* c = (raptor_btree_leaf*)child;
+      raptor_btree_leaf* l = (raptor_btree_leaf*)left;
+
+      memmove(&c->items[1], &c->items[0],
+              RAPTOR_GOOD_CAST(size_t, child->count) * sizeof(void*));
+      c->items[0] = l->items[--left->count];
+    } else {
+      raptor_btree_inner* c = (raptor_btree_inner*)child;
+      raptor_btree_inner* l = (raptor_btree_inner*)left;
+
+      memmove(&c->keys[1], &c->keys[0],
+              RAPTOR_GOOD_CAST(size_t, child->count) * sizeof(void*));
+      memmove(&c->children[1], &c->children[0],
+              RAPTOR_GOOD_CAST(size_t, child->count) * sizeof(raptor_btree_node*));
+      c->children[0] = l->children[--left->count];
+      c->keys[1] = raptor_btree_subtree_min(c->children[1]);
+    }
+    child->count++;
+    return;
+  }
+
+  if(right && right->count > min) {
+    /* move first entry of right sibling to the end of child */
+    if(child->is_leaf) {
+      raptor_btree_leaf* c = (raptor_btree_leaf*)child;
+      raptor_btree_leaf* r = (raptor_btree_leaf*)right;
+
+      c->items[child->count] = r->items[0];
+      memmove(&r->items[0], &r->items[1],
+              RAPTOR_GOOD_CAST(size_t, right->count - 1) * sizeof(void*));
+    } else {
+      raptor_btree_inner* c = (raptor_btree_inner*)child;
+      raptor_btree_inner* r = (raptor_btree_inner*)right;
+
+      c->children[child->count] = r->children[0];
+      c->keys[child->count] = raptor_btree_subtree_min(r->children[0]);
+      memmove(&r->keys[0], &r->keys[1],
+              RAPTOR_GOOD_CAST(size_t, right->count - 1) * sizeof(void*));
+      memmove(&r->children[0], &r->children[1],
+              RAPTOR_GOOD_CAST(size_t, right->count - 1) * sizeof(raptor_btree_node*));
+    }
+    child->count++;
+    right->count--;
+    return;
+  }
+
+  /* merge child i into left sibling or right sibling into child */
+  if(left) {
+    merge_into = i - 1;
+  } else {
+    merge_into = i;
+  }
+  left = parent->children[merge_into];
+  right = parent->children[merge_into + 1];
+
+  if(left->is_leaf) {
+    raptor_btree_leaf* l = (raptor_btree_leaf*)left;
+    raptor_btree_leaf* r = (raptor_btree_leaf*)right;
+
+    memcpy(&l->items[left->count], r->items,
+           RAPTOR_GOOD_CAST(size_t, right->count) * sizeof(void*));
+    l->next = r->next;
+    if(r->next)
+      r->next->prev = l;
+    left->count += right->count;
+    RAPTOR_FREE(raptor_btree_leaf, r);
+  } else {
+    raptor_btree_inner* l = (raptor_btree_inner*)left;
+    raptor_btree_inner* r = (raptor_btree_inner*)right;
+
+    memcpy(&l->children[left->count], r->children,
+           RAPTOR_GOOD_CAST(size_t, right->count) * sizeof(raptor_btree_node*));
+    memcpy(&l->keys[left->count], r->keys,
+           RAPTOR_GOOD_CAST(size_t, right->count) * sizeof(void*));
+    l->keys[left->count] = raptor_btree_subtree_min(r->children[0]);
+    left->count += right->count;
+    RAPTOR_FREE(raptor_btree_inner, r);
+  }
+
+  i = merge_into + 1;
+  memmove(&parent->keys[i], &parent->keys[i + 1],
+          RAPTOR_GOOD_CAST(size_t, parent->node.count - i - 1) * sizeof(void*));
+  memmove(&parent->children[i], &parent->children[i + 1],
+          RAPTOR_GOOD_CAST(size_t, parent->node.count - i - 1) * sizeof(raptor_btree_node*));
+  parent->node.count--;
+}
+
+
+static void*
+raptor_btree_remove_internal(raptor_btree* tree, raptor_btree_node* node,
+                             const void* p_data)
+{
+  raptor_btree_inner* inner;
+  void* rdata;
+  int min;
+  int i;
+  int j;
+
+  if(node->is_leaf) {
+    raptor_btree_leaf* leaf = (raptor_btree_leaf*)node;
+
+    i = raptor_btree_leaf_lower_bound(tree, leaf, p_data);
+    if(i == node->count || tree->compare_handler(p_data, leaf->items[i]))
+      return NULL;
+
+    rdata = leaf->items[i];
+    memmove(&leaf->items[i], &leaf->items[i + 1],
+            RAPTOR_GOOD_CAST(size_t, node->count - i - 1) * sizeof(void*));
+    node->count--;
+    return rdata;
+  }
+
+  inner = (raptor_btree_inner*)node;
+  i = raptor_btree_inner_child(tree, inner, p_data, 0);
+  rdata = raptor_btree_remove_internal(tree, inner->children[i], p_data);
+  if(!rdata)
+    return NULL;
+
+  min = inner->children[i]->is_leaf ? RAPTOR_BTREE_LEAF_MIN :
+                                      RAPTOR_BTREE_INNER_MIN;
+  if(inner->children[i]->count < min)
+    raptor_btree_rebalance(tree, inner, i);
+
+  /* the removed item may have been the smallest under some of the
+   * children around i and so used as their key */
+  for(j = (i > 1) ? i - 1 : 1; j <= i + 1 && j < node->count; j++)
+    inner->keys[j] = raptor_btree_subtree_min(inner->children[j]);
+
+  return rdata;
+}
+
+
+/**
+ * raptor_btree_remove:
+ * @tree: B+ Tree object
+ * @p_data: pointer to data item
+ *
+ * INTERNAL - Remove an item from a B+ Tree and return it
+ *
+ * The item removed is no longer owned by the B+ Tree and is
+ * owned by the caller.
+ *
+ * Return value: object or NULL on failure or if not found
+ */
+void*
+raptor_btree_remove(raptor_btree* tree, void* p_data)
+{
+  raptor_btree_node* root = tree->root;
+  void* rdata;
+
+  if(!root)
+    return NULL;
+
+  rdata = raptor_btree_remove_internal(tree, root, p_data);
+  if(!rdata)
+    return NULL;
+
+  tree->size--;
+
+  if(!root->is_leaf && root->count == 1) {
+    tree->root = ((raptor_btree_inner*)root)->children[0];
+    tree->height--;
+    RAPTOR_FREE(raptor_btree_inner, root);
+  } else if(root->is_leaf && !root->count) {
+    tree->root = NULL;
+    RAPTOR_FREE(raptor_btree_leaf, root);
+  }
+
+  return rdata;
+}
+
+
+/**
+ * raptor_btree_delete:
+ * @tree: B+ Tree object
+ * @p_data: pointer to data item
+ *
+ * INTERNAL - Remove an item from a B+ Tree and free it
+ *
+ * Return value: non-0 if the item was found and deleted
+ */
+int
+raptor_btree_delete(raptor_btree* tree, void* p_data)
+{
+  void* rdata;
+
+  rdata = raptor_btree_remove(tree, p_data);
+  if(rdata) {
+    if(tree->free_handler)
+      tree->free_handler(rdata);
+  }
+
+  return (rdata != NULL);
+}
+
+
+/**
+ * raptor_btree_visit:
+ * @tree: B+ Tree object
+ * @visit_handler: visit function to call at each item
+ * @user_data: user data pointer fo visit function
+ *
+ * INTERNAL - Perform an in-order visit of the items in the B+ Tree
+ *
+ * The depth passed to @visit_handler is always 0.
+ *
+ * Return value: 0 if traversal was terminated early by @visit_handler
+ */
+int
+raptor_btree_visit(raptor_btree* tree,
+                   raptor_avltree_visit_handler visit_handler,
+                   void* user_data)
+{
+  raptor_btree_leaf* leaf;
+
+  for(leaf = raptor_btree_first_leaf(tree); leaf; leaf = leaf->next) {
+    int i;
+    for(i = 0; i < leaf->node.count; i++) {
+      if(!visit_handler(0, leaf->items[i], user_data))
+        return 0;
+    }
+  }
+
+  return 1;
+}
+
+
+/**
+ * raptor_btree_size:
+ * @tree: B+ Tree object
+ *
+ * INTERNAL - Get the number of items in the B+ Tree
+ *
+ * Return value: number of items in tree
+ */
+int
+raptor_btree_size(raptor_btree* tree)
+{
+  return RAPTOR_GOOD_CAST(int, tree->size);
+}
+
+
+/**
+ * raptor_btree_set_print_handler:
+ * @tree: B+ Tree object
+ * @print_handler: print function
+ *
+ * INTERNAL - Set the handler for printing an item in a tree
+ */
+void
+raptor_btree_set_print_handler(raptor_btree* tree,
+                               raptor_data_print_handler print_handler)
+{
+  tree->print_handler = print_handler;
+}
+
+
+/**
+ * raptor_new_btree_iterator:
+ * @tree: #raptor_btree object
+ * @range: range
+ * @range_free_handler: function to free @range object
+ * @direction: <0 to go 'backwards' otherwise 'forwards'
+ *
+ * INTERNAL - Get an in-order iterator for the start of a range, or the entire contents
+ *
+ * If @range is NULL, the entire tree is walked in order.  Otherwise
+ * the iterator covers the items that the tree comparison function
+ * matches (returns 0 for) against @range, as for
+ * raptor_new_avltree_iterator().
+ *
+ * Return value: a new #raptor_btree_iterator object or NULL on failure
+ **/
+raptor_btree_iterator*
+raptor_new_btree_iterator(raptor_btree* tree, void* range,
+                          raptor_data_free_handler range_free_handler,
+                          int direction)
+{
+  raptor_btree_iterator* iterator;
+  raptor_btree_leaf* leaf;
+  int i;
+
+  iterator = RAPTOR_CALLOC(raptor_btree_iterator*, 1, sizeof(*iterator));
+  if(!iterator)
+    return NULL;
+
+  iterator->tree = tree;
+  iterator->range = range;
+  iterator->range_free_handler = range_free_handler;
+  iterator->direction = direction;
+
+  if(!tree->root) {
+    iterator->is_finished = 1;
+    return iterator;
+  }
+
+  if(direction < 0) {
+    /* last item not above range (or tree) */
+    if(range) {
+      leaf = raptor_btree_leaf_for(tree, range, 0);
+      i = raptor_btree_leaf_upper_bound(tree, leaf, range) - 1;
+    } else {
+      raptor_btree_node* node = tree->root;
+      while(!node->is_leaf)
+        node = ((raptor_btree_inner*)node)->children[node->count - 1];
+      leaf = (raptor_btree_leaf*)node;
+      i = node->count - 1;
+    }
+    if(i < 0) {
+      leaf = leaf->prev;
+      if(leaf)
+        i = leaf->node.count - 1;
+    }
+  } else {
+    /* first item not below range (or tree) */
+    if(range) {
+      leaf = raptor_btree_leaf_for(tree, range, 1);
+      i = raptor_btree_leaf_lower_bound(tree, leaf, range);
+    } else {
+      leaf = raptor_btree_first_leaf(tree);
+      i = 0;
+    }
+    if(i == leaf->node.count) {
+      leaf = leaf->next;
+      i = 0;
+    }
+  }
+
+  iterator->leaf = leaf;
+  iterator->index = i;
+
+  if(!leaf ||
+     (range && tree->compare_handler(range, leaf->items[i])))
+    iterator->is_finished = 1;
+
+  return iterator;
+}
+
+
+/**
+ * raptor_free_btree_iterator:
+ * @iterator: B+ Tree iterator object
+ *
+ * INTERNAL - B+ Tree Iterator destructor
+ */
+void
+raptor_free_btree_iterator(raptor_btree_iterator* iterator)
+{
+  if(!iterator)
+    return;
+
+  if(iterator->range && iterator->range_free_handler)
+    iterator->range_free_handler(iterator->range);
+
+  RAPTOR_FREE(raptor_btree_iterator, iterator);
+}
+
+
+/**
+ * raptor_btree_iterator_is_end:
+ * @iterator: B+ Tree iterator object
+ *
+ * INTERNAL - Test if an iteration is finished
+ *
+ * Return value: non-0 if iteration is finished
+ */
+int
+raptor_btree_iterator_is_end(raptor_btree_iterator* iterator)
+{
+  return iterator->is_finished;
+}
+
+
+/**
+ * raptor_btree_iterator_next:
+ * @iterator: B+ Tree iterator object
+ *
+ * INTERNAL - Move iteration to next/prev object
+ *
+ * Return value: non-0 if iteration is finished
+ */
+int
+raptor_btree_iterator_next(raptor_btree_iterator* iterator)
+{
+  raptor_btree_leaf* leaf = iterator->leaf;
+
+  if(iterator->is_finished)
+    return 1;
+
+  if(iterator->direction < 0) {
+    if(--iterator->index < 0) {
+      leaf = leaf->prev;
+      if(leaf)
+        iterator->index = leaf->node.count - 1;
+    }
+  } else {
+    if(++iterator->index == leaf->node.count) {
+      leaf = leaf->next;
+      iterator->index = 0;
+    }
+  }
+  iterator->leaf = leaf;
+
+  if(!leaf ||
+     (iterator->range &&
+      iterator->tree->compare_handler(iterator->range,
+                                      leaf->items[iterator->index])))
+    iterator->is_finished = 1;
+
+  return iterator->is_finished;
+}
+
+
+/**
+ * raptor_btree_iterator_get:
+ * @iterator: B+ Tree iterator object
+ *
+ * INTERNAL - Get current iteration object
+ *
+ * Return value: object or NULL if iteration is finished
+ */
+void*
+raptor_btree_iterator_get(raptor_btree_iterator* iterator)
+{
+  if(iterator->is_finished)
+    return NULL;
+
+  return iterator->leaf->items[iterator->index];
+}
+
+
+/**
+ * raptor_btree_print:
+ * @tree: B+ Tree
+ * @stream: stream to print to
+ *
+ * INTERNAL - Print the items in the tree in order to a stream (for debugging)
+ *
+ * Return value: non-0 on failure
+ */
+int
+raptor_btree_print(raptor_btree* tree, FILE* stream)
+{
+  raptor_btree_iterator* iter;
+  int i;
+
+  fprintf(stream, "B+ Tree size %u\n", tree->size);
+  iter = raptor_new_btree_iterator(tree, NULL, NULL, 1);
+  if(!iter)
+    return 1;
+
+  for(i = 0; !raptor_btree_iterator_is_end(iter);
+      i++, raptor_btree_iterator_next(iter)) {
+    void* data = raptor_btree_iterator_get(iter);
+
+    fprintf(stream, "%d) ", i);
+    if(tree->print_handler)
+      tree->print_handler(data, stream);
+    else
+      fprintf(stream, "Data Node %p\n", data);
+  }
+  raptor_free_btree_iterator(iter);
+
+  return 0;
+}
+
+
+static int
+raptor_btree_check_node(raptor_btree* tree, raptor_btree_node* node,
+                        int is_root, void* low, void* high,
+                        raptor_btree_leaf** leaf_p, unsigned int* count_p)
+{
+  int depth = 0;
+  int i;
+
+  if(!is_root) {
+    int min = node->is_leaf ? RAPTOR_BTREE_LEAF_MIN : RAPTOR_BTREE_INNER_MIN;
+    if(node->count < min)
+      return -1;
+  }
+
+  if(node->is_leaf) {
+    raptor_btree_leaf* leaf = (raptor_btree_leaf*)node;
+
+    if(leaf->prev != *leaf_p)
+      return -1;
+    if(*leaf_p && (*leaf_p)->next != leaf)
+      return -1;
+    *leaf_p = leaf;
+
+    for(i = 0; i < node->count; i++) {
+      if(i && tree->compare_handler(leaf->items[i - 1], leaf->items[i]) >= 0)
+        return -1;
+      if(low && tree->compare_handler(leaf->items[i], low) < 0)
+        return -1;
+      if(high && tree->compare_handler(leaf->items[i], high) >= 0)
+        return -1;
+    }
+    /* the smallest item of a subtree is its key */
+    if(low && leaf->items[0] != low)
+      return -1;
+    *count_p += RAPTOR_GOOD_CAST(unsigned int, node->count);
+  } else {
+    raptor_btree_inner* inner = (raptor_btree_inner*)node;
+
+    if(node->count < 2)
+      return -1;
+
+    for(i = 0; i < node->count; i++) {
+      int d;
+      d = raptor_btree_check_node(tree, inner->children[i], 0,
+                                  i ? inner->keys[i] : low,
+                                  (i + 1 < node->count) ? inner->keys[i + 1] : high,
+                                  leaf_p, count_p);
+      if(d < 0 || (i && d != depth))
+        return -1;
+      depth = d;
+    }
+    depth++;
+  }
+
+  return depth;
+}
+
+
+/*
+ * raptor_btree_check:
+ * @tree: B+ Tree
+ *
+ * INTERNAL - Check the B+ Tree ordering, balance, keys and leaf links
+ *
+ * Return value: non-0 if the tree is inconsistent
+ */
+int
+raptor_btree_check(raptor_btree* tree)
+{
+  raptor_btree_leaf* leaf = NULL;
+  unsigned int count = 0;
+
+  if(!tree->root)
+    return tree->size != 0;
+
+  if(raptor_btree_check_node(tree, tree->root, 1, NULL, NULL, &leaf,
+                             &count) < 0)
+    return 1;
+
+  return (leaf->next != NULL || count != tree->size);
+}
+
+
+#endif
+
+
+
+#ifdef STANDALONE
+
+/* one more prototype */
+int main(int argc, char *argv[]);
+
+
+static int
+compare_ints(const void *l, const void *r)
+{
+  /* a negative value -(n + 1) is a range matching all items n*10 .. n*10+9 */
+  int i1 = *(const int*)l;
+  int i2 = *(const int*)r;
+
+  if(i1 < 0) {
+    i1 = -i1 - 1;
+    i2 /= 10;
+  } else if(i2 < 0) {
+    i2 = -i2 - 1;
+    i1 /= 10;
+  }
+
+  return (i1 > i2) - (i1 < i2);
+}
+
+
+static int
+count_visit(int depth, void* data, void *user_data)
+{
+  int* count = (int*)user_data;
+
+  (*count)++;
+  return 1;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  const char *program = raptor_basename(argv[0]);
+#define ITEM_COUNT 20000
+  int* values;
+  char* present;
+  raptor_btree* tree;
+  raptor_btree_iterator* iter;
+  int count;
+  int i;
+  unsigned int seed = 1;
+  int rc = 0;
+
+  values = (int*)malloc(ITEM_COUNT * sizeof(int));
+  present = (char*)calloc(ITEM_COUNT, 1);
+  for(i = 0; i < ITEM_COUNT; i++)
+    values[i] = i;
+
+  tree = raptor_new_btree(compare_ints, NULL, 0);
+  if(!tree) {
+    fprintf(stderr, "%s: Failed to create tree\n", program);
+    return 1;
+  }
+
+  /* random adds and deletes checked against a presence map */
+  for(i = 0; i < ITEM_COUNT * 8; i++) {
+    int v;
+
+    seed = seed * 1103515245U + 12345U;
+    v = RAPTOR_GOOD_CAST(int, (seed >> 8) % ITEM_COUNT);
+
+    if(((seed >> 4) & 3) && !present[v]) {
+      if(raptor_btree_add(tree, &values[v])) {
+        fprintf(stderr, "%s: Adding item %d failed\n", program, v);
+        return 1;
+      }
+      present[v] = 1;
+    } else {
+      int found = raptor_btree_delete(tree, &values[v]);
+      if(found != present[v]) {
+        fprintf(stderr, "%s: Deleting item %d returned %d expected %d\n",
+                program, v, found, present[v]);
+        return 1;
+      }
+      present[v] = 0;
+    }
+
+    if(!(i % 997) && raptor_btree_check(tree)) {
+      fprintf(stderr, "%s: Tree check failed after %d operations\n",
+              program, i);
+      return 1;
+    }
+  }
+
+  if(raptor_btree_check(tree)) {
+    fprintf(stderr, "%s: Tree check failed\n", program);
+    return 1;
+  }
+
+  for(i = 0, count = 0; i < ITEM_COUNT; i++) {
+    if((raptor_btree_search(tree, &values[i]) != NULL) != present[i]) {
+      fprintf(stderr, "%s: Search for item %d failed\n", program, i);
+      return 1;
+    }
+    count += present[i];
+  }
+
+  if(count != raptor_btree_size(tree)) {
+    fprintf(stderr, "%s: Tree size %d expected %d\n", program,
+            raptor_btree_size(tree), count);
+    return 1;
+  }
+
+  if(raptor_btree_add(tree, &values[0]) != (present[0] ? 1 : 0)) {
+    fprintf(stderr, "%s: Adding item 0 again did not report it\n", program);
+    return 1;
+  }
+  if(!present[0])
+    count++;
+  present[0] = 1;
+
+  /* forwards and backwards iteration */
+  iter = raptor_new_btree_iterator(tree, NULL, NULL, 1);
+  for(i = -1; !raptor_btree_iterator_is_end(iter); raptor_btree_iterator_next(iter)) {
+    int v = *(int*)raptor_btree_iterator_get(iter);
+    if(v <= i || !present[v]) {
+      fprintf(stderr, "%s: Forwards iterator returned %d after %d\n",
+              program, v, i);
+      return 1;
+    }
+    i = v;
+  }
+  raptor_free_btree_iterator(iter);
+
+  iter = raptor_new_btree_iterator(tree, NULL, NULL, -1);
+  for(i = ITEM_COUNT; !raptor_btree_iterator_is_end(iter); raptor_btree_iterator_next(iter)) {
+    int v = *(int*)raptor_btree_iterator_get(iter);
+    if(v >= i || !present[v]) {
+      fprintf(stderr, "%s: Backwards iterator returned %d after %d\n",
+              program, v, i);
+      return 1;
+    }
+    i = v;
+  }
+  raptor_free_btree_iterator(iter);
+
+  /* range iteration in both directions */
+  for(i = 0; i < ITEM_COUNT / 10; i += 37) {
+    int range = -(i + 1);
+    int expected = 0;
+    int j;
+    int d;
+
+    for(j = i * 10; j < i * 10 + 10; j++)
+      expected += present[j];
+
+    for(d = -1; d <= 1; d += 2) {
+      int got = 0;
+      iter = raptor_new_btree_iterator(tree, &range, NULL, d);
+      for(; !raptor_btree_iterator_is_end(iter); raptor_btree_iterator_next(iter)) {
+        int v = *(int*)raptor_btree_iterator_get(iter);
+        if(v / 10 != i) {
+          fprintf(stderr, "%s: Range %d iterator returned %d\n", program,
+                  i, v);
+          return 1;
+        }
+        got++;
+      }
+      raptor_free_btree_iterator(iter);
+      if(got != expected) {
+        fprintf(stderr, "%s: Range %d direction %d returned %d items expected %d\n",
+                program, i, d, got, expected);
+        return 1;
+      }
+    }
+  }
+
+  i = 0;
+  raptor_btree_visit(tree, count_visit, &i);
+  if(i != count) {
+    fprintf(stderr, "%s: Visit saw %d items expected %d\n", program, i, count);
+    return 1;
+  }
+
+  /* remove everything */
+  for(i = 0; i < ITEM_COUNT; i++) {
+    if(present[i] && raptor_btree_remove(tree, &values[i]) != &values[i]) {
+      fprintf(stderr, "%s: Removing item %d failed\n", program, i);
+      return 1;
+    }
+  }
+  if(raptor_btree_size(tree) || raptor_btree_check(tree)) {
+    fprintf(stderr, "%s: Emptied tree is not empty\n", program);
+    rc = 1;
+  }
+
+  raptor_free_btree(tree);
+  free(present);
+  free(values);
+
+  return rc;
+}
+
+#endif
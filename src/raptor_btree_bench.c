@@ -0,0 +1,274 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_btree_bench.c - Raptor ordered container benchmark
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Compares the B+ tree against the AVL tree.  For each count of
+ * distinct integer keys it times inserting them in a scattered order,
+ * looking them all up again in another scattered order, iterating
+ * over the whole container in order and deleting every key.  Small
+ * counts are repeated so that each measurement covers at least
+ * BENCH_MIN_OPS operations.  Results are in millions of operations
+ * per second.
+ *
+ * Usage: raptor_btree_bench [COUNT...]
+ * Default counts are 10000 100000 1000000 10000000 - a count of
+ * 100000000 needs several gigabytes of memory for the AVL tree.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+int main(int argc, char *argv[]);
+
+
+static const char *program;
+
+#define BENCH_MIN_OPS 10000000UL
+
+/* visit 0..count-1 in a scattered order; the strides are prime */
+#define BENCH_STRIDE1 2654435761UL
+#define BENCH_STRIDE2 2246822519UL
+#define BENCH_SCATTER(i, count, stride) \
+  ((unsigned long)(((unsigned long long)(i) * (stride)) % (count)))
+
+
+typedef struct {
+  double insert;
+  double lookup;
+  double iterate;
+  double remove;
+} bench_times;
+
+
+static int
+bench_key_compare(const void* a, const void* b)
+{
+  unsigned long k1 = *(const unsigned long*)a;
+  unsigned long k2 = *(const unsigned long*)b;
+
+  return (k1 > k2) - (k1 < k2);
+}
+
+
+static double
+bench_seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+static int
+bench_avltree(unsigned long* keys, unsigned long count, bench_times* times)
+{
+  raptor_avltree* tree;
+  raptor_avltree_iterator* iter;
+  unsigned long i;
+  unsigned long n;
+  clock_t start;
+
+  tree = raptor_new_avltree(bench_key_compare, NULL, 0);
+  if(!tree)
+    return 1;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    if(raptor_avltree_add(tree, &keys[BENCH_SCATTER(i, count, BENCH_STRIDE1)]))
+      return 1;
+  }
+  times->insert += bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    unsigned long j = BENCH_SCATTER(i, count, BENCH_STRIDE2);
+    if(raptor_avltree_search(tree, &keys[j]) != &keys[j])
+      return 1;
+  }
+  times->lookup += bench_seconds(start);
+
+  start = clock();
+  n = 0;
+  for(iter = raptor_new_avltree_iterator(tree, NULL, NULL, 1);
+      iter && !raptor_avltree_iterator_is_end(iter);
+      raptor_avltree_iterator_next(iter)) {
+    if(*(unsigned long*)raptor_avltree_iterator_get(iter) != n++)
+      return 1;
+  }
+  raptor_free_avltree_iterator(iter);
+  times->iterate += bench_seconds(start);
+  if(n != count)
+    return 1;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    if(!raptor_avltree_delete(tree, &keys[BENCH_SCATTER(i, count, BENCH_STRIDE2)]))
+      return 1;
+  }
+  times->remove += bench_seconds(start);
+
+  raptor_free_avltree(tree);
+  return 0;
+}
+
+
+static int
+bench_btree(unsigned long* keys, unsigned long count, bench_times* times)
+{
+  raptor_btree* tree;
+  raptor_btree_iterator* iter;
+  unsigned long i;
+  unsigned long n;
+  clock_t start;
+
+  tree = raptor_new_btree(bench_key_compare, NULL, 0);
+  if(!tree)
+    return 1;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    if(raptor_btree_add(tree, &keys[BENCH_SCATTER(i, count, BENCH_STRIDE1)]))
+      return 1;
+  }
+  times->insert += bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    unsigned long j = BENCH_SCATTER(i, count, BENCH_STRIDE2);
+    if(raptor_btree_search(tree, &keys[j]) != &keys[j])
+      return 1;
+  }
+  times->lookup += bench_seconds(start);
+
+  start = clock();
+  n = 0;
+  for(iter = raptor_new_btree_iterator(tree, NULL, NULL, 1);
+      iter && !raptor_btree_iterator_is_end(iter);
+      raptor_btree_iterator_next(iter)) {
+    if(*(unsigned long*)raptor_btree_iterator_get(iter) != n++)
+      return 1;
+  }
+  raptor_free_btree_iterator(iter);
+  times->iterate += bench_seconds(start);
+  if(n != count)
+    return 1;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    if(!raptor_btree_delete(tree, &keys[BENCH_SCATTER(i, count, BENCH_STRIDE2)]))
+      return 1;
+  }
+  times->remove += bench_seconds(start);
+
+  raptor_free_btree(tree);
+  return 0;
+}
+
+
+static void
+bench_report(const char* name, unsigned long count, unsigned long rounds,
+             bench_times* times)
+{
+  double ops = (double)count * (double)rounds / 1e6;
+
+  fprintf(stdout,
+          "%-6s %10lu  insert %7.2f  lookup %7.2f  iterate %8.2f  delete %7.2f Mops/s\n",
+          name, count,
+          ops / times->insert, ops / times->lookup,
+          ops / times->iterate, ops / times->remove);
+}
+
+
+static int
+bench_count(unsigned long count)
+{
+  unsigned long* keys;
+  unsigned long rounds;
+  unsigned long r;
+  unsigned long i;
+  bench_times avl_times;
+  bench_times btree_times;
+
+  keys = RAPTOR_MALLOC(unsigned long*, count * sizeof(unsigned long));
+  if(!keys)
+    return 1;
+  for(i = 0; i < count; i++)
+    keys[i] = i;
+
+  rounds = (count < BENCH_MIN_OPS) ? BENCH_MIN_OPS / count : 1;
+
+  memset(&avl_times, '\0', sizeof(avl_times));
+  memset(&btree_times, '\0', sizeof(btree_times));
+  for(r = 0; r < rounds; r++) {
+    if(bench_avltree(keys, count, &avl_times) ||
+       bench_btree(keys, count, &btree_times)) {
+      RAPTOR_FREE(unsigned long*, keys);
+      return 1;
+    }
+  }
+
+  bench_report("avl", count, rounds, &avl_times);
+  bench_report("btree", count, rounds, &btree_times);
+
+  RAPTOR_FREE(unsigned long*, keys);
+  return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  static const char* default_counts[5] = {
+    "10000", "100000", "1000000", "10000000", NULL
+  };
+  const char* const* counts;
+  int i;
+
+  program = raptor_basename(argv[0]);
+
+  counts = (argc > 1) ? (const char* const*)&argv[1] : default_counts;
+
+  for(i = 0; counts[i]; i++) {
+    unsigned long count = strtoul(counts[i], NULL, 10);
+
+    if(!count) {
+      fprintf(stderr, "%s: Bad count '%s'\n", program, counts[i]);
+      return 1;
+    }
+
+    if(bench_count(count)) {
+      fprintf(stderr, "%s: Benchmark failed for %lu keys\n", program, count);
+      return 1;
+    }
+  }
+
+  return 0;
+}
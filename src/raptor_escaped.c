@@ -59,11 +59,45 @@ raptor_string_escaped_write(const unsigned char *string,
   unsigned char c;
   int unichar_len;
   raptor_unichar unichar;
+  size_t string_len = len;
+  unsigned char low = 0x01;
+  char stops[RAPTOR_NTRIPLES_SPAN_MAX_STOPS + 1];
+  char *stop = stops;
 
   if(!string)
     return 1;
+
+  /* bytes that are not written as-is by the loop below */
+  *stop++ = '\\';
+  if(delim)
+    *stop++ = delim;
+  if(flags & RAPTOR_ESCAPED_WRITE_BITFLAG_SPARQL_URI_ESCAPES) {
+    low = 0x21;
+    memcpy(stop, "<>\"{}|^`", 8);
+    stop += 8;
+  } else if(flags & RAPTOR_ESCAPED_WRITE_BITFLAG_BS_ESCAPES_TNRU)
+    low = 0x20;
+  else if(flags & RAPTOR_ESCAPED_WRITE_BITFLAG_BS_ESCAPES_BF) {
+    *stop++ = 0x08;
+    *stop++ = 0x0b;
+  }
+  *stop = '\0';
   
   for(; (c=*string); string++, len--) {
+    /* copy a run of bytes needing no escapes in one write */
+    if(len <= string_len) {
+      size_t run = raptor_ntriples_span(string, len, stops, low, 0x7e);
+
+      if(run) {
+        raptor_iostream_counted_string_write(string, run, iostr);
+        string += run;
+        len -= run;
+        c = *string;
+        if(!c)
+          break;
+      }
+    }
+
     if((delim && c == delim && (delim == '\'' || delim == '"')) ||
        c == '\\') {
       raptor_iostream_write_byte('\\', iostr);
@@ -146,6 +146,10 @@ raptor_new_world_internal(unsigned int version_decimal)
     world->uri_interning = 1;
 
     world->internal_ignore_errors = 0;
+
+#ifdef RAPTOR_THREADS
+    pthread_mutex_init(&world->mutex, NULL);
+#endif
   }
   
   return world;
@@ -177,6 +181,18 @@ raptor_world_open(raptor_world* world)
   if(world->opened)
     return 0; /* not an error */
 
+  /* libxml error handlers are process-wide so cannot be saved and
+   * restored by several threads; refuse handler flags the caller
+   * asked for rather than silently dropping them */
+  if(world->thread_safe) {
+    if(world->libxml_flags_set && world->libxml_flags) {
+      raptor_log_error(world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                       "libxml error handler saving cannot be used with a thread-safe world");
+      return 1;
+    }
+    world->libxml_flags = 0;
+  }
+
   world->opened = 1;
 
   rc = raptor_uri_init(world);
@@ -246,6 +262,10 @@ raptor_free_world(raptor_world* world)
 
   raptor_uri_finish(world);
 
+#ifdef RAPTOR_THREADS
+  pthread_mutex_destroy(&world->mutex);
+#endif
+
   RAPTOR_FREE(raptor_world, world);
 }
 
@@ -293,7 +313,7 @@ raptor_world_default_generate_bnodeid_handler(void *user_data,
   if(user_bnodeid)
     return user_bnodeid;
 
-  id = ++world->default_generate_bnodeid_handler_base;
+  id = RAPTOR_WORLD_INCREMENT(world, &world->default_generate_bnodeid_handler_base);
 
   id_length = raptor_format_integer(NULL, 0, id, /* base */ 10, -1, '\0');
 
@@ -467,6 +487,7 @@ raptor_world_set_flag(raptor_world *world, raptor_world_flag flag, int value)
         world->libxml_flags |= (int)flag;
       else
         world->libxml_flags &= ~(int)flag;
+      world->libxml_flags_set = 1;
       break;
 
     case RAPTOR_WORLD_FLAG_URI_INTERNING:
@@ -476,6 +497,15 @@ raptor_world_set_flag(raptor_world *world, raptor_world_flag flag, int value)
     case RAPTOR_WORLD_FLAG_WWW_SKIP_INIT_FINISH:
       world->www_skip_www_init_finish = value;
       break;
+
+    case RAPTOR_WORLD_FLAG_THREAD_SAFE:
+#ifdef RAPTOR_THREADS
+      world->thread_safe = value;
+#else
+      if(value)
+        rc = -2;
+#endif
+      break;
   }
 
   return rc;
@@ -124,6 +124,7 @@ struct raptor_grddl_parser_context_s {
    */
   void* saved_user_data;
   raptor_statement_handler saved_statement_handler;
+  raptor_statement_batch_handler saved_statement_batch_handler;
 
   /* URI data-view:namespaceTransformation */
   raptor_uri* namespace_transformation_uri;
@@ -382,6 +383,7 @@ raptor_grddl_parser_add_parent(raptor_parser *rdf_parser,
 
   grddl_parser->saved_user_data = parent_grddl_parser->rdf_parser;
   grddl_parser->saved_statement_handler = raptor_grddl_filter_triples;
+  grddl_parser->saved_statement_batch_handler = NULL;
 }
 
     
@@ -643,15 +645,18 @@ raptor_grddl_ensure_internal_parser(raptor_parser* rdf_parser,
     
     grddl_parser->saved_user_data = rdf_parser->user_data;
     grddl_parser->saved_statement_handler = rdf_parser->statement_handler;
+    grddl_parser->saved_statement_batch_handler = rdf_parser->statement_batch_handler;
   }
 
   /* Filter the triples for profile/namespace URIs */
   if(filter) {
     grddl_parser->internal_parser->user_data = rdf_parser;
     grddl_parser->internal_parser->statement_handler = raptor_grddl_filter_triples;
+    grddl_parser->internal_parser->statement_batch_handler = NULL;
   } else {
     grddl_parser->internal_parser->user_data = grddl_parser->saved_user_data;
     grddl_parser->internal_parser->statement_handler = grddl_parser->saved_statement_handler;
+    grddl_parser->internal_parser->statement_batch_handler = grddl_parser->saved_statement_batch_handler;
   }
 
   return 0;
@@ -422,9 +422,25 @@ void raptor_concepts_finish(raptor_world* world);
 
 /* raptor_iostream.c */
 raptor_world* raptor_iostream_get_world(raptor_iostream *iostr);
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+#define RAPTOR_IOSTREAM_COMPRESSION 1
+int raptor_compression_file_handle_peek(FILE* handle);
+#endif
 
 
 /* Raptor Namespace Stack node */
+/* Entry in the namespace stack cache of namespace URI + local name URIs */
+typedef struct {
+  /* namespace URI (a reference is held) or NULL if the slot is empty */
+  raptor_uri *ns_uri;
+  unsigned char *local_name;
+  size_t local_name_length;
+  unsigned int hash;
+  /* URI of namespace URI + local name */
+  raptor_uri *uri;
+} raptor_namespace_uri_cache_entry;
+
+
 struct raptor_namespace_stack_s {
   raptor_world* world;
   int size;
@@ -435,8 +451,21 @@ struct raptor_namespace_stack_s {
 
   raptor_uri *rdf_ms_uri;
   raptor_uri *rdf_schema_uri;
+
+  /* cache of qname URIs keyed by namespace URI and local name,
+   * allocated on first use */
+  raptor_namespace_uri_cache_entry* uri_cache;
+  int uri_cache_count;
+  /* cache statistics */
+  int uri_cache_hits;
+  int uri_cache_misses;
 };
 
+raptor_uri* raptor_namespaces_local_name_to_uri(raptor_namespace_stack *nstack, raptor_uri *ns_uri, const unsigned char *local_name, size_t local_name_length);
+#ifdef RAPTOR_DEBUG
+void raptor_namespaces_stats_print(raptor_namespace_stack *nstack, FILE *stream);
+#endif
+
 
 /* Forms:
  * 1) prefix=NULL uri=<URI>      - default namespace defined
@@ -482,6 +511,23 @@ raptor_namespace** raptor_namespace_stack_to_array(raptor_namespace_stack *nstac
 #endif
 
 
+/* Statistics of reading parser input for raptor_stats_print() */
+typedef struct {
+  /* blocks and bytes passed to the parser */
+  unsigned long reads;
+  size_t bytes;
+  /* largest read size */
+  size_t read_size;
+  /* buffers read ahead by a thread; 0 if reads were made on demand */
+  int read_ahead;
+  /* seconds the parser waited for input and spent parsing it */
+  double input_wait;
+  double parse_time;
+  /* seconds the read-ahead thread waited for a free buffer */
+  double reader_wait;
+} raptor_read_stats;
+
+
 /*
  * Raptor parser object
  */
@@ -525,6 +571,17 @@ struct raptor_parser_s {
   /* parser callbacks */
   raptor_statement_handler statement_handler;
 
+  raptor_statement_batch_handler statement_batch_handler;
+
+  /* batch_size reusable statement slots for statement_batch_handler
+   * that own their terms and are cleared after each delivery, and the
+   * array of pointers to them passed to the handler.  batch_count of
+   * batch_size are used.  Allocated on the first statement. */
+  raptor_statement* batch_statements;
+  raptor_statement** batch;
+  int batch_size;
+  int batch_count;
+
   raptor_graph_mark_handler graph_mark_handler;
 
   void* uri_filter_user_data;
@@ -548,6 +605,10 @@ struct raptor_parser_s {
   /* internal data for lexers */
   void* lexer_user_data;
 
+  /* statistics of the last raptor_parser_parse_file_stream() or
+   * raptor_parser_parse_iostream() */
+  raptor_read_stats read_stats;
+
   /* internal read buffer */
   unsigned char buffer[RAPTOR_READ_BUFFER_SIZE + 1];
 };
@@ -605,6 +666,13 @@ struct raptor_parser_factory_s {
 
   /* get the locator (OPTIONAL) */
   raptor_locator* (*get_locator)(raptor_parser* rdf_parser);
+
+  /* parse all content in one read-only buffer such as a memory
+   * mapped file (OPTIONAL) - if not implemented, content is passed
+   * in blocks to the chunk method.  The buffer is valid and unchanged
+   * until the method returns.
+   */
+  int (*parse_buffer)(raptor_parser* parser, const unsigned char *buffer, size_t len);
 };
 
 
@@ -678,6 +746,9 @@ struct raptor_serializer_factory_s {
 
   /* flush current serialization state */
   int (*serialize_flush)(raptor_serializer* serializer);
+
+  /* serialize an ordered batch of statements (optional) */
+  int (*serialize_statements)(raptor_serializer* serializer, raptor_statement **statements, int count);
 };
 
 
@@ -710,8 +781,38 @@ void raptor_stats_print(raptor_parser *rdf_parser, FILE *stream);
 RAPTOR_INTERNAL_API const char* raptor_basename(const char *name);
 int raptor_term_print_as_ntriples(const raptor_term *term, FILE* stream);
 
+/* raptor_term.c */
+typedef struct raptor_term_arena_s raptor_term_arena;
+raptor_term_arena* raptor_new_term_arena(raptor_world* world);
+void raptor_free_term_arena(raptor_term_arena* arena);
+void raptor_term_arena_reset(raptor_term_arena* arena);
+raptor_term* raptor_term_arena_new_uri(raptor_term_arena* arena, raptor_uri* uri);
+raptor_term* raptor_term_arena_new_literal(raptor_term_arena* arena, const unsigned char* literal, size_t literal_len, raptor_uri* datatype, const unsigned char* language, unsigned char language_len);
+raptor_term* raptor_term_arena_new_blank(raptor_term_arena* arena, const unsigned char* blank, size_t length);
+
 /* raptor_ntriples.c */
-size_t raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator, unsigned char *string, size_t *len_p, raptor_term** term_p, int allow_turtle);
+
+/* An N-Triples term found by raptor_ntriples_scan_term().  The strings
+ * point into the input and are not NUL terminated.
+ */
+typedef struct {
+  raptor_term_type type;
+  /* URI, literal or blank node ID */
+  const unsigned char *string;
+  size_t length;
+  /* literal language before normalising case or NULL */
+  const unsigned char *language;
+  unsigned char language_len;
+  /* literal datatype URI or NULL */
+  const unsigned char *datatype;
+  size_t datatype_len;
+} raptor_ntriples_token;
+
+/* most stop bytes raptor_ntriples_span() accepts */
+#define RAPTOR_NTRIPLES_SPAN_MAX_STOPS 16
+size_t raptor_ntriples_span(const unsigned char *p, size_t len, const char *stops, unsigned char low, unsigned char high);
+size_t raptor_ntriples_scan_term(const unsigned char *string, size_t len, raptor_ntriples_token* token);
+size_t raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator, unsigned char *string, size_t *len_p, raptor_term** term_p, int allow_turtle, raptor_term_arena* arena);
 
 /* raptor_parse.c */
 raptor_parser_factory* raptor_world_get_parser_factory(raptor_world* world, const char *name);  
@@ -748,6 +849,16 @@ void raptor_xml_comment_handler(void *user_data, const unsigned char *s);
 void raptor_rdfxml_parser_stats_print(raptor_rdfxml_parser* rdf_xml_parser, FILE *stream);
 #endif
 
+/* ntriples_parse.c */
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+void raptor_ntriples_parser_stats_print(raptor_parser* rdf_parser, FILE *stream);
+#endif
+
+/* turtle_parser.y */
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+void raptor_turtle_parser_stats_print(raptor_parser* rdf_parser, FILE *stream);
+#endif
+
 void raptor_parser_copy_flags_state(raptor_parser *to_parser, raptor_parser *from_parser);
 int raptor_parser_copy_user_state(raptor_parser *to_parser, raptor_parser *from_parser);
 
@@ -804,6 +915,7 @@ struct raptor_qname_s {
 
 
 /* raptor_qname.c */
+raptor_qname* raptor_new_qname_from_namespace_counted_local_name(raptor_namespace_stack *nstack, const raptor_namespace *ns, const unsigned char *local_name, size_t local_name_length, unsigned char *value, size_t value_length);
 #ifdef RAPTOR_DEBUG
 void raptor_qname_print(FILE *stream, raptor_qname* name);
 #endif
@@ -815,6 +927,7 @@ int raptor_uri_init(raptor_world* world);
 void raptor_uri_finish(raptor_world* world);
 raptor_uri* raptor_new_uri_from_rdf_ordinal(raptor_world* world, int ordinal);
 size_t raptor_uri_normalize_path(unsigned char* path_buffer, size_t path_len);
+unsigned int raptor_uri_get_hash(raptor_uri *uri);
 
 /* parsers */
 int raptor_init_parser_rdfxml(raptor_world* world);
@@ -829,6 +942,7 @@ int raptor_init_parser_rss(raptor_world* world);
 int raptor_init_parser_rdfa(raptor_world* world);
 int raptor_init_parser_json(raptor_world* world);
 int raptor_init_parser_nquads(raptor_world* world);
+int raptor_init_parser_binary(raptor_world* world);
 
 void raptor_terminate_parser_grddl_common(raptor_world *world);
 
@@ -851,6 +965,7 @@ void raptor_terminate_parser_grddl_common(raptor_world *world);
 #define rdfa_create_mapping raptor_librdfa_rdfa_create_mapping
 #define rdfa_create_new_element_context raptor_librdfa_rdfa_create_new_element_context
 #define rdfa_create_triple raptor_librdfa_rdfa_create_triple
+#define rdfa_delete_mapping raptor_librdfa_rdfa_delete_mapping
 #define rdfa_establish_new_1_0_subject raptor_librdfa_rdfa_establish_new_1_0_subject
 #define rdfa_establish_new_1_0_subject_with_relrev raptor_librdfa_ablish_new_1_0_subject_with_relrev
 #define rdfa_establish_new_1_1_subject raptor_librdfa_ablish_new_1_1_subject
@@ -865,6 +980,7 @@ void raptor_terminate_parser_grddl_common(raptor_world *world);
 #define rdfa_get_curie_type raptor_librdfa_rdfa_get_curie_type
 #define rdfa_get_list_mapping raptor_librdfa_rdfa_get_list_mapping
 #define rdfa_get_mapping raptor_librdfa_rdfa_get_mapping
+#define rdfa_get_mapping_for_update raptor_librdfa_rdfa_get_mapping_for_update
 #define rdfa_init_base raptor_librdfa_rdfa_init_base
 #define rdfa_init_context raptor_librdfa_rdfa_init_context
 #define rdfa_iri_get_base raptor_librdfa_rdfa_iri_get_base
@@ -908,6 +1024,8 @@ void raptor_parsers_finish(raptor_world *world);
 
 void raptor_parser_save_content(raptor_parser* rdf_parser, int save);
 const unsigned char* raptor_parser_get_content(raptor_parser* rdf_parser, size_t* length_p);
+void raptor_parser_emit_statement(raptor_parser* parser, raptor_statement* statement);
+void raptor_parser_flush_statements(raptor_parser* parser);
 void raptor_parser_start_graph(raptor_parser* parser, raptor_uri* uri, int is_declared);
 void raptor_parser_end_graph(raptor_parser* parser, raptor_uri* uri, int is_declared);
 
@@ -921,6 +1039,7 @@ extern const unsigned char * const raptor_atom_namespace_uri;
 RAPTOR_INTERNAL_API raptor_uri_detail* raptor_new_uri_detail(const unsigned char *uri_string);
 RAPTOR_INTERNAL_API void raptor_free_uri_detail(raptor_uri_detail* uri_detail);
 unsigned char* raptor_uri_detail_to_string(raptor_uri_detail *ud, size_t* len_p);
+size_t raptor_uri_resolve_uri_reference_detail(const unsigned char *base_uri, raptor_uri_detail *base, const unsigned char *reference_uri, size_t reference_len, unsigned char *buffer, size_t length);
 
 /* serializers */
 /* raptor_serializer.c */
@@ -950,6 +1069,49 @@ int raptor_init_serializer_html(raptor_world* world);
 /* raptor_serialize_json.c */  
 int raptor_init_serializer_json(raptor_world* world);
 
+/* raptor_serialize_binary.c */
+int raptor_init_serializer_binary(raptor_world* world);
+
+/*
+ * Binary RDF syntax shared by raptor_binary.c and
+ * raptor_serialize_binary.c
+ *
+ * A stream is RAPTOR_BINARY_MAGIC, a version byte and then records.
+ * Each record is a tag byte followed by unsigned LEB128 varints and
+ * strings written as a varint byte length then the bytes, unescaped
+ * UTF-8.  Definition records add the next entry to one of the
+ * per-stream dictionaries, numbered from 0 in order of definition:
+ *   'p' len prefix            - IRI prefix (numbered from 1)
+ *   'i' prefix-id len suffix  - IRI: prefix (0 for none) + suffix
+ *   'b' len blank-id          - blank node ID
+ *   'l' len language          - literal language tag
+ *   'n' len prefix iri-id     - namespace declaration
+ *   't' s p o                 - triple
+ *   'q' s p o g               - quad
+ *   'r'                       - reset all dictionaries
+ * A term is a varint with the kind in the low 2 bits:
+ *   (iri-id << 2) | 0, (blank-id << 2) | 1, or a literal:
+ *   (0 << 2) | 2 len string,
+ *   (1 << 2) | 2 language-id len string or
+ *   (2 << 2) | 2 datatype-iri-id len string
+ */
+#define RAPTOR_BINARY_MAGIC "\x89RBF"
+#define RAPTOR_BINARY_MAGIC_LEN 4
+#define RAPTOR_BINARY_VERSION 1
+
+#define RAPTOR_BINARY_TERM_IRI 0
+#define RAPTOR_BINARY_TERM_BLANK 1
+#define RAPTOR_BINARY_TERM_LITERAL 2
+#define RAPTOR_BINARY_TERM_KIND_MASK 3
+#define RAPTOR_BINARY_TERM_KIND_BITS 2
+
+#define RAPTOR_BINARY_LITERAL_PLAIN 0
+#define RAPTOR_BINARY_LITERAL_LANGUAGE 1
+#define RAPTOR_BINARY_LITERAL_DATATYPE 2
+
+/* longest varint: enough for 64 bits */
+#define RAPTOR_BINARY_VARINT_MAX_LEN 10
+
 /* raptor_unicode.c */
 extern const raptor_unichar raptor_unicode_max_codepoint;
 
@@ -1051,7 +1213,7 @@ void raptor_www_libfetch_free(raptor_www *www);
 int raptor_www_libfetch_fetch(raptor_www *www);
 
 /* raptor_set.c */
-RAPTOR_INTERNAL_API raptor_id_set* raptor_new_id_set(raptor_world* world);
+RAPTOR_INTERNAL_API raptor_id_set* raptor_new_id_set(raptor_world* world, size_t filter_size);
 RAPTOR_INTERNAL_API void raptor_free_id_set(raptor_id_set* set);
 RAPTOR_INTERNAL_API int raptor_id_set_add(raptor_id_set* set, raptor_uri* base_uri, const unsigned char *item, size_t item_len);
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
@@ -1174,6 +1336,10 @@ void raptor_print_xml_element(raptor_xml_element *element, FILE* stream);
 
 void raptor_sax2_start_element(void* user_data, const unsigned char *name, const unsigned char **atts);
 void raptor_sax2_end_element(void* user_data, const unsigned char *name);
+#ifdef RAPTOR_XML_LIBXML
+void raptor_sax2_start_element_ns(void* user_data, const unsigned char *localname, const unsigned char *prefix, const unsigned char *URI, int nb_namespaces, const unsigned char **namespaces, int nb_attributes, int nb_defaulted, const unsigned char **attributes);
+void raptor_sax2_end_element_ns(void* user_data, const unsigned char *localname, const unsigned char *prefix, const unsigned char *URI);
+#endif
 void raptor_sax2_characters(void* user_data, const unsigned char *s, int len);
 void raptor_sax2_cdata(void* user_data, const unsigned char *s, int len);
 void raptor_sax2_comment(void* user_data, const unsigned char *s);
@@ -1210,6 +1376,14 @@ struct raptor_uri_detail_s
 
   /* Flags */
   int is_hierarchical;
+
+  /* Offsets into the original URI string: the length before any
+   * fragment and, if the path is hierarchical and has no "." or ".."
+   * segments before its last '/', the length up to and including
+   * that '/' (otherwise 0).
+   */
+  size_t fragment_offset;
+  size_t directory_len;
 };
 
 
@@ -1251,13 +1425,21 @@ RAPTOR_INTERNAL_API int raptor_stringbuffer_append_turtle_string(raptor_stringbu
 
 /* raptor_abbrev.c */
 
-typedef struct {
+typedef struct raptor_abbrev_node_table_s raptor_abbrev_node_table;
+typedef struct raptor_abbrev_subject_table_s raptor_abbrev_subject_table;
+
+typedef struct raptor_abbrev_node_s {
   raptor_world* world;
   int ref_count;         /* count of references to this node */
   int count_as_subject;  /* count of this blank/resource node as subject */
   int count_as_object;   /* count of this blank/resource node as object */
   
   raptor_term* term;
+
+  unsigned int hash;     /* hash of term */
+  struct raptor_abbrev_node_s* next; /* next node in hash chain or
+                                      * free list */
+  raptor_abbrev_node_table* table;   /* table owning the storage or NULL */
 } raptor_abbrev_node;
 
 #ifdef RAPTOR_DEBUG
@@ -1274,7 +1456,7 @@ typedef struct {
 #define RAPTOR_DEBUG_ABBREV_NODE(label, node)
 #endif
 
-typedef struct {
+typedef struct raptor_abbrev_subject_s {
   raptor_abbrev_node* node;      /* node representing the subject of
                                   * this resource */
   raptor_abbrev_node* node_type; /* the rdf:type of this resource */
@@ -1285,6 +1467,9 @@ typedef struct {
                                   * is rdf container */
   int valid;                     /* set 0 for blank nodes that do not
                                   * need to be referred to again */
+  int pending;                   /* non-0 while queued for grouped
+                                  * turtle output */
+  struct raptor_abbrev_subject_s* next; /* next subject in hash chain */
 } raptor_abbrev_subject;
 
 
@@ -1292,15 +1477,33 @@ raptor_abbrev_node* raptor_new_abbrev_node(raptor_world* world, raptor_term* ter
 void raptor_free_abbrev_node(raptor_abbrev_node* node);
 int raptor_abbrev_node_compare(raptor_abbrev_node* node1, raptor_abbrev_node* node2);
 int raptor_abbrev_node_equals(raptor_abbrev_node* node1, raptor_abbrev_node* node2);
-raptor_abbrev_node* raptor_abbrev_node_lookup(raptor_avltree* nodes, raptor_term* term);
+raptor_abbrev_node_table* raptor_new_abbrev_node_table(raptor_world* world);
+void raptor_free_abbrev_node_table(raptor_abbrev_node_table* nodes);
+raptor_abbrev_node* raptor_abbrev_node_lookup(raptor_abbrev_node_table* nodes, raptor_term* term);
+void raptor_abbrev_node_table_remove(raptor_abbrev_node_table* nodes, raptor_abbrev_node* node);
 
 void raptor_free_abbrev_subject(raptor_abbrev_subject* subject);
 int raptor_abbrev_subject_add_property(raptor_abbrev_subject* subject, raptor_abbrev_node* predicate, raptor_abbrev_node* object);
 int raptor_abbrev_subject_compare(raptor_abbrev_subject* subject1, raptor_abbrev_subject* subject2);
-raptor_abbrev_subject* raptor_abbrev_subject_find(raptor_avltree *subjects, raptor_term* node);
-raptor_abbrev_subject* raptor_abbrev_subject_lookup(raptor_avltree* nodes, raptor_avltree* subjects, raptor_avltree* blanks, raptor_term* term);
+raptor_abbrev_subject_table* raptor_new_abbrev_subject_table(void);
+void raptor_free_abbrev_subject_table(raptor_abbrev_subject_table* subjects);
+int raptor_abbrev_subject_table_size(raptor_abbrev_subject_table* subjects);
+int raptor_abbrev_subject_table_delete(raptor_abbrev_subject_table* subjects, raptor_abbrev_subject* subject);
+raptor_sequence* raptor_abbrev_subject_table_sorted(raptor_abbrev_subject_table* subjects);
+raptor_abbrev_subject* raptor_abbrev_subject_find(raptor_abbrev_subject_table *subjects, raptor_term* node);
+raptor_abbrev_subject* raptor_abbrev_subject_lookup(raptor_abbrev_node_table* nodes, raptor_abbrev_subject_table* subjects, raptor_abbrev_subject_table* blanks, raptor_term* term);
 int raptor_abbrev_subject_valid(raptor_abbrev_subject *subject);
 int raptor_abbrev_subject_invalidate(raptor_abbrev_subject *subject);
+void raptor_abbrev_subject_remove(raptor_abbrev_node_table* nodes, raptor_abbrev_subject_table* subjects, raptor_abbrev_subject_table* blanks, raptor_abbrev_subject* subject);
+
+typedef struct raptor_abbrev_spill_s raptor_abbrev_spill;
+typedef int (*raptor_abbrev_spill_handler)(void* user_data, raptor_statement* statement);
+
+raptor_abbrev_spill* raptor_new_abbrev_spill(raptor_world* world, size_t limit);
+void raptor_free_abbrev_spill(raptor_abbrev_spill* spill);
+int raptor_abbrev_spill_add_statement(raptor_abbrev_spill* spill, raptor_statement* statement);
+int raptor_abbrev_spill_is_spilled(raptor_abbrev_spill* spill);
+int raptor_abbrev_spill_replay(raptor_abbrev_spill* spill, raptor_abbrev_spill_handler handler, void* user_data);
 
 
 /* avltree */
@@ -1310,6 +1513,39 @@ void raptor_avltree_check(raptor_avltree* tree);
 #endif
 
 
+/* raptor_read_ahead.c */
+typedef struct raptor_read_ahead_s raptor_read_ahead;
+
+raptor_read_ahead* raptor_new_read_ahead(FILE* stream, raptor_iostream* iostr, int buffers, raptor_read_stats* stats);
+int raptor_read_ahead_next(raptor_read_ahead* ra, unsigned char** buffer_p, size_t* length_p, int* is_end_p);
+void raptor_free_read_ahead(raptor_read_ahead* ra);
+#ifdef RAPTOR_DEBUG
+void raptor_read_stats_print(raptor_read_stats* stats, FILE *stream);
+#endif
+
+
+/* raptor_btree.c */
+typedef struct raptor_btree_s raptor_btree;
+typedef struct raptor_btree_iterator_s raptor_btree_iterator;
+
+raptor_btree* raptor_new_btree(raptor_data_compare_handler compare_handler, raptor_data_free_handler free_handler, unsigned int flags);
+void raptor_free_btree(raptor_btree* tree);
+int raptor_btree_add(raptor_btree* tree, void* p_data);
+void* raptor_btree_remove(raptor_btree* tree, void* p_data);
+int raptor_btree_delete(raptor_btree* tree, void* p_data);
+void* raptor_btree_search(raptor_btree* tree, const void* p_data);
+int raptor_btree_visit(raptor_btree* tree, raptor_avltree_visit_handler visit_handler, void* user_data);
+int raptor_btree_size(raptor_btree* tree);
+void raptor_btree_set_print_handler(raptor_btree* tree, raptor_data_print_handler print_handler);
+int raptor_btree_print(raptor_btree* tree, FILE* stream);
+int raptor_btree_check(raptor_btree* tree);
+raptor_btree_iterator* raptor_new_btree_iterator(raptor_btree* tree, void* range, raptor_data_free_handler range_free_handler, int direction);
+void raptor_free_btree_iterator(raptor_btree_iterator* iterator);
+int raptor_btree_iterator_is_end(raptor_btree_iterator* iterator);
+int raptor_btree_iterator_next(raptor_btree_iterator* iterator);
+void* raptor_btree_iterator_get(raptor_btree_iterator* iterator);
+
+
 raptor_qname* raptor_new_qname_from_resource(raptor_sequence* namespaces, raptor_namespace_stack* nstack, int* namespace_count, raptor_abbrev_node* node);
 
 
@@ -1408,6 +1644,39 @@ RAPTOR_INTERNAL_API int raptor_check_world_internal(raptor_world* world, const c
 
 
 
+/* Thread-safe worlds need POSIX threads and atomic builtins */
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H) && defined(HAVE_ATOMIC_BUILTINS)
+#define RAPTOR_THREADS 1
+#include <pthread.h>
+#endif
+
+#ifdef RAPTOR_THREADS
+#define RAPTOR_ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define RAPTOR_ATOMIC_ADD(p, v) __atomic_add_fetch(p, v, __ATOMIC_ACQ_REL)
+#define RAPTOR_ATOMIC_CAS(p, expected_p, desired) \
+  __atomic_compare_exchange_n(p, expected_p, desired, 1, \
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/* Update a counter shared by all users of a world: atomically if the
+ * world is thread-safe.  Return the new value.
+ */
+#define RAPTOR_WORLD_INCREMENT(world, p) \
+  ((world)->thread_safe ? RAPTOR_ATOMIC_ADD(p, 1) : ++*(p))
+#define RAPTOR_WORLD_DECREMENT(world, p) \
+  ((world)->thread_safe ? RAPTOR_ATOMIC_ADD(p, -1) : --*(p))
+#define RAPTOR_WORLD_LOCK(world) \
+  do { if((world)->thread_safe) pthread_mutex_lock(&(world)->mutex); } while(0)
+#define RAPTOR_WORLD_UNLOCK(world) \
+  do { if((world)->thread_safe) pthread_mutex_unlock(&(world)->mutex); } while(0)
+#else
+#define RAPTOR_WORLD_INCREMENT(world, p) (++*(p))
+#define RAPTOR_WORLD_DECREMENT(world, p) (--*(p))
+#define RAPTOR_WORLD_LOCK(world) do { } while(0)
+#define RAPTOR_WORLD_UNLOCK(world) do { } while(0)
+#endif
+
+typedef struct raptor_uri_table_s raptor_uri_table;
+
 struct raptor_world_s {
   /* signature to check this is a world object */
   unsigned int magic;
@@ -1456,6 +1725,10 @@ struct raptor_world_s {
    */
   int libxml_flags;
 
+  /* non-0 if libxml_flags was set by raptor_world_set_flag() rather
+   * than left at the default */
+  int libxml_flags_set;
+
 #ifdef RAPTOR_XML_LIBXML
   void *libxml_saved_structured_error_context;
   xmlStructuredErrorFunc libxml_saved_structured_error_handler;
@@ -1464,7 +1737,10 @@ struct raptor_world_s {
   xmlGenericErrorFunc libxml_saved_generic_error_handler;
 #endif  
 
-  raptor_avltree *uris_tree;
+  /* URI intern tables when uri_interning is set: one, or
+   * RAPTOR_URI_TABLE_SHARDS selected by URI hash when thread_safe */
+  raptor_uri_table *uris_tables;
+  unsigned int uris_tables_count;
 
   raptor_uri* concepts[RDF_NS_LAST + 1];
 
@@ -1489,6 +1765,15 @@ struct raptor_world_s {
   raptor_uri* xsd_decimal_uri;
   raptor_uri* xsd_double_uri;
   raptor_uri* xsd_integer_uri;
+
+  /* world may be used by several threads at once - set by
+   * RAPTOR_WORLD_FLAG_THREAD_SAFE */
+  int thread_safe;
+
+#ifdef RAPTOR_THREADS
+  /* protects lazily created world data when thread_safe */
+  pthread_mutex_t mutex;
+#endif
 };
 
 /* raptor_www.c */
@@ -30,6 +30,16 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdarg.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define RAPTOR_IOSTREAM_DECOMPRESS_THREAD 1
+#endif
 
 /* Raptor includes */
 #include "raptor2.h"
@@ -44,6 +54,9 @@
 #define RAPTOR_IOSTREAM_FLAGS_EOF           1
 #define RAPTOR_IOSTREAM_FLAGS_FREE_HANDLER  2
 
+/* default write buffer size for the iostreams constructed here */
+#define RAPTOR_IOSTREAM_WRITE_BUFFER_SIZE 8192
+
 struct raptor_iostream_s
 {
   raptor_world *world;
@@ -53,6 +66,11 @@ struct raptor_iostream_s
   size_t offset;
   unsigned int mode;
   int flags;
+
+  /* write buffer or NULL to write through to the handler */
+  unsigned char *buffer;
+  size_t buffer_size;
+  size_t buffer_used;
 };
 
 
@@ -97,6 +115,32 @@ raptor_iostream_check_handler(const raptor_iostream_handler * const handler,
 }
 
 
+/* Pass buffered output to the handler; return non-0 on failure */
+static int
+raptor_iostream_flush_buffer(raptor_iostream *iostr)
+{
+  size_t used = iostr->buffer_used;
+  int nobj;
+
+  if(!used)
+    return 0;
+
+  iostr->buffer_used = 0;
+
+  if(!iostr->handler->write_bytes) {
+    size_t i;
+
+    /* write_byte handler return values are not consistent: ignore them */
+    for(i = 0; i < used; i++)
+      iostr->handler->write_byte(iostr->user_data, iostr->buffer[i]);
+    return 0;
+  }
+
+  nobj = iostr->handler->write_bytes(iostr->user_data, iostr->buffer, 1, used);
+  return (nobj < 0 || RAPTOR_BAD_CAST(size_t, nobj) != used);
+}
+
+
 /**
  * raptor_new_iostream_from_handler:
  * @world: raptor_world object
@@ -310,6 +354,12 @@ raptor_new_iostream_to_filename(raptor_world *world, const char *filename)
     raptor_free_iostream(iostr);
     return NULL;
   }
+
+  if(raptor_iostream_set_write_buffer_size(iostr,
+                                           RAPTOR_IOSTREAM_WRITE_BUFFER_SIZE)) {
+    raptor_free_iostream(iostr);
+    return NULL;
+  }
   return iostr;
 }
 
@@ -336,6 +386,12 @@ static const raptor_iostream_handler raptor_iostream_write_file_handler = {
  * The @handle must already be open for writing.
  * NOTE: This does not fclose the @handle when it is finished.
  *
+ * Output is written through to @handle unbuffered so the caller may
+ * keep writing to it directly.  Use
+ * raptor_iostream_set_write_buffer_size() to buffer the output; then
+ * call raptor_iostream_write_flush() before writing to @handle
+ * directly while the iostream is in use.
+ *
  * Return value: new #raptor_iostream object or NULL on failure
  **/
 raptor_iostream*
@@ -369,6 +425,7 @@ raptor_new_iostream_to_file_handle(raptor_world *world, FILE *handle)
     RAPTOR_FREE(raptor_iostream, iostr);
     return NULL;
   }
+
   return iostr;
 }
 
@@ -477,205 +534,1237 @@ raptor_new_iostream_to_string(raptor_world *world,
   const raptor_iostream_handler* handler;
   const unsigned int mode = RAPTOR_IOSTREAM_MODE_WRITE;
 
-  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  if(!string_p)
+    return NULL;
+  
+  raptor_world_open(world);
+  
+  handler = &raptor_iostream_write_string_handler;
+  if(!raptor_iostream_check_handler(handler, mode))
+    return NULL;
+
+  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+  if(!iostr)
+    return NULL;
+
+  con = RAPTOR_CALLOC(struct raptor_write_string_iostream_context*, 1,
+                      sizeof(*con));
+  if(!con) {
+    RAPTOR_FREE(raptor_iostream, iostr);
+    return NULL;
+  }
+
+  con->sb = raptor_new_stringbuffer();
+  if(!con->sb) {
+    RAPTOR_FREE(raptor_iostream, iostr);
+    RAPTOR_FREE(raptor_write_string_iostream_context, con);
+    return NULL;
+  }
+
+  con->string_p = string_p;
+  *string_p = NULL;
+
+  con->length_p = length_p;  
+  if(length_p)
+    *length_p = 0;
+
+  if(malloc_handler)
+    con->malloc_handler = malloc_handler;
+  else
+    con->malloc_handler = raptor_alloc_memory;
+
+  iostr->world = world;
+  iostr->handler = handler;
+  iostr->user_data = (void*)con;
+  iostr->mode = mode;
+
+  if(iostr->handler->init && iostr->handler->init(iostr->user_data)) {
+    raptor_free_iostream(iostr);
+    return NULL;
+  }
+
+  if(raptor_iostream_set_write_buffer_size(iostr,
+                                           RAPTOR_IOSTREAM_WRITE_BUFFER_SIZE)) {
+    raptor_free_iostream(iostr);
+    return NULL;
+  }
+  return iostr;
+}
+
+
+/**
+ * raptor_new_iostream_from_sink:
+ * @world: raptor world
+ *
+ * Create a new read iostream from a sink, returning no data.
+ *
+ * Provides an I/O source that returns end of input immediately on
+ * reads, and throw away all writes. Same as
+ * raptor_new_iostream_to_sink()
+ * 
+ * Return value: new #raptor_iostream object or NULL on failure
+ **/
+raptor_iostream*
+raptor_new_iostream_from_sink(raptor_world *world)
+{
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  raptor_world_open(world);
+  
+  return raptor_new_iostream_from_handler(world, NULL,
+                                          &raptor_iostream_sink_handler);
+}
+
+
+static const raptor_iostream_handler raptor_iostream_read_filename_handler = {
+  /* .version     = */ 2,
+  /* .init        = */ NULL,
+  /* .finish      = */ raptor_filename_iostream_finish,
+  /* .write_byte  = */ NULL,
+  /* .write_bytes = */ NULL,
+  /* .write_end   = */ NULL,
+  /* .read_bytes  = */ raptor_filename_iostream_read_bytes,
+  /* .read_eof    = */ raptor_filename_iostream_read_eof
+};
+
+
+/**
+ * raptor_new_iostream_from_filename:
+ * @world: raptor world
+ * @filename: Input filename to open and read from
+ *
+ * Constructor - create a new iostream reading from a filename.
+ * 
+ * Return value: new #raptor_iostream object or NULL on failure
+ **/
+raptor_iostream*
+raptor_new_iostream_from_filename(raptor_world *world, const char *filename)
+{
+  FILE *handle;
+  raptor_iostream* iostr;
+  const raptor_iostream_handler* handler;
+  const unsigned int mode = RAPTOR_IOSTREAM_MODE_READ;
+
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  if(!filename)
+    return NULL;
+  
+  raptor_world_open(world);
+  
+  handler = &raptor_iostream_read_filename_handler;
+  if(!raptor_iostream_check_handler(handler, mode))
+    return NULL;
+
+  handle = fopen(filename, "rb");
+  if(!handle)
+    return NULL;
+  
+  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+  if(!iostr) {
+    fclose(handle);
+    return NULL;
+  }
+
+  iostr->world = world;
+  iostr->handler = handler;
+  iostr->user_data = (void*)handle;
+  iostr->mode = mode;
+
+  if(iostr->handler->init && 
+     iostr->handler->init(iostr->user_data)) {
+    raptor_free_iostream(iostr);
+    return NULL;
+  }
+  return iostr;
+}
+
+
+static const raptor_iostream_handler raptor_iostream_read_file_handle_handler = {
+  /* .version     = */ 2,
+  /* .init        = */ NULL,
+  /* .finish      = */ NULL,
+  /* .write_byte  = */ NULL,
+  /* .write_bytes = */ NULL,
+  /* .write_end   = */ NULL,
+  /* .read_bytes  = */ raptor_filename_iostream_read_bytes,
+  /* .read_eof    = */ raptor_filename_iostream_read_eof
+};
+
+
+/**
+ * raptor_new_iostream_from_file_handle:
+ * @world: raptor world
+ * @handle: Input file_handle to open and read from
+ *
+ * Constructor - create a new iostream reading from a file_handle.
+ * 
+ * The @handle must already be open for reading.
+ * NOTE: This does not fclose the @handle when it is finished.
+ *
+ * Return value: new #raptor_iostream object or NULL on failure
+ **/
+raptor_iostream*
+raptor_new_iostream_from_file_handle(raptor_world *world, FILE *handle)
+{
+  raptor_iostream* iostr;
+  const raptor_iostream_handler* handler;
+  const unsigned int mode = RAPTOR_IOSTREAM_MODE_READ;
+
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  if(!handle)
+    return NULL;
+  
+  raptor_world_open(world);
+  
+  handler = &raptor_iostream_read_file_handle_handler;
+  if(!raptor_iostream_check_handler(handler, mode))
+    return NULL;
+
+  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+  if(!iostr)
+    return NULL;
+
+  iostr->world = world;
+  iostr->handler = handler;
+  iostr->user_data = (void*)handle;
+  iostr->mode = mode;
+
+  if(iostr->handler->init && 
+     iostr->handler->init(iostr->user_data)) {
+    RAPTOR_FREE(raptor_iostream, iostr);
+    return NULL;
+  }
+  return iostr;
+}
+
+
+/* Compressed iostreams */
+
+static const char* const raptor_compression_type_names[RAPTOR_COMPRESSION_LAST + 1] = {
+  "none",
+  "gzip",
+  "zstd"
+};
+
+/* size of the compressed data buffers */
+#define RAPTOR_COMPRESS_BUFFER_SIZE 65536
+
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+/* decompressed blocks queued ahead of the reader by the thread */
+#define RAPTOR_DECOMPRESS_BLOCKS 4
+#define RAPTOR_DECOMPRESS_BLOCK_SIZE 131072
+#endif
+
+
+/**
+ * raptor_compression_type_get_name:
+ * @type: compression type
+ *
+ * Get the name of a compression type
+ *
+ * Return value: name such as "gzip" or NULL if @type is out of range
+ **/
+const char*
+raptor_compression_type_get_name(raptor_compression_type type)
+{
+  if(RAPTOR_GOOD_CAST(unsigned int, type) > RAPTOR_COMPRESSION_LAST)
+    return NULL;
+
+  return raptor_compression_type_names[type];
+}
+
+
+/**
+ * raptor_compression_type_is_available:
+ * @type: compression type
+ *
+ * Check if a compression type is supported by this build
+ *
+ * Return value: non-0 if compressed iostreams of @type can be made
+ **/
+int
+raptor_compression_type_is_available(raptor_compression_type type)
+{
+  switch(type) {
+    case RAPTOR_COMPRESSION_NONE:
+      return 1;
+
+#ifdef HAVE_ZLIB
+    case RAPTOR_COMPRESSION_GZIP:
+      return 1;
+#endif
+
+#ifdef HAVE_ZSTD
+    case RAPTOR_COMPRESSION_ZSTD:
+      return 1;
+#endif
+
+    default:
+      return 0;
+  }
+}
+
+
+static raptor_compression_type
+raptor_compression_detect(const unsigned char *buffer, size_t length)
+{
+  if(length >= 2 && buffer[0] == 0x1f && buffer[1] == 0x8b)
+    return RAPTOR_COMPRESSION_GZIP;
+
+  if(length >= 4 && buffer[0] == 0x28 && buffer[1] == 0xb5 &&
+     buffer[2] == 0x2f && buffer[3] == 0xfd)
+    return RAPTOR_COMPRESSION_ZSTD;
+
+  return RAPTOR_COMPRESSION_NONE;
+}
+
+
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+/*
+ * raptor_compression_file_handle_peek:
+ * @handle: FILE* open for reading
+ *
+ * INTERNAL - Check if the content of a file handle may be compressed
+ *
+ * Looks at the next byte without consuming it so that uncompressed
+ * content can still be read directly from @handle.
+ *
+ * Return value: non-0 if the next byte starts a compressed format
+ */
+int
+raptor_compression_file_handle_peek(FILE* handle)
+{
+  int c = getc(handle);
+
+  if(c == EOF) {
+    clearerr(handle);
+    return 0;
+  }
+  ungetc(c, handle);
+
+  return (c == 0x1f || c == 0x28);
+}
+#endif
+
+
+/* Local handlers for reading compressed content from a file handle */
+
+typedef struct {
+  FILE* handle;
+  /* non-0 to fclose the handle when finished */
+  int close_handle;
+  raptor_compression_type type;
+
+  /* compressed input */
+  unsigned char* input;
+  size_t input_length;
+  size_t input_offset;
+  int input_eof;
+
+  /* non-0 between compressed streams */
+  int stream_end;
+  /* 0 while decoding, 1 at the end of the content, -1 on failure */
+  int status;
+
+#ifdef HAVE_ZLIB
+  z_stream zstream;
+  int zstream_init;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_DCtx* zstd_dctx;
+#endif
+
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+  /* decoding runs in the thread when thread_started is set */
+  pthread_t thread;
+  int thread_started;
+  pthread_mutex_t lock;
+  /* signalled when a block is filled or decoding stops */
+  pthread_cond_t filled_cond;
+  /* signalled when a block is released or the thread must stop */
+  pthread_cond_t free_cond;
+  unsigned char* blocks[RAPTOR_DECOMPRESS_BLOCKS];
+  size_t block_lengths[RAPTOR_DECOMPRESS_BLOCKS];
+  /* ring of filled blocks starting at head; head_offset bytes read */
+  int head;
+  int filled;
+  size_t head_offset;
+  /* copy of status made by the thread after each block */
+  int thread_status;
+  int stop;
+#endif
+
+  /* non-0 once all content has been read */
+  int eof;
+} raptor_decompress_context;
+
+
+/* Read more compressed input; return <0 on failure, 0 at end of input */
+static int
+raptor_decompress_refill(raptor_decompress_context* con)
+{
+  if(con->input_eof)
+    return 0;
+
+  con->input_length = fread(con->input, 1, RAPTOR_COMPRESS_BUFFER_SIZE,
+                            con->handle);
+  con->input_offset = 0;
+  if(con->input_length < RAPTOR_COMPRESS_BUFFER_SIZE) {
+    if(ferror(con->handle))
+      return -1;
+    con->input_eof = 1;
+  }
+
+  return (con->input_length > 0);
+}
+
+
+/*
+ * raptor_decompress_decode:
+ * @con: decompress context
+ * @buffer: buffer to fill
+ * @size: size of @buffer
+ *
+ * INTERNAL - Decompress content into a buffer
+ *
+ * Sets con->status at the end of the content or on failure.  Input
+ * that ends inside a compressed stream is a failure.
+ *
+ * Return value: bytes decompressed, less than @size only if con->status is set
+ */
+static size_t
+raptor_decompress_decode(raptor_decompress_context* con,
+                         unsigned char* buffer, size_t size)
+{
+  size_t length = 0;
+
+  while(!con->status && length < size) {
+    size_t old_length = length;
+    size_t old_offset;
+    int at_end;
+
+    if(con->input_offset == con->input_length &&
+       raptor_decompress_refill(con) < 0) {
+      con->status = -1;
+      break;
+    }
+
+    at_end = (con->input_offset == con->input_length);
+    if(at_end && con->stream_end) {
+      con->status = 1;
+      break;
+    }
+    old_offset = con->input_offset;
+
+    switch(con->type) {
+      case RAPTOR_COMPRESSION_NONE:
+        {
+          size_t len = con->input_length - con->input_offset;
+
+          if(len > size - length)
+            len = size - length;
+          memcpy(buffer + length, con->input + con->input_offset, len);
+          con->input_offset += len;
+          length += len;
+        }
+        break;
+
+#ifdef HAVE_ZLIB
+      case RAPTOR_COMPRESSION_GZIP:
+        {
+          z_stream* zs = &con->zstream;
+          int zrc;
+
+          /* concatenated gzip members */
+          if(con->stream_end) {
+            inflateReset(zs);
+            con->stream_end = 0;
+          }
+
+          zs->next_in = con->input + con->input_offset;
+          zs->avail_in = RAPTOR_BAD_CAST(uInt, con->input_length - con->input_offset);
+          zs->next_out = buffer + length;
+          zs->avail_out = RAPTOR_BAD_CAST(uInt, size - length);
+
+          zrc = inflate(zs, Z_NO_FLUSH);
+
+          con->input_offset = con->input_length - zs->avail_in;
+          length = size - zs->avail_out;
+          if(zrc == Z_STREAM_END)
+            con->stream_end = 1;
+          else if(zrc != Z_OK && zrc != Z_BUF_ERROR)
+            con->status = -1;
+        }
+        break;
+#endif
+
+#ifdef HAVE_ZSTD
+      case RAPTOR_COMPRESSION_ZSTD:
+        {
+          ZSTD_inBuffer in;
+          ZSTD_outBuffer out;
+          size_t zrc;
+
+          in.src = con->input;
+          in.size = con->input_length;
+          in.pos = con->input_offset;
+          out.dst = buffer;
+          out.size = size;
+          out.pos = length;
+
+          zrc = ZSTD_decompressStream(con->zstd_dctx, &out, &in);
+
+          con->input_offset = in.pos;
+          length = out.pos;
+          if(ZSTD_isError(zrc))
+            con->status = -1;
+          else
+            con->stream_end = (zrc == 0);
+        }
+        break;
+#endif
+
+      default:
+        con->status = -1;
+        break;
+    }
+
+    /* all input used and the decoder has nothing more to give */
+    if(!con->status && at_end && length == old_length &&
+       con->input_offset == old_offset)
+      con->status = con->stream_end ? 1 : -1;
+  }
+
+  return length;
+}
+
+
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+static void*
+raptor_decompress_thread(void* arg)
+{
+  raptor_decompress_context* con = (raptor_decompress_context*)arg;
+
+  pthread_mutex_lock(&con->lock);
+  while(!con->stop && !con->thread_status) {
+    int i;
+    size_t length;
+
+    while(con->filled == RAPTOR_DECOMPRESS_BLOCKS && !con->stop)
+      pthread_cond_wait(&con->free_cond, &con->lock);
+    if(con->stop)
+      break;
+
+    i = (con->head + con->filled) % RAPTOR_DECOMPRESS_BLOCKS;
+    pthread_mutex_unlock(&con->lock);
+
+    /* the reader does not touch unfilled blocks */
+    length = raptor_decompress_decode(con, con->blocks[i],
+                                      RAPTOR_DECOMPRESS_BLOCK_SIZE);
+
+    pthread_mutex_lock(&con->lock);
+    con->block_lengths[i] = length;
+    if(length)
+      con->filled++;
+    con->thread_status = con->status;
+    pthread_cond_signal(&con->filled_cond);
+  }
+  pthread_mutex_unlock(&con->lock);
+
+  return NULL;
+}
+
+
+/*
+ * raptor_decompress_read_blocks:
+ * @con: decompress context
+ * @buffer: buffer to fill
+ * @size: size of @buffer
+ * @status_p: pointer to store the decoding status when no blocks remain
+ *
+ * INTERNAL - Copy blocks decompressed by the thread into a buffer
+ *
+ * Return value: bytes read, less than @size only at the end or on failure
+ */
+static size_t
+raptor_decompress_read_blocks(raptor_decompress_context* con,
+                              unsigned char* buffer, size_t size,
+                              int* status_p)
+{
+  size_t length = 0;
+
+  pthread_mutex_lock(&con->lock);
+  while(length < size) {
+    int i;
+    size_t len;
+
+    while(!con->filled && !con->thread_status)
+      pthread_cond_wait(&con->filled_cond, &con->lock);
+    if(!con->filled)
+      break;
+
+    i = con->head;
+    pthread_mutex_unlock(&con->lock);
+
+    /* the thread does not touch filled blocks */
+    len = con->block_lengths[i] - con->head_offset;
+    if(len > size - length)
+      len = size - length;
+    memcpy(buffer + length, con->blocks[i] + con->head_offset, len);
+    length += len;
+    con->head_offset += len;
+
+    pthread_mutex_lock(&con->lock);
+    if(con->head_offset == con->block_lengths[i]) {
+      con->head = (i + 1) % RAPTOR_DECOMPRESS_BLOCKS;
+      con->filled--;
+      con->head_offset = 0;
+      pthread_cond_signal(&con->free_cond);
+    }
+  }
+  *status_p = con->filled ? 0 : con->thread_status;
+  pthread_mutex_unlock(&con->lock);
+
+  return length;
+}
+
+
+static void
+raptor_decompress_start_thread(raptor_decompress_context* con)
+{
+  int i;
+
+  for(i = 0; i < RAPTOR_DECOMPRESS_BLOCKS; i++) {
+    con->blocks[i] = RAPTOR_MALLOC(unsigned char*,
+                                   RAPTOR_DECOMPRESS_BLOCK_SIZE);
+    if(!con->blocks[i])
+      return;
+  }
+
+  if(pthread_mutex_init(&con->lock, NULL))
+    return;
+  if(pthread_cond_init(&con->filled_cond, NULL)) {
+    pthread_mutex_destroy(&con->lock);
+    return;
+  }
+  if(pthread_cond_init(&con->free_cond, NULL)) {
+    pthread_cond_destroy(&con->filled_cond);
+    pthread_mutex_destroy(&con->lock);
+    return;
+  }
+
+  if(pthread_create(&con->thread, NULL, raptor_decompress_thread, con)) {
+    pthread_cond_destroy(&con->free_cond);
+    pthread_cond_destroy(&con->filled_cond);
+    pthread_mutex_destroy(&con->lock);
+    return;
+  }
+
+  con->thread_started = 1;
+}
+#endif
+
+
+static void
+raptor_free_decompress_context(raptor_decompress_context* con)
+{
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+  int i;
+
+  if(con->thread_started) {
+    pthread_mutex_lock(&con->lock);
+    con->stop = 1;
+    pthread_cond_signal(&con->free_cond);
+    pthread_mutex_unlock(&con->lock);
+
+    pthread_join(con->thread, NULL);
+
+    pthread_cond_destroy(&con->free_cond);
+    pthread_cond_destroy(&con->filled_cond);
+    pthread_mutex_destroy(&con->lock);
+  }
+
+  for(i = 0; i < RAPTOR_DECOMPRESS_BLOCKS; i++) {
+    if(con->blocks[i])
+      RAPTOR_FREE(char*, con->blocks[i]);
+  }
+#endif
+
+#ifdef HAVE_ZLIB
+  if(con->zstream_init)
+    inflateEnd(&con->zstream);
+#endif
+#ifdef HAVE_ZSTD
+  if(con->zstd_dctx)
+    ZSTD_freeDCtx(con->zstd_dctx);
+#endif
+
+  if(con->input)
+    RAPTOR_FREE(char*, con->input);
+  if(con->close_handle)
+    fclose(con->handle);
+
+  RAPTOR_FREE(raptor_decompress_context, con);
+}
+
+
+static void
+raptor_decompress_iostream_finish(void *user_data)
+{
+  raptor_decompress_context* con = (raptor_decompress_context*)user_data;
+
+  raptor_free_decompress_context(con);
+}
+
+
+static int
+raptor_decompress_iostream_read_bytes(void *user_data,
+                                      void *ptr, size_t size, size_t nmemb)
+{
+  raptor_decompress_context* con = (raptor_decompress_context*)user_data;
+  size_t want = size * nmemb;
+  size_t length;
+  int status;
+
+  if(!want || con->eof)
+    return 0;
+
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+  if(con->thread_started)
+    length = raptor_decompress_read_blocks(con, (unsigned char*)ptr, want,
+                                           &status);
+  else
+#endif
+  {
+    length = raptor_decompress_decode(con, (unsigned char*)ptr, want);
+    status = con->status;
+  }
+
+  if(length < want) {
+    con->eof = 1;
+    if(status < 0)
+      return -1;
+  }
+
+  return RAPTOR_BAD_CAST(int, length / size);
+}
+
+
+static int
+raptor_decompress_iostream_read_eof(void *user_data)
+{
+  raptor_decompress_context* con = (raptor_decompress_context*)user_data;
+
+  return con->eof;
+}
+
+
+static const raptor_iostream_handler raptor_iostream_read_compressed_handler = {
+  /* .version     = */ 2,
+  /* .init        = */ NULL,
+  /* .finish      = */ raptor_decompress_iostream_finish,
+  /* .write_byte  = */ NULL,
+  /* .write_bytes = */ NULL,
+  /* .write_end   = */ NULL,
+  /* .read_bytes  = */ raptor_decompress_iostream_read_bytes,
+  /* .read_eof    = */ raptor_decompress_iostream_read_eof
+};
+
+
+static raptor_iostream*
+raptor_new_iostream_from_compressed_handle(raptor_world *world, FILE *handle,
+                                           int close_handle)
+{
+  raptor_decompress_context* con;
+  raptor_iostream* iostr;
+
+  con = RAPTOR_CALLOC(raptor_decompress_context*, 1, sizeof(*con));
+  if(!con)
+    return NULL;
+
+  con->handle = handle;
+
+  con->input = RAPTOR_MALLOC(unsigned char*, RAPTOR_COMPRESS_BUFFER_SIZE);
+  if(!con->input)
+    goto failed;
+
+  /* the first input block decides the compression */
+  if(raptor_decompress_refill(con) < 0)
+    goto failed;
+  con->type = raptor_compression_detect(con->input, con->input_length);
+
+  switch(con->type) {
+    case RAPTOR_COMPRESSION_NONE:
+      con->stream_end = 1;
+      break;
+
+#ifdef HAVE_ZLIB
+    case RAPTOR_COMPRESSION_GZIP:
+      /* 16 selects the gzip wrapper */
+      if(inflateInit2(&con->zstream, 15 + 16) != Z_OK)
+        goto failed;
+      con->zstream_init = 1;
+      break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case RAPTOR_COMPRESSION_ZSTD:
+      con->zstd_dctx = ZSTD_createDCtx();
+      if(!con->zstd_dctx)
+        goto failed;
+      break;
+#endif
+
+    default:
+      goto failed;
+  }
+
+  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+  if(!iostr)
+    goto failed;
+
+  iostr->world = world;
+  iostr->handler = &raptor_iostream_read_compressed_handler;
+  iostr->user_data = (void*)con;
+  iostr->mode = RAPTOR_IOSTREAM_MODE_READ;
+
+  con->close_handle = close_handle;
+
+#ifdef RAPTOR_IOSTREAM_DECOMPRESS_THREAD
+  /* uncompressed content is passed through without a thread */
+  if(con->type != RAPTOR_COMPRESSION_NONE)
+    raptor_decompress_start_thread(con);
+#endif
+
+  return iostr;
+
+  failed:
+  raptor_free_decompress_context(con);
+  return NULL;
+}
+
+
+/**
+ * raptor_new_iostream_from_compressed_filename:
+ * @world: raptor world
+ * @filename: Input filename to open and read from
+ *
+ * Constructor - create a new iostream reading possibly compressed content from a filename.
+ *
+ * The compression is detected from the magic number at the start of
+ * the content; content that is not compressed is read unchanged.
+ * When POSIX threads are available, decompression runs in a separate
+ * thread ahead of the reader.
+ *
+ * Return value: new #raptor_iostream object or NULL on failure or if the compression is not supported
+ **/
+raptor_iostream*
+raptor_new_iostream_from_compressed_filename(raptor_world *world,
+                                             const char *filename)
+{
+  FILE *handle;
+  raptor_iostream* iostr;
+
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  if(!filename)
+    return NULL;
+
+  raptor_world_open(world);
+
+  handle = fopen(filename, "rb");
+  if(!handle)
+    return NULL;
+
+  iostr = raptor_new_iostream_from_compressed_handle(world, handle, 1);
+  if(!iostr)
+    fclose(handle);
+
+  return iostr;
+}
+
+
+/**
+ * raptor_new_iostream_from_compressed_file_handle:
+ * @world: raptor world
+ * @handle: Input file_handle to read from
+ *
+ * Constructor - create a new iostream reading possibly compressed content from a file_handle.
+ *
+ * As raptor_new_iostream_from_compressed_filename().  The @handle
+ * must already be open for reading.
+ * NOTE: This does not fclose the @handle when it is finished.
+ *
+ * Return value: new #raptor_iostream object or NULL on failure or if the compression is not supported
+ **/
+raptor_iostream*
+raptor_new_iostream_from_compressed_file_handle(raptor_world *world,
+                                                FILE *handle)
+{
+  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+
+  if(!handle)
+    return NULL;
+
+  raptor_world_open(world);
+
+  return raptor_new_iostream_from_compressed_handle(world, handle, 0);
+}
+
+
+/* Local handlers for writing compressed content to a file handle */
+
+typedef struct {
+  FILE* handle;
+  /* non-0 to fclose the handle when finished */
+  int close_handle;
+  raptor_compression_type type;
+
+  /* compressed output */
+  unsigned char* output;
+
+  /* non-0 once the compressed stream has been ended */
+  int ended;
+  int failed;
+
+#ifdef HAVE_ZLIB
+  z_stream zstream;
+  int zstream_init;
+#endif
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx* zstd_cctx;
+#endif
+} raptor_compress_context;
+
+
+/* Write compressed output; return non-0 on failure */
+static int
+raptor_compress_write_output(raptor_compress_context* con, size_t length)
+{
+  if(length && fwrite(con->output, 1, length, con->handle) != length)
+    con->failed = 1;
+
+  return con->failed;
+}
+
+
+/*
+ * raptor_compress_encode:
+ * @con: compress context
+ * @data: bytes to compress
+ * @length: length of @data
+ * @end: non-0 to end the compressed stream after @data
+ *
+ * INTERNAL - Compress bytes and write the compressed output
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_compress_encode(raptor_compress_context* con,
+                       const unsigned char* data, size_t length, int end)
+{
+  if(con->failed)
+    return 1;
+
+  switch(con->type) {
+    case RAPTOR_COMPRESSION_NONE:
+      if(length && fwrite(data, 1, length, con->handle) != length)
+        con->failed = 1;
+      break;
+
+#ifdef HAVE_ZLIB
+    case RAPTOR_COMPRESSION_GZIP:
+      {
+        z_stream* zs = &con->zstream;
+        int zrc;
+
+        zs->next_in = RAPTOR_GOOD_CAST(Bytef*, data);
+        zs->avail_in = RAPTOR_BAD_CAST(uInt, length);
+        do {
+          zs->next_out = con->output;
+          zs->avail_out = RAPTOR_COMPRESS_BUFFER_SIZE;
+
+          zrc = deflate(zs, end ? Z_FINISH : Z_NO_FLUSH);
+          if(zrc == Z_STREAM_ERROR)
+            con->failed = 1;
+          else
+            raptor_compress_write_output(con, RAPTOR_COMPRESS_BUFFER_SIZE -
+                                         zs->avail_out);
+        } while(!con->failed &&
+                (end ? zrc != Z_STREAM_END : !zs->avail_out));
+      }
+      break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case RAPTOR_COMPRESSION_ZSTD:
+      {
+        ZSTD_inBuffer in;
+        ZSTD_outBuffer out;
+        size_t remaining;
+
+        in.src = data;
+        in.size = length;
+        in.pos = 0;
+        do {
+          out.dst = con->output;
+          out.size = RAPTOR_COMPRESS_BUFFER_SIZE;
+          out.pos = 0;
+
+          remaining = ZSTD_compressStream2(con->zstd_cctx, &out, &in,
+                                           end ? ZSTD_e_end : ZSTD_e_continue);
+          if(ZSTD_isError(remaining))
+            con->failed = 1;
+          else
+            raptor_compress_write_output(con, out.pos);
+        } while(!con->failed && (end ? remaining : in.pos < in.size));
+      }
+      break;
+#endif
+
+    default:
+      con->failed = 1;
+      break;
+  }
+
+  return con->failed;
+}
+
+
+static int
+raptor_compress_iostream_write_byte(void *user_data, const int byte)
+{
+  raptor_compress_context* con = (raptor_compress_context*)user_data;
+  unsigned char c = RAPTOR_GOOD_CAST(unsigned char, byte);
+
+  return raptor_compress_encode(con, &c, 1, 0);
+}
+
+
+static int
+raptor_compress_iostream_write_bytes(void *user_data,
+                                     const void *ptr, size_t size, size_t nmemb)
+{
+  raptor_compress_context* con = (raptor_compress_context*)user_data;
+
+  if(raptor_compress_encode(con, (const unsigned char*)ptr, size * nmemb, 0))
+    return -1;
+
+  return RAPTOR_BAD_CAST(int, nmemb);
+}
+
+
+static int
+raptor_compress_iostream_write_end(void *user_data)
+{
+  raptor_compress_context* con = (raptor_compress_context*)user_data;
+  int rc;
+
+  if(con->ended)
+    return 0;
+  con->ended = 1;
+
+  rc = raptor_compress_encode(con, NULL, 0, 1);
+  if(fflush(con->handle))
+    rc = 1;
+
+  return rc;
+}
+
+
+static void
+raptor_free_compress_context(raptor_compress_context* con)
+{
+#ifdef HAVE_ZLIB
+  if(con->zstream_init)
+    deflateEnd(&con->zstream);
+#endif
+#ifdef HAVE_ZSTD
+  if(con->zstd_cctx)
+    ZSTD_freeCCtx(con->zstd_cctx);
+#endif
+
+  if(con->output)
+    RAPTOR_FREE(char*, con->output);
+  if(con->close_handle)
+    fclose(con->handle);
+
+  RAPTOR_FREE(raptor_compress_context, con);
+}
+
+
+static void
+raptor_compress_iostream_finish(void *user_data)
+{
+  raptor_compress_context* con = (raptor_compress_context*)user_data;
+
+  /* a compressed stream must always be ended to be readable */
+  raptor_compress_iostream_write_end(con);
+
+  raptor_free_compress_context(con);
+}
+
+
+static const raptor_iostream_handler raptor_iostream_write_compressed_handler = {
+  /* .version     = */ 2,
+  /* .init        = */ NULL,
+  /* .finish      = */ raptor_compress_iostream_finish,
+  /* .write_byte  = */ raptor_compress_iostream_write_byte,
+  /* .write_bytes = */ raptor_compress_iostream_write_bytes,
+  /* .write_end   = */ raptor_compress_iostream_write_end,
+  /* .read_bytes  = */ NULL,
+  /* .read_eof    = */ NULL
+};
+
 
-  if(!string_p)
-    return NULL;
-  
-  raptor_world_open(world);
-  
-  handler = &raptor_iostream_write_string_handler;
-  if(!raptor_iostream_check_handler(handler, mode))
-    return NULL;
+static raptor_iostream*
+raptor_new_iostream_to_compressed_handle(raptor_world *world, FILE *handle,
+                                         int close_handle,
+                                         raptor_compression_type type)
+{
+  raptor_compress_context* con;
+  raptor_iostream* iostr;
 
-  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
-  if(!iostr)
+  if(!raptor_compression_type_is_available(type))
     return NULL;
 
-  con = RAPTOR_CALLOC(struct raptor_write_string_iostream_context*, 1,
-                      sizeof(*con));
-  if(!con) {
-    RAPTOR_FREE(raptor_iostream, iostr);
+  con = RAPTOR_CALLOC(raptor_compress_context*, 1, sizeof(*con));
+  if(!con)
     return NULL;
-  }
 
-  con->sb = raptor_new_stringbuffer();
-  if(!con->sb) {
-    RAPTOR_FREE(raptor_iostream, iostr);
-    RAPTOR_FREE(raptor_write_string_iostream_context, con);
-    return NULL;
-  }
+  con->handle = handle;
+  con->type = type;
+
+  con->output = RAPTOR_MALLOC(unsigned char*, RAPTOR_COMPRESS_BUFFER_SIZE);
+  if(!con->output)
+    goto failed;
+
+  switch(type) {
+    case RAPTOR_COMPRESSION_NONE:
+      break;
+
+#ifdef HAVE_ZLIB
+    case RAPTOR_COMPRESSION_GZIP:
+      /* 16 selects the gzip wrapper */
+      if(deflateInit2(&con->zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                      15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        goto failed;
+      con->zstream_init = 1;
+      break;
+#endif
 
-  con->string_p = string_p;
-  *string_p = NULL;
+#ifdef HAVE_ZSTD
+    case RAPTOR_COMPRESSION_ZSTD:
+      con->zstd_cctx = ZSTD_createCCtx();
+      if(!con->zstd_cctx)
+        goto failed;
+      break;
+#endif
 
-  con->length_p = length_p;  
-  if(length_p)
-    *length_p = 0;
+    default:
+      goto failed;
+  }
 
-  if(malloc_handler)
-    con->malloc_handler = malloc_handler;
-  else
-    con->malloc_handler = raptor_alloc_memory;
+  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+  if(!iostr)
+    goto failed;
 
   iostr->world = world;
-  iostr->handler = handler;
+  iostr->handler = &raptor_iostream_write_compressed_handler;
   iostr->user_data = (void*)con;
-  iostr->mode = mode;
+  iostr->mode = RAPTOR_IOSTREAM_MODE_WRITE;
 
-  if(iostr->handler->init && iostr->handler->init(iostr->user_data)) {
+  if(raptor_iostream_set_write_buffer_size(iostr,
+                                           RAPTOR_COMPRESS_BUFFER_SIZE)) {
+    /* nothing was written so do not end the compressed stream */
+    con->ended = 1;
     raptor_free_iostream(iostr);
     return NULL;
   }
-  return iostr;
-}
 
+  con->close_handle = close_handle;
 
-/**
- * raptor_new_iostream_from_sink:
- * @world: raptor world
- *
- * Create a new read iostream from a sink, returning no data.
- *
- * Provides an I/O source that returns end of input immediately on
- * reads, and throw away all writes. Same as
- * raptor_new_iostream_to_sink()
- * 
- * Return value: new #raptor_iostream object or NULL on failure
- **/
-raptor_iostream*
-raptor_new_iostream_from_sink(raptor_world *world)
-{
-  RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
+  return iostr;
 
-  raptor_world_open(world);
-  
-  return raptor_new_iostream_from_handler(world, NULL,
-                                          &raptor_iostream_sink_handler);
+  failed:
+  raptor_free_compress_context(con);
+  return NULL;
 }
 
 
-static const raptor_iostream_handler raptor_iostream_read_filename_handler = {
-  /* .version     = */ 2,
-  /* .init        = */ NULL,
-  /* .finish      = */ raptor_filename_iostream_finish,
-  /* .write_byte  = */ NULL,
-  /* .write_bytes = */ NULL,
-  /* .write_end   = */ NULL,
-  /* .read_bytes  = */ raptor_filename_iostream_read_bytes,
-  /* .read_eof    = */ raptor_filename_iostream_read_eof
-};
-
-
 /**
- * raptor_new_iostream_from_filename:
+ * raptor_new_iostream_to_compressed_filename:
  * @world: raptor world
- * @filename: Input filename to open and read from
+ * @filename: Output filename to open and write to
+ * @type: compression type
  *
- * Constructor - create a new iostream reading from a filename.
- * 
- * Return value: new #raptor_iostream object or NULL on failure
+ * Constructor - create a new iostream writing compressed content to a filename.
+ *
+ * The compressed stream is ended by raptor_iostream_write_end() or
+ * when the iostream is freed.
+ *
+ * Return value: new #raptor_iostream object or NULL on failure or if @type is not supported
  **/
 raptor_iostream*
-raptor_new_iostream_from_filename(raptor_world *world, const char *filename)
+raptor_new_iostream_to_compressed_filename(raptor_world *world,
+                                           const char *filename,
+                                           raptor_compression_type type)
 {
   FILE *handle;
   raptor_iostream* iostr;
-  const raptor_iostream_handler* handler;
-  const unsigned int mode = RAPTOR_IOSTREAM_MODE_READ;
 
   RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
 
-  if(!filename)
-    return NULL;
-  
   raptor_world_open(world);
-  
-  handler = &raptor_iostream_read_filename_handler;
-  if(!raptor_iostream_check_handler(handler, mode))
+
+  if(!filename || !raptor_compression_type_is_available(type))
     return NULL;
 
-  handle = fopen(filename, "rb");
+  handle = fopen(filename, "wb");
   if(!handle)
     return NULL;
-  
-  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
+
+  iostr = raptor_new_iostream_to_compressed_handle(world, handle, 1, type);
   if(!iostr) {
     fclose(handle);
-    return NULL;
+    remove(filename);
   }
 
-  iostr->world = world;
-  iostr->handler = handler;
-  iostr->user_data = (void*)handle;
-  iostr->mode = mode;
-
-  if(iostr->handler->init && 
-     iostr->handler->init(iostr->user_data)) {
-    raptor_free_iostream(iostr);
-    return NULL;
-  }
   return iostr;
 }
 
 
-static const raptor_iostream_handler raptor_iostream_read_file_handle_handler = {
-  /* .version     = */ 2,
-  /* .init        = */ NULL,
-  /* .finish      = */ NULL,
-  /* .write_byte  = */ NULL,
-  /* .write_bytes = */ NULL,
-  /* .write_end   = */ NULL,
-  /* .read_bytes  = */ raptor_filename_iostream_read_bytes,
-  /* .read_eof    = */ raptor_filename_iostream_read_eof
-};
-
-
 /**
- * raptor_new_iostream_from_file_handle:
+ * raptor_new_iostream_to_compressed_file_handle:
  * @world: raptor world
- * @handle: Input file_handle to open and read from
+ * @handle: FILE* handle to write to
+ * @type: compression type
  *
- * Constructor - create a new iostream reading from a file_handle.
- * 
- * The @handle must already be open for reading.
+ * Constructor - create a new iostream writing compressed content to a FILE*.
+ *
+ * As raptor_new_iostream_to_compressed_filename().  The @handle must
+ * already be open for writing.
  * NOTE: This does not fclose the @handle when it is finished.
  *
- * Return value: new #raptor_iostream object or NULL on failure
+ * Return value: new #raptor_iostream object or NULL on failure or if @type is not supported
  **/
 raptor_iostream*
-raptor_new_iostream_from_file_handle(raptor_world *world, FILE *handle)
+raptor_new_iostream_to_compressed_file_handle(raptor_world *world,
+                                              FILE *handle,
+                                              raptor_compression_type type)
 {
-  raptor_iostream* iostr;
-  const raptor_iostream_handler* handler;
-  const unsigned int mode = RAPTOR_IOSTREAM_MODE_READ;
-
   RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
 
-  if(!handle)
-    return NULL;
-  
   raptor_world_open(world);
-  
-  handler = &raptor_iostream_read_file_handle_handler;
-  if(!raptor_iostream_check_handler(handler, mode))
-    return NULL;
 
-  iostr = RAPTOR_CALLOC(raptor_iostream*, 1, sizeof(*iostr));
-  if(!iostr)
+  if(!handle)
     return NULL;
 
-  iostr->world = world;
-  iostr->handler = handler;
-  iostr->user_data = (void*)handle;
-  iostr->mode = mode;
-
-  if(iostr->handler->init && 
-     iostr->handler->init(iostr->user_data)) {
-    RAPTOR_FREE(raptor_iostream, iostr);
-    return NULL;
-  }
-  return iostr;
+  return raptor_new_iostream_to_compressed_handle(world, handle, 0, type);
 }
 
 
@@ -694,6 +1783,11 @@ raptor_free_iostream(raptor_iostream *iostr)
   if(iostr->flags & RAPTOR_IOSTREAM_FLAGS_EOF)
     raptor_iostream_write_end(iostr);
 
+  if(iostr->buffer) {
+    raptor_iostream_flush_buffer(iostr);
+    RAPTOR_FREE(char*, iostr->buffer);
+  }
+
   if(iostr->handler->finish)
     iostr->handler->finish(iostr->user_data);
 
@@ -721,6 +1815,15 @@ raptor_iostream_write_byte(const int byte, raptor_iostream *iostr)
 
   if(iostr->flags & RAPTOR_IOSTREAM_FLAGS_EOF)
     return 1;
+
+  if(iostr->buffer) {
+    if(iostr->buffer_used == iostr->buffer_size &&
+       raptor_iostream_flush_buffer(iostr))
+      return 1;
+    iostr->buffer[iostr->buffer_used++] = RAPTOR_GOOD_CAST(unsigned char, byte);
+    return 0;
+  }
+
   if(!iostr->handler->write_byte)
     return 1;
   if(!(iostr->mode & RAPTOR_IOSTREAM_MODE_WRITE))
@@ -748,6 +1851,23 @@ raptor_iostream_write_bytes(const void *ptr, size_t size, size_t nmemb,
   
   if(iostr->flags & RAPTOR_IOSTREAM_FLAGS_EOF)
     return -1;
+
+  if(iostr->buffer) {
+    size_t len = size * nmemb;
+
+    if(len > iostr->buffer_size - iostr->buffer_used &&
+       raptor_iostream_flush_buffer(iostr))
+      return -1;
+
+    if(len < iostr->buffer_size) {
+      memcpy(iostr->buffer + iostr->buffer_used, ptr, len);
+      iostr->buffer_used += len;
+      iostr->offset += len;
+      return RAPTOR_BAD_CAST(int, nmemb);
+    }
+    /* otherwise too large to buffer: write it directly */
+  }
+
   if(!iostr->handler->write_bytes)
     return -1;
   if(!(iostr->mode & RAPTOR_IOSTREAM_MODE_WRITE))
@@ -832,14 +1952,77 @@ raptor_iostream_write_end(raptor_iostream *iostr)
   
   if(iostr->flags & RAPTOR_IOSTREAM_FLAGS_EOF)
     return 1;
-  if(iostr->handler->write_end)
-    rc = iostr->handler->write_end(iostr->user_data);
+  if(iostr->buffer)
+    rc = raptor_iostream_flush_buffer(iostr);
+  if(iostr->handler->write_end && iostr->handler->write_end(iostr->user_data))
+    rc = 1;
   iostr->flags |= RAPTOR_IOSTREAM_FLAGS_EOF;
 
   return rc;
 }
 
 
+/**
+ * raptor_iostream_write_flush:
+ * @iostr: raptor iostream
+ *
+ * Write any buffered output to the iostream handler.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+raptor_iostream_write_flush(raptor_iostream *iostr)
+{
+  return raptor_iostream_flush_buffer(iostr);
+}
+
+
+/**
+ * raptor_iostream_set_write_buffer_size:
+ * @iostr: raptor iostream
+ * @size: buffer size in bytes or 0 to write through to the handler
+ *
+ * Set the size of the iostream write buffer.
+ *
+ * Buffered output is passed to the handler in blocks when the buffer
+ * is full, on raptor_iostream_write_flush() and when writing ends.
+ * The iostreams made by the raptor_new_iostream_to_filename() and
+ * raptor_new_iostream_to_string() constructors are buffered by
+ * default; iostreams over a caller's FILE* or user handlers are not.
+ *
+ * Any output already buffered is flushed first.
+ *
+ * Return value: non-0 on failure
+ **/
+int
+raptor_iostream_set_write_buffer_size(raptor_iostream *iostr, size_t size)
+{
+  if(!(iostr->mode & RAPTOR_IOSTREAM_MODE_WRITE))
+    return 1;
+
+  if(raptor_iostream_flush_buffer(iostr))
+    return 1;
+
+  if(size == iostr->buffer_size)
+    return 0;
+
+  if(iostr->buffer) {
+    RAPTOR_FREE(char*, iostr->buffer);
+    iostr->buffer = NULL;
+    iostr->buffer_size = 0;
+  }
+
+  if(size) {
+    iostr->buffer = RAPTOR_MALLOC(unsigned char*, size);
+    if(!iostr->buffer)
+      return 1;
+    iostr->buffer_size = size;
+  }
+
+  return 0;
+}
+
+
 /**
  * raptor_stringbuffer_write:
  * @sb: #raptor_stringbuffer to write
@@ -1244,6 +2427,14 @@ test_write_to_file_handle(raptor_world *world, FILE* handle,
     fprintf(stderr, "%s: %s wrote %d bytes, expected %d\n", program, label,
             (int)count, expected_bytes_count);
     rc = 1;
+    goto tidy;
+  }
+
+  /* unbuffered: the caller may write to the handle directly */
+  if(ftell(handle) != (long)expected_bytes_count) {
+    fprintf(stderr, "%s: %s passed %ld bytes to the handle, expected %d\n",
+            program, label, ftell(handle), expected_bytes_count);
+    rc = 1;
   }
 
   tidy:
@@ -1576,6 +2767,96 @@ test_read_from_sink(raptor_world *world, size_t read_len, size_t expected_len)
   return rc;
 }
 
+/* large enough to cross the compressed iostream buffers */
+#define COMPRESSED_TEST_LINES 40000
+
+static int
+test_compressed_filename(raptor_world *world, const char* filename,
+                         raptor_compression_type type)
+{
+  raptor_iostream *iostr = NULL;
+  char buffer[READ_BUFFER_SIZE];
+  char line[32];
+  size_t line_len = 0;
+  size_t line_offset = 0;
+  int line_number = 0;
+  size_t total = 0;
+  size_t expected_total = 0;
+  int i;
+  int rc = 0;
+  const char* const label="compressed iostream";
+  const char* name = raptor_compression_type_get_name(type);
+
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  fprintf(stderr, "%s: Testing %s %s '%s'\n", program, name, label, filename);
+#endif
+
+  iostr = raptor_new_iostream_to_compressed_filename(world, filename, type);
+  if(!iostr) {
+    fprintf(stderr, "%s: Failed to create write %s %s '%s'\n", program,
+            name, label, filename);
+    rc = 1;
+    goto tidy;
+  }
+  for(i = 0; i < COMPRESSED_TEST_LINES; i++) {
+    int len = sprintf(line, "line %d\n", i);
+    raptor_iostream_write_bytes(line, 1, RAPTOR_GOOD_CAST(size_t, len), iostr);
+    expected_total += RAPTOR_GOOD_CAST(size_t, len);
+  }
+  raptor_free_iostream(iostr);
+
+  iostr = raptor_new_iostream_from_compressed_filename(world, filename);
+  if(!iostr) {
+    fprintf(stderr, "%s: Failed to create read %s %s '%s'\n", program,
+            name, label, filename);
+    rc = 1;
+    goto tidy;
+  }
+
+  /* compare with the lines as they are regenerated */
+  while(!raptor_iostream_read_eof(iostr)) {
+    int count = raptor_iostream_read_bytes(buffer, 1, READ_BUFFER_SIZE, iostr);
+
+    if(count < 0) {
+      fprintf(stderr, "%s: %s %s read failed\n", program, name, label);
+      rc = 1;
+      goto tidy;
+    }
+
+    for(i = 0; i < count; i++) {
+      if(line_offset == line_len) {
+        line_len = RAPTOR_GOOD_CAST(size_t,
+                                    sprintf(line, "line %d\n", line_number++));
+        line_offset = 0;
+      }
+      if(buffer[i] != line[line_offset++]) {
+        fprintf(stderr, "%s: %s %s differs at byte %d\n", program, name,
+                label, (int)(total + RAPTOR_GOOD_CAST(size_t, i)));
+        rc = 1;
+        goto tidy;
+      }
+    }
+    total += RAPTOR_GOOD_CAST(size_t, count);
+  }
+
+  if(total != expected_total) {
+    fprintf(stderr, "%s: %s %s read %d bytes, expected %d\n", program,
+            name, label, (int)total, (int)expected_total);
+    rc = 1;
+  }
+
+  tidy:
+  if(iostr)
+    raptor_free_iostream(iostr);
+  remove(filename);
+
+  if(rc)
+    fprintf(stderr, "%s: FAILED Testing %s %s\n", program, name, label);
+
+  return rc;
+}
+
+
 
 #define OUT_FILENAME "out.bin"
 #define OUT_BYTES_COUNT 14
@@ -1590,6 +2871,7 @@ main(int argc, char *argv[])
   raptor_world *world;
   FILE *handle = NULL;
   int failures = 0;
+  int i;
   
   program = raptor_basename(argv[0]);
 
@@ -1657,6 +2939,13 @@ main(int argc, char *argv[])
   failures+= test_read_from_sink(world, TEST_STRING_LEN, 0);
 
   remove(IN_FILENAME);
+
+  /* Compressed write and read tests; NONE tests reading uncompressed */
+  for(i = 0; i <= RAPTOR_COMPRESSION_LAST; i++) {
+    if(raptor_compression_type_is_available((raptor_compression_type)i))
+      failures+= test_compressed_filename(world, (const char*)OUT_FILENAME,
+                                          (raptor_compression_type)i);
+  }
   
   raptor_free_world(world);
   
@@ -406,7 +406,7 @@ static int raptor_json_yajl_end_map(void * ctx)
       return 0;
 
     /* Generate the statement */
-    (*rdf_parser->statement_handler)(rdf_parser->user_data, &context->statement);
+    raptor_parser_emit_statement(rdf_parser, &context->statement);
 
     raptor_free_term(context->statement.object);
     context->statement.object = NULL;
@@ -460,7 +460,7 @@ static int raptor_json_yajl_end_map(void * ctx)
       return 0;
     } else {
       /* Generate the statement */
-      (*rdf_parser->statement_handler)(rdf_parser->user_data, &context->statement);
+      raptor_parser_emit_statement(rdf_parser, &context->statement);
     }
     raptor_statement_clear(&context->statement);
     context->state = RAPTOR_JSON_STATE_TRIPLES_ARRAY;
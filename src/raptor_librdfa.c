@@ -116,7 +116,7 @@ raptor_librdfa_generate_statement(rdftriple* triple, void* callback_data)
     parser->emitted_default_graph++;
   }
 
-  if(!parser->statement_handler)
+  if(!parser->statement_handler && !parser->statement_batch_handler)
     goto cleanup;
 
   if(!triple->subject || !triple->predicate || !triple->object) {
@@ -228,7 +228,7 @@ raptor_librdfa_generate_statement(rdftriple* triple, void* callback_data)
   s->object = object_term;
   
   /* Generate statement */
-  (*parser->statement_handler)(parser->user_data, s);
+  raptor_parser_emit_statement(parser, s);
 
   cleanup:
   rdfa_free_triple(triple);
@@ -600,9 +600,17 @@ raptor_libxml_sax_init(raptor_sax2* sax2)
   sax->externalSubset = raptor_libxml_externalSubset;
 #endif
 
+#ifdef HAVE_XMLSAX2INTERNALSUBSET
+  /* SAX2 - 2.6.0 or later: libxml2 does the namespace processing and
+   * passes split names so startElement above is not used */
+  sax->startElementNs = raptor_sax2_start_element_ns;
+  sax->endElementNs = raptor_sax2_end_element_ns;
+  sax->initialized = XML_SAX2_MAGIC;
+#else
 #ifdef RAPTOR_LIBXML_XMLSAXHANDLER_INITIALIZED
   sax->initialized = 1;
 #endif
+#endif
 }
 
 
@@ -877,6 +885,28 @@ raptor_libxml_xmlStructuredError_handler_parsing(void *user_data,
     }
   }
 
+#ifdef HAVE_XMLSAX2INTERNALSUBSET
+  /* In SAX2 mode libxml2 reports parsing errors here rather than via
+   * the warning and error handlers so pass them on to those, except
+   * undeclared namespace prefixes which raptor_sax2 reports itself */
+  if(sax2 && err && err->message) {
+    size_t len;
+
+    if(err->code == XML_NS_ERR_UNDEFINED_NAMESPACE)
+      return;
+
+    len = strlen(err->message);
+    if(len && err->message[len - 1] == '\n')
+      err->message[len - 1] = '\0';
+
+    if(err->level == XML_ERR_WARNING)
+      raptor_libxml_warning(sax2, "%s", err->message);
+    else
+      raptor_libxml_error(sax2, "%s", err->message);
+    return;
+  }
+#endif
+
   if(sax2)
     raptor_libxml_xmlStructuredError_handler_common(sax2->world, sax2->locator,
                                                     err);
@@ -125,6 +125,8 @@ raptor_log_error(raptor_world* world, raptor_log_level level,
                  raptor_locator* locator, const char* text)
 {
   raptor_log_handler handler;
+  raptor_log_message thread_message;
+  raptor_log_message* message;
 
   if(level == RAPTOR_LOG_LEVEL_NONE)
     return;
@@ -133,19 +135,22 @@ raptor_log_error(raptor_world* world, raptor_log_level level,
     if(world->internal_ignore_errors)
       return;
 
-    memset(&world->message, '\0', sizeof(world->message));
-    world->message.code = -1;
-    world->message.domain = RAPTOR_DOMAIN_NONE;
-    world->message.level = level;
-    world->message.locator = locator;
-    world->message.text = text;
+    /* other threads may be logging with the same world */
+    message = world->thread_safe ? &thread_message : &world->message;
+
+    memset(message, '\0', sizeof(*message));
+    message->code = -1;
+    message->domain = RAPTOR_DOMAIN_NONE;
+    message->level = level;
+    message->locator = locator;
+    message->text = text;
   
     handler = world->message_handler;
     if(handler) {
       /* This is the place in raptor that ALL of the user error handler
        * functions are called.
        */
-      handler(world->message_handler_user_data, &world->message);
+      handler(world->message_handler_user_data, message);
       return;
     }
   }
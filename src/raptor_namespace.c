@@ -147,6 +147,11 @@ raptor_namespaces_init(raptor_world* world,
 
   nstack->def_namespace = NULL;
 
+  nstack->uri_cache = NULL;
+  nstack->uri_cache_count = 0;
+  nstack->uri_cache_hits = 0;
+  nstack->uri_cache_misses = 0;
+
   nstack->rdf_ms_uri = raptor_new_uri_from_counted_string(nstack->world,
                                                           (const unsigned char*)raptor_rdf_namespace_uri,
                                                           raptor_rdf_namespace_uri_len);
@@ -282,6 +287,132 @@ raptor_namespaces_start_namespace_full(raptor_namespace_stack *nstack,
 }
 
 
+/* number of slots in the URI cache; a power of 2 */
+#define RAPTOR_NAMESPACES_URI_CACHE_SIZE 2048
+
+/*
+ * raptor_namespaces_uri_cache_flush - INTERNAL
+ * @nstack: namespace stack
+ *
+ * Empty the namespace URI + local name cache
+ */
+static void
+raptor_namespaces_uri_cache_flush(raptor_namespace_stack *nstack)
+{
+  int i;
+
+  for(i = 0; i < RAPTOR_NAMESPACES_URI_CACHE_SIZE; i++) {
+    raptor_namespace_uri_cache_entry* entry = &nstack->uri_cache[i];
+
+    if(!entry->ns_uri)
+      continue;
+    raptor_free_uri(entry->ns_uri);
+    raptor_free_uri(entry->uri);
+    RAPTOR_FREE(char*, entry->local_name);
+    entry->ns_uri = NULL;
+  }
+  nstack->uri_cache_count = 0;
+}
+
+
+/*
+ * raptor_namespaces_local_name_to_uri - INTERNAL
+ * @nstack: namespace stack
+ * @ns_uri: namespace URI
+ * @local_name: local name (NUL terminated)
+ * @local_name_length: length of @local_name
+ *
+ * Get the URI of a namespace URI followed by a local name.
+ *
+ * URIs made are cached in @nstack keyed by the namespace URI object
+ * and the local name so that repeated qnames take one hash probe and
+ * no allocation.  Keying on the namespace URI rather than the prefix
+ * means rebinding a prefix never finds a stale entry.  The cache is
+ * emptied when full.
+ *
+ * Return value: new URI reference or NULL on failure
+ */
+raptor_uri*
+raptor_namespaces_local_name_to_uri(raptor_namespace_stack *nstack,
+                                    raptor_uri *ns_uri,
+                                    const unsigned char *local_name,
+                                    size_t local_name_length)
+{
+  raptor_namespace_uri_cache_entry* entry;
+  raptor_uri* uri;
+  unsigned char* new_local_name;
+  unsigned int hash;
+  size_t i;
+
+  if(!ns_uri)
+    return NULL;
+
+  if(!nstack->uri_cache) {
+    nstack->uri_cache = RAPTOR_CALLOC(raptor_namespace_uri_cache_entry*,
+                                      RAPTOR_NAMESPACES_URI_CACHE_SIZE,
+                                      sizeof(*nstack->uri_cache));
+    if(!nstack->uri_cache)
+      return NULL;
+  }
+
+  /* djb2 over the local name seeded with the namespace URI address */
+  hash = 5381U ^ (unsigned int)((size_t)ns_uri >> 4);
+  for(i = 0; i < local_name_length; i++)
+    hash = ((hash << 5) + hash) + local_name[i];
+
+  for(i = hash & (RAPTOR_NAMESPACES_URI_CACHE_SIZE - 1);
+      (entry = &nstack->uri_cache[i])->ns_uri;
+      i = (i + 1) & (RAPTOR_NAMESPACES_URI_CACHE_SIZE - 1)) {
+    if(entry->hash == hash && entry->ns_uri == ns_uri &&
+       entry->local_name_length == local_name_length &&
+       !memcmp(entry->local_name, local_name, local_name_length)) {
+      nstack->uri_cache_hits++;
+      return raptor_uri_copy(entry->uri);
+    }
+  }
+
+  nstack->uri_cache_misses++;
+
+  uri = raptor_new_uri_from_uri_local_name(nstack->world, ns_uri, local_name);
+  if(!uri)
+    return NULL;
+
+  /* keep at most 3/4 of the slots used */
+  if((nstack->uri_cache_count + 1) * 4 > RAPTOR_NAMESPACES_URI_CACHE_SIZE * 3) {
+    raptor_namespaces_uri_cache_flush(nstack);
+    for(i = hash & (RAPTOR_NAMESPACES_URI_CACHE_SIZE - 1);
+        nstack->uri_cache[i].ns_uri;
+        i = (i + 1) & (RAPTOR_NAMESPACES_URI_CACHE_SIZE - 1))
+      ;
+    entry = &nstack->uri_cache[i];
+  }
+
+  new_local_name = RAPTOR_MALLOC(unsigned char*, local_name_length + 1);
+  if(!new_local_name)
+    return uri;
+  memcpy(new_local_name, local_name, local_name_length + 1); /* Copy NUL */
+
+  entry->ns_uri = raptor_uri_copy(ns_uri);
+  entry->local_name = new_local_name;
+  entry->local_name_length = local_name_length;
+  entry->hash = hash;
+  entry->uri = raptor_uri_copy(uri);
+  nstack->uri_cache_count++;
+
+  return uri;
+}
+
+
+#ifdef RAPTOR_DEBUG
+void
+raptor_namespaces_stats_print(raptor_namespace_stack *nstack, FILE *stream)
+{
+  fprintf(stream, "namespace URI cache hits: %d misses: %d\n",
+          nstack->uri_cache_hits, nstack->uri_cache_misses);
+}
+#endif
+
+
 /**
  * raptor_namespaces_clear:
  * @nstack: namespace stack
@@ -311,6 +442,12 @@ raptor_namespaces_clear(raptor_namespace_stack *nstack)
     nstack->table_size = 0;
   }
 
+  if(nstack->uri_cache) {
+    raptor_namespaces_uri_cache_flush(nstack);
+    RAPTOR_FREE(raptor_namespace_uri_cache_entry*, nstack->uri_cache);
+    nstack->uri_cache = NULL;
+  }
+
   if(nstack->world) {
     if(nstack->rdf_ms_uri) {
       raptor_free_uri(nstack->rdf_ms_uri);
@@ -35,6 +35,10 @@
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#if defined(HAVE_EMMINTRIN_H) && defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define RAPTOR_NTRIPLES_SSE2 1
+#endif
 
 
 /* Raptor includes */
@@ -103,6 +107,84 @@ raptor_ntriples_term_valid(unsigned char c, int position,
 }
 
 
+/*
+ * raptor_ntriples_span:
+ * @p: bytes to scan
+ * @len: number of bytes
+ * @stops: stop bytes as a NUL terminated string (at most
+ *   #RAPTOR_NTRIPLES_SPAN_MAX_STOPS)
+ * @low: lowest byte allowed in the run
+ * @high: highest byte allowed in the run
+ *
+ * INTERNAL - Find the length of the initial run of bytes in a range and not in a set
+ *
+ * Used to skip or copy ASCII runs of N-Triples lines and terms that
+ * need no per-character handling and to find runs of strings that can
+ * be written without escaping.  Where SSE2 is available 16 bytes are
+ * classified at a time.
+ *
+ * Return value: number of bytes before the first stop byte or byte outside @low to @high, or @len
+ */
+size_t
+raptor_ntriples_span(const unsigned char *p, size_t len,
+                     const char *stops, unsigned char low, unsigned char high)
+{
+  size_t stops_len = strlen(stops);
+  size_t i = 0;
+  size_t k;
+
+  RAPTOR_ASSERT_RETURN(stops_len > RAPTOR_NTRIPLES_SPAN_MAX_STOPS,
+                       "too many stop bytes", 0);
+
+#ifdef RAPTOR_NTRIPLES_SSE2
+  if(len >= 16 && stops_len <= RAPTOR_NTRIPLES_SPAN_MAX_STOPS) {
+    __m128i stop_vectors[RAPTOR_NTRIPLES_SPAN_MAX_STOPS];
+    int check_range = (low > 0x00 || high < 0xff);
+    /* flipping the top bit lets a signed compare order bytes unsigned */
+    __m128i bias = _mm_set1_epi8(RAPTOR_GOOD_CAST(char, 0x80));
+    __m128i low_vector = _mm_set1_epi8(RAPTOR_GOOD_CAST(char, low ^ 0x80));
+    __m128i high_vector = _mm_set1_epi8(RAPTOR_GOOD_CAST(char, high ^ 0x80));
+
+    for(k = 0; k < stops_len; k++)
+      stop_vectors[k] = _mm_set1_epi8(stops[k]);
+
+    for(; i + 16 <= len; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+      __m128i hits = _mm_setzero_si128();
+      int bits;
+
+      if(check_range) {
+        __m128i biased = _mm_xor_si128(v, bias);
+
+        hits = _mm_or_si128(_mm_cmplt_epi8(biased, low_vector),
+                            _mm_cmpgt_epi8(biased, high_vector));
+      }
+
+      for(k = 0; k < stops_len; k++)
+        hits = _mm_or_si128(hits, _mm_cmpeq_epi8(v, stop_vectors[k]));
+
+      bits = _mm_movemask_epi8(hits);
+      if(bits)
+        return i + (size_t)__builtin_ctz((unsigned int)bits);
+    }
+  }
+#endif
+
+  for(; i < len; i++) {
+    unsigned char c = p[i];
+
+    if(c < low || c > high)
+      break;
+    for(k = 0; k < stops_len; k++) {
+      if(c == (unsigned char)stops[k])
+        return i;
+    }
+  }
+
+  return i;
+}
+
+
 /*
  * raptor_ntriples_parse_term_internal:
  * @world: raptor world
@@ -146,11 +228,42 @@ raptor_ntriples_parse_term_internal(raptor_world* world,
   unsigned long unichar = 0;
   unsigned int position = 0;
   int end_char_seen = 0;
+  char span_stops[4] = { '\\', '\0', '\0', '\0' };
+  int use_span = 0;
+
+  if(end_char && (term_class == RAPTOR_TERM_CLASS_URI ||
+                  term_class == RAPTOR_TERM_CLASS_STRING)) {
+    /* URIs and strings accept every ASCII character except these
+     * until the end character, so runs of them can be copied in bulk */
+    span_stops[1] = end_char;
+    if(term_class == RAPTOR_TERM_CLASS_URI)
+      span_stops[2] = ' ';
+    use_span = 1;
+  }
 
   /* find end of string, fixing backslashed characters on the way */
   while(*lenp > 0) {
     int unichar_width;
 
+    if(use_span) {
+      size_t span = raptor_ntriples_span(p, *lenp, span_stops, 0x00, 0x7f);
+
+      if(span) {
+        if(dest != p)
+          memmove(dest, p, span);
+        dest += span;
+        p += span;
+        (*lenp) -= span;
+        position += RAPTOR_GOOD_CAST(unsigned int, span);
+        if(locator) {
+          locator->column += RAPTOR_GOOD_CAST(int, span);
+          locator->byte += RAPTOR_GOOD_CAST(int, span);
+        }
+        if(!*lenp)
+          break;
+      }
+    }
+
     c = *p;
 
     p++;
@@ -438,6 +551,188 @@ raptor_parse_turtle_term_internal(raptor_world* world,
 }
 
 
+/* prefix of rdf:_n properties that raptor_ntriples_parse_term() checks */
+#define RAPTOR_NTRIPLES_ORDINAL_PREFIX "http://www.w3.org/1999/02/22-rdf-syntax-ns#_"
+#define RAPTOR_NTRIPLES_ORDINAL_PREFIX_LEN 44
+
+/*
+ * raptor_ntriples_scan_uri:
+ * @p: first character after '<'
+ * @end: end of input
+ *
+ * INTERNAL - Find the end of a URI with no escapes or errors
+ *
+ * Return value: length of the URI before '>' or 0 if it needs
+ * raptor_ntriples_parse_term()
+ */
+static size_t
+raptor_ntriples_scan_uri(const unsigned char *p, const unsigned char *end)
+{
+  const unsigned char *start = p;
+
+  while(p < end) {
+    p += raptor_ntriples_span(p, end - p, "\\> ", 0x00, 0x7f);
+    if(p == end || *p != '>') {
+      int unichar_len;
+
+      if(p == end || *p < 0x80)
+        /* escape, space or missing '>' */
+        return 0;
+
+      unichar_len = raptor_unicode_utf8_string_get_char(p, end - p, NULL);
+      if(unichar_len < 0 || unichar_len > end - p - 1)
+        return 0;
+      p += unichar_len;
+      continue;
+    }
+
+    /* '>' - the URI must be absolute */
+    if(!raptor_uri_uri_string_is_absolute(start))
+      return 0;
+    return p - start;
+  }
+
+  return 0;
+}
+
+
+/*
+ * raptor_ntriples_scan_term:
+ * @string: term input
+ * @len: length of @string
+ * @token: pointer to token to fill in (out)
+ *
+ * INTERNAL - Find an N-Triples term that can be used without decoding
+ *
+ * Recognises the common forms of a URI, a blank node or a literal
+ * with an optional language or datatype that have no escapes and
+ * need no error or warning from raptor_ntriples_parse_term().  The
+ * @token strings point into @string and are not NUL terminated.
+ *
+ * Unlike raptor_ntriples_parse_term() this does not touch the world
+ * or the input, so it can be called from any thread.  @string must
+ * not contain NUL bytes.
+ *
+ * Return value: number of bytes of the term or 0 if the term must be
+ * parsed with raptor_ntriples_parse_term()
+ */
+size_t
+raptor_ntriples_scan_term(const unsigned char *string, size_t len,
+                          raptor_ntriples_token* token)
+{
+  const unsigned char *p = string;
+  const unsigned char *end = string + len;
+  size_t n;
+  int unichar_len;
+
+  token->language = NULL;
+  token->language_len = 0;
+  token->datatype = NULL;
+  token->datatype_len = 0;
+
+  if(!len)
+    return 0;
+
+  switch(*p) {
+    case '<':
+      n = raptor_ntriples_scan_uri(p + 1, end);
+      if(!n)
+        return 0;
+      /* raptor_ntriples_parse_term() reports bad ordinals */
+      if(n >= RAPTOR_NTRIPLES_ORDINAL_PREFIX_LEN &&
+         !memcmp(p + 1, RAPTOR_NTRIPLES_ORDINAL_PREFIX,
+                 RAPTOR_NTRIPLES_ORDINAL_PREFIX_LEN))
+        return 0;
+
+      token->type = RAPTOR_TERM_TYPE_URI;
+      token->string = p + 1;
+      token->length = n;
+      p += n + 2;
+      break;
+
+    case '_':
+      if(len < 3 || p[1] != ':')
+        return 0;
+      p += 2;
+      token->type = RAPTOR_TERM_TYPE_BLANK;
+      token->string = p;
+
+      for(n = 0; p < end; p++, n++) {
+        if(!raptor_ntriples_term_valid(*p, RAPTOR_GOOD_CAST(int, n),
+                                       RAPTOR_TERM_CLASS_BNODEID)) {
+          if(*p == '\\' || *p > 0x7f)
+            return 0;
+          /* an ID stopped by another character does not end on '.' */
+          if(n && p[-1] == '.') {
+            p--;
+            n--;
+          }
+          break;
+        }
+      }
+      if(!n)
+        return 0;
+      token->length = n;
+      break;
+
+    case '"':
+      p++;
+      token->type = RAPTOR_TERM_TYPE_LITERAL;
+      token->string = p;
+
+      while(1) {
+        p += raptor_ntriples_span(p, end - p, "\\\"", 0x00, 0x7f);
+        if(p == end || *p == '\\')
+          return 0;
+        if(*p == '"')
+          break;
+
+        unichar_len = raptor_unicode_utf8_string_get_char(p, end - p, NULL);
+        if(unichar_len < 0 || unichar_len > end - p - 1)
+          return 0;
+        p += unichar_len;
+      }
+      token->length = p - token->string;
+      p++;
+
+      if(p < end && *p == '@') {
+        p++;
+        token->language = p;
+        for(n = 0; p < end; p++, n++) {
+          if(!raptor_ntriples_term_valid(*p, RAPTOR_GOOD_CAST(int, n),
+                                         RAPTOR_TERM_CLASS_LANGUAGE)) {
+            if(*p == '\\' || *p > 0x7f)
+              return 0;
+            break;
+          }
+        }
+        if(!n || n > 255)
+          return 0;
+        token->language_len = RAPTOR_GOOD_CAST(unsigned char, n);
+      }
+
+      if(end - p > 1 && *p == '^' && p[1] == '^') {
+        /* a datatype after a language gives a warning */
+        if(token->language || end - p < 3 || p[2] != '<')
+          return 0;
+        p += 3;
+        n = raptor_ntriples_scan_uri(p, end);
+        if(!n)
+          return 0;
+        token->datatype = p;
+        token->datatype_len = n;
+        p += n + 1;
+      }
+      break;
+
+    default:
+      return 0;
+  }
+
+  return p - string;
+}
+
+
 /*
  * raptor_ntriples_parse_term:
  * @world: raptor world
@@ -446,6 +741,7 @@ raptor_parse_turtle_term_internal(raptor_world* world,
  * @len_p: pointer to length of @string (in/out)
  * @term_p: pointer to store term (out)
  * @allow_turtle: non-0 to allow Turtle forms such as integers, boolean
+ * @arena: term arena to allocate the term in (or NULL)
  *
  * INTERNAL - Parse an N-Triples string into a #raptor_term
  *
@@ -453,12 +749,15 @@ raptor_parse_turtle_term_internal(raptor_world* world,
  * proceeds to be used in error messages.  The final value is written
  * into the #raptor_term pointed at by @term_p
  *
+ * If @arena is given, the term is only valid until the arena is reset.
+ *
  * Return value: number of bytes processed or 0 on failure
  */
 size_t
 raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator,
                            unsigned char *string, size_t *len_p,
-                           raptor_term** term_p, int allow_turtle)
+                           raptor_term** term_p, int allow_turtle,
+                           raptor_term_arena* arena)
 {
   unsigned char *p = string;
   unsigned char *dest;
@@ -503,7 +802,10 @@ raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator,
           goto fail;
         }
 
-        *term_p = raptor_new_term_from_uri(world, uri);
+        if(arena)
+          *term_p = raptor_term_arena_new_uri(arena, uri);
+        else
+          *term_p = raptor_new_term_from_uri(world, uri);
         raptor_free_uri(uri);
       }
       break;
@@ -532,10 +834,18 @@ raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator,
           goto fail;
         }
 
-        *term_p = raptor_new_term_from_literal(world,
-                                               dest,
-                                               datatype_uri,
-                                               NULL /* language */);
+        if(arena)
+          *term_p = raptor_term_arena_new_literal(arena,
+                                                  dest, strlen((const char*)dest),
+                                                  datatype_uri,
+                                                  NULL /* language */, 0);
+        else
+          *term_p = raptor_new_term_from_literal(world,
+                                                 dest,
+                                                 datatype_uri,
+                                                 NULL /* language */);
+        if(datatype_uri)
+          raptor_free_uri(datatype_uri);
       } else
         goto fail;
       break;
@@ -659,10 +969,20 @@ raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator,
           object_literal_language = NULL;
         }
 
-        *term_p = raptor_new_term_from_literal(world,
-                                               dest,
-                                               datatype_uri,
-                                               object_literal_language);
+        if(arena)
+          *term_p = raptor_term_arena_new_literal(arena,
+                                                  dest, strlen((const char*)dest),
+                                                  datatype_uri,
+                                                  object_literal_language,
+                                                  object_literal_language ?
+                                                  RAPTOR_BAD_CAST(unsigned char, strlen((const char*)object_literal_language)) : 0);
+        else
+          *term_p = raptor_new_term_from_literal(world,
+                                                 dest,
+                                                 datatype_uri,
+                                                 object_literal_language);
+        if(datatype_uri)
+          raptor_free_uri(datatype_uri);
       }
 
       break;
@@ -706,7 +1026,11 @@ raptor_ntriples_parse_term(raptor_world* world, raptor_locator* locator,
           goto fail;
         }
 
-        *term_p = raptor_new_term_from_blank(world, dest);
+        if(arena)
+          *term_p = raptor_term_arena_new_blank(arena, dest,
+                                                strlen((const char*)dest));
+        else
+          *term_p = raptor_new_term_from_blank(world, dest);
 
         break;
 
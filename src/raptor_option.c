@@ -296,6 +296,54 @@ static const struct
     RAPTOR_OPTION_VALUE_TYPE_BOOL,
     "loadExternalEntities",
     "Parsers and SAX2 should load external entities."
+  },
+  { RAPTOR_OPTION_STATEMENT_ARENA,
+    RAPTOR_OPTION_AREA_PARSER,
+    RAPTOR_OPTION_VALUE_TYPE_BOOL,
+    "statementArena",
+    "Parsers allocate statement terms in an arena reset after each statement."
+  },
+  { RAPTOR_OPTION_PARSE_THREADS,
+    RAPTOR_OPTION_AREA_PARSER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "parseThreads",
+    "Number of threads parsers may use for N-Triples and N-Quads files."
+  },
+  { RAPTOR_OPTION_PARSE_UNORDERED,
+    RAPTOR_OPTION_AREA_PARSER,
+    RAPTOR_OPTION_VALUE_TYPE_BOOL,
+    "parseUnordered",
+    "Parsers may return statements out of document order when using threads."
+  },
+  { RAPTOR_OPTION_WRITE_GROUPED,
+    RAPTOR_OPTION_AREA_SERIALIZER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "writeGrouped",
+    "Write Turtle subject by subject with this many subjects pending"
+  },
+  { RAPTOR_OPTION_MEMORY_LIMIT,
+    RAPTOR_OPTION_AREA_SERIALIZER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "memoryLimit",
+    "Memory in kilobytes abbreviating serializers may use before spilling to temporary files"
+  },
+  { RAPTOR_OPTION_WRITE_THREADS,
+    RAPTOR_OPTION_AREA_SERIALIZER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "writeThreads",
+    "Number of threads the N-Triples and N-Quads serializers use to format statement batches."
+  },
+  { RAPTOR_OPTION_READ_AHEAD,
+    RAPTOR_OPTION_AREA_PARSER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "readAhead",
+    "Number of buffers of input a thread reads ahead of the parser."
+  },
+  { RAPTOR_OPTION_RDF_ID_FILTER_SIZE,
+    RAPTOR_OPTION_AREA_PARSER,
+    RAPTOR_OPTION_VALUE_TYPE_INT,
+    "rdfIDFilterSize",
+    "RDF/XML parser checks rdf:ID values with a filter of this many kilobytes that may miss duplicates."
   }
 };
 
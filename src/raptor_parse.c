@@ -43,6 +43,9 @@
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 /* Raptor includes */
 #include "raptor2.h"
@@ -53,6 +56,11 @@
 
 /* prototypes for helper functions */
 static void raptor_parser_set_strict(raptor_parser* rdf_parser, int is_strict);
+static void raptor_parser_free_batch(raptor_parser* parser);
+static void raptor_parser_discard_statements(raptor_parser* parser);
+
+/* default statements per raptor_statement_batch_handler call */
+#define RAPTOR_PARSER_STATEMENT_BATCH_SIZE 256
 
 /* helper methods */
 
@@ -128,6 +136,10 @@ raptor_parsers_init(raptor_world *world)
   rc+= raptor_init_parser_nquads(world) != 0;
 #endif
 
+#ifdef RAPTOR_PARSER_BINARY
+  rc+= raptor_init_parser_binary(world) != 0;
+#endif
+
   return rc;
 }
 
@@ -444,6 +456,9 @@ raptor_parser_parse_start(raptor_parser *rdf_parser, raptor_uri *uri)
     raptor_free_uri(rdf_parser->base_uri);
   rdf_parser->base_uri = uri;
 
+  /* drop any statements left over from an aborted parse */
+  raptor_parser_discard_statements(rdf_parser);
+
   rdf_parser->locator.uri    = uri;
   rdf_parser->locator.line   = -1;
   rdf_parser->locator.column = -1;
@@ -476,10 +491,18 @@ int
 raptor_parser_parse_chunk(raptor_parser* rdf_parser,
                           const unsigned char *buffer, size_t len, int is_end) 
 {
+  int rc;
+
   if(rdf_parser->sb)
     raptor_stringbuffer_append_counted_string(rdf_parser->sb, buffer, len, 1);
     
-  return rdf_parser->factory->chunk(rdf_parser, buffer, len, is_end);
+  rc = rdf_parser->factory->chunk(rdf_parser, buffer, len, is_end);
+
+  /* deliver any partial batch at the end of the content */
+  if(rc || is_end)
+    raptor_parser_flush_statements(rdf_parser);
+
+  return rc;
 }
 
 
@@ -511,12 +534,67 @@ raptor_free_parser(raptor_parser* rdf_parser)
   if(rdf_parser->sb)
     raptor_free_stringbuffer(rdf_parser->sb);
 
+  if(rdf_parser->batch)
+    raptor_parser_free_batch(rdf_parser);
+
   raptor_object_options_clear(&rdf_parser->options);
 
   RAPTOR_FREE(raptor_parser, rdf_parser);
 }
 
 
+/*
+ * raptor_parser_parse_read_ahead:
+ * @rdf_parser: parser
+ * @stream: FILE* to read from or NULL
+ * @iostr: iostream to read from if @stream is NULL
+ *
+ * INTERNAL - Parse content read in blocks after the parse has started
+ *
+ * Reads are made through raptor_read_ahead with the number of
+ * buffers set by #RAPTOR_OPTION_READ_AHEAD and recorded in
+ * rdf_parser->read_stats.
+ *
+ * Return value: <0 if reading failed, >0 if parsing failed or 0
+ */
+static int
+raptor_parser_parse_read_ahead(raptor_parser* rdf_parser,
+                               FILE *stream, raptor_iostream *iostr)
+{
+  raptor_read_ahead* ra;
+  int rc = 0;
+
+  ra = raptor_new_read_ahead(stream, iostr,
+                             RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser,
+                                                        RAPTOR_OPTION_READ_AHEAD),
+                             &rdf_parser->read_stats);
+  if(!ra)
+    return 1;
+
+  while(1) {
+    unsigned char* buffer;
+    size_t len;
+    int is_end;
+
+    rc = raptor_read_ahead_next(ra, &buffer, &len, &is_end);
+    if(rc) {
+      /* input that was already at the end is not a failure */
+      if(rc > 0)
+        rc = 0;
+      break;
+    }
+
+    rc = raptor_parser_parse_chunk(rdf_parser, buffer, len, is_end);
+    if(rc || is_end)
+      break;
+  }
+
+  raptor_free_read_ahead(ra);
+
+  return rc;
+}
+
+
 /**
  * raptor_parser_parse_file_stream:
  * @rdf_parser: parser
@@ -528,6 +606,9 @@ raptor_free_parser(raptor_parser* rdf_parser)
  *
  * After draining the FILE* stream (EOF), fclose is not called on it.
  *
+ * If option #RAPTOR_OPTION_READ_AHEAD is set, the FILE* is read by
+ * a thread ahead of the parser until this function returns.
+ *
  * Return value: non 0 on failure
  **/
 int
@@ -546,18 +627,137 @@ raptor_parser_parse_file_stream(raptor_parser* rdf_parser,
 
   if(raptor_parser_parse_start(rdf_parser, base_uri))
     return 1;
-  
-  while(!feof(stream)) {
-    size_t len = fread(rdf_parser->buffer, 1, RAPTOR_READ_BUFFER_SIZE, stream);
-    int is_end = (len < RAPTOR_READ_BUFFER_SIZE);
-    rdf_parser->buffer[len] = '\0';
-    rc = raptor_parser_parse_chunk(rdf_parser, rdf_parser->buffer, len, is_end);
-    if(rc || is_end)
-      break;
+
+  rc = raptor_parser_parse_read_ahead(rdf_parser, stream, NULL);
+
+  return (rc != 0);
+}
+
+
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+/*
+ * raptor_parser_parse_compressed_file:
+ * @rdf_parser: parser
+ * @stream: FILE* of RDF content
+ * @filename: filename of content or NULL if it has no name
+ * @base_uri: the base URI to use
+ *
+ * INTERNAL - Parse RDF content from a FILE* that may be compressed
+ *
+ * The content is read through
+ * raptor_new_iostream_from_compressed_file_handle() which detects
+ * the compression and decompresses ahead of the parser.  The
+ * decompressed content is parsed in blocks as for
+ * raptor_parser_parse_iostream() so #RAPTOR_OPTION_READ_AHEAD applies
+ * but #RAPTOR_OPTION_PARSE_THREADS does not.
+ *
+ * Return value: non 0 on failure
+ */
+static int
+raptor_parser_parse_compressed_file(raptor_parser* rdf_parser,
+                                    FILE *stream, const char* filename,
+                                    raptor_uri *base_uri)
+{
+  int rc = 0;
+  raptor_locator *locator = &rdf_parser->locator;
+  raptor_iostream* iostr;
+
+  locator->line= locator->column = -1;
+  locator->file= filename;
+
+  iostr = raptor_new_iostream_from_compressed_file_handle(rdf_parser->world,
+                                                          stream);
+  if(!iostr) {
+    raptor_parser_error(rdf_parser,
+                        "Cannot read compressed content - compression not supported");
+    return 1;
+  }
+
+  if(raptor_parser_parse_start(rdf_parser, base_uri)) {
+    raptor_free_iostream(iostr);
+    return 1;
+  }
+
+  rc = raptor_parser_parse_read_ahead(rdf_parser, NULL, iostr);
+  if(rc < 0)
+    raptor_parser_error(rdf_parser,
+                        "Failed to read compressed content - corrupt or truncated");
+
+  raptor_free_iostream(iostr);
+
+  return (rc != 0);
+}
+#endif
+
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_STAT_H)
+#define RAPTOR_PARSE_FILE_MMAP 1
+
+/*
+ * raptor_parser_parse_file_mmap:
+ * @rdf_parser: parser
+ * @stream: FILE* of RDF content
+ * @filename: filename of content
+ * @base_uri: the base URI to use
+ *
+ * INTERNAL - Parse RDF content from a memory mapped regular file.
+ *
+ * Only used for parsers that implement the factory parse_buffer
+ * method; they are handed the whole file as one read-only buffer
+ * without any intermediate copying into read buffers.
+ *
+ * Return value: <0 if the file cannot be mapped and should be read
+ * with raptor_parser_parse_file_stream(), otherwise non 0 on failure
+ */
+static int
+raptor_parser_parse_file_mmap(raptor_parser* rdf_parser,
+                              FILE *stream, const char* filename,
+                              raptor_uri *base_uri)
+{
+  int rc = 0;
+  struct stat buf;
+  size_t len;
+  void *map;
+  raptor_locator *locator = &rdf_parser->locator;
+
+  if(fstat(fileno(stream), &buf) || !S_ISREG(buf.st_mode) || !buf.st_size)
+    return -1;
+
+  len = RAPTOR_BAD_CAST(size_t, buf.st_size);
+  if(RAPTOR_GOOD_CAST(off_t, len) != buf.st_size)
+    return -1;
+
+  map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fileno(stream), 0);
+  if(map == MAP_FAILED)
+    return -1;
+
+#ifdef MADV_SEQUENTIAL
+  madvise(map, len, MADV_SEQUENTIAL);
+#endif
+
+  locator->line= locator->column = -1;
+  locator->file= filename;
+
+  if(raptor_parser_parse_start(rdf_parser, base_uri)) {
+    rc = 1;
+    goto tidy;
   }
 
+  if(rdf_parser->sb)
+    raptor_stringbuffer_append_counted_string(rdf_parser->sb,
+                                              (const unsigned char*)map,
+                                              len, 1);
+
+  rc = rdf_parser->factory->parse_buffer(rdf_parser,
+                                         (const unsigned char*)map, len);
+  raptor_parser_flush_statements(rdf_parser);
+
+  tidy:
+  munmap(map, len);
+
   return (rc != 0);
 }
+#endif
 
 
 /**
@@ -569,6 +769,13 @@ raptor_parser_parse_file_stream(raptor_parser* rdf_parser,
  * Parse RDF content at a file URI.
  *
  * If @uri is NULL (source is stdin), then the @base_uri is required.
+ *
+ * Content compressed with gzip or zstd is recognised by its magic
+ * number and decompressed if the compression is supported (see
+ * raptor_compression_type_is_available()).  Compressed content is
+ * read ahead as set by #RAPTOR_OPTION_READ_AHEAD but is always parsed
+ * on the calling thread: #RAPTOR_OPTION_PARSE_THREADS only applies to
+ * uncompressed regular files.
  * 
  * Return value: non 0 on failure
  **/
@@ -613,6 +820,23 @@ raptor_parser_parse_file(raptor_parser* rdf_parser, raptor_uri *uri,
     fh = stdin;
   }
 
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+  /* gzip or zstd content is detected by its magic number */
+  if(raptor_compression_file_handle_peek(fh)) {
+    rc = raptor_parser_parse_compressed_file(rdf_parser, fh, filename,
+                                             base_uri);
+    goto cleanup;
+  }
+#endif
+
+#ifdef RAPTOR_PARSE_FILE_MMAP
+  if(uri && rdf_parser->factory->parse_buffer) {
+    rc = raptor_parser_parse_file_mmap(rdf_parser, fh, filename, base_uri);
+    if(rc >= 0)
+      goto cleanup;
+  }
+#endif
+
   rc = raptor_parser_parse_file_stream(rdf_parser, fh, filename, base_uri);
 
   cleanup:
@@ -981,6 +1205,48 @@ raptor_parser_set_statement_handler(raptor_parser* parser,
 }
 
 
+/**
+ * raptor_parser_set_statement_batch_handler:
+ * @parser: #raptor_parser parser object
+ * @user_data: user data pointer for callback
+ * @handler: new batched statement callback function
+ * @batch_size: maximum number of statements per call or <= 0 for the default
+ *
+ * Set the batched statement handler function for the parser.
+ *
+ * Use this to receive statements in arrays of up to @batch_size
+ * statements as the parsing proceeds, for example to do bulk inserts
+ * into a store.  Any partial batch is delivered before each graph
+ * mark and at the end of the parse, so statements keep their order
+ * relative to graph marks.
+ *
+ * The statements passed to @handler are owned by the parser and
+ * cleared for reuse after @handler returns.  A handler set with
+ * raptor_parser_set_statement_handler() is still called for each
+ * statement as it is parsed, with the batched statement as it is
+ * added to the batch.
+ **/
+void
+raptor_parser_set_statement_batch_handler(raptor_parser* parser,
+                                          void *user_data,
+                                          raptor_statement_batch_handler handler,
+                                          int batch_size)
+{
+  /* deliver statements batched for any previous handler */
+  raptor_parser_flush_statements(parser);
+
+  if(batch_size <= 0)
+    batch_size = RAPTOR_PARSER_STATEMENT_BATCH_SIZE;
+
+  if(parser->batch && parser->batch_size != batch_size)
+    raptor_parser_free_batch(parser);
+
+  parser->user_data = user_data;
+  parser->statement_batch_handler = handler;
+  parser->batch_size = batch_size;
+}
+
+
 /**
  * raptor_parser_set_graph_mark_handler:
  * @parser: #raptor_parser parser object
@@ -1230,15 +1496,35 @@ raptor_parser_get_locator(raptor_parser *rdf_parser)
 void
 raptor_stats_print(raptor_parser *rdf_parser, FILE *stream)
 {
+  fputs("raptor parser stats\n  ", stream);
+  raptor_read_stats_print(&rdf_parser->read_stats, stream);
 #ifdef RAPTOR_PARSER_RDFXML
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
   if(!strcmp(rdf_parser->factory->desc.names[0], "rdfxml")) {
     raptor_rdfxml_parser *rdf_xml_parser = (raptor_rdfxml_parser*)rdf_parser->context;
-    fputs("raptor parser stats\n  ", stream);
+    fputs("  ", stream);
     raptor_rdfxml_parser_stats_print(rdf_xml_parser, stream);
   }
 #endif
 #endif
+#if defined(RAPTOR_PARSER_NTRIPLES) || defined(RAPTOR_PARSER_NQUADS)
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  if(!strcmp(rdf_parser->factory->desc.names[0], "ntriples") ||
+     !strcmp(rdf_parser->factory->desc.names[0], "nquads")) {
+    fputs("  ", stream);
+    raptor_ntriples_parser_stats_print(rdf_parser, stream);
+  }
+#endif
+#endif
+#if defined(RAPTOR_PARSER_TURTLE) || defined(RAPTOR_PARSER_TRIG)
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  if(!strcmp(rdf_parser->factory->desc.names[0], "turtle") ||
+     !strcmp(rdf_parser->factory->desc.names[0], "trig")) {
+    fputs("  ", stream);
+    raptor_turtle_parser_stats_print(rdf_parser, stream);
+  }
+#endif
+#endif
 }
 #endif
 
@@ -1446,6 +1732,8 @@ raptor_parser_copy_user_state(raptor_parser *to_parser,
   
   to_parser->user_data = from_parser->user_data;
   to_parser->statement_handler = from_parser->statement_handler;
+  to_parser->statement_batch_handler = from_parser->statement_batch_handler;
+  to_parser->batch_size = from_parser->batch_size;
   to_parser->namespace_handler = from_parser->namespace_handler;
   to_parser->namespace_handler_user_data = from_parser->namespace_handler_user_data;
   to_parser->uri_filter = from_parser->uri_filter;
@@ -1646,6 +1934,137 @@ raptor_parser_get_content(raptor_parser* rdf_parser, size_t* length_p)
 }
 
 
+/* allocate the batch statement slots and the array passed to the handler */
+static int
+raptor_parser_alloc_batch(raptor_parser* parser)
+{
+  size_t size = RAPTOR_GOOD_CAST(size_t, parser->batch_size);
+  size_t i;
+
+  parser->batch_statements = RAPTOR_CALLOC(raptor_statement*, size,
+                                           sizeof(raptor_statement));
+  parser->batch = RAPTOR_CALLOC(raptor_statement**, size,
+                                sizeof(raptor_statement*));
+  if(!parser->batch_statements || !parser->batch) {
+    raptor_parser_free_batch(parser);
+    return 1;
+  }
+
+  for(i = 0; i < size; i++) {
+    raptor_statement_init(&parser->batch_statements[i], parser->world);
+    parser->batch[i] = &parser->batch_statements[i];
+  }
+
+  return 0;
+}
+
+
+/* clear batched statements without delivering them */
+static void
+raptor_parser_discard_statements(raptor_parser* parser)
+{
+  int i;
+
+  for(i = 0; i < parser->batch_count; i++)
+    raptor_statement_clear(&parser->batch_statements[i]);
+  parser->batch_count = 0;
+}
+
+
+/* free the batch statement slots and any statements in them */
+static void
+raptor_parser_free_batch(raptor_parser* parser)
+{
+  if(parser->batch_statements) {
+    raptor_parser_discard_statements(parser);
+    RAPTOR_FREE(raptor_statement*, parser->batch_statements);
+    parser->batch_statements = NULL;
+  }
+
+  if(parser->batch) {
+    RAPTOR_FREE(raptor_statement**, parser->batch);
+    parser->batch = NULL;
+  }
+
+  parser->batch_count = 0;
+}
+
+
+/*
+ * raptor_parser_emit_statement:
+ * @parser: parser
+ * @statement: statement
+ *
+ * Internal - Deliver a parsed statement to the user handlers
+ *
+ * With no batch handler, calls the statement handler (if any) with
+ * @statement.  Otherwise the terms of @statement are copied into the
+ * next reusable batch slot, the statement handler is called with that
+ * slot and the batch is delivered when it is full.  All parsers
+ * report statements through here.
+ */
+void
+raptor_parser_emit_statement(raptor_parser* parser,
+                             raptor_statement* statement)
+{
+  raptor_statement* slot;
+
+  if(!parser->statement_batch_handler) {
+    if(parser->statement_handler)
+      (*parser->statement_handler)(parser->user_data, statement);
+    return;
+  }
+
+  if(!parser->batch && raptor_parser_alloc_batch(parser)) {
+    raptor_parser_fatal_error(parser, "Out of memory");
+    return;
+  }
+
+  /* statement and its terms may be static and reused by the parser so
+   * the slot takes its own references; only static terms are copied */
+  slot = &parser->batch_statements[parser->batch_count];
+  slot->subject = raptor_term_copy(statement->subject);
+  slot->predicate = raptor_term_copy(statement->predicate);
+  slot->object = raptor_term_copy(statement->object);
+  slot->graph = raptor_term_copy(statement->graph);
+  if((statement->subject && !slot->subject) ||
+     (statement->predicate && !slot->predicate) ||
+     (statement->object && !slot->object) ||
+     (statement->graph && !slot->graph)) {
+    raptor_statement_clear(slot);
+    raptor_parser_fatal_error(parser, "Out of memory");
+    return;
+  }
+  parser->batch_count++;
+
+  if(parser->statement_handler)
+    (*parser->statement_handler)(parser->user_data, slot);
+
+  if(parser->batch_count == parser->batch_size)
+    raptor_parser_flush_statements(parser);
+}
+
+
+/*
+ * raptor_parser_flush_statements:
+ * @parser: parser
+ *
+ * Internal - Deliver any batched statements to the batch handler
+ */
+void
+raptor_parser_flush_statements(raptor_parser* parser)
+{
+  if(!parser->batch_count)
+    return;
+
+  if(parser->statement_batch_handler)
+    (*parser->statement_batch_handler)(parser->user_data, parser->batch,
+                                       parser->batch_count);
+
+  raptor_parser_discard_statements(parser);
+}
+
+
 void 
 raptor_parser_start_graph(raptor_parser* parser, raptor_uri* uri,
                           int is_declared)
@@ -1654,6 +2073,9 @@ raptor_parser_start_graph(raptor_parser* parser, raptor_uri* uri,
   if(is_declared)
     flags |= RAPTOR_GRAPH_MARK_DECLARED;
 
+  /* statements before the mark are delivered before it */
+  raptor_parser_flush_statements(parser);
+
   if(!parser->emit_graph_marks)
     return;
   
@@ -1669,6 +2091,8 @@ raptor_parser_end_graph(raptor_parser* parser, raptor_uri* uri, int is_declared)
   if(is_declared)
     flags |= RAPTOR_GRAPH_MARK_DECLARED;
   
+  raptor_parser_flush_statements(parser);
+
   if(!parser->emit_graph_marks)
     return;
   
@@ -1722,6 +2146,9 @@ raptor_parser_get_graph(raptor_parser* rdf_parser)
  *
  * If the parser requires a base URI and @base_uri is NULL, an error
  * will be generated and the function will fail.
+ *
+ * If option #RAPTOR_OPTION_READ_AHEAD is set, @iostr is read by a
+ * thread ahead of the parser until this function returns.
  * 
  * Return value: non 0 on failure, <0 if a required base URI was missing
  **/
@@ -1737,25 +2164,10 @@ raptor_parser_parse_iostream(raptor_parser* rdf_parser, raptor_iostream *iostr,
   rc = raptor_parser_parse_start(rdf_parser, base_uri);
   if(rc)
     return rc;
-  
-  while(!raptor_iostream_read_eof(iostr)) {
-    int ilen;
-    size_t len;
-    int is_end;
 
-    ilen = raptor_iostream_read_bytes(rdf_parser->buffer, 1,
-                                      RAPTOR_READ_BUFFER_SIZE, iostr);
-    if(ilen < 0)
-      break;
-    len = RAPTOR_GOOD_CAST(size_t, ilen);
-    is_end = (len < RAPTOR_READ_BUFFER_SIZE);
+  rc = raptor_parser_parse_read_ahead(rdf_parser, NULL, iostr);
 
-    rc = raptor_parser_parse_chunk(rdf_parser, rdf_parser->buffer, len, is_end);
-    if(rc || is_end)
-      break;
-  }
-  
-  return rc;
+  return (rc != 0);
 }
 
 
@@ -1769,6 +2181,252 @@ raptor_parser_parse_iostream(raptor_parser* rdf_parser, raptor_iostream *iostr,
 int main(int argc, char *argv[]);
 
 
+static const char *batch_test_content =
+  "<http://example.org/s> <http://example.org/p> \"1\" .\n"
+  "<http://example.org/s> <http://example.org/p> \"2\" <http://example.org/g1> .\n"
+  "<http://example.org/s> <http://example.org/p> \"3\" <http://example.org/g1> .\n"
+  "<http://example.org/s> <http://example.org/p> \"4\" <http://example.org/g1> .\n"
+  "<http://example.org/s> <http://example.org/p> \"5\" <http://example.org/g2> .\n";
+
+#define BATCH_TEST_STATEMENTS 5
+#define BATCH_TEST_SIZE 2
+
+typedef struct {
+  /* statements seen by the per-statement handler */
+  int statements;
+  /* last statement given to the per-statement handler */
+  raptor_statement* last;
+  /* statements seen by the batch handler */
+  int batched;
+  int batches;
+  /* non-0 if a batch was too big or a mark arrived before a batch */
+  int failed;
+} batch_test_state;
+
+
+static void
+batch_test_statement_handler(void *user_data, raptor_statement *statement)
+{
+  batch_test_state* state = (batch_test_state*)user_data;
+
+  state->statements++;
+  state->last = statement;
+}
+
+
+static void
+batch_test_batch_handler(void *user_data, raptor_statement **statements,
+                         int count)
+{
+  batch_test_state* state = (batch_test_state*)user_data;
+  int i;
+
+  if(count < 1 || count > BATCH_TEST_SIZE)
+    state->failed = 1;
+
+  /* both handlers are given the same batched statement */
+  if(count > 0 && statements[count - 1] != state->last)
+    state->failed = 1;
+
+  for(i = 0; i < count; i++) {
+    if(!statements[i] || !statements[i]->object)
+      state->failed = 1;
+  }
+
+  state->batched += count;
+  state->batches++;
+}
+
+
+static void
+batch_test_graph_mark_handler(void *user_data, raptor_uri *graph, int flags)
+{
+  batch_test_state* state = (batch_test_state*)user_data;
+
+  /* all statements before a mark must have been delivered */
+  if(state->batched != state->statements)
+    state->failed = 1;
+}
+
+
+static int
+batch_test(raptor_world* world, const char* program)
+{
+  raptor_parser* parser;
+  raptor_uri* base_uri;
+  batch_test_state state;
+  int rc = 0;
+
+  memset(&state, '\0', sizeof(state));
+
+  parser = raptor_new_parser(world, "nquads");
+  base_uri = raptor_new_uri(world, (const unsigned char*)"http://example.org/");
+  if(!parser || !base_uri) {
+    fprintf(stderr, "%s: Failed to create nquads parser\n", program);
+    rc = 1;
+    goto tidy;
+  }
+
+  raptor_parser_set_statement_handler(parser, &state,
+                                      batch_test_statement_handler);
+  raptor_parser_set_graph_mark_handler(parser, &state,
+                                       batch_test_graph_mark_handler);
+  raptor_parser_set_statement_batch_handler(parser, &state,
+                                            batch_test_batch_handler,
+                                            BATCH_TEST_SIZE);
+
+  if(raptor_parser_parse_start(parser, base_uri) ||
+     raptor_parser_parse_chunk(parser,
+                               (const unsigned char*)batch_test_content,
+                               strlen(batch_test_content), 1)) {
+    fprintf(stderr, "%s: Failed to parse batch test content\n", program);
+    rc = 1;
+    goto tidy;
+  }
+
+  if(state.failed || state.statements != BATCH_TEST_STATEMENTS ||
+     state.batched != BATCH_TEST_STATEMENTS) {
+    fprintf(stderr,
+            "%s: Batch handler got %d statements in %d batches, handler got %d statements, expected %d%s\n",
+            program, state.batched, state.batches, state.statements,
+            BATCH_TEST_STATEMENTS,
+            (state.failed ? " and batches were out of order" : ""));
+    rc = 1;
+  }
+
+  tidy:
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  if(parser)
+    raptor_free_parser(parser);
+
+  return rc;
+}
+
+
+/* enough lines for several reads at the largest read size */
+#define READ_AHEAD_TEST_LINES 40000
+
+static void
+read_ahead_test_statement_handler(void *user_data, raptor_statement *statement)
+{
+  int* count_p = (int*)user_data;
+
+  (*count_p)++;
+}
+
+
+static int
+read_ahead_test_parse(raptor_world* world, const char* program,
+                      const char* content, size_t content_len,
+                      int read_ahead, int from_file)
+{
+  raptor_parser* parser;
+  raptor_uri* base_uri;
+  raptor_iostream* iostr = NULL;
+  FILE* fh = NULL;
+  int count = 0;
+  int rc = 0;
+
+  parser = raptor_new_parser(world, "nquads");
+  base_uri = raptor_new_uri(world, (const unsigned char*)"http://example.org/");
+  if(!parser || !base_uri) {
+    fprintf(stderr, "%s: Failed to create nquads parser\n", program);
+    rc = 1;
+    goto tidy;
+  }
+
+  raptor_parser_set_statement_handler(parser, &count,
+                                      read_ahead_test_statement_handler);
+  raptor_parser_set_option(parser, RAPTOR_OPTION_READ_AHEAD, NULL, read_ahead);
+
+  if(from_file) {
+    fh = tmpfile();
+    if(!fh || fwrite(content, 1, content_len, fh) != content_len) {
+      fprintf(stderr, "%s: Failed to write temporary file\n", program);
+      rc = 1;
+      goto tidy;
+    }
+    rewind(fh);
+    rc = raptor_parser_parse_file_stream(parser, fh, NULL, base_uri);
+  } else {
+    iostr = raptor_new_iostream_from_string(world, (void*)content,
+                                            content_len);
+    if(!iostr) {
+      rc = 1;
+      goto tidy;
+    }
+    rc = raptor_parser_parse_iostream(parser, iostr, base_uri);
+  }
+
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  raptor_stats_print(parser, stderr);
+#endif
+
+  if(rc || count != READ_AHEAD_TEST_LINES ||
+     parser->read_stats.bytes != content_len) {
+    fprintf(stderr,
+            "%s: Parsing %s with %d read-ahead buffers returned %d, %d statements and %ld bytes, expected %d statements and %ld bytes\n",
+            program, (from_file ? "a file" : "an iostream"), read_ahead, rc,
+            count, (long)parser->read_stats.bytes, READ_AHEAD_TEST_LINES,
+            (long)content_len);
+    rc = 1;
+  }
+
+  tidy:
+  if(iostr)
+    raptor_free_iostream(iostr);
+  if(fh)
+    fclose(fh);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  if(parser)
+    raptor_free_parser(parser);
+
+  return rc;
+}
+
+
+static const int read_ahead_test_buffers[4] = { 0, 1, 4, 16 };
+
+static int
+read_ahead_test(raptor_world* world, const char* program)
+{
+  raptor_stringbuffer* sb;
+  const char* content;
+  size_t content_len;
+  int i;
+  int rc = 0;
+
+  sb = raptor_new_stringbuffer();
+  if(!sb)
+    return 1;
+
+  for(i = 0; i < READ_AHEAD_TEST_LINES; i++) {
+    char line[128];
+
+    sprintf(line,
+            "<http://example.org/s%d> <http://example.org/p> \"%d\" <http://example.org/g> .\n",
+            i, i);
+    raptor_stringbuffer_append_string(sb, (const unsigned char*)line, 1);
+  }
+  content = (const char*)raptor_stringbuffer_as_string(sb);
+  content_len = raptor_stringbuffer_length(sb);
+
+  /* 0 reads on demand */
+  for(i = 0; !rc && i < 4; i++) {
+    rc = read_ahead_test_parse(world, program, content, content_len,
+                               read_ahead_test_buffers[i], 0) ||
+         read_ahead_test_parse(world, program, content, content_len,
+                               read_ahead_test_buffers[i], 1);
+  }
+
+  raptor_free_stringbuffer(sb);
+
+  return rc;
+}
+
+
 int
 main(int argc, char *argv[])
 {
@@ -1820,6 +2478,12 @@ main(int argc, char *argv[])
   }
   RAPTOR_FREE(char*, s);
 
+  if(batch_test(world, program))
+    return 1;
+
+  if(read_ahead_test(world, program))
+    return 1;
+
   raptor_free_world(world);
   
   return 0;
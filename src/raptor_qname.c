@@ -204,7 +204,8 @@ raptor_new_qname(raptor_namespace_stack *nstack,
   if(qname->nspace && local_name_length) {
     raptor_uri *uri = raptor_namespace_get_uri(qname->nspace);
     if(uri)
-      uri = raptor_new_uri_from_uri_local_name(qname->world, uri, new_name);
+      uri = raptor_namespaces_local_name_to_uri(nstack, uri, new_name,
+                                                local_name_length);
 
     qname->uri = uri;
   }
@@ -341,11 +342,75 @@ raptor_qname_copy(raptor_qname *qname)
   new_qname->uri = raptor_namespace_get_uri(new_qname->nspace);
   if(new_qname->uri)
     new_qname->uri = raptor_new_uri_from_uri_local_name(qname->world, new_qname->uri, new_name);
-  
+
   return new_qname;
 }
 
 
+/*
+ * raptor_new_qname_from_namespace_counted_local_name - INTERNAL
+ * @nstack: namespace stack @ns is in
+ * @ns: namespace of qname (or NULL)
+ * @local_name: element or attribute name
+ * @local_name_length: length of @local_name
+ * @value: attribute value (else NULL for an element)
+ * @value_length: length of @value
+ *
+ * Constructor - create a new XML qname taking ownership of the value.
+ *
+ * Used when the XML parser has already split the name into a
+ * namespace and local name.  @value must have been allocated with
+ * RAPTOR_MALLOC() and NUL terminated; it becomes owned by the qname
+ * and is freed here on failure.
+ *
+ * Return value: a new #raptor_qname object or NULL on failure
+ */
+raptor_qname*
+raptor_new_qname_from_namespace_counted_local_name(raptor_namespace_stack *nstack,
+                                                   const raptor_namespace *ns,
+                                                   const unsigned char *local_name,
+                                                   size_t local_name_length,
+                                                   unsigned char *value,
+                                                   size_t value_length)
+{
+  raptor_qname* qname;
+  unsigned char* new_name;
+
+  qname = RAPTOR_CALLOC(raptor_qname*, 1, sizeof(*qname));
+  if(!qname) {
+    if(value)
+      RAPTOR_FREE(char*, value);
+    return NULL;
+  }
+  qname->world = nstack->world;
+  qname->value = value;
+  qname->value_length = value_length;
+
+  new_name = RAPTOR_MALLOC(unsigned char*, local_name_length + 1);
+  if(!new_name) {
+    raptor_free_qname(qname);
+    return NULL;
+  }
+  memcpy(new_name, local_name, local_name_length); /* No NUL to copy */
+  new_name[local_name_length] = '\0';
+  qname->local_name = new_name;
+  qname->local_name_length = RAPTOR_BAD_CAST(int, local_name_length);
+
+  qname->nspace = ns;
+
+  if(ns && local_name_length) {
+    raptor_uri *uri = raptor_namespace_get_uri(ns);
+    if(uri)
+      uri = raptor_namespaces_local_name_to_uri(nstack, uri, new_name,
+                                                local_name_length);
+
+    qname->uri = uri;
+  }
+
+  return qname;
+}
+
+
 #ifdef RAPTOR_DEBUG
 void
 raptor_qname_print(FILE *stream, raptor_qname* name) 
@@ -494,7 +559,8 @@ raptor_qname_string_to_uri(raptor_namespace_stack *nstack,
    */
   if(ns && (uri = raptor_namespace_get_uri(ns))) {
     if(local_name_length)
-      uri = raptor_new_uri_from_uri_local_name(nstack->world, uri, local_name);
+      uri = raptor_namespaces_local_name_to_uri(nstack, uri, local_name,
+                                                local_name_length);
     else
       uri = raptor_uri_copy(uri);
   }
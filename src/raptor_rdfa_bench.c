@@ -0,0 +1,214 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_rdfa_bench.c - Raptor RDFa parser evaluation context benchmark
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Measures how fast the RDFa parser handles generated XHTML+RDFa
+ * documents where the cost is dominated by creating an evaluation
+ * context for each element:
+ *
+ *   "nested" - blocks of deeply nested elements each with a property,
+ *              using the XHTML terms and many declared prefixes.
+ *   "lists"  - the same nesting where an outer subject has many
+ *              inlist predicates and every element adds to the lists.
+ *
+ * Usage: raptor_rdfa_bench [DEPTH [BLOCKS]]
+ * Default is 200 levels of nesting in each of 500 blocks.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+int main(int argc, char *argv[]);
+
+
+static const char *program;
+
+#define BENCH_BASE_URI "http://example.org/bench.xhtml"
+
+/* number of prefixes declared and of inlist predicates used */
+#define BENCH_PREFIX_COUNT 64
+#define BENCH_LIST_COUNT 32
+
+
+static void
+bench_statement_handler(void *user_data, raptor_statement *statement)
+{
+  unsigned long* count_p = (unsigned long*)user_data;
+
+  (*count_p)++;
+}
+
+
+static void
+bench_write_document(raptor_iostream* iostr, int lists,
+                     unsigned long depth, unsigned long blocks)
+{
+  unsigned long block;
+  unsigned long i;
+
+  raptor_iostream_string_write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                               "<!DOCTYPE html PUBLIC \"-//W3C//DTD XHTML+RDFa 1.1//EN\" \"http://www.w3.org/MarkUp/DTD/xhtml-rdfa-2.dtd\">\n"
+                               "<html xmlns=\"http://www.w3.org/1999/xhtml\" version=\"XHTML+RDFa 1.1\" prefix=\"",
+                               iostr);
+  for(i = 0; i < BENCH_PREFIX_COUNT; i++) {
+    raptor_iostream_string_write(" p", iostr);
+    raptor_iostream_decimal_write((int)i, iostr);
+    raptor_iostream_string_write(": http://example.org/p", iostr);
+    raptor_iostream_decimal_write((int)i, iostr);
+    raptor_iostream_string_write("/", iostr);
+  }
+  raptor_iostream_string_write("\">\n<head><title>bench</title></head>\n<body>\n",
+                               iostr);
+
+  for(block = 0; block < blocks; block++) {
+    raptor_iostream_string_write("<div about=\"#b", iostr);
+    raptor_iostream_decimal_write((int)block, iostr);
+    raptor_iostream_string_write("\">\n", iostr);
+
+    for(i = 0; i < depth; i++) {
+      if(lists) {
+        raptor_iostream_string_write("<span rel=\"p", iostr);
+        raptor_iostream_decimal_write((int)(i % BENCH_PREFIX_COUNT), iostr);
+        raptor_iostream_string_write(":l", iostr);
+        raptor_iostream_decimal_write((int)(i % BENCH_LIST_COUNT), iostr);
+        raptor_iostream_string_write("\" inlist=\"\" resource=\"#i", iostr);
+      } else {
+        raptor_iostream_string_write("<span rel=\"next\" property=\"p", iostr);
+        raptor_iostream_decimal_write((int)(i % BENCH_PREFIX_COUNT), iostr);
+        raptor_iostream_string_write(":v\" resource=\"#i", iostr);
+      }
+      raptor_iostream_decimal_write((int)i, iostr);
+      raptor_iostream_string_write("\">\n", iostr);
+    }
+
+    for(i = 0; i < depth; i++)
+      raptor_iostream_string_write("</span>", iostr);
+    raptor_iostream_string_write("\n</div>\n", iostr);
+  }
+
+  raptor_iostream_string_write("</body>\n</html>\n", iostr);
+}
+
+
+static int
+bench_form(raptor_world* world, raptor_uri* base_uri, const char* name,
+           int lists, unsigned long depth, unsigned long blocks)
+{
+  raptor_iostream* iostr;
+  raptor_parser* parser;
+  unsigned char* document = NULL;
+  size_t document_len = 0;
+  unsigned long count = 0;
+  clock_t start;
+  double seconds;
+  int rc;
+
+  iostr = raptor_new_iostream_to_string(world, (void**)&document,
+                                        &document_len, NULL);
+  if(!iostr)
+    return 1;
+  bench_write_document(iostr, lists, depth, blocks);
+  raptor_free_iostream(iostr);
+  if(!document)
+    return 1;
+
+  parser = raptor_new_parser(world, "rdfa");
+  if(!parser) {
+    fprintf(stderr, "%s: Failed to create rdfa parser\n", program);
+    raptor_free_memory(document);
+    return 1;
+  }
+  raptor_parser_set_statement_handler(parser, &count,
+                                      bench_statement_handler);
+
+  start = clock();
+  rc = raptor_parser_parse_start(parser, base_uri);
+  if(!rc)
+    rc = raptor_parser_parse_chunk(parser, document, document_len, 1);
+  seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  raptor_free_parser(parser);
+  raptor_free_memory(document);
+
+  if(rc) {
+    fprintf(stderr, "%s: Failed to parse %s document\n", program, name);
+    return 1;
+  }
+
+  fprintf(stdout, "%-8s %10lu bytes %8lu triples %8.3fs %10.0f elements/s\n",
+          name, (unsigned long)document_len, count, seconds,
+          seconds > 0.0 ? (depth * blocks) / seconds : 0.0);
+  return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  raptor_world* world;
+  raptor_uri* base_uri;
+  unsigned long depth = 200;
+  unsigned long blocks = 500;
+  int rc;
+
+  program = raptor_basename(argv[0]);
+
+  if(argc > 3) {
+    fprintf(stderr, "USAGE: %s [DEPTH [BLOCKS]]\n", program);
+    return 1;
+  }
+  if(argc > 1)
+    depth = strtoul(argv[1], NULL, 10);
+  if(argc > 2)
+    blocks = strtoul(argv[2], NULL, 10);
+
+  world = raptor_new_world();
+  if(!world || raptor_world_open(world))
+    return 1;
+
+  base_uri = raptor_new_uri(world, (const unsigned char*)BENCH_BASE_URI);
+  if(!base_uri)
+    return 1;
+
+  fprintf(stdout, "%s: %lu blocks of %lu nested elements\n",
+          program, blocks, depth);
+
+  rc = bench_form(world, base_uri, "nested", 0, depth, blocks);
+  if(!rc)
+    rc = bench_form(world, base_uri, "lists", 1, depth, blocks);
+
+  raptor_free_uri(base_uri);
+  raptor_free_world(world);
+
+  return rc;
+}
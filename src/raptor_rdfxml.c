@@ -1020,7 +1020,14 @@ raptor_rdfxml_parse_start(raptor_parser* rdf_parser)
   
   /* Create a new id_set if needed */
   if(RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser, RAPTOR_OPTION_CHECK_RDF_ID)) {
-    rdf_xml_parser->id_set = raptor_new_id_set(rdf_parser->world);
+    int filter_size;
+
+    filter_size = RAPTOR_OPTIONS_GET_NUMERIC(rdf_parser,
+                                             RAPTOR_OPTION_RDF_ID_FILTER_SIZE);
+    if(filter_size < 0)
+      filter_size = 0;
+    rdf_xml_parser->id_set = raptor_new_id_set(rdf_parser->world,
+                                               (size_t)filter_size * 1024);
     if(!rdf_xml_parser->id_set)
       return 1;
   }
@@ -1228,11 +1235,11 @@ raptor_rdfxml_generate_statement(raptor_parser *rdf_parser,
     rdf_parser->emitted_default_graph++;
   }
 
-  if(!rdf_parser->statement_handler)
+  if(!rdf_parser->statement_handler && !rdf_parser->statement_batch_handler)
     goto generate_tidy;
 
   /* Generate the statement; or is it a fact? */
-  (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+  raptor_parser_emit_statement(rdf_parser, statement);
 
 
   /* the bagID mess */
@@ -1278,7 +1285,7 @@ raptor_rdfxml_generate_statement(raptor_parser *rdf_parser,
     }
     
     statement->object = reified_term;
-    (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+    raptor_parser_emit_statement(rdf_parser, statement);
 
     if(bag_predicate_term)
       raptor_free_term(bag_predicate_term);
@@ -1295,23 +1302,23 @@ raptor_rdfxml_generate_statement(raptor_parser *rdf_parser,
   statement->subject = reified_term;
   statement->predicate = RAPTOR_RDF_type_term(rdf_parser->world);
   statement->object = RAPTOR_RDF_Statement_term(rdf_parser->world);
-  (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+  raptor_parser_emit_statement(rdf_parser, statement);
 
   /* statement->subject = reified_term; */
   statement->predicate = RAPTOR_RDF_subject_term(rdf_parser->world);
   statement->object = subject_term;
-  (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+  raptor_parser_emit_statement(rdf_parser, statement);
 
 
   /* statement->subject = reified_term; */
   statement->predicate = RAPTOR_RDF_predicate_term(rdf_parser->world);
   statement->object = predicate_term;
-  (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+  raptor_parser_emit_statement(rdf_parser, statement);
 
   /* statement->subject = reified_term; */
   statement->predicate = RAPTOR_RDF_object_term(rdf_parser->world);
   statement->object = object_term;
-  (*rdf_parser->statement_handler)(rdf_parser->user_data, statement);
+  raptor_parser_emit_statement(rdf_parser, statement);
 
 
  generate_tidy:
@@ -3222,5 +3229,7 @@ raptor_rdfxml_parser_stats_print(raptor_rdfxml_parser* rdf_xml_parser,
 {
   fputs("rdf:ID set ", stream);
   raptor_id_set_stats_print(rdf_xml_parser->id_set, stream);
+  fputs("  ", stream);
+  raptor_namespaces_stats_print(&rdf_xml_parser->sax2->namespaces, stream);
 }
 #endif
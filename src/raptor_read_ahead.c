@@ -0,0 +1,462 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_read_ahead.c - Raptor read-ahead of parser input
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Reads parser input from a FILE* or an iostream in blocks.  With
+ * read-ahead buffers a thread fills a ring of buffers while the
+ * parser works on the current one, so waiting for slow storage
+ * overlaps parsing.  The thread doubles its read size after a full
+ * read when the parser has had to wait for input since the last
+ * increase, that is while reading rather than parsing is holding
+ * things up.
+ *
+ * Time spent waiting for input and parsing it is recorded in a
+ * raptor_read_stats for raptor_stats_print().
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define RAPTOR_READ_AHEAD_THREAD 1
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+#ifndef STANDALONE
+
+/* most buffers that can be read ahead of the parser */
+#define RAPTOR_READ_AHEAD_MAX_BUFFERS 16
+
+/* largest size the read-ahead thread grows reads to */
+#define RAPTOR_READ_AHEAD_MAX_READ_SIZE (1024 * 1024)
+
+/* buffer status values */
+#define RAPTOR_READ_AHEAD_MORE     0
+#define RAPTOR_READ_AHEAD_LAST     1
+/* nothing was read: the input was already at the end */
+#define RAPTOR_READ_AHEAD_NONE     2
+#define RAPTOR_READ_AHEAD_FAILED  -1
+
+typedef struct {
+  unsigned char* data;
+  size_t capacity;
+  size_t length;
+  int status;
+} raptor_read_ahead_buffer;
+
+
+struct raptor_read_ahead_s {
+  /* input: one of stream or iostr */
+  FILE* stream;
+  raptor_iostream* iostr;
+
+  raptor_read_stats* stats;
+
+  /* size of the next read */
+  size_t read_size;
+
+  /* ring of buffers: the one being parsed and those read ahead */
+  raptor_read_ahead_buffer* buffers;
+  int buffers_count;
+
+  /* buffer returned by the last raptor_read_ahead_next() or -1 */
+  int current;
+
+  /* time the last buffer was returned to the parser */
+  double returned_time;
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+  pthread_t thread;
+  int thread_started;
+  pthread_mutex_t lock;
+  /* signalled when a buffer is filled */
+  pthread_cond_t filled_cond;
+  /* signalled when a buffer is released or the thread must stop */
+  pthread_cond_t free_cond;
+  /* filled buffers, including the current one, starting at head */
+  int head;
+  int filled;
+  int stop;
+  /* set when the thread has read the last buffer */
+  int done;
+  /* set when the parser waited for a buffer to be filled */
+  int starved;
+  /* largest read size and seconds spent waiting for a free buffer */
+  size_t max_read_size;
+  double reader_wait;
+#endif
+};
+
+
+/* Wall clock time in seconds */
+static double
+raptor_read_ahead_time(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+  struct timeval tv;
+
+  if(!gettimeofday(&tv, NULL))
+    return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
+#endif
+  return (double)time(NULL);
+}
+
+
+/*
+ * raptor_read_ahead_fill:
+ * @ra: read-ahead object
+ * @buffer: buffer to read into
+ * @size: bytes to read
+ *
+ * INTERNAL - Read the next block of input into a buffer
+ *
+ * A read shorter than @size is the last one.  The buffer content is
+ * NUL terminated.
+ */
+static void
+raptor_read_ahead_fill(raptor_read_ahead* ra, raptor_read_ahead_buffer* buffer,
+                       size_t size)
+{
+  buffer->length = 0;
+
+  if(ra->stream ? feof(ra->stream) : raptor_iostream_read_eof(ra->iostr)) {
+    buffer->status = RAPTOR_READ_AHEAD_NONE;
+    return;
+  }
+
+  if(buffer->capacity < size) {
+    unsigned char* data;
+
+    data = RAPTOR_REALLOC(unsigned char*, buffer->data, size + 1);
+    if(!data) {
+      buffer->status = RAPTOR_READ_AHEAD_FAILED;
+      return;
+    }
+    buffer->data = data;
+    buffer->capacity = size;
+  }
+
+  if(ra->stream)
+    buffer->length = fread(buffer->data, 1, size, ra->stream);
+  else {
+    int ilen = raptor_iostream_read_bytes(buffer->data, 1, size, ra->iostr);
+    if(ilen < 0) {
+      buffer->status = RAPTOR_READ_AHEAD_FAILED;
+      return;
+    }
+    buffer->length = RAPTOR_GOOD_CAST(size_t, ilen);
+  }
+
+  buffer->data[buffer->length] = '\0';
+  buffer->status = (buffer->length < size) ? RAPTOR_READ_AHEAD_LAST :
+                                             RAPTOR_READ_AHEAD_MORE;
+}
+
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+static void*
+raptor_read_ahead_thread(void* arg)
+{
+  raptor_read_ahead* ra = (raptor_read_ahead*)arg;
+
+  pthread_mutex_lock(&ra->lock);
+  while(!ra->stop) {
+    raptor_read_ahead_buffer* buffer;
+    size_t size;
+
+    if(ra->filled == ra->buffers_count) {
+      double start = raptor_read_ahead_time();
+
+      while(ra->filled == ra->buffers_count && !ra->stop)
+        pthread_cond_wait(&ra->free_cond, &ra->lock);
+      ra->reader_wait += raptor_read_ahead_time() - start;
+    }
+    if(ra->stop)
+      break;
+
+    buffer = &ra->buffers[(ra->head + ra->filled) % ra->buffers_count];
+    size = ra->read_size;
+    pthread_mutex_unlock(&ra->lock);
+
+    /* the parser does not touch buffers that are not filled */
+    raptor_read_ahead_fill(ra, buffer, size);
+    if(size > ra->max_read_size)
+      ra->max_read_size = size;
+
+    pthread_mutex_lock(&ra->lock);
+    /* reading is the bottleneck: fewer, larger reads */
+    if(ra->starved && buffer->status == RAPTOR_READ_AHEAD_MORE &&
+       size < RAPTOR_READ_AHEAD_MAX_READ_SIZE) {
+      ra->read_size = size << 1;
+      ra->starved = 0;
+    }
+    ra->filled++;
+    if(buffer->status != RAPTOR_READ_AHEAD_MORE)
+      ra->done = 1;
+    pthread_cond_signal(&ra->filled_cond);
+    if(ra->done)
+      break;
+  }
+  pthread_mutex_unlock(&ra->lock);
+
+  return NULL;
+}
+
+
+static int
+raptor_read_ahead_start_thread(raptor_read_ahead* ra)
+{
+  if(pthread_mutex_init(&ra->lock, NULL))
+    return 1;
+  if(pthread_cond_init(&ra->filled_cond, NULL)) {
+    pthread_mutex_destroy(&ra->lock);
+    return 1;
+  }
+  if(pthread_cond_init(&ra->free_cond, NULL)) {
+    pthread_cond_destroy(&ra->filled_cond);
+    pthread_mutex_destroy(&ra->lock);
+    return 1;
+  }
+
+  if(pthread_create(&ra->thread, NULL, raptor_read_ahead_thread, ra)) {
+    pthread_cond_destroy(&ra->free_cond);
+    pthread_cond_destroy(&ra->filled_cond);
+    pthread_mutex_destroy(&ra->lock);
+    return 1;
+  }
+
+  ra->thread_started = 1;
+  return 0;
+}
+#endif
+
+
+/*
+ * raptor_new_read_ahead:
+ * @stream: FILE* to read from or NULL
+ * @iostr: iostream to read from if @stream is NULL
+ * @buffers: number of buffers to read ahead; 0 to read on demand
+ * @stats: statistics to reset and update
+ *
+ * INTERNAL - Constructor - create a reader of parser input
+ *
+ * If read-ahead buffers are asked for, a thread reads from @stream
+ * or @iostr until the reader is freed, so neither must be used by
+ * anything else until then.  If raptor was built without threads or
+ * the thread cannot be started, reads are made on demand.
+ *
+ * Return value: new reader or NULL on failure
+ */
+raptor_read_ahead*
+raptor_new_read_ahead(FILE* stream, raptor_iostream* iostr, int buffers,
+                      raptor_read_stats* stats)
+{
+  raptor_read_ahead* ra;
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+  if(buffers > RAPTOR_READ_AHEAD_MAX_BUFFERS)
+    buffers = RAPTOR_READ_AHEAD_MAX_BUFFERS;
+  else if(buffers < 0)
+    buffers = 0;
+#else
+  buffers = 0;
+#endif
+
+  ra = RAPTOR_CALLOC(raptor_read_ahead*, 1, sizeof(*ra));
+  if(!ra)
+    return NULL;
+
+  ra->stream = stream;
+  ra->iostr = iostr;
+  ra->stats = stats;
+  ra->read_size = RAPTOR_READ_BUFFER_SIZE;
+  ra->current = -1;
+
+  /* one more buffer than is read ahead for the parser to work on */
+  ra->buffers_count = buffers + 1;
+  ra->buffers = RAPTOR_CALLOC(raptor_read_ahead_buffer*,
+                              RAPTOR_GOOD_CAST(size_t, ra->buffers_count),
+                              sizeof(raptor_read_ahead_buffer));
+  if(!ra->buffers) {
+    RAPTOR_FREE(raptor_read_ahead, ra);
+    return NULL;
+  }
+
+  memset(stats, '\0', sizeof(*stats));
+  stats->read_size = ra->read_size;
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+  if(buffers && raptor_read_ahead_start_thread(ra))
+    ra->buffers_count = 1;
+  stats->read_ahead = ra->thread_started ? buffers : 0;
+#endif
+
+  ra->returned_time = raptor_read_ahead_time();
+
+  return ra;
+}
+
+
+/*
+ * raptor_read_ahead_next:
+ * @ra: read-ahead object
+ * @buffer_p: pointer to store the content
+ * @length_p: pointer to store the length of the content
+ * @is_end_p: pointer to store whether this is the last content
+ *
+ * INTERNAL - Get the next block of input
+ *
+ * The content is NUL terminated and stays valid until the next call
+ * or the reader is freed.  The time since the previous call is
+ * counted as parsing.
+ *
+ * Return value: 0 if content was returned, >0 if the input was
+ * already at the end or <0 on failure
+ */
+int
+raptor_read_ahead_next(raptor_read_ahead* ra, unsigned char** buffer_p,
+                       size_t* length_p, int* is_end_p)
+{
+  raptor_read_ahead_buffer* buffer;
+  double start;
+
+  start = raptor_read_ahead_time();
+  ra->stats->parse_time += start - ra->returned_time;
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+  if(ra->thread_started) {
+    pthread_mutex_lock(&ra->lock);
+    if(ra->current >= 0) {
+      ra->head = (ra->head + 1) % ra->buffers_count;
+      ra->filled--;
+      pthread_cond_signal(&ra->free_cond);
+    }
+    if(!ra->filled && !ra->done) {
+      ra->starved = 1;
+      while(!ra->filled && !ra->done)
+        pthread_cond_wait(&ra->filled_cond, &ra->lock);
+    }
+    if(!ra->filled) {
+      /* called again after the last buffer */
+      ra->current = -1;
+      pthread_mutex_unlock(&ra->lock);
+      ra->returned_time = raptor_read_ahead_time();
+      return 1;
+    }
+    ra->current = ra->head;
+    pthread_mutex_unlock(&ra->lock);
+
+    /* the thread does not touch filled buffers */
+    buffer = &ra->buffers[ra->current];
+  } else
+#endif
+  {
+    ra->current = 0;
+    buffer = &ra->buffers[0];
+    raptor_read_ahead_fill(ra, buffer, ra->read_size);
+  }
+
+  ra->returned_time = raptor_read_ahead_time();
+  ra->stats->input_wait += ra->returned_time - start;
+
+  if(buffer->status == RAPTOR_READ_AHEAD_FAILED)
+    return -1;
+  if(buffer->status == RAPTOR_READ_AHEAD_NONE)
+    return 1;
+
+  ra->stats->reads++;
+  ra->stats->bytes += buffer->length;
+
+  *buffer_p = buffer->data;
+  *length_p = buffer->length;
+  *is_end_p = (buffer->status == RAPTOR_READ_AHEAD_LAST);
+
+  return 0;
+}
+
+
+/*
+ * raptor_free_read_ahead:
+ * @ra: read-ahead object
+ *
+ * INTERNAL - Destructor - stop reading and destroy a reader
+ */
+void
+raptor_free_read_ahead(raptor_read_ahead* ra)
+{
+  int i;
+
+  ra->stats->parse_time += raptor_read_ahead_time() - ra->returned_time;
+
+#ifdef RAPTOR_READ_AHEAD_THREAD
+  if(ra->thread_started) {
+    pthread_mutex_lock(&ra->lock);
+    ra->stop = 1;
+    pthread_cond_signal(&ra->free_cond);
+    pthread_mutex_unlock(&ra->lock);
+
+    pthread_join(ra->thread, NULL);
+
+    pthread_cond_destroy(&ra->free_cond);
+    pthread_cond_destroy(&ra->filled_cond);
+    pthread_mutex_destroy(&ra->lock);
+
+    if(ra->max_read_size > ra->stats->read_size)
+      ra->stats->read_size = ra->max_read_size;
+    ra->stats->reader_wait = ra->reader_wait;
+  }
+#endif
+
+  for(i = 0; i < ra->buffers_count; i++) {
+    if(ra->buffers[i].data)
+      RAPTOR_FREE(char*, ra->buffers[i].data);
+  }
+  RAPTOR_FREE(raptor_read_ahead_buffer*, ra->buffers);
+
+  RAPTOR_FREE(raptor_read_ahead, ra);
+}
+
+
+#ifdef RAPTOR_DEBUG
+void
+raptor_read_stats_print(raptor_read_stats* stats, FILE *stream)
+{
+  fprintf(stream,
+          "read: %lu blocks %ld bytes read size: %ld read ahead: %d buffers\n",
+          stats->reads, (long)stats->bytes, (long)stats->read_size,
+          stats->read_ahead);
+  fprintf(stream,
+          "  waiting for input: %.3fs parsing: %.3fs reader waiting for a buffer: %.3fs\n",
+          stats->input_wait, stats->parse_time, stats->reader_wait);
+}
+#endif
+
+#endif
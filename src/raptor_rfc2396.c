@@ -42,6 +42,41 @@
 
 #ifndef STANDALONE
 
+/*
+ * raptor_uri_path_directory_len:
+ * @path: hierarchical URI path
+ * @path_len: length of @path
+ *
+ * INTERNAL - get the length of a path up to and including its last '/'
+ *
+ * Return value: length or 0 if a segment before the last '/' is "."
+ * or ".." or empty (other than the root)
+ */
+static size_t
+raptor_uri_path_directory_len(const unsigned char *path, size_t path_len)
+{
+  size_t i;
+  size_t segment = 0;
+  size_t len = 0;
+
+  for(i = 0; i < path_len; i++) {
+    if(path[i] != '/')
+      continue;
+
+    if(i && (i == segment ||
+              (path[segment] == '.' &&
+               (i == segment + 1 ||
+                (i == segment + 2 && path[segment + 1] == '.')))))
+      return 0;
+
+    segment = i + 1;
+    len = i + 1;
+  }
+
+  return len;
+}
+
+
 /**
  * raptor_new_uri_detail:
  * @uri_string: The URI string to split
@@ -52,6 +87,7 @@
 raptor_uri_detail*
 raptor_new_uri_detail(const unsigned char *uri_string)
 {
+  const unsigned char *start = uri_string;
   const unsigned char *s = NULL;
   unsigned char *b = NULL;
   raptor_uri_detail *ud;
@@ -70,6 +106,7 @@ raptor_new_uri_detail(const unsigned char *uri_string)
     return NULL;
   ud->uri_len = uri_len;
   ud->buffer = (unsigned char*)((unsigned char*)ud + sizeof(raptor_uri_detail));
+  ud->fragment_offset = uri_len;
   
   s = uri_string;
   b = ud->buffer;
@@ -125,6 +162,8 @@ raptor_new_uri_detail(const unsigned char *uri_string)
 
   /* path */
   if(*s && *s != '?' && *s != '#') {
+    size_t path_offset = s - start;
+
     ud->path = b;
     
     while(*s && *s != '?' && *s != '#')
@@ -133,6 +172,12 @@ raptor_new_uri_detail(const unsigned char *uri_string)
     ud->path_len = b-ud->path;
     
     *b++ = '\0';
+
+    if(*ud->path == '/') {
+      size_t len = raptor_uri_path_directory_len(ud->path, ud->path_len);
+      if(len)
+        ud->directory_len = path_offset + len;
+    }
   }
 
 
@@ -154,6 +199,7 @@ raptor_new_uri_detail(const unsigned char *uri_string)
   /* fragment identifier - RFC2396 Section 4.1 */
   if(*s && *s == '#') {
     ud->fragment = b;
+    ud->fragment_offset = s - start;
     
     s++;
     
@@ -421,6 +467,112 @@ raptor_uri_normalize_path(unsigned char* path_buffer, size_t path_len)
 
 
 
+/*
+ * raptor_uri_is_dot_segment:
+ * @segment: start of path segment
+ * @end: end of path segment
+ *
+ * INTERNAL - check if a path segment is "." or ".."
+ */
+static int
+raptor_uri_is_dot_segment(const unsigned char *segment,
+                          const unsigned char *end)
+{
+  return *segment == '.' &&
+    (end == segment + 1 || (end == segment + 2 && segment[1] == '.'));
+}
+
+
+/*
+ * raptor_uri_resolve_relative_path:
+ * @base_uri: Base URI string
+ * @base: parsed @base_uri with a directory_len
+ * @reference_uri: Reference URI string
+ * @reference_len: length of @reference_uri
+ * @buffer: Destination URI output buffer
+ * @length: Length of destination output buffer
+ *
+ * INTERNAL - Resolve a relative path reference such as "name" or
+ * "../name" against the directory of a base URI by copying
+ *
+ * After any leading "./" and "../" segments, each "../" removing a
+ * directory of the base URI, the reference must be a path with no
+ * scheme and no "." or ".." segments, which makes normalizing the
+ * result unnecessary.  A ".." at the root is left to the full
+ * resolution.
+ *
+ * Return value: length of resolved string or 0 if the reference is
+ * not of this form or @buffer is too small
+ */
+static size_t
+raptor_uri_resolve_relative_path(const unsigned char *base_uri,
+                                 raptor_uri_detail *base,
+                                 const unsigned char *reference_uri,
+                                 size_t reference_len,
+                                 unsigned char *buffer, size_t length)
+{
+  const unsigned char *r = reference_uri;
+  const unsigned char *end = reference_uri + reference_len;
+  const unsigned char *p;
+  const unsigned char *segment;
+  size_t root_len = 0;
+  size_t dir_len = base->directory_len;
+  size_t result_len;
+  int dotted = 0;
+
+  /* length of the base URI before its path */
+  if(base->scheme)
+    root_len += base->scheme_len + 1;
+  if(base->authority)
+    root_len += 2 + base->authority_len;
+
+  while(r < end && *r == '.') {
+    p = r + ((r + 1 < end && r[1] == '.') ? 2 : 1);
+    if(p < end && *p != '/' && *p != '?' && *p != '#')
+      break;
+
+    if(p == r + 2) {
+      /* ".." removes the last directory */
+      if(dir_len <= root_len + 1)
+        return 0;
+      for(dir_len--; base_uri[dir_len - 1] != '/'; dir_len--)
+        ;
+    }
+
+    r = (p < end && *p == '/') ? p + 1 : p;
+    dotted = 1;
+  }
+
+  /* an absolute path, network path or a query only reference */
+  if(r < end && (*r == '/' || (!dotted && *r == '?')))
+    return 0;
+
+  for(p = segment = r; p < end && *p != '?' && *p != '#'; p++) {
+    /* A ':' in the first segment may be a scheme */
+    if(*p == ':' && !dotted && segment == r)
+      return 0;
+
+    if(*p == '/') {
+      if(raptor_uri_is_dot_segment(segment, p))
+        return 0;
+      segment = p + 1;
+    }
+  }
+  if(segment < p && raptor_uri_is_dot_segment(segment, p))
+    return 0;
+
+  result_len = dir_len + (end - r);
+  if(result_len > length)
+    return 0;
+
+  memcpy(buffer, base_uri, dir_len);
+  memcpy(buffer + dir_len, r, end - r);
+  buffer[result_len] = '\0';
+
+  return result_len;
+}
+
+
 /**
  * raptor_uri_resolve_uri_reference:
  * @base_uri: Base URI string
@@ -436,11 +588,43 @@ size_t
 raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
                                  const unsigned char *reference_uri,
                                  unsigned char *buffer, size_t length)
+{
+  return raptor_uri_resolve_uri_reference_detail(base_uri, NULL,
+                                                 reference_uri, 0,
+                                                 buffer, length);
+}
+
+
+/*
+ * raptor_uri_resolve_uri_reference_detail:
+ * @base_uri: Base URI string
+ * @base_detail: parsed @base_uri or NULL
+ * @reference_uri: Reference URI string
+ * @reference_len: length of @reference_uri or 0 to count it
+ * @buffer: Destination URI output buffer
+ * @length: Length of destination output buffer
+ *
+ * INTERNAL - Resolve a URI against a base URI to create a new absolute URI.
+ *
+ * @base_detail lets a caller that resolves many references against
+ * the same base URI parse it only once.  With it, references "#frag",
+ * "name" and "../name" are resolved without allocating.
+ * 
+ * Return value: length of resolved string or 0 on failure (such as @buffer too small)
+ */
+size_t
+raptor_uri_resolve_uri_reference_detail(const unsigned char *base_uri,
+                                        raptor_uri_detail *base_detail,
+                                        const unsigned char *reference_uri,
+                                        size_t reference_len,
+                                        unsigned char *buffer, size_t length)
 {
   raptor_uri_detail *ref = NULL;
-  raptor_uri_detail *base = NULL;
+  raptor_uri_detail *base = base_detail;
   raptor_uri_detail result; /* static - pointers go to inside ref or base */
   unsigned char *path_buffer = NULL;
+  const unsigned char *base_path;
+  size_t base_path_len;
   unsigned char *p;
   size_t result_len = 0;
   size_t l;
@@ -455,45 +639,43 @@ raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
   *buffer = '\0';
   memset(&result, 0, sizeof(result));
 
-  ref = raptor_new_uri_detail(reference_uri);
-  if(!ref)
+  if(!reference_uri)
     goto resolve_tidy;
-  
 
-  /* is reference URI "" or "#frag"? */
-  if(!ref->scheme && !ref->authority && !ref->path && !ref->query) {
-    unsigned char c;
+  if(!reference_len)
+    reference_len = strlen((const char*)reference_uri);
 
-    /* Copy base URI to result up to '\0' or '#' */
-    for(p = buffer, l = length;
-        (c = *base_uri) && c != '#' && l;
-        p++, base_uri++, l--)
-      *p = c;
+  /* is reference URI "" or "#frag"? */
+  if(!*reference_uri || *reference_uri == '#') {
+    /* Copy base URI to result up to '\0' or '#' and append the reference */
+    if(base)
+      l = base->fragment_offset;
+    else {
+      for(l = 0; base_uri[l] && base_uri[l] != '#'; l++)
+        ;
+    }
 
-    if(!l) {
-      result_len = 0;
+    if(l + reference_len > length)
       goto resolve_tidy;
-    }
-    *p = '\0';
-    
-    if(ref->fragment) {
-      unsigned char *src = ref->fragment;
-      /* Append any fragment */
-      *p++ = '#';
-      while(*src && l) {
-        *p++ = *src++;
-        l--;
-      }
-      if(!l) {
-        result_len = 0;
-        goto resolve_tidy;
-      }
-      *p = '\0';
-    }
 
-    result_len = p - buffer;
+    memcpy(buffer, base_uri, l);
+    memcpy(buffer + l, reference_uri, reference_len);
+    result_len = l + reference_len;
+    buffer[result_len] = '\0';
     goto resolve_tidy;
   }
+
+  if(base && base->directory_len) {
+    result_len = raptor_uri_resolve_relative_path(base_uri, base,
+                                                  reference_uri, reference_len,
+                                                  buffer, length);
+    if(result_len)
+      goto resolve_tidy;
+  }
+
+  ref = raptor_new_uri_detail(reference_uri);
+  if(!ref)
+    goto resolve_tidy;
   
   /* reference has a scheme - is an absolute URI */
   if(ref->scheme) {
@@ -520,9 +702,11 @@ raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
   
 
   /* now the reference URI must be schemeless, i.e. relative */
-  base = raptor_new_uri_detail(base_uri);
-  if(!base)
-    goto resolve_tidy;
+  if(!base) {
+    base = raptor_new_uri_detail(base_uri);
+    if(!base)
+      goto resolve_tidy;
+  }
 
   /* result URI must be of the base URI scheme */
   result.scheme = base->scheme;
@@ -568,15 +752,15 @@ raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
   /* Build the result path in path_buffer */
   result.path_len = 0;
 
-  if(base->path)
-    result.path_len += base->path_len;
-  else {
+  if(base->path) {
+    base_path = base->path;
+    base_path_len = base->path_len;
+  } else {
     /* Add a missing path - makes the base URI 1 character longer */
-    base->path = (unsigned char*)"/"; /* static, but copied and not free()d  */
-    base->path_len = 1;
-    base->uri_len++;
-    result.path_len++;
+    base_path = (const unsigned char*)"/";
+    base_path_len = 1;
   }
+  result.path_len += base_path_len;
 
   if(ref->path)
     result.path_len += ref->path_len;
@@ -592,18 +776,20 @@ raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
 
   if(!ref->path) {
     /* If there is no reference path, copy the full base over */
-    result.path_len = base->path_len;
-    memcpy(path_buffer, base->path, result.path_len);
+    result.path_len = base_path_len;
+    memcpy(path_buffer, base_path, result.path_len);
   } else {
     /** Otherwise copy base path up to previous / and append ref path */
-    for(p = base->path + base->path_len - 1; p > base->path && *p != '/'; p--)
+    const unsigned char *bp;
+
+    for(bp = base_path + base_path_len - 1; bp > base_path && *bp != '/'; bp--)
       ;
 
-    if(p >= base->path) {
-      result.path_len = p-base->path + 1;
+    if(bp >= base_path) {
+      result.path_len = bp - base_path + 1;
 
       /* Found a /, copy everything before that to path_buffer */
-      memcpy(path_buffer, base->path, result.path_len);
+      memcpy(path_buffer, base_path, result.path_len);
       path_buffer[result.path_len] = '\0';
     }
 
@@ -683,7 +869,7 @@ raptor_uri_resolve_uri_reference(const unsigned char *base_uri,
   resolve_tidy:
   if(path_buffer)
     RAPTOR_FREE(char*, path_buffer);
-  if(base)
+  if(base && base != base_detail)
     raptor_free_uri_detail(base);
   if(ref)
     raptor_free_uri_detail(ref);
@@ -715,10 +901,11 @@ check_resolve(const char *base_uri, const char *reference_uri,
               const char *result_uri)
 {
   unsigned char buffer[1024];
+  raptor_uri_detail* base_detail;
 
   raptor_uri_resolve_uri_reference((const unsigned char*)base_uri,
                                    (const unsigned char*)reference_uri,
-                                   buffer, sizeof(buffer));
+                                   buffer, sizeof(buffer) - 1);
 
   if(strcmp((const char*)buffer, result_uri)) {
       fprintf(stderr,
@@ -727,6 +914,22 @@ check_resolve(const char *base_uri, const char *reference_uri,
               buffer, result_uri);
       return 1;
   }
+
+  /* again with the base URI parsed once as raptor_uri does */
+  base_detail = raptor_new_uri_detail((const unsigned char*)base_uri);
+  raptor_uri_resolve_uri_reference_detail((const unsigned char*)base_uri,
+                                          base_detail,
+                                          (const unsigned char*)reference_uri,
+                                          0, buffer, sizeof(buffer) - 1);
+  raptor_free_uri_detail(base_detail);
+
+  if(strcmp((const char*)buffer, result_uri)) {
+      fprintf(stderr,
+              "%s: raptor_uri_resolve_uri_reference_detail(%s, %s) FAILED giving '%s' != '%s'\n",
+              program, base_uri, reference_uri, 
+              buffer, result_uri);
+      return 1;
+  }
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 2
   fprintf(stderr,
           "%s: raptor_uri_resolve_uri_reference(%s, %s) OK giving '%s'\n",
@@ -859,6 +1062,13 @@ main(int argc, char *argv[])
   /* RDF xml:base check that an absolute URI replaces */
   failures += check_resolve("http://example.org/dir/file", "http://another.example.org/dir2/file2", "http://another.example.org/dir2/file2");
 
+  /* relative paths resolved against a parsed base URI by copying */
+  failures += check_resolve("http://example.org/a/b/c/doc", "../../x/y#f", "http://example.org/a/x/y#f");
+  failures += check_resolve("http://example.org/a/", "..", "http://example.org/");
+  failures += check_resolve("http://example.org/", "../x", "http://example.org/x");
+  failures += check_resolve("http://example.org/a//b/doc", "../x", "http://example.org/a//x");
+  failures += check_resolve("http://example.org/a/./b/doc", "x", "http://example.org/a/b/x");
+
   /* base URI and relative URI with no absolute path works */
   failures += check_resolve("foo:", "not_scheme:blah", "foo:not_scheme:blah");
 
@@ -295,14 +295,11 @@ const unsigned char * const raptor_atom_namespace_uri = (const unsigned char *)"
 
 
 
-int
-raptor_rss_common_init(raptor_world* world) {
+static int
+raptor_rss_common_init_uris(raptor_world* world) {
   int i;
   raptor_uri *namespace_uri;
 
-  if(world->rss_common_initialised++)
-    return 0;
-
   world->rss_namespaces_info_uris = RAPTOR_CALLOC(raptor_uri**, 
                                                   RAPTOR_RSS_NAMESPACES_SIZE,
                                                   sizeof(raptor_uri*));
@@ -351,11 +348,27 @@ raptor_rss_common_init(raptor_world* world) {
 }
 
 
+int
+raptor_rss_common_init(raptor_world* world) {
+  int rc = 0;
+
+  /* parsers and serializers in other threads may share the URIs */
+  RAPTOR_WORLD_LOCK(world);
+  if(!world->rss_common_initialised++)
+    rc = raptor_rss_common_init_uris(world);
+  RAPTOR_WORLD_UNLOCK(world);
+
+  return rc;
+}
+
+
 void
 raptor_rss_common_terminate(raptor_world* world) {
   int i;
+
+  RAPTOR_WORLD_LOCK(world);
   if(--world->rss_common_initialised)
-    return;
+    goto unlock;
 
   if(world->rss_types_info_uris) {
     for(i = 0; i< RAPTOR_RSS_COMMON_SIZE; i++) {
@@ -383,6 +396,9 @@ raptor_rss_common_terminate(raptor_world* world) {
     RAPTOR_FREE(raptor_uri* array, world->rss_namespaces_info_uris);
     world->rss_namespaces_info_uris = NULL;
   }
+
+  unlock:
+  RAPTOR_WORLD_UNLOCK(world);
 }
 
 
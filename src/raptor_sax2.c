@@ -845,6 +845,293 @@ raptor_sax2_start_element(void* user_data, const unsigned char *name,
 }
 
 
+#ifdef RAPTOR_XML_LIBXML
+
+#define RAPTOR_SAX2_IS_SPACE(c) \
+  ((c) == 0x20 || (c) == 0x0d || (c) == 0x0a || (c) == 0x09)
+
+/*
+ * raptor_sax2_new_attribute_value - INTERNAL
+ * @src: start of attribute value
+ * @end: end of attribute value
+ * @length_p: pointer to store length of new value
+ *
+ * Copy a counted libxml2 attribute value with the same whitespace
+ * normalization raptor_sax2_start_element() does.
+ *
+ * Return value: new NUL terminated value or NULL on failure
+ */
+static unsigned char*
+raptor_sax2_new_attribute_value(const unsigned char *src,
+                                const unsigned char *end,
+                                size_t *length_p)
+{
+  unsigned char *value;
+  unsigned char *dst;
+
+  value = RAPTOR_MALLOC(unsigned char*, RAPTOR_GOOD_CAST(size_t, end - src) + 1);
+  if(!value)
+    return NULL;
+
+  dst = value;
+  while(src < end && RAPTOR_SAX2_IS_SPACE(*src))
+    src++;
+  while(src < end) {
+    if(RAPTOR_SAX2_IS_SPACE(*src)) {
+      while(src < end && RAPTOR_SAX2_IS_SPACE(*src))
+        src++;
+      if(src < end)
+        *dst++ = 0x20;
+    } else
+      *dst++ = *src++;
+  }
+  *dst = '\0';
+
+  *length_p = RAPTOR_GOOD_CAST(size_t, dst - value);
+  return value;
+}
+
+
+/*
+ * raptor_sax2_new_qname_ns - INTERNAL
+ * @sax2: SAX2 object
+ * @localname: local name
+ * @prefix: namespace prefix or NULL
+ * @value: attribute value owned by the new qname or NULL for an element
+ * @value_length: length of @value
+ *
+ * Create a qname from a name libxml2 has already split, finding the
+ * namespace the same way as raptor_new_qname().
+ *
+ * Return value: new qname or NULL on failure
+ */
+static raptor_qname*
+raptor_sax2_new_qname_ns(raptor_sax2* sax2, const unsigned char *localname,
+                         const unsigned char *prefix,
+                         unsigned char *value, size_t value_length)
+{
+  const raptor_namespace* ns = NULL;
+
+  if(prefix) {
+    ns = raptor_namespaces_find_namespace(&sax2->namespaces, prefix,
+                                          RAPTOR_BAD_CAST(int, strlen((const char*)prefix)));
+    if(!ns)
+      raptor_log_error_formatted(sax2->world, RAPTOR_LOG_LEVEL_ERROR, NULL,
+                                 "The namespace prefix in \"%s:%s\" was not declared.",
+                                 prefix, localname);
+  } else if(!value)
+    /* For elements only, pick up the default namespace */
+    ns = raptor_namespaces_get_default_namespace(&sax2->namespaces);
+
+  return raptor_new_qname_from_namespace_counted_local_name(&sax2->namespaces,
+                                                            ns, localname,
+                                                            strlen((const char*)localname),
+                                                            value,
+                                                            value_length);
+}
+
+
+/*
+ * raptor_sax2_start_element_ns:
+ *
+ * Start of an element from the libxml2 SAX2 startElementNs callback.
+ *
+ * libxml2 has already split the element and attribute names and
+ * separated out the namespace declarations so this avoids the copying
+ * and name parsing raptor_sax2_start_element() does.  Attributes are
+ * given as 5 pointers each: localname, prefix, URI, value start and
+ * value end.
+ */
+void
+raptor_sax2_start_element_ns(void* user_data, const unsigned char *localname,
+                             const unsigned char *prefix,
+                             const unsigned char *URI,
+                             int nb_namespaces,
+                             const unsigned char **namespaces,
+                             int nb_attributes, int nb_defaulted,
+                             const unsigned char **attributes)
+{
+  raptor_sax2* sax2 = (raptor_sax2*)user_data;
+  raptor_qname* el_name;
+  int ns_attributes_count = 0;
+  raptor_qname** named_attrs = NULL;
+  raptor_xml_element* xml_element = NULL;
+  unsigned char *xml_language = NULL;
+  raptor_uri *xml_base = NULL;
+  int i;
+
+  if(sax2->failed || !sax2->enabled)
+    return;
+
+  raptor_sax2_inc_depth(sax2);
+
+  /* XML namespace declarations (Namespaces in XML REC) */
+  for(i = 0; i < nb_namespaces; i++) {
+    raptor_namespace* nspace;
+
+    nspace = raptor_new_namespace(&sax2->namespaces,
+                                  namespaces[i << 1],
+                                  namespaces[(i << 1) + 1],
+                                  raptor_sax2_get_depth(sax2));
+    if(nspace) {
+      raptor_namespaces_start_namespace(&sax2->namespaces, nspace);
+
+      if(sax2->namespace_handler)
+        (*sax2->namespace_handler)(sax2->user_data, nspace);
+    }
+  }
+
+  /* Attributes defaulted from the DTD are not passed on, as with
+   * raptor_sax2_start_element() */
+  nb_attributes -= nb_defaulted;
+
+  /* XML attributes processing:
+   *   xml:lang - XML language (XML REC)
+   *     Optionally normalised to lowercase
+   *   xml:base - XML Base (XML Base REC)
+   *     Used to set the in-scope base URI for this XML element
+   * All attributes with names starting xml are then ignored.
+   */
+  for(i = 0; i < nb_attributes; i++) {
+    const unsigned char **attr = &attributes[i * 5];
+    const unsigned char *name = attr[1] ? attr[1] : attr[0];
+    unsigned char *value;
+    size_t value_length;
+
+    if(strncmp((const char*)name, "xml", 3)) {
+      /* count non xml* attributes */
+      ns_attributes_count++;
+      continue;
+    }
+
+    if(!attr[1] || strcmp((const char*)attr[1], "xml") ||
+       (strcmp((const char*)attr[0], "lang") &&
+        strcmp((const char*)attr[0], "base")))
+      continue;
+
+    value = raptor_sax2_new_attribute_value(attr[3], attr[4], &value_length);
+    if(!value) {
+      raptor_log_error(sax2->world, RAPTOR_LOG_LEVEL_FATAL,
+                       sax2->locator, "Out of memory");
+      goto fail;
+    }
+
+    if(*attr[0] == 'l') {
+      /* optionally normalize language to lowercase */
+      if(RAPTOR_OPTIONS_GET_NUMERIC(sax2, RAPTOR_OPTION_NORMALIZE_LANGUAGE)) {
+        unsigned char *p;
+
+        for(p = value; *p; p++) {
+          if(isupper(*p))
+            *p = RAPTOR_GOOD_CAST(unsigned char, tolower(*p));
+        }
+      }
+      if(xml_language)
+        RAPTOR_FREE(char*, xml_language);
+      xml_language = value;
+    } else {
+      raptor_uri* base_uri;
+      raptor_uri* xuri;
+
+      base_uri = raptor_sax2_inscope_base_uri(sax2);
+      xuri = raptor_new_uri_relative_to_base(sax2->world, base_uri, value);
+      if(xml_base)
+        raptor_free_uri(xml_base);
+      xml_base = raptor_new_uri_for_xmlbase(xuri);
+      raptor_free_uri(xuri);
+      RAPTOR_FREE(char*, value);
+    }
+  }
+
+
+  /* Create new element structure */
+  el_name = raptor_sax2_new_qname_ns(sax2, localname, prefix, NULL, 0);
+  if(!el_name)
+    goto fail;
+
+  xml_element = raptor_new_xml_element(el_name, xml_language, xml_base);
+  if(!xml_element) {
+    raptor_free_qname(el_name);
+    goto fail;
+  }
+  /* xml_language,xml_base now owned by xml_element */
+  xml_language = NULL;
+  xml_base = NULL;
+
+  /* Turn the other attributes into namespaced-attributes */
+  if(ns_attributes_count) {
+    int offset = 0;
+
+    named_attrs = RAPTOR_CALLOC(raptor_qname**, ns_attributes_count,
+                                sizeof(raptor_qname*));
+    if(!named_attrs) {
+      raptor_log_error(sax2->world, RAPTOR_LOG_LEVEL_FATAL,
+                       sax2->locator, "Out of memory");
+      goto fail;
+    }
+
+    for(i = 0; i < nb_attributes; i++) {
+      const unsigned char **attr = &attributes[i * 5];
+      const unsigned char *name = attr[1] ? attr[1] : attr[0];
+      unsigned char *value;
+      size_t value_length;
+      raptor_qname* qname = NULL;
+
+      if(!strncmp((const char*)name, "xml", 3))
+        continue;
+
+      value = raptor_sax2_new_attribute_value(attr[3], attr[4], &value_length);
+      if(value)
+        qname = raptor_sax2_new_qname_ns(sax2, attr[0], attr[1],
+                                         value, value_length);
+      if(!qname) { /* failed - tidy up and return */
+        while(offset)
+          raptor_free_qname(named_attrs[--offset]);
+        RAPTOR_FREE(raptor_qname_array, named_attrs);
+        goto fail;
+      }
+
+      named_attrs[offset++] = qname;
+    }
+
+    raptor_xml_element_set_attributes(xml_element,
+                                      named_attrs, ns_attributes_count);
+  }
+
+  raptor_xml_element_push(sax2, xml_element);
+
+  if(sax2->start_element_handler)
+    sax2->start_element_handler(sax2->user_data, xml_element);
+
+  return;
+
+  fail:
+  if(xml_base)
+    raptor_free_uri(xml_base);
+  if(xml_language)
+    RAPTOR_FREE(char*, xml_language);
+  if(xml_element)
+    raptor_free_xml_element(xml_element);
+}
+
+
+/*
+ * raptor_sax2_end_element_ns:
+ *
+ * End of an element from the libxml2 SAX2 endElementNs callback.
+ */
+void
+raptor_sax2_end_element_ns(void* user_data, const unsigned char *localname,
+                           const unsigned char *prefix,
+                           const unsigned char *URI)
+{
+  raptor_sax2_end_element(user_data, localname);
+}
+
+/* end if RAPTOR_XML_LIBXML */
+#endif
+
+
 /* end of an element */
 void
 raptor_sax2_end_element(void* user_data, const unsigned char *name)
@@ -115,6 +115,10 @@ raptor_serializers_init(raptor_world* world)
   rc += raptor_init_serializer_nquads(world) != 0;
 #endif
 
+#ifdef RAPTOR_SERIALIZER_BINARY
+  rc += raptor_init_serializer_binary(world) != 0;
+#endif
+
   return rc;
 }
 
@@ -584,6 +588,49 @@ raptor_serializer_serialize_statement(raptor_serializer* rdf_serializer,
 }
 
 
+/**
+ * raptor_serializer_serialize_statements:
+ * @rdf_serializer: the #raptor_serializer
+ * @statements: array of #raptor_statement to serialize to a syntax
+ * @count: number of statements in @statements
+ *
+ * Serialize several statements in order.
+ *
+ * The output is the same as calling
+ * raptor_serializer_serialize_statement() on each statement in turn
+ * but serializers may use the whole batch at once, such as formatting
+ * it on several threads with #RAPTOR_OPTION_WRITE_THREADS.  The
+ * statements must not change during the call.
+ *
+ * Return value: non-0 on failure.
+ **/
+int
+raptor_serializer_serialize_statements(raptor_serializer* rdf_serializer,
+                                       raptor_statement **statements,
+                                       int count)
+{
+  int i;
+
+  if(!rdf_serializer->iostream)
+    return 1;
+
+  if(count <= 0)
+    return 0;
+
+  if(rdf_serializer->factory->serialize_statements)
+    return rdf_serializer->factory->serialize_statements(rdf_serializer,
+                                                         statements, count);
+
+  for(i = 0; i < count; i++) {
+    if(rdf_serializer->factory->serialize_statement(rdf_serializer,
+                                                    statements[i]))
+      return 1;
+  }
+
+  return 0;
+}
+
+
 /**
  * raptor_serializer_serialize_end:
  * @rdf_serializer:  the #raptor_serializer
@@ -608,6 +655,8 @@ raptor_serializer_serialize_end(raptor_serializer *rdf_serializer)
   if(rdf_serializer->iostream) {
     if(rdf_serializer->free_iostream_on_end)
       raptor_free_iostream(rdf_serializer->iostream);
+    else if(raptor_iostream_write_flush(rdf_serializer->iostream))
+      rc = 1;
     rdf_serializer->iostream = NULL;
   }
   return rc;
@@ -787,5 +836,10 @@ raptor_serializer_flush(raptor_serializer *rdf_serializer)
   else
     rc = 0;
 
+  /* pass on any output buffered in the iostream */
+  if(rdf_serializer->iostream &&
+     raptor_iostream_write_flush(rdf_serializer->iostream))
+    rc = 1;
+
   return rc;
 }
@@ -0,0 +1,723 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_serialize_binary.c - Raptor binary RDF serializer
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Writes the binary RDF syntax read by raptor_binary.c.  The record
+ * layout is described in raptor_internal.h.  Each IRI, IRI prefix,
+ * blank node and language tag is written once per stream and then
+ * referred to by number.
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+/* dictionary entries kept before writing a reset record */
+#define RAPTOR_BINARY_DICT_MAX_ENTRIES (1UL << 20)
+
+/* shortest IRI prefix worth a dictionary entry */
+#define RAPTOR_BINARY_MIN_PREFIX_LEN 8
+
+
+typedef struct {
+  /* key bytes: the URI string if uri is set, otherwise owned */
+  const unsigned char *key;
+  size_t length;
+  unsigned int hash;
+  unsigned long id;
+  raptor_uri *uri;
+} raptor_binary_dict_entry;
+
+/* open addressing hash of strings to dictionary IDs */
+typedef struct {
+  /* entries with NULL key are empty */
+  raptor_binary_dict_entry* entries;
+  /* power of 2 */
+  unsigned long size;
+  unsigned long count;
+  /* ID of the first entry */
+  unsigned long base;
+} raptor_binary_dict;
+
+
+typedef struct raptor_binary_namespace_s raptor_binary_namespace;
+
+/* namespace declared before the serializing started */
+struct raptor_binary_namespace_s {
+  raptor_binary_namespace* next;
+  unsigned char *prefix;
+  raptor_uri *uri;
+};
+
+
+/*
+ * Raptor binary RDF serializer object
+ */
+typedef struct {
+  raptor_binary_dict iris;
+  raptor_binary_dict prefixes;
+  raptor_binary_dict blanks;
+  raptor_binary_dict languages;
+
+  /* non-0 once the stream header has been written */
+  int started;
+
+  /* pending namespace declarations, in order */
+  raptor_binary_namespace* namespaces;
+  raptor_binary_namespace* namespaces_tail;
+} raptor_binary_serializer_context;
+
+
+static unsigned int
+raptor_binary_string_hash(const unsigned char *string, size_t length)
+{
+  unsigned int hash = 2166136261U;
+  size_t i;
+
+  for(i = 0; i < length; i++) {
+    hash ^= string[i];
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+static void
+raptor_binary_dict_clear(raptor_binary_dict* dict)
+{
+  unsigned long i;
+
+  if(!dict->count)
+    return;
+
+  for(i = 0; i < dict->size; i++) {
+    raptor_binary_dict_entry* entry = &dict->entries[i];
+
+    if(!entry->key)
+      continue;
+
+    if(entry->uri)
+      raptor_free_uri(entry->uri);
+    else
+      RAPTOR_FREE(char*, entry->key);
+    entry->key = NULL;
+  }
+  dict->count = 0;
+}
+
+
+static void
+raptor_binary_dict_free(raptor_binary_dict* dict)
+{
+  raptor_binary_dict_clear(dict);
+  if(dict->entries)
+    RAPTOR_FREE(raptor_binary_dict_entry*, dict->entries);
+  dict->entries = NULL;
+  dict->size = 0;
+}
+
+
+/*
+ * raptor_binary_dict_find:
+ * @dict: dictionary
+ * @key: key bytes
+ * @length: key length
+ * @hash: key hash
+ *
+ * INTERNAL - Find a key or the empty entry where it would be added
+ *
+ * Return value: entry or NULL if the dictionary has no entries allocated
+ */
+static raptor_binary_dict_entry*
+raptor_binary_dict_find(raptor_binary_dict* dict, const unsigned char *key,
+                        size_t length, unsigned int hash)
+{
+  unsigned long mask = dict->size - 1;
+  unsigned long i;
+
+  if(!dict->size)
+    return NULL;
+
+  for(i = hash & mask; ; i = (i + 1) & mask) {
+    raptor_binary_dict_entry* entry = &dict->entries[i];
+
+    if(!entry->key ||
+       (entry->hash == hash && entry->length == length &&
+        (entry->key == key || !memcmp(entry->key, key, length))))
+      return entry;
+  }
+}
+
+
+static int
+raptor_binary_dict_grow(raptor_binary_dict* dict)
+{
+  raptor_binary_dict_entry* old_entries = dict->entries;
+  unsigned long old_size = dict->size;
+  unsigned long size = old_size ? old_size << 1 : 256;
+  unsigned long i;
+
+  dict->entries = RAPTOR_CALLOC(raptor_binary_dict_entry*, size,
+                                sizeof(raptor_binary_dict_entry));
+  if(!dict->entries) {
+    dict->entries = old_entries;
+    return 1;
+  }
+  dict->size = size;
+
+  for(i = 0; i < old_size; i++) {
+    raptor_binary_dict_entry* entry = &old_entries[i];
+
+    if(entry->key)
+      *raptor_binary_dict_find(dict, entry->key, entry->length,
+                               entry->hash) = *entry;
+  }
+
+  if(old_entries)
+    RAPTOR_FREE(raptor_binary_dict_entry*, old_entries);
+
+  return 0;
+}
+
+
+/*
+ * raptor_binary_dict_add:
+ * @dict: dictionary
+ * @entry: entry from raptor_binary_dict_find() or NULL
+ * @key: key bytes
+ * @length: key length
+ * @hash: key hash
+ * @uri: URI owning @key or NULL to copy @key
+ *
+ * INTERNAL - Add a key that is not in the dictionary with the next ID
+ *
+ * Return value: new ID or -1 on failure
+ */
+static long
+raptor_binary_dict_add(raptor_binary_dict* dict,
+                       raptor_binary_dict_entry* entry,
+                       const unsigned char *key, size_t length,
+                       unsigned int hash, raptor_uri* uri)
+{
+  /* keep the load below 3/4 */
+  if(!entry || (dict->count + 1) * 4 > dict->size * 3) {
+    if(raptor_binary_dict_grow(dict))
+      return -1;
+    entry = raptor_binary_dict_find(dict, key, length, hash);
+  }
+
+  if(uri)
+    entry->uri = raptor_uri_copy(uri);
+  else {
+    unsigned char *copy = RAPTOR_MALLOC(unsigned char*, length + 1);
+
+    if(!copy)
+      return -1;
+    memcpy(copy, key, length);
+    copy[length] = '\0';
+    key = copy;
+    entry->uri = NULL;
+  }
+
+  entry->key = key;
+  entry->length = length;
+  entry->hash = hash;
+  entry->id = dict->base + dict->count++;
+
+  return (long)entry->id;
+}
+
+
+static void
+raptor_binary_write_varint(unsigned long value, raptor_iostream* iostr)
+{
+  unsigned char buffer[RAPTOR_BINARY_VARINT_MAX_LEN];
+  size_t len = 0;
+
+  do {
+    unsigned char byte = (unsigned char)(value & 0x7f);
+
+    value >>= 7;
+    if(value)
+      byte |= 0x80;
+    buffer[len++] = byte;
+  } while(value);
+
+  raptor_iostream_write_bytes(buffer, 1, len, iostr);
+}
+
+
+static void
+raptor_binary_write_string(const unsigned char *string, size_t length,
+                           raptor_iostream* iostr)
+{
+  raptor_binary_write_varint(RAPTOR_GOOD_CAST(unsigned long, length), iostr);
+  if(length)
+    raptor_iostream_write_bytes(string, 1, length, iostr);
+}
+
+
+/*
+ * raptor_binary_serialize_string_id:
+ * @serializer: serializer
+ * @dict: dictionary
+ * @tag: record type that defines an entry
+ * @string: string
+ * @length: length of @string
+ *
+ * INTERNAL - Get the dictionary ID of a string, defining it if new
+ *
+ * Return value: ID or -1 on failure
+ */
+static long
+raptor_binary_serialize_string_id(raptor_serializer* serializer,
+                                  raptor_binary_dict* dict, int tag,
+                                  const unsigned char *string, size_t length)
+{
+  unsigned int hash = raptor_binary_string_hash(string, length);
+  raptor_binary_dict_entry* entry;
+  long id;
+
+  entry = raptor_binary_dict_find(dict, string, length, hash);
+  if(entry && entry->key)
+    return (long)entry->id;
+
+  id = raptor_binary_dict_add(dict, entry, string, length, hash, NULL);
+  if(id < 0)
+    return -1;
+
+  raptor_iostream_write_byte(tag, serializer->iostream);
+  raptor_binary_write_string(string, length, serializer->iostream);
+
+  return id;
+}
+
+
+/*
+ * raptor_binary_serialize_iri_id:
+ * @serializer: serializer
+ * @uri: IRI
+ *
+ * INTERNAL - Get the dictionary ID of an IRI, defining it if new
+ *
+ * Return value: ID or -1 on failure
+ */
+static long
+raptor_binary_serialize_iri_id(raptor_serializer* serializer, raptor_uri* uri)
+{
+  raptor_binary_serializer_context* context;
+  const unsigned char *string;
+  size_t length;
+  unsigned int hash;
+  raptor_binary_dict_entry* entry;
+  size_t prefix_len;
+  long prefix_id = 0;
+  long id;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  string = raptor_uri_as_counted_string(uri, &length);
+  hash = raptor_uri_get_hash(uri);
+
+  entry = raptor_binary_dict_find(&context->iris, string, length, hash);
+  if(entry && entry->key)
+    return (long)entry->id;
+
+  /* share the IRI up to the last / or # with other IRIs */
+  for(prefix_len = length; prefix_len > 0; prefix_len--) {
+    if(string[prefix_len - 1] == '/' || string[prefix_len - 1] == '#')
+      break;
+  }
+  if(prefix_len >= RAPTOR_BINARY_MIN_PREFIX_LEN) {
+    prefix_id = raptor_binary_serialize_string_id(serializer,
+                                                  &context->prefixes, 'p',
+                                                  string, prefix_len);
+    if(prefix_id < 0)
+      return -1;
+  } else
+    prefix_len = 0;
+
+  /* defining a prefix may have moved the entry */
+  entry = raptor_binary_dict_find(&context->iris, string, length, hash);
+  id = raptor_binary_dict_add(&context->iris, entry, string, length, hash,
+                              uri);
+  if(id < 0)
+    return -1;
+
+  raptor_iostream_write_byte('i', serializer->iostream);
+  raptor_binary_write_varint(RAPTOR_GOOD_CAST(unsigned long, prefix_id),
+                             serializer->iostream);
+  raptor_binary_write_string(string + prefix_len, length - prefix_len,
+                             serializer->iostream);
+
+  return id;
+}
+
+
+/*
+ * raptor_binary_serialize_term_ids:
+ * @serializer: serializer
+ * @term: term
+ * @id_p: pointer to store the IRI or blank node ID or the literal
+ *   language or datatype ID
+ *
+ * INTERNAL - Define the dictionary entries a term uses
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_binary_serialize_term_ids(raptor_serializer* serializer,
+                                 raptor_term* term, long* id_p)
+{
+  raptor_binary_serializer_context* context;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  *id_p = 0;
+
+  switch(term->type) {
+    case RAPTOR_TERM_TYPE_URI:
+      *id_p = raptor_binary_serialize_iri_id(serializer, term->value.uri);
+      break;
+
+    case RAPTOR_TERM_TYPE_BLANK:
+      *id_p = raptor_binary_serialize_string_id(serializer, &context->blanks,
+                                                'b',
+                                                term->value.blank.string,
+                                                term->value.blank.string_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_LITERAL:
+      if(term->value.literal.datatype)
+        *id_p = raptor_binary_serialize_iri_id(serializer,
+                                               term->value.literal.datatype);
+      else if(term->value.literal.language)
+        *id_p = raptor_binary_serialize_string_id(serializer,
+                                                  &context->languages, 'l',
+                                                  term->value.literal.language,
+                                                  term->value.literal.language_len);
+      break;
+
+    case RAPTOR_TERM_TYPE_UNKNOWN:
+    default:
+      raptor_log_error_formatted(serializer->world, RAPTOR_LOG_LEVEL_ERROR,
+                                 NULL, "Triple has unsupported term type %u",
+                                 term->type);
+      return 1;
+  }
+
+  return (*id_p < 0);
+}
+
+
+static void
+raptor_binary_serialize_write_term(raptor_serializer* serializer,
+                                   raptor_term* term, long id)
+{
+  raptor_iostream* iostr = serializer->iostream;
+  unsigned long value = RAPTOR_GOOD_CAST(unsigned long, id);
+
+  if(term->type == RAPTOR_TERM_TYPE_URI) {
+    raptor_binary_write_varint((value << RAPTOR_BINARY_TERM_KIND_BITS) |
+                               RAPTOR_BINARY_TERM_IRI, iostr);
+    return;
+  }
+
+  if(term->type == RAPTOR_TERM_TYPE_BLANK) {
+    raptor_binary_write_varint((value << RAPTOR_BINARY_TERM_KIND_BITS) |
+                               RAPTOR_BINARY_TERM_BLANK, iostr);
+    return;
+  }
+
+  if(term->value.literal.datatype) {
+    raptor_binary_write_varint((RAPTOR_BINARY_LITERAL_DATATYPE << RAPTOR_BINARY_TERM_KIND_BITS) |
+                               RAPTOR_BINARY_TERM_LITERAL, iostr);
+    raptor_binary_write_varint(value, iostr);
+  } else if(term->value.literal.language) {
+    raptor_binary_write_varint((RAPTOR_BINARY_LITERAL_LANGUAGE << RAPTOR_BINARY_TERM_KIND_BITS) |
+                               RAPTOR_BINARY_TERM_LITERAL, iostr);
+    raptor_binary_write_varint(value, iostr);
+  } else
+    raptor_binary_write_varint((RAPTOR_BINARY_LITERAL_PLAIN << RAPTOR_BINARY_TERM_KIND_BITS) |
+                               RAPTOR_BINARY_TERM_LITERAL, iostr);
+
+  raptor_binary_write_string(term->value.literal.string,
+                             term->value.literal.string_len, iostr);
+}
+
+
+/* forget all dictionary entries */
+static void
+raptor_binary_serialize_clear_dictionaries(raptor_serializer* serializer)
+{
+  raptor_binary_serializer_context* context;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  raptor_binary_dict_clear(&context->iris);
+  raptor_binary_dict_clear(&context->prefixes);
+  raptor_binary_dict_clear(&context->blanks);
+  raptor_binary_dict_clear(&context->languages);
+}
+
+
+static int
+raptor_binary_serialize_write_namespace(raptor_serializer* serializer,
+                                        raptor_uri *uri,
+                                        const unsigned char *prefix)
+{
+  long id;
+
+  id = raptor_binary_serialize_iri_id(serializer, uri);
+  if(id < 0)
+    return 1;
+
+  raptor_iostream_write_byte('n', serializer->iostream);
+  raptor_binary_write_string(prefix,
+                             prefix ? strlen((const char*)prefix) : 0,
+                             serializer->iostream);
+  raptor_binary_write_varint(RAPTOR_GOOD_CAST(unsigned long, id),
+                             serializer->iostream);
+
+  return 0;
+}
+
+
+/* create a new serializer */
+static int
+raptor_binary_serialize_init(raptor_serializer* serializer, const char *name)
+{
+  raptor_binary_serializer_context* context;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  /* prefix 0 is no prefix */
+  context->prefixes.base = 1;
+
+  return 0;
+}
+
+
+/* destroy a serializer */
+static void
+raptor_binary_serialize_terminate(raptor_serializer* serializer)
+{
+  raptor_binary_serializer_context* context;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  raptor_binary_dict_free(&context->iris);
+  raptor_binary_dict_free(&context->prefixes);
+  raptor_binary_dict_free(&context->blanks);
+  raptor_binary_dict_free(&context->languages);
+
+  while(context->namespaces) {
+    raptor_binary_namespace* ns = context->namespaces;
+
+    context->namespaces = ns->next;
+    if(ns->prefix)
+      RAPTOR_FREE(char*, ns->prefix);
+    raptor_free_uri(ns->uri);
+    RAPTOR_FREE(raptor_binary_namespace, ns);
+  }
+  context->namespaces_tail = NULL;
+}
+
+
+/* add a namespace */
+static int
+raptor_binary_serialize_declare_namespace(raptor_serializer* serializer,
+                                          raptor_uri *uri,
+                                          const unsigned char *prefix)
+{
+  raptor_binary_serializer_context* context;
+  raptor_binary_namespace* ns;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  if(!uri)
+    return 1;
+
+  if(context->started)
+    return raptor_binary_serialize_write_namespace(serializer, uri, prefix);
+
+  /* write when the stream starts */
+  ns = RAPTOR_CALLOC(raptor_binary_namespace*, 1, sizeof(*ns));
+  if(!ns)
+    return 1;
+
+  if(prefix) {
+    size_t len = strlen((const char*)prefix);
+
+    ns->prefix = RAPTOR_MALLOC(unsigned char*, len + 1);
+    if(!ns->prefix) {
+      RAPTOR_FREE(raptor_binary_namespace, ns);
+      return 1;
+    }
+    memcpy(ns->prefix, prefix, len + 1);
+  }
+  ns->uri = raptor_uri_copy(uri);
+
+  if(context->namespaces_tail)
+    context->namespaces_tail->next = ns;
+  else
+    context->namespaces = ns;
+  context->namespaces_tail = ns;
+
+  return 0;
+}
+
+
+/* start a serialize */
+static int
+raptor_binary_serialize_start(raptor_serializer* serializer)
+{
+  raptor_binary_serializer_context* context;
+  raptor_binary_namespace* ns;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  raptor_binary_serialize_clear_dictionaries(serializer);
+
+  raptor_iostream_write_bytes(RAPTOR_BINARY_MAGIC, 1, RAPTOR_BINARY_MAGIC_LEN,
+                              serializer->iostream);
+  raptor_iostream_write_byte(RAPTOR_BINARY_VERSION, serializer->iostream);
+  context->started = 1;
+
+  for(ns = context->namespaces; ns; ns = ns->next) {
+    if(raptor_binary_serialize_write_namespace(serializer, ns->uri,
+                                               ns->prefix))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/* serialize a statement */
+static int
+raptor_binary_serialize_statement(raptor_serializer* serializer,
+                                  raptor_statement *statement)
+{
+  raptor_binary_serializer_context* context;
+  raptor_term* terms[4];
+  long ids[4];
+  int count;
+  int i;
+
+  context = (raptor_binary_serializer_context*)serializer->context;
+
+  terms[0] = statement->subject;
+  terms[1] = statement->predicate;
+  terms[2] = statement->object;
+  terms[3] = statement->graph;
+  count = statement->graph ? 4 : 3;
+
+  /* bound the dictionaries for long streams */
+  if(context->iris.count + context->prefixes.count + context->blanks.count +
+     context->languages.count >= RAPTOR_BINARY_DICT_MAX_ENTRIES) {
+    raptor_iostream_write_byte('r', serializer->iostream);
+    raptor_binary_serialize_clear_dictionaries(serializer);
+  }
+
+  for(i = 0; i < count; i++) {
+    if(!terms[i] ||
+       raptor_binary_serialize_term_ids(serializer, terms[i], &ids[i]))
+      return 1;
+  }
+
+  raptor_iostream_write_byte((count == 4) ? 'q' : 't', serializer->iostream);
+  for(i = 0; i < count; i++)
+    raptor_binary_serialize_write_term(serializer, terms[i], ids[i]);
+
+  return 0;
+}
+
+
+/* end a serialize */
+static int
+raptor_binary_serialize_end(raptor_serializer* serializer)
+{
+  /* release the dictionary IRIs */
+  raptor_binary_serialize_clear_dictionaries(serializer);
+
+  return 0;
+}
+
+
+/* finish the serializer factory */
+static void
+raptor_binary_serialize_finish_factory(raptor_serializer_factory* factory)
+{
+
+}
+
+
+static const char* const binary_names[2] = { "binary", NULL};
+
+#define BINARY_TYPES_COUNT 1
+static const raptor_type_q binary_types[BINARY_TYPES_COUNT + 1] = {
+  { "application/x-raptor-binary-rdf", 31, 10},
+  { NULL, 0, 0}
+};
+
+static int
+raptor_binary_serializer_register_factory(raptor_serializer_factory *factory)
+{
+  factory->desc.names = binary_names;
+  factory->desc.mime_types = binary_types;
+
+  factory->desc.label = "Raptor binary RDF";
+  factory->desc.uri_strings = NULL;
+
+  factory->context_length     = sizeof(raptor_binary_serializer_context);
+
+  factory->init                = raptor_binary_serialize_init;
+  factory->terminate           = raptor_binary_serialize_terminate;
+  factory->declare_namespace   = raptor_binary_serialize_declare_namespace;
+  factory->serialize_start     = raptor_binary_serialize_start;
+  factory->serialize_statement = raptor_binary_serialize_statement;
+  factory->serialize_end       = raptor_binary_serialize_end;
+  factory->finish_factory      = raptor_binary_serialize_finish_factory;
+
+  return 0;
+}
+
+
+int
+raptor_init_serializer_binary(raptor_world* world)
+{
+  return !raptor_serializer_register_factory(world,
+                                             &raptor_binary_serializer_register_factory);
+}
@@ -50,7 +50,7 @@ typedef struct {
   raptor_json_writer* json_writer;
 
   /* Ordered sequence of triples if is_resource */
-  raptor_avltree* avltree;
+  raptor_btree* btree;
 
   /* Last statement generated if is_resource (shared pointer) */
   raptor_statement* last_statement;
@@ -101,9 +101,9 @@ raptor_json_serialize_terminate(raptor_serializer* serializer)
     context->json_writer = NULL;
   }
 
-  if(context->avltree) {
-    raptor_free_avltree(context->avltree);
-    context->avltree = NULL;
+  if(context->btree) {
+    raptor_free_btree(context->btree);
+    context->btree = NULL;
   }
 }
 
@@ -125,10 +125,10 @@ raptor_json_serialize_start(raptor_serializer* serializer)
     return 1;
 
   if(context->is_resource) {
-    context->avltree = raptor_new_avltree((raptor_data_compare_handler)raptor_statement_compare,
-                                          (raptor_data_free_handler)raptor_free_statement,
-                                          0);
-    if(!context->avltree) {
+    context->btree = raptor_new_btree((raptor_data_compare_handler)raptor_statement_compare,
+                                      (raptor_data_free_handler)raptor_free_statement,
+                                      0);
+    if(!context->btree) {
       raptor_free_json_writer(context->json_writer);
       context->json_writer = NULL;
       return 1;
@@ -168,7 +168,7 @@ raptor_json_serialize_statement(raptor_serializer* serializer,
     raptor_statement* s = raptor_statement_copy(statement);
     if(!s)
       return 1;
-    return raptor_avltree_add(context->avltree, s);
+    return raptor_btree_add(context->btree, s);
   }
 
   if(context->need_subject_comma) {
@@ -210,7 +210,7 @@ raptor_json_serialize_statement(raptor_serializer* serializer,
 
 /* return 0 to abort visit */
 static int
-raptor_json_serialize_avltree_visit(int depth, void* data, void *user_data)
+raptor_json_serialize_btree_visit(int depth, void* data, void *user_data)
 {
   raptor_serializer* serializer = (raptor_serializer*)user_data;
   raptor_json_context* context = (raptor_json_context*)serializer->context;
@@ -345,9 +345,9 @@ raptor_json_serialize_end(raptor_serializer* serializer)
     raptor_json_writer_start_block(context->json_writer, '{');
     raptor_json_writer_newline(context->json_writer);
     
-    raptor_avltree_visit(context->avltree,
-                         raptor_json_serialize_avltree_visit,
-                         serializer);
+    raptor_btree_visit(context->btree,
+                       raptor_json_serialize_btree_visit,
+                       serializer);
 
     /* end last triples block */
     if(context->last_statement) {
@@ -35,17 +35,78 @@
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
 #endif
+#if defined(HAVE_PTHREAD) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define RAPTOR_NTRIPLES_WRITE_PARALLEL 1
+#endif
 
 /* Raptor includes */
 #include "raptor2.h"
 #include "raptor_internal.h"
 
 
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+/* most threads used to format a batch */
+#define RAPTOR_NTRIPLES_WRITE_MAX_THREADS 64
+
+/* fewest statements worth handing to another thread */
+#define RAPTOR_NTRIPLES_WRITE_MIN_SLICE 64
+
+typedef struct raptor_ntriples_write_pool_s raptor_ntriples_write_pool;
+
+/* the part of a batch formatted by one worker thread */
+typedef struct {
+  raptor_ntriples_write_pool* pool;
+
+  /* batch generation this slice was last formatted for */
+  unsigned long generation;
+
+  int offset;
+  int count;
+  /* non-0 if a statement failed to format */
+  int failed;
+
+  /* formatted output of the slice */
+  raptor_iostream* iostr;
+  unsigned char *buffer;
+  size_t length;
+  size_t size;
+} raptor_ntriples_write_slice;
+
+struct raptor_ntriples_write_pool_s {
+  /* protects generation, busy and finished */
+  pthread_mutex_t lock;
+  /* signalled when a batch is ready or when finished */
+  pthread_cond_t batch_cond;
+  /* signalled when the last worker finishes its slice */
+  pthread_cond_t done_cond;
+
+  /* current batch: incremented for each batch */
+  unsigned long generation;
+  raptor_statement **statements;
+  int write_graph_term;
+  /* workers still formatting the current batch */
+  int busy;
+
+  /* non-0 when workers should exit */
+  int finished;
+
+  pthread_t workers[RAPTOR_NTRIPLES_WRITE_MAX_THREADS];
+  raptor_ntriples_write_slice slices[RAPTOR_NTRIPLES_WRITE_MAX_THREADS];
+  int workers_count;
+};
+#endif
+
+
 /*
  * Raptor N-Triples serializer object
  */
 typedef struct {
   int is_nquads;
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+  /* formatting threads, created on the first parallel batch */
+  raptor_ntriples_write_pool* pool;
+#endif
 } raptor_ntriples_serializer_context;
 
 
@@ -63,11 +124,24 @@ raptor_ntriples_serialize_init(raptor_serializer* serializer, const char *name)
 }
   
 
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+static void raptor_free_ntriples_write_pool(raptor_ntriples_write_pool* pool);
+#endif
+
+
 /* destroy a serializer */
 static void
 raptor_ntriples_serialize_terminate(raptor_serializer* serializer)
 {
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+  raptor_ntriples_serializer_context* ntriples_serializer;
 
+  ntriples_serializer = (raptor_ntriples_serializer_context*)serializer->context;
+  if(ntriples_serializer->pool) {
+    raptor_free_ntriples_write_pool(ntriples_serializer->pool);
+    ntriples_serializer->pool = NULL;
+  }
+#endif
 }
   
 
@@ -132,17 +206,24 @@ raptor_bnodeid_ntriples_write(const unsigned char *bnodeid,
                               size_t len,
                               raptor_iostream *iostr)
 {
-  unsigned int i;
+  size_t i = 0;
 
   raptor_iostream_counted_string_write("_:", 2, iostr);
 
-  for(i = 0; i < len; i++) {
-    unsigned char c = *bnodeid++;
-    if(!isalpha(c) && !isdigit(c)) {
+  while(i < len) {
+    size_t start = i;
+
+    /* write runs of legal N-Triples bnode characters in one go */
+    while(i < len && (isalpha(bnodeid[i]) || isdigit(bnodeid[i])))
+      i++;
+    if(i > start)
+      raptor_iostream_counted_string_write(bnodeid + start, i - start, iostr);
+
+    if(i < len) {
       /* Replace characters not in legal N-Triples bnode set */
-      c = 'z';
+      raptor_iostream_write_byte('z', iostr);
+      i++;
     }
-    raptor_iostream_write_byte(c, iostr);
   }
 
   return 0;
@@ -229,6 +310,326 @@ raptor_ntriples_serialize_statement(raptor_serializer* serializer,
 }
 
 
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+/* Local handlers for writing a slice to its buffer */
+
+static int
+raptor_ntriples_write_slice_grow(raptor_ntriples_write_slice* slice,
+                                 size_t len)
+{
+  size_t size = slice->size ? slice->size : 4096;
+  unsigned char *buffer;
+
+  while(size < slice->length + len)
+    size <<= 1;
+
+  buffer = RAPTOR_REALLOC(unsigned char*, slice->buffer, size);
+  if(!buffer) {
+    slice->failed = 1;
+    return 1;
+  }
+
+  slice->buffer = buffer;
+  slice->size = size;
+  return 0;
+}
+
+
+static int
+raptor_ntriples_write_slice_write_byte(void *user_data, const int byte)
+{
+  raptor_ntriples_write_slice* slice = (raptor_ntriples_write_slice*)user_data;
+
+  if(slice->length == slice->size &&
+     raptor_ntriples_write_slice_grow(slice, 1))
+    return 1;
+
+  slice->buffer[slice->length++] = (unsigned char)byte;
+  return 0;
+}
+
+
+static int
+raptor_ntriples_write_slice_write_bytes(void *user_data,
+                                        const void *ptr, size_t size,
+                                        size_t nmemb)
+{
+  raptor_ntriples_write_slice* slice = (raptor_ntriples_write_slice*)user_data;
+  size_t len = size * nmemb;
+
+  if(slice->length + len > slice->size &&
+     raptor_ntriples_write_slice_grow(slice, len))
+    return 0;
+
+  memcpy(slice->buffer + slice->length, ptr, len);
+  slice->length += len;
+  return RAPTOR_BAD_CAST(int, nmemb);
+}
+
+
+static const raptor_iostream_handler raptor_ntriples_write_slice_handler = {
+  /* .version     = */ 2,
+  /* .init        = */ NULL,
+  /* .finish      = */ NULL,
+  /* .write_byte  = */ raptor_ntriples_write_slice_write_byte,
+  /* .write_bytes = */ raptor_ntriples_write_slice_write_bytes,
+  /* .write_end   = */ NULL,
+  /* .read_bytes  = */ NULL,
+  /* .read_eof    = */ NULL
+};
+
+
+static void*
+raptor_ntriples_write_worker(void* arg)
+{
+  raptor_ntriples_write_slice* slice = (raptor_ntriples_write_slice*)arg;
+  raptor_ntriples_write_pool* pool = slice->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  while(!pool->finished) {
+    int i;
+
+    if(slice->generation == pool->generation) {
+      pthread_cond_wait(&pool->batch_cond, &pool->lock);
+      continue;
+    }
+
+    slice->generation = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    /* only reads the statements: terms are not copied or freed here */
+    for(i = slice->offset; i < slice->offset + slice->count; i++) {
+      if(raptor_statement_ntriples_write(pool->statements[i], slice->iostr,
+                                         pool->write_graph_term))
+        slice->failed = 1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if(!--pool->busy)
+      pthread_cond_signal(&pool->done_cond);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+
+/*
+ * raptor_free_ntriples_write_pool:
+ * @pool: formatting threads
+ *
+ * INTERNAL - Stop the formatting threads and free their buffers
+ */
+static void
+raptor_free_ntriples_write_pool(raptor_ntriples_write_pool* pool)
+{
+  int i;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->finished = 1;
+  pthread_cond_broadcast(&pool->batch_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for(i = 0; i < pool->workers_count; i++)
+    pthread_join(pool->workers[i], NULL);
+
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->batch_cond);
+  pthread_mutex_destroy(&pool->lock);
+
+  for(i = 0; i < RAPTOR_NTRIPLES_WRITE_MAX_THREADS; i++) {
+    raptor_ntriples_write_slice* slice = &pool->slices[i];
+
+    if(slice->iostr)
+      raptor_free_iostream(slice->iostr);
+    if(slice->buffer)
+      RAPTOR_FREE(unsigned char*, slice->buffer);
+  }
+
+  RAPTOR_FREE(raptor_ntriples_write_pool, pool);
+}
+
+
+/*
+ * raptor_new_ntriples_write_pool:
+ * @world: world
+ * @threads: number of worker threads wanted
+ *
+ * INTERNAL - Start formatting threads
+ *
+ * Return value: new pool or NULL if no threads could be started
+ */
+static raptor_ntriples_write_pool*
+raptor_new_ntriples_write_pool(raptor_world* world, int threads)
+{
+  raptor_ntriples_write_pool* pool;
+  int i;
+
+  pool = RAPTOR_CALLOC(raptor_ntriples_write_pool*, 1, sizeof(*pool));
+  if(!pool)
+    return NULL;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->batch_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  for(i = 0; i < threads; i++) {
+    raptor_ntriples_write_slice* slice = &pool->slices[i];
+
+    slice->pool = pool;
+    slice->iostr = raptor_new_iostream_from_handler(world, slice,
+                                                    &raptor_ntriples_write_slice_handler);
+    if(!slice->iostr)
+      break;
+
+    if(pthread_create(&pool->workers[pool->workers_count], NULL,
+                      raptor_ntriples_write_worker, slice))
+      break;
+    pool->workers_count++;
+  }
+
+  if(!pool->workers_count) {
+    raptor_free_ntriples_write_pool(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+
+/*
+ * raptor_ntriples_serialize_statements_parallel:
+ * @serializer: serializer
+ * @statements: statements
+ * @count: number of statements
+ * @threads: number of threads to use including the calling one
+ *
+ * INTERNAL - Format a batch of statements on several threads
+ *
+ * The calling thread writes the first slice of the batch directly to
+ * the output while the workers format the following slices into their
+ * buffers, which are then written in order.
+ *
+ * Return value: non-0 on failure, <0 if no threads could be started
+ */
+static int
+raptor_ntriples_serialize_statements_parallel(raptor_serializer* serializer,
+                                              raptor_statement **statements,
+                                              int count, int threads)
+{
+  raptor_ntriples_serializer_context* ntriples_serializer;
+  raptor_ntriples_write_pool* pool;
+  int slices_count;
+  int slice_size;
+  int offset;
+  int rc = 0;
+  int i;
+
+  ntriples_serializer = (raptor_ntriples_serializer_context*)serializer->context;
+
+  if(!ntriples_serializer->pool) {
+    if(threads > RAPTOR_NTRIPLES_WRITE_MAX_THREADS)
+      threads = RAPTOR_NTRIPLES_WRITE_MAX_THREADS;
+    /* the calling thread formats one slice itself */
+    ntriples_serializer->pool = raptor_new_ntriples_write_pool(serializer->world,
+                                                               threads - 1);
+    if(!ntriples_serializer->pool)
+      return -1;
+  }
+  pool = ntriples_serializer->pool;
+
+  slices_count = pool->workers_count + 1;
+  if(slices_count > count / RAPTOR_NTRIPLES_WRITE_MIN_SLICE)
+    slices_count = count / RAPTOR_NTRIPLES_WRITE_MIN_SLICE;
+  slice_size = count / slices_count;
+
+  /* slice 0 is for the calling thread; other slices follow in order */
+  offset = count - slice_size * (slices_count - 1);
+  for(i = 0; i < pool->workers_count; i++) {
+    raptor_ntriples_write_slice* slice = &pool->slices[i];
+
+    slice->offset = offset;
+    slice->count = (i < slices_count - 1) ? slice_size : 0;
+    slice->failed = 0;
+    slice->length = 0;
+    offset += slice->count;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->statements = statements;
+  pool->write_graph_term = ntriples_serializer->is_nquads;
+  pool->busy = pool->workers_count;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->batch_cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for(i = 0; i < count - slice_size * (slices_count - 1); i++) {
+    if(raptor_statement_ntriples_write(statements[i], serializer->iostream,
+                                       ntriples_serializer->is_nquads))
+      rc = 1;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  while(pool->busy)
+    pthread_cond_wait(&pool->done_cond, &pool->lock);
+  pool->statements = NULL;
+  pthread_mutex_unlock(&pool->lock);
+
+  for(i = 0; i < slices_count - 1; i++) {
+    raptor_ntriples_write_slice* slice = &pool->slices[i];
+
+    if(slice->length &&
+       raptor_iostream_write_bytes(slice->buffer, 1, slice->length,
+                                   serializer->iostream) !=
+       RAPTOR_BAD_CAST(int, slice->length))
+      rc = 1;
+    if(slice->failed)
+      rc = 1;
+  }
+
+  return rc;
+}
+#endif
+
+
+/* serialize a batch of statements */
+static int
+raptor_ntriples_serialize_statements(raptor_serializer* serializer,
+                                     raptor_statement **statements,
+                                     int count)
+{
+  raptor_ntriples_serializer_context* ntriples_serializer;
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+  int threads;
+#endif
+  int rc = 0;
+  int i;
+
+  ntriples_serializer = (raptor_ntriples_serializer_context*)serializer->context;
+
+#ifdef RAPTOR_NTRIPLES_WRITE_PARALLEL
+  threads = RAPTOR_OPTIONS_GET_NUMERIC(serializer, RAPTOR_OPTION_WRITE_THREADS);
+  if(threads > 1 && count >= 2 * RAPTOR_NTRIPLES_WRITE_MIN_SLICE) {
+    rc = raptor_ntriples_serialize_statements_parallel(serializer,
+                                                       statements, count,
+                                                       threads);
+    /* if no threads could be started, format here */
+    if(rc >= 0)
+      return rc;
+    rc = 0;
+  }
+#endif
+
+  for(i = 0; i < count; i++) {
+    if(raptor_statement_ntriples_write(statements[i], serializer->iostream,
+                                       ntriples_serializer->is_nquads))
+      rc = 1;
+  }
+
+  return rc;
+}
+
+
 #if 0
 /* end a serialize */
 static int
@@ -280,6 +681,7 @@ raptor_ntriples_serializer_register_factory(raptor_serializer_factory *factory)
   factory->serialize_statement = raptor_ntriples_serialize_statement;
   factory->serialize_end       = NULL;
   factory->finish_factory      = raptor_ntriples_serialize_finish_factory;
+  factory->serialize_statements = raptor_ntriples_serialize_statements;
 
   return 0;
 }
@@ -318,6 +720,7 @@ raptor_nquads_serializer_register_factory(raptor_serializer_factory *factory)
   factory->serialize_statement = raptor_ntriples_serialize_statement;
   factory->serialize_end       = NULL;
   factory->finish_factory      = raptor_ntriples_serialize_finish_factory;
+  factory->serialize_statements = raptor_ntriples_serialize_statements;
 
   return 0;
 }
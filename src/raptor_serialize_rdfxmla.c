@@ -52,9 +52,9 @@ typedef struct {
   raptor_xml_element* rdf_RDF_element;  /* the rdf:RDF element */
   raptor_xml_writer *xml_writer;        /* where the xml is being written */
   raptor_sequence *namespaces;          /* User declared namespaces */
-  raptor_avltree *subjects;             /* subject items */
-  raptor_avltree *blanks;               /* blank subject items */
-  raptor_avltree *nodes;                /* nodes */
+  raptor_abbrev_subject_table *subjects; /* subject items */
+  raptor_abbrev_subject_table *blanks;  /* blank subject items */
+  raptor_abbrev_node_table *nodes;      /* nodes */
   raptor_abbrev_node *rdf_type;         /* rdf:type uri */
 
   /* non-zero if is Adobe XMP abbreviated form */
@@ -86,6 +86,16 @@ typedef struct {
 
   /* If non-0, emit typed nodes */
   int write_typed_nodes;
+
+  /* statements held under RAPTOR_OPTION_MEMORY_LIMIT or NULL */
+  raptor_abbrev_spill *spill;
+
+  /* non-0 while writing statements merged back from temporary files,
+   * one subject at a time */
+  int spilled;
+
+  /* subject of the statements being merged back */
+  raptor_term *spill_subject;
 } raptor_rdfxmla_context;
 
 
@@ -341,7 +351,8 @@ raptor_rdfxmla_emit_blank(raptor_serializer *serializer,
   if(node->term->type != RAPTOR_TERM_TYPE_BLANK)
     return 1;
   
-  if((node->count_as_subject == 1 && node->count_as_object == 1)) {
+  if(!context->spilled &&
+     (node->count_as_subject == 1 && node->count_as_object == 1)) {
     /* If this is only used as a 1 subject and object or never
      * used as a subject or never used as an object, it never need
      * be referenced with an explicit name */
@@ -648,7 +659,7 @@ raptor_rdfxmla_emit_subject(raptor_serializer *serializer,
 
   RAPTOR_DEBUG_ABBREV_NODE("Emitting subject node", subject->node);
   
-  if(!depth &&
+  if(!depth && !context->spilled &&
      subject_term->type == RAPTOR_TERM_TYPE_BLANK &&
      subject->node->count_as_subject == 1 &&
      subject->node->count_as_object == 1) {
@@ -712,10 +723,11 @@ raptor_rdfxmla_emit_subject(raptor_serializer *serializer,
       attr_value = raptor_uri_to_string(subject_term->value.uri);
     
   } else if(subject_term->type == RAPTOR_TERM_TYPE_BLANK) {
-    if(subject->node->count_as_subject &&
-       subject->node->count_as_object &&
-       !(subject->node->count_as_subject == 1 && 
-         subject->node->count_as_object == 1)) {
+    if(context->spilled ||
+       (subject->node->count_as_subject &&
+        subject->node->count_as_object &&
+        !(subject->node->count_as_subject == 1 && 
+          subject->node->count_as_object == 1))) {
       /* No need for nodeID if this node is never used as a subject
        * or object OR if it is used exactly once as subject and object.
        */
@@ -765,6 +777,40 @@ raptor_rdfxmla_emit_subject(raptor_serializer *serializer,
 }
 
 
+/*
+ * raptor_rdfxmla_emit_subjects:
+ * @serializer: #raptor_serializer object
+ * @subjects: table of subjects
+ *
+ * Emit the subjects of a table in subject order
+ *
+ * Return value: non-0 on failure
+ **/
+static int
+raptor_rdfxmla_emit_subjects(raptor_serializer *serializer,
+                             raptor_abbrev_subject_table *subjects)
+{
+  raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
+  raptor_sequence* seq;
+  int i;
+
+  seq = raptor_abbrev_subject_table_sorted(subjects);
+  if(!seq)
+    return 1;
+
+  for(i = 0; i < raptor_sequence_size(seq); i++) {
+    raptor_abbrev_subject* subject;
+
+    subject = (raptor_abbrev_subject*)raptor_sequence_get_at(seq, i);
+    raptor_rdfxmla_emit_subject(serializer, subject, context->starting_depth);
+  }
+
+  raptor_free_sequence(seq);
+
+  return 0;
+}
+
+
 /*
  * raptor_rdfxmla_emit - 
  * @serializer: #raptor_serializer object
@@ -777,35 +823,12 @@ static int
 raptor_rdfxmla_emit(raptor_serializer *serializer)
 {
   raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
-  raptor_abbrev_subject* subject;
-  raptor_abbrev_subject* blank;
-  raptor_avltree_iterator* iter = NULL;
 
-  iter = raptor_new_avltree_iterator(context->subjects, NULL, NULL, 1);
-  while(iter) {
-    subject = (raptor_abbrev_subject*)raptor_avltree_iterator_get(iter);
-    if(subject) {
-      raptor_rdfxmla_emit_subject(serializer, subject, context->starting_depth);
-    }
-    if(raptor_avltree_iterator_next(iter))
-      break;
-  }
-  if(iter) 
-    raptor_free_avltree_iterator(iter);
+  raptor_rdfxmla_emit_subjects(serializer, context->subjects);
   
   if(!context->single_node) {
     /* Emit any remaining blank nodes */
-    iter = raptor_new_avltree_iterator(context->blanks, NULL, NULL, 1);
-    while(iter) {
-      blank = (raptor_abbrev_subject*)raptor_avltree_iterator_get(iter);
-      if(blank) {
-	raptor_rdfxmla_emit_subject(serializer, blank, context->starting_depth);
-      }
-      if(raptor_avltree_iterator_next(iter))
-	break;
-    }
-    if(iter) 
-      raptor_free_avltree_iterator(iter);
+    raptor_rdfxmla_emit_subjects(serializer, context->blanks);
   }
     
   return 0;
@@ -853,17 +876,11 @@ raptor_rdfxmla_serialize_init(raptor_serializer* serializer, const char *name)
 
   context->namespaces = raptor_new_sequence(NULL, NULL);
 
-  context->subjects =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_subject_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_subject, 0);
+  context->subjects = raptor_new_abbrev_subject_table();
 
-  context->blanks =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_subject_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_subject, 0);
+  context->blanks = raptor_new_abbrev_subject_table();
   
-  context->nodes =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_node_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_node, 0);
+  context->nodes = raptor_new_abbrev_node_table(serializer->world);
 
   type_term = RAPTOR_RDF_type_term(serializer->world);
   context->rdf_type = raptor_new_abbrev_node(serializer->world, type_term);
@@ -937,18 +954,28 @@ raptor_rdfxmla_serialize_terminate(raptor_serializer* serializer)
     context->namespaces = NULL;
   }
 
+  if(context->spill) {
+    raptor_free_abbrev_spill(context->spill);
+    context->spill = NULL;
+  }
+
+  if(context->spill_subject) {
+    raptor_free_term(context->spill_subject);
+    context->spill_subject = NULL;
+  }
+
   if(context->subjects) {
-    raptor_free_avltree(context->subjects);
+    raptor_free_abbrev_subject_table(context->subjects);
     context->subjects = NULL;
   }
   
   if(context->blanks) {
-    raptor_free_avltree(context->blanks);
+    raptor_free_abbrev_subject_table(context->blanks);
     context->blanks = NULL;
   }
   
   if(context->nodes) {
-    raptor_free_avltree(context->nodes);
+    raptor_free_abbrev_node_table(context->nodes);
     context->nodes = NULL;
   }
   
@@ -1189,6 +1216,24 @@ raptor_rdfxmla_serialize_start(raptor_serializer* serializer)
 
     context->xml_writer = xml_writer;
   }
+
+  if(context->spill) {
+    raptor_free_abbrev_spill(context->spill);
+    context->spill = NULL;
+  }
+
+  /* Not when writing a single node inside another serializer's output */
+  if(!context->external_xml_writer && !context->single_node) {
+    int limit;
+
+    limit = RAPTOR_OPTIONS_GET_NUMERIC(serializer, RAPTOR_OPTION_MEMORY_LIMIT);
+    if(limit > 0) {
+      context->spill = raptor_new_abbrev_spill(serializer->world,
+                                               (size_t)limit * 1024);
+      if(!context->spill)
+        return 1;
+    }
+  }
   
   return 0;
 }
@@ -1285,10 +1330,10 @@ raptor_rdfxmla_ensure_writen_header(raptor_serializer* serializer,
 }
   
 
-/* serialize a statement */
+/* add a statement to the subject trees */
 static int
-raptor_rdfxmla_serialize_statement(raptor_serializer* serializer, 
-                                   raptor_statement *statement)
+raptor_rdfxmla_store_statement(raptor_serializer* serializer, 
+                               raptor_statement *statement)
 {
   raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
   raptor_abbrev_subject* subject = NULL;
@@ -1374,7 +1419,8 @@ raptor_rdfxmla_serialize_statement(raptor_serializer* serializer,
               raptor_abbrev_subject *blank = 
                 raptor_abbrev_subject_find(context->blanks,
                                            statement->object);
-              if(subject) raptor_avltree_delete(context->blanks, blank);
+              if(blank)
+                raptor_abbrev_subject_table_delete(context->blanks, blank);
             }
             break;
           }
@@ -1411,6 +1457,68 @@ raptor_rdfxmla_serialize_statement(raptor_serializer* serializer,
 }
 
 
+/* write and remove the subject being merged back from temporary files */
+static void
+raptor_rdfxmla_flush_spill_subject(raptor_serializer* serializer)
+{
+  raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
+  raptor_term* term = context->spill_subject;
+  raptor_abbrev_subject* subject;
+
+  if(!term)
+    return;
+
+  subject = raptor_abbrev_subject_find((term->type == RAPTOR_TERM_TYPE_BLANK) ?
+                                       context->blanks : context->subjects,
+                                       term);
+  if(subject) {
+    raptor_rdfxmla_emit_subject(serializer, subject, context->starting_depth);
+    raptor_abbrev_subject_remove(context->nodes, context->subjects,
+                                 context->blanks, subject);
+  }
+
+  raptor_free_term(term);
+  context->spill_subject = NULL;
+}
+
+
+static int
+raptor_rdfxmla_spill_handler(void *user_data, raptor_statement *statement)
+{
+  raptor_serializer* serializer = (raptor_serializer*)user_data;
+  raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
+
+  /* merged statements are sorted so a new subject ends the last one */
+  if(context->spilled) {
+    if(context->spill_subject &&
+       !raptor_term_equals(context->spill_subject, statement->subject))
+      raptor_rdfxmla_flush_spill_subject(serializer);
+
+    if(!context->spill_subject) {
+      context->spill_subject = raptor_term_copy(statement->subject);
+      if(!context->spill_subject)
+        return 1;
+    }
+  }
+
+  return raptor_rdfxmla_store_statement(serializer, statement);
+}
+
+
+/* serialize a statement */
+static int
+raptor_rdfxmla_serialize_statement(raptor_serializer* serializer, 
+                                   raptor_statement *statement)
+{
+  raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
+
+  if(context->spill)
+    return raptor_abbrev_spill_add_statement(context->spill, statement);
+
+  return raptor_rdfxmla_store_statement(serializer, statement);
+}
+
+
 /* end a serialize */
 static int
 raptor_rdfxmla_serialize_end(raptor_serializer* serializer)
@@ -1418,10 +1526,20 @@ raptor_rdfxmla_serialize_end(raptor_serializer* serializer)
 
   raptor_rdfxmla_context* context = (raptor_rdfxmla_context*)serializer->context;
   raptor_xml_writer* xml_writer = context->xml_writer;
+  int rc = 0;
 
   if(xml_writer) {
     if(!raptor_rdfxmla_ensure_writen_header(serializer, context)) {
 
+      if(context->spill) {
+        context->spilled = raptor_abbrev_spill_is_spilled(context->spill);
+        rc = raptor_abbrev_spill_replay(context->spill,
+                                        raptor_rdfxmla_spill_handler,
+                                        serializer);
+        raptor_rdfxmla_flush_spill_subject(serializer);
+        context->spilled = 0;
+      }
+
       raptor_rdfxmla_emit(serializer);  
 
       if(context->write_rdf_RDF) {
@@ -1450,7 +1568,7 @@ raptor_rdfxmla_serialize_end(raptor_serializer* serializer)
 
   context->written_header = 0;
   
-  return 0;
+  return rc;
 }
 
 
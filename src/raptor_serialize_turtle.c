@@ -45,6 +45,10 @@
 
 #define MAX_ASCII_INT_SIZE 13
 
+/* subjects kept pending when writing statements merged back from
+ * temporary files (RAPTOR_OPTION_MEMORY_LIMIT) */
+#define RAPTOR_TURTLE_SPILL_WINDOW 64
+
 
 /*
  * Raptor turtle serializer object
@@ -54,9 +58,9 @@ typedef struct {
   raptor_namespace *rdf_nspace;         /* the rdf: namespace */
   raptor_turtle_writer *turtle_writer;  /* where the xml is being written */
   raptor_sequence *namespaces;          /* User declared namespaces */
-  raptor_avltree *subjects;             /* subject items */
-  raptor_avltree *blanks;               /* blank subject items */
-  raptor_avltree *nodes;                /* nodes */
+  raptor_abbrev_subject_table *subjects; /* subject items */
+  raptor_abbrev_subject_table *blanks;  /* blank subject items */
+  raptor_abbrev_node_table *nodes;      /* nodes */
   raptor_abbrev_node *rdf_type;         /* rdf:type uri */
 
   /* URI of rdf:XMLLiteral */
@@ -102,6 +106,19 @@ typedef struct {
   int mkr_rs_ntuple;
   int mkr_rs_nvalue;
   int mkr_rs_processing_value;
+
+  /* Non 0 to write subjects as the input moves on from them, keeping
+   * at most this many pending (RAPTOR_OPTION_WRITE_GROUPED) */
+  int grouped;
+
+  /* grouped: subjects not yet written, in order of first appearance */
+  raptor_sequence *pending;
+
+  /* grouped: subject of the last statement seen */
+  raptor_abbrev_subject *current;
+
+  /* statements held under RAPTOR_OPTION_MEMORY_LIMIT or NULL */
+  raptor_abbrev_spill *spill;
 } raptor_turtle_context;
 
 
@@ -133,6 +150,8 @@ static int raptor_turtle_emit_subject(raptor_serializer *serializer,
                                       raptor_abbrev_subject* subject,
                                       int depth);
 static int raptor_turtle_emit(raptor_serializer *serializer);
+static void raptor_turtle_ensure_writen_header(raptor_serializer* serializer,
+                                              raptor_turtle_context* context);
 
 static int raptor_turtle_serialize_init(raptor_serializer* serializer,
                                         const char *name);
@@ -302,7 +321,10 @@ raptor_turtle_emit_blank(raptor_serializer *serializer,
   if(node->term->type != RAPTOR_TERM_TYPE_BLANK)
     return 1;
 
-  if((node->count_as_subject == 1 && node->count_as_object == 1)) {
+  /* grouped: the counts so far do not include later references so
+   * it is always written by name */
+  if(!context->grouped &&
+     (node->count_as_subject == 1 && node->count_as_object == 1)) {
     /* If this is only used as a 1 subject and object or never
      * used as a subject or never used as an object, it never need
      * be referenced with an explicit name */
@@ -852,7 +874,7 @@ raptor_turtle_emit_subject(raptor_serializer *serializer,
 
   RAPTOR_DEBUG_ABBREV_NODE("Emitting subject node", subject->node);
 
-  if(!depth &&
+  if(!depth && !context->grouped &&
      subject->node->term->type == RAPTOR_TERM_TYPE_BLANK &&
      subject->node->count_as_subject == 1 &&
      subject->node->count_as_object == 1) {
@@ -898,6 +920,10 @@ raptor_turtle_emit_subject(raptor_serializer *serializer,
        raptor_uri_equals(pred1->term->value.uri, context->rs_resultVariable_uri)) {
         context->resultset = 1;
     }
+
+    /* grouped: the cells may be referred to again later */
+    if(context->grouped)
+      collection = 0;
   }
 
   /* emit the subject node */
@@ -922,7 +948,15 @@ raptor_turtle_emit_subject(raptor_serializer *serializer,
     collection = 0;
 
   } else if(subject->node->term->type == RAPTOR_TERM_TYPE_BLANK) {
-    if((subject->node->count_as_subject == 1 &&
+    if(context->grouped && !depth) {
+      /* grouped: later statements may still refer to it */
+      raptor_turtle_writer_bnodeid(turtle_writer,
+                                   subject->node->term->value.blank.string,
+                                   subject->node->term->value.blank.string_len);
+      if(emit_mkr)
+        raptor_turtle_writer_raw_counted(turtle_writer, (const unsigned char*)" has", 4);
+      blank = 0;
+    } else if((subject->node->count_as_subject == 1 &&
         subject->node->count_as_object == 0) && depth > 1) {
       blank = 1;
     } else if(subject->node->count_as_object == 0) {
@@ -1047,6 +1081,40 @@ raptor_turtle_emit_subject(raptor_serializer *serializer,
 }
 
 
+/*
+ * raptor_turtle_emit_subjects:
+ * @serializer: #raptor_serializer object
+ * @subjects: table of subjects
+ *
+ * Emit the subjects of a table in subject order
+ *
+ * Return value: non-0 on failure
+ **/
+static int
+raptor_turtle_emit_subjects(raptor_serializer *serializer,
+                            raptor_abbrev_subject_table *subjects)
+{
+  raptor_sequence* seq;
+  int i;
+  int rc = 0;
+
+  seq = raptor_abbrev_subject_table_sorted(subjects);
+  if(!seq)
+    return 1;
+
+  for(i = 0; !rc && i < raptor_sequence_size(seq); i++) {
+    raptor_abbrev_subject* subject;
+
+    subject = (raptor_abbrev_subject*)raptor_sequence_get_at(seq, i);
+    rc = raptor_turtle_emit_subject(serializer, subject, 0);
+  }
+
+  raptor_free_sequence(seq);
+
+  return rc;
+}
+
+
 /*
  * raptor_turtle_emit:
  * @serializer: #raptor_serializer object
@@ -1059,41 +1127,50 @@ static int
 raptor_turtle_emit(raptor_serializer *serializer)
 {
   raptor_turtle_context* context = (raptor_turtle_context*)serializer->context;
-  raptor_abbrev_subject* subject;
-  raptor_abbrev_subject* blank;
   int rc;
-  raptor_avltree_iterator* iter = NULL;
 
-  iter = raptor_new_avltree_iterator(context->subjects, NULL, NULL, 1);
-  while(iter) {
-    subject = (raptor_abbrev_subject *)raptor_avltree_iterator_get(iter);
-    if(subject) {
-      rc = raptor_turtle_emit_subject(serializer, subject, 0);
-      if(rc) {
-        raptor_free_avltree_iterator(iter);
-        return rc;
-      }
-    }
-    if(raptor_avltree_iterator_next(iter)) break;
-  }
-  if(iter) raptor_free_avltree_iterator(iter);
+  rc = raptor_turtle_emit_subjects(serializer, context->subjects);
+  if(rc)
+    return rc;
 
   /* Emit any remaining blank nodes. */
-  iter = raptor_new_avltree_iterator(context->blanks, NULL, NULL, 1);
-  while(iter) {
-    blank = (raptor_abbrev_subject *)raptor_avltree_iterator_get(iter);
-    if(blank) {
-      rc = raptor_turtle_emit_subject(serializer, blank, 0);
-      if(rc) {
-        raptor_free_avltree_iterator(iter);
-        return rc;
-      }
-    }
-    if(raptor_avltree_iterator_next(iter)) break;
+  return raptor_turtle_emit_subjects(serializer, context->blanks);
+}
+
+
+/*
+ * raptor_turtle_emit_pending:
+ * @serializer: #raptor_serializer object
+ * @size: number of subjects to leave pending
+ *
+ * Write and free pending subjects, oldest first (grouped mode)
+ *
+ * Return value: non-0 on failure
+ **/
+static int
+raptor_turtle_emit_pending(raptor_serializer* serializer, int size)
+{
+  raptor_turtle_context* context = (raptor_turtle_context*)serializer->context;
+  int rc = 0;
+
+  while(!rc && raptor_sequence_size(context->pending) > size) {
+    raptor_abbrev_subject* subject;
+
+    subject = (raptor_abbrev_subject*)raptor_sequence_get_at(context->pending, 0);
+    if(subject == context->current)
+      break;
+
+    raptor_sequence_unshift(context->pending);
+    subject->pending = 0;
+
+    raptor_turtle_ensure_writen_header(serializer, context);
+
+    rc = raptor_turtle_emit_subject(serializer, subject, 0);
+    raptor_abbrev_subject_remove(context->nodes, context->subjects,
+                                 context->blanks, subject);
   }
-  if(iter) raptor_free_avltree_iterator(iter);
 
-  return 0;
+  return rc;
 }
 
 
@@ -1128,17 +1205,13 @@ raptor_turtle_serialize_init(raptor_serializer* serializer, const char *name)
 
   context->namespaces = raptor_new_sequence(NULL, NULL);
 
-  context->subjects =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_subject_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_subject, 0);
+  context->pending = raptor_new_sequence(NULL, NULL);
+
+  context->subjects = raptor_new_abbrev_subject_table();
 
-  context->blanks =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_subject_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_subject, 0);
+  context->blanks = raptor_new_abbrev_subject_table();
 
-  context->nodes =
-    raptor_new_avltree((raptor_data_compare_handler)raptor_abbrev_node_compare,
-                       (raptor_data_free_handler)raptor_free_abbrev_node, 0);
+  context->nodes = raptor_new_abbrev_node_table(serializer->world);
 
   rdf_type_uri = raptor_new_uri_for_rdf_concept(serializer->world,
                                                 (const unsigned char*)"type");
@@ -1161,6 +1234,7 @@ raptor_turtle_serialize_init(raptor_serializer* serializer, const char *name)
   context->rs_resultVariable_uri = raptor_new_uri(serializer->world, (const unsigned char*)"http://jena.hpl.hp.com/2003/03/result-set#resultVariable");
 
   if(!context->rdf_nspace || !context->namespaces ||
+     !context->pending ||
      !context->subjects || !context->blanks || !context->nodes ||
      !context->rdf_xml_literal_uri || !context->rdf_first_uri ||
      !context->rdf_rest_uri || !context->rdf_nil_uri || !context->rdf_type ||
@@ -1210,18 +1284,30 @@ raptor_turtle_serialize_terminate(raptor_serializer* serializer)
     context->namespaces = NULL;
   }
 
+  if(context->pending) {
+    raptor_free_sequence(context->pending);
+    context->pending = NULL;
+  }
+
+  context->current = NULL;
+
+  if(context->spill) {
+    raptor_free_abbrev_spill(context->spill);
+    context->spill = NULL;
+  }
+
   if(context->subjects) {
-    raptor_free_avltree(context->subjects);
+    raptor_free_abbrev_subject_table(context->subjects);
     context->subjects = NULL;
   }
 
   if(context->blanks) {
-    raptor_free_avltree(context->blanks);
+    raptor_free_abbrev_subject_table(context->blanks);
     context->blanks = NULL;
   }
 
   if(context->nodes) {
-    raptor_free_avltree(context->nodes);
+    raptor_free_abbrev_node_table(context->nodes);
     context->nodes = NULL;
   }
 
@@ -1356,6 +1442,25 @@ raptor_turtle_serialize_start(raptor_serializer* serializer)
 
   context->turtle_writer = turtle_writer;
 
+  context->grouped = RAPTOR_OPTIONS_GET_NUMERIC(serializer,
+                                                RAPTOR_OPTION_WRITE_GROUPED);
+  if(context->grouped < 0)
+    context->grouped = 0;
+
+  if(context->spill) {
+    raptor_free_abbrev_spill(context->spill);
+    context->spill = NULL;
+  }
+
+  /* grouped output already keeps memory bounded */
+  flag = RAPTOR_OPTIONS_GET_NUMERIC(serializer, RAPTOR_OPTION_MEMORY_LIMIT);
+  if(flag > 0 && !context->grouped) {
+    context->spill = raptor_new_abbrev_spill(serializer->world,
+                                             (size_t)flag * 1024);
+    if(!context->spill)
+      return 1;
+  }
+
   return 0;
 }
 
@@ -1384,10 +1489,10 @@ raptor_turtle_ensure_writen_header(raptor_serializer* serializer,
   context->written_header = 1;
 }
 
-/* serialize a statement */
+/* add a statement to the subject trees */
 static int
-raptor_turtle_serialize_statement(raptor_serializer* serializer,
-                                  raptor_statement *statement)
+raptor_turtle_store_statement(raptor_serializer* serializer,
+                              raptor_statement *statement)
 {
   raptor_turtle_context* context = (raptor_turtle_context*)serializer->context;
   raptor_abbrev_subject* subject = NULL;
@@ -1451,24 +1556,74 @@ raptor_turtle_serialize_statement(raptor_serializer* serializer,
      object_type == RAPTOR_TERM_TYPE_BLANK)
     object->count_as_object++;
 
+  if(context->grouped && subject != context->current) {
+    if(!subject->pending) {
+      if(raptor_sequence_push(context->pending, subject))
+        return 1;
+      subject->pending = 1;
+    }
+    context->current = subject;
+
+    return raptor_turtle_emit_pending(serializer, context->grouped);
+  }
+
   return 0;
 }
 
 
+static int
+raptor_turtle_spill_handler(void *user_data, raptor_statement *statement)
+{
+  return raptor_turtle_store_statement((raptor_serializer*)user_data,
+                                       statement);
+}
+
+
+/* serialize a statement */
+static int
+raptor_turtle_serialize_statement(raptor_serializer* serializer,
+                                  raptor_statement *statement)
+{
+  raptor_turtle_context* context = (raptor_turtle_context*)serializer->context;
+
+  if(context->spill)
+    return raptor_abbrev_spill_add_statement(context->spill, statement);
+
+  return raptor_turtle_store_statement(serializer, statement);
+}
+
+
 /* end a serialize */
 static int
 raptor_turtle_serialize_end(raptor_serializer* serializer)
 {
   raptor_turtle_context* context = (raptor_turtle_context*)serializer->context;
+  int rc = 0;
+
+  if(context->spill) {
+    /* statements come back sorted by subject if any were spilled;
+     * the grouped window then writes blank nodes by label since the
+     * references to them are spread over the runs */
+    if(raptor_abbrev_spill_is_spilled(context->spill))
+      context->grouped = RAPTOR_TURTLE_SPILL_WINDOW;
+    rc = raptor_abbrev_spill_replay(context->spill,
+                                    raptor_turtle_spill_handler, serializer);
+  }
 
   raptor_turtle_ensure_writen_header(serializer, context);
 
+  if(context->grouped) {
+    context->current = NULL;
+    raptor_turtle_emit_pending(serializer, 0);
+  }
+
+  /* write everything left */
   raptor_turtle_emit(serializer);
 
   /* reset serializer for reuse */
   context->written_header = 0;
 
-  return 0;
+  return rc;
 }
 
 
@@ -50,35 +50,86 @@
  *  Destroy Set
  *  Check a (base, ID) pair present add it if not, return if added/not
  *
+ * The set is one open addressing hash table with linear probing keyed
+ * on the base URI and the ID bytes.  Base URIs are kept once in a
+ * small table of their own and entries refer to them by index.  The
+ * IDs are copied, each after its length, into a list of blocks that
+ * are only freed with the set.
+ *
+ * If the set is created with a filter size, only a 64 bit fingerprint
+ * of each (base, ID) pair is kept in a fixed size table of buckets of
+ * RAPTOR_ID_SET_FILTER_WAYS slots.  When a bucket is full a fingerprint
+ * is overwritten, so a duplicate of an ID added long before may be
+ * missed.  Two different IDs with the same fingerprint would be
+ * reported as a duplicate but that is very unlikely.
  */
 
-struct raptor_base_id_set_s
-{
-  raptor_world* world;
-
-  /* The base URI of this set of IDs */
-  raptor_uri *uri;
-  
-  /* neighbour ID sets */
-  struct raptor_base_id_set_s* prev;
-  struct raptor_base_id_set_s* next;
+typedef struct raptor_id_set_block_s raptor_id_set_block;
 
-  /* binary tree */
-  raptor_avltree* tree;
+struct raptor_id_set_block_s {
+  raptor_id_set_block* next;
+  /* size of data area */
+  size_t size;
+  /* bytes of data area used */
+  size_t used;
 };
-typedef struct raptor_base_id_set_s raptor_base_id_set;
+
+#define RAPTOR_ID_SET_BLOCK_SIZE 65536
+#define RAPTOR_ID_SET_BLOCK_DATA(block) \
+  ((unsigned char*)(block) + sizeof(raptor_id_set_block))
+
+typedef struct {
+  /* unsigned int length then the ID bytes in a block; NULL if the
+   * slot is empty */
+  const unsigned char* id;
+  unsigned int hash;
+  /* index into bases */
+  unsigned int base;
+} raptor_id_set_entry;
+
+typedef struct {
+  unsigned int hash;
+  unsigned int check;
+} raptor_id_set_fingerprint;
+
+#define RAPTOR_ID_SET_INITIAL_SIZE 1024
+
+#define RAPTOR_ID_SET_BASES_INITIAL_SIZE 8
+
+#define RAPTOR_ID_SET_FILTER_WAYS 4
 
 
 struct raptor_id_set_s
 {
   raptor_world* world;
 
-  /* start of trees, 1 per base URI */
-  struct raptor_base_id_set_s* first;
+  /* hash table; size is a power of 2 */
+  raptor_id_set_entry* entries;
+  size_t size;
+  size_t count;
+
+  /* blocks holding the IDs; the first is allocated from */
+  raptor_id_set_block* blocks;
+
+  /* base URIs of the IDs, each held once */
+  raptor_uri** bases;
+  unsigned int bases_count;
+  /* hash table of base index + 1 (0 is empty); size is a power of 2
+   * and at least twice bases_count, which is also the size of bases */
+  unsigned int* bases_table;
+  unsigned int bases_size;
+  /* index of the base URI found last */
+  unsigned int last_base;
+
+  /* filter used instead of the table or NULL; size is a power of 2
+   * number of buckets */
+  raptor_id_set_fingerprint* filter;
+  size_t filter_buckets;
 
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
   int hits;
   int misses;
+  int evictions;
 #endif
 };
 
@@ -88,13 +139,17 @@ struct raptor_id_set_s
 /**
  * raptor_new_id_set:
  * @world: raptor_world object
+ * @filter_size: size in bytes of a probabilistic filter to use or 0
  *
  * INTERNAL - Constructor - create a new ID set.
+ *
+ * If @filter_size is 0 every ID is kept, otherwise the set uses a
+ * fixed amount of memory and may miss some duplicates.
  * 
- * Return value: non 0 on failure
+ * Return value: new set or NULL on failure
  **/
 raptor_id_set*
-raptor_new_id_set(raptor_world* world)
+raptor_new_id_set(raptor_world* world, size_t filter_size)
 {
   raptor_id_set* set = RAPTOR_CALLOC(raptor_id_set*, 1, sizeof(*set));
   if(!set)
@@ -102,25 +157,24 @@ raptor_new_id_set(raptor_world* world)
 
   set->world = world;
 
-  return set;
-}
+  if(filter_size) {
+    size_t bucket_size = RAPTOR_ID_SET_FILTER_WAYS * sizeof(*set->filter);
 
+    for(set->filter_buckets = 1;
+        (set->filter_buckets << 1) * bucket_size <= filter_size;
+        set->filter_buckets <<= 1)
+      ;
 
-/**
- * raptor_free_base_id_set:
- * @set: #raptor_base_id_set
- *
- * INTERNAL - Destructor - Free a Base ID Set.
- *
- **/
-static void
-raptor_free_base_id_set(raptor_base_id_set *base) 
-{
-  if(base->tree)
-    raptor_free_avltree(base->tree);
-  if(base->uri)
-    raptor_free_uri(base->uri);
-  RAPTOR_FREE(raptor_base_id_set, base);
+    set->filter = RAPTOR_CALLOC(raptor_id_set_fingerprint*,
+                                set->filter_buckets * RAPTOR_ID_SET_FILTER_WAYS,
+                                sizeof(*set->filter));
+    if(!set->filter) {
+      RAPTOR_FREE(raptor_id_set, set);
+      return NULL;
+    }
+  }
+
+  return set;
 }
 
 
@@ -134,20 +188,256 @@ raptor_free_base_id_set(raptor_base_id_set *base)
 void
 raptor_free_id_set(raptor_id_set *set) 
 {
-  raptor_base_id_set *base;
+  raptor_id_set_block* block;
+  unsigned int i;
 
   RAPTOR_ASSERT_OBJECT_POINTER_RETURN(set, raptor_id_set);
 
-  base = set->first;
-  while(base) {
-    raptor_base_id_set *next = base->next;
-    raptor_free_base_id_set(base);
-    base = next;
+  if(set->entries)
+    RAPTOR_FREE(raptor_id_set_entry*, set->entries);
+
+  while((block = set->blocks)) {
+    set->blocks = block->next;
+    RAPTOR_FREE(raptor_id_set_block, block);
+  }
+
+  if(set->bases) {
+    for(i = 0; i < set->bases_count; i++)
+      raptor_free_uri(set->bases[i]);
+    RAPTOR_FREE(raptor_uri**, set->bases);
   }
+  if(set->bases_table)
+    RAPTOR_FREE(unsigned int*, set->bases_table);
+
+  if(set->filter)
+    RAPTOR_FREE(raptor_id_set_fingerprint*, set->filter);
+
   RAPTOR_FREE(raptor_id_set, set);
 }
 
 
+/*
+ * raptor_id_set_base_index:
+ * @set: #raptor_id_set
+ * @base_uri: base URI
+ * @index_p: pointer to store the index of @base_uri in
+ *
+ * INTERNAL - Find the index of a base URI, adding it if not present
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_id_set_base_index(raptor_id_set* set, raptor_uri* base_uri,
+                         unsigned int* index_p)
+{
+  unsigned int mask;
+  unsigned int i;
+  unsigned int index;
+
+  if(set->bases_count && set->bases[set->last_base] == base_uri) {
+    *index_p = set->last_base;
+    return 0;
+  }
+
+  if(set->bases_count) {
+    mask = set->bases_size - 1;
+    for(i = raptor_uri_get_hash(base_uri) & mask; set->bases_table[i];
+        i = (i + 1) & mask) {
+      index = set->bases_table[i] - 1;
+      if(set->bases[index] == base_uri ||
+         raptor_uri_equals(set->bases[index], base_uri)) {
+        set->last_base = index;
+        *index_p = index;
+        return 0;
+      }
+    }
+  }
+
+  /* keep the table at most half full */
+  if((set->bases_count + 1) * 2 > set->bases_size) {
+    unsigned int new_size;
+    raptor_uri** new_bases;
+    unsigned int* new_table;
+
+    new_size = set->bases_size ? (set->bases_size << 1) :
+      RAPTOR_ID_SET_BASES_INITIAL_SIZE;
+
+    new_bases = RAPTOR_CALLOC(raptor_uri**, new_size, sizeof(raptor_uri*));
+    if(!new_bases)
+      return 1;
+    new_table = RAPTOR_CALLOC(unsigned int*, new_size, sizeof(unsigned int));
+    if(!new_table) {
+      RAPTOR_FREE(raptor_uri**, new_bases);
+      return 1;
+    }
+
+    mask = new_size - 1;
+    for(index = 0; index < set->bases_count; index++) {
+      new_bases[index] = set->bases[index];
+      for(i = raptor_uri_get_hash(new_bases[index]) & mask; new_table[i];
+          i = (i + 1) & mask)
+        ;
+      new_table[i] = index + 1;
+    }
+
+    if(set->bases)
+      RAPTOR_FREE(raptor_uri**, set->bases);
+    if(set->bases_table)
+      RAPTOR_FREE(unsigned int*, set->bases_table);
+    set->bases = new_bases;
+    set->bases_table = new_table;
+    set->bases_size = new_size;
+  }
+
+  mask = set->bases_size - 1;
+  for(i = raptor_uri_get_hash(base_uri) & mask; set->bases_table[i];
+      i = (i + 1) & mask)
+    ;
+
+  index = set->bases_count++;
+  set->bases[index] = raptor_uri_copy(base_uri);
+  set->bases_table[i] = index + 1;
+  set->last_base = index;
+
+  *index_p = index;
+  return 0;
+}
+
+
+/*
+ * raptor_id_set_copy_id:
+ * @set: #raptor_id_set
+ * @id: identifier name
+ * @id_len: length of identifier
+ *
+ * INTERNAL - Copy an ID after its length into the blocks of the set
+ *
+ * Return value: copy or NULL on failure
+ */
+static const unsigned char*
+raptor_id_set_copy_id(raptor_id_set* set, const unsigned char *id,
+                      unsigned int id_len)
+{
+  raptor_id_set_block* block = set->blocks;
+  size_t size = sizeof(id_len) + id_len;
+  unsigned char* copy;
+
+  if(!block || block->used + size > block->size) {
+    size_t block_size = RAPTOR_ID_SET_BLOCK_SIZE;
+
+    if(size > block_size)
+      block_size = size;
+
+    block = (raptor_id_set_block*)RAPTOR_MALLOC(void*, sizeof(*block) + block_size);
+    if(!block)
+      return NULL;
+
+    block->size = block_size;
+    block->used = 0;
+    block->next = set->blocks;
+    set->blocks = block;
+  }
+
+  copy = RAPTOR_ID_SET_BLOCK_DATA(block) + block->used;
+  memcpy(copy, &id_len, sizeof(id_len));
+  memcpy(copy + sizeof(id_len), id, id_len);
+  block->used += size;
+
+  return copy;
+}
+
+
+/*
+ * raptor_id_set_grow:
+ * @set: #raptor_id_set
+ *
+ * INTERNAL - Double the size of the hash table
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_id_set_grow(raptor_id_set* set)
+{
+  raptor_id_set_entry* new_entries;
+  size_t new_size;
+  size_t mask;
+  size_t i;
+
+  new_size = set->size ? (set->size << 1) : RAPTOR_ID_SET_INITIAL_SIZE;
+  new_entries = RAPTOR_CALLOC(raptor_id_set_entry*, new_size,
+                              sizeof(*new_entries));
+  if(!new_entries)
+    return 1;
+
+  mask = new_size - 1;
+  for(i = 0; i < set->size; i++) {
+    raptor_id_set_entry* entry = &set->entries[i];
+    size_t j;
+
+    if(!entry->id)
+      continue;
+
+    for(j = entry->hash & mask; new_entries[j].id; j = (j + 1) & mask)
+      ;
+    new_entries[j] = *entry;
+  }
+
+  if(set->entries)
+    RAPTOR_FREE(raptor_id_set_entry*, set->entries);
+  set->entries = new_entries;
+  set->size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * raptor_id_set_filter_add:
+ * @set: #raptor_id_set
+ * @hash: hash of the (base, ID) pair
+ * @check: second hash of the (base, ID) pair
+ *
+ * INTERNAL - Add a fingerprint to the filter
+ *
+ * Return value: 0 if added, 1 if already present
+ */
+static int
+raptor_id_set_filter_add(raptor_id_set* set, unsigned int hash,
+                         unsigned int check)
+{
+  raptor_id_set_fingerprint* bucket;
+  int i;
+
+  /* 0, 0 marks an empty slot */
+  if(!hash && !check)
+    check = 1;
+
+  bucket = &set->filter[(hash & (set->filter_buckets - 1)) *
+                        RAPTOR_ID_SET_FILTER_WAYS];
+
+  for(i = 0; i < RAPTOR_ID_SET_FILTER_WAYS; i++) {
+    if(bucket[i].hash == hash && bucket[i].check == check)
+      return 1;
+
+    if(!bucket[i].hash && !bucket[i].check)
+      break;
+  }
+
+  if(i == RAPTOR_ID_SET_FILTER_WAYS) {
+    /* full bucket: forget a fingerprint chosen by bits not used to
+     * pick the bucket */
+    i = (int)((check >> 16) % RAPTOR_ID_SET_FILTER_WAYS);
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    set->evictions++;
+#endif
+  }
+
+  bucket[i].hash = hash;
+  bucket[i].check = check;
+
+  return 0;
+}
+
 
 /**
  * raptor_id_set_add:
@@ -164,81 +454,88 @@ int
 raptor_id_set_add(raptor_id_set* set, raptor_uri *base_uri,
                   const unsigned char *id, size_t id_len)
 {
-  raptor_base_id_set *base;
-  char* item;
+  raptor_id_set_entry* entry;
+  unsigned int hash;
+  unsigned int check;
+  unsigned int base;
+  size_t mask;
+  size_t i;
   
   if(!base_uri || !id || !id_len)
     return -1;
 
-  base = set->first;
-  while(base) {
-    if(raptor_uri_equals(base->uri, base_uri))
-      break;
-    base = base->next;
+  /* FNV-1a and a multiplicative hash of the ID from the base URI hash */
+  hash = raptor_uri_get_hash(base_uri);
+  check = hash ^ 0x9e3779b9U;
+  for(i = 0; i < id_len; i++) {
+    hash ^= id[i];
+    hash *= 16777619U;
+    check = (check * 31U) + id[i];
   }
 
-  if(!base) {
-    /* a set for this base_uri not found */
-    base = RAPTOR_CALLOC(raptor_base_id_set*, 1, sizeof(*base));
-    if(!base)
-      return -1;
+  if(set->filter) {
+    int rc = raptor_id_set_filter_add(set, hash, check);
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    if(rc)
+      set->misses++;
+    else
+      set->hits++;
+#endif
+    return rc;
+  }
 
-    base->world = set->world;
+  /* the length is stored as an unsigned int */
+  if((size_t)(unsigned int)id_len != id_len)
+    return -1;
 
-    base->uri = raptor_uri_copy(base_uri);
+  if(raptor_id_set_base_index(set, base_uri, &base))
+    return -1;
 
-    base->tree = raptor_new_avltree((raptor_data_compare_handler)strcmp,
-                                    free, 0);
-  
-    /* Add to the start of the list */
-    if(set->first)
-      set->first->prev = base;
-    /* base->prev = NULL; */
-    base->next = set->first;
-
-    set->first = base;
-  } else {
-    /* If not at the start of the list, move there */
-    if(base != set->first) {
-      /* remove from the list */
-      base->prev->next = base->next;
-      if(base->next)
-        base->next->prev = base->prev;
-      /* add at the start of the list */
-      set->first->prev = base;
-      base->prev = NULL;
-      base->next = set->first;
-    }
+  /* keep the table at most 3/4 full */
+  if((set->count + 1) * 4 > set->size * 3) {
+    if(raptor_id_set_grow(set))
+      return -1;
   }
-  
-  item = (char*)raptor_avltree_search(base->tree, id);
 
-  /* if already there, error */
-  if(item) {
+  mask = set->size - 1;
+  for(i = hash & mask; (entry = &set->entries[i])->id; i = (i + 1) & mask) {
+    unsigned int entry_len;
+
+    if(entry->hash != hash || entry->base != base)
+      continue;
+
+    memcpy(&entry_len, entry->id, sizeof(entry_len));
+    /* if already there, error */
+    if(entry_len == id_len &&
+       !memcmp(entry->id + sizeof(entry_len), id, id_len)) {
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-    set->misses++;
+      set->misses++;
 #endif
-    return 1;
+      return 1;
+    }
   }
   
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
   set->hits++;
 #endif
   
-  item = RAPTOR_MALLOC(char*, id_len + 1);
-  if(!item)
-    return 1;
+  entry->id = raptor_id_set_copy_id(set, id, (unsigned int)id_len);
+  if(!entry->id)
+    return -1;
 
-  memcpy(item, id, id_len + 1);
+  entry->hash = hash;
+  entry->base = base;
+  set->count++;
 
-  return raptor_avltree_add(base->tree, item);
+  return 0;
 }
 
 
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
 void
 raptor_id_set_stats_print(raptor_id_set* set, FILE *stream) {
-  fprintf(stream, "set hits: %d misses: %d\n", set->hits, set->misses);
+  fprintf(stream, "set hits: %d misses: %d evictions: %d\n", set->hits,
+          set->misses, set->evictions);
 }
 #endif
 
@@ -251,6 +548,34 @@ raptor_id_set_stats_print(raptor_id_set* set, FILE *stream) {
 int main(int argc, char *argv[]);
 
 
+#define SET_TEST_ID_LEN 32
+#define SET_TEST_COUNT 100000
+#define SET_TEST_FILTER_COUNT 100
+#define SET_TEST_FILTER_SIZE 65536
+
+
+/* add IDs 0..count-1 expecting return code rc */
+static int
+set_test_add_ids(const char* program, raptor_id_set* set,
+                 raptor_uri* base_uri, int count, int expected_rc)
+{
+  char id[SET_TEST_ID_LEN];
+  int i;
+
+  for(i = 0; i < count; i++) {
+    size_t len = (size_t)snprintf(id, SET_TEST_ID_LEN, "id%d", i);
+    int rc = raptor_id_set_add(set, base_uri, (const unsigned char*)id, len);
+    if(rc != expected_rc) {
+      fprintf(stderr, "%s: Adding set item '%s' returned %d expected %d\n",
+              program, id, rc, expected_rc);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+
 int
 main(int argc, char *argv[]) 
 {
@@ -259,6 +584,8 @@ main(int argc, char *argv[])
   const char *items[8] = { "ron", "amy", "jen", "bij", "jib", "daj", "jim", NULL };
   raptor_id_set *set;
   raptor_uri *base_uri;
+  raptor_uri *other_base_uri;
+  char id[SET_TEST_ID_LEN];
   int i = 0;
   
   world = raptor_new_world();
@@ -271,7 +598,7 @@ main(int argc, char *argv[])
   fprintf(stderr, "%s: Creating set\n", program);
 #endif
 
-  set = raptor_new_id_set(world);
+  set = raptor_new_id_set(world, 0);
   if(!set) {
     fprintf(stderr, "%s: Failed to create set\n", program);
     exit(1);
@@ -318,6 +645,47 @@ if(rc) {
 #endif
   raptor_free_id_set(set);
 
+
+  /* Same IDs with different base URIs and enough to grow the table */
+  other_base_uri = raptor_new_uri(world, (const unsigned char*)"http://example.org/other#");
+
+  set = raptor_new_id_set(world, 0);
+  if(!set) {
+    fprintf(stderr, "%s: Failed to create set\n", program);
+    exit(1);
+  }
+  if(set_test_add_ids(program, set, base_uri, SET_TEST_COUNT, 0) ||
+     set_test_add_ids(program, set, other_base_uri, SET_TEST_COUNT, 0) ||
+     set_test_add_ids(program, set, base_uri, SET_TEST_COUNT, 1) ||
+     set_test_add_ids(program, set, other_base_uri, SET_TEST_COUNT, 1))
+    exit(1);
+  raptor_free_id_set(set);
+
+
+  /* Filter finds duplicates until it fills, then fails safe */
+  set = raptor_new_id_set(world, SET_TEST_FILTER_SIZE);
+  if(!set) {
+    fprintf(stderr, "%s: Failed to create filter set\n", program);
+    exit(1);
+  }
+  if(set_test_add_ids(program, set, base_uri, SET_TEST_FILTER_COUNT, 0) ||
+     set_test_add_ids(program, set, other_base_uri, SET_TEST_FILTER_COUNT, 0) ||
+     set_test_add_ids(program, set, base_uri, SET_TEST_FILTER_COUNT, 1))
+    exit(1);
+  for(i = 0; i < SET_TEST_COUNT; i++) {
+    size_t len = (size_t)snprintf(id, SET_TEST_ID_LEN, "new%d", i);
+    if(raptor_id_set_add(set, base_uri, (const unsigned char*)id, len) < 0) {
+      fprintf(stderr, "%s: Adding filter set item '%s' failed\n",
+              program, id);
+      exit(1);
+    }
+  }
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+  raptor_id_set_stats_print(set, stderr);
+#endif
+  raptor_free_id_set(set);
+
+  raptor_free_uri(other_base_uri);
   raptor_free_uri(base_uri);
   
   raptor_free_world(world);
@@ -176,7 +176,7 @@ raptor_statement_copy(raptor_statement *statement)
     return s2;
   }
   
-  statement->usage++;
+  RAPTOR_WORLD_INCREMENT(statement->world, &statement->usage);
 
   return statement;
 }
@@ -230,7 +230,7 @@ raptor_free_statement(raptor_statement *statement)
   is_dynamic = (statement->usage >= 0);
 
   /* dynamically allocated and still in use? */
-  if(is_dynamic && --statement->usage)
+  if(is_dynamic && RAPTOR_WORLD_DECREMENT(statement->world, &statement->usage))
     return;
 
   raptor_statement_clear(statement);
@@ -413,7 +413,7 @@ raptor_new_term_from_counted_string(raptor_world* world,
   locator.line = -1;
 
   bytes_read = raptor_ntriples_parse_term(world, &locator,
-                                          string, &length, &term, 1);
+                                          string, &length, &term, 1, NULL);
 
   if(!bytes_read || length != 0) {
     if(term)
@@ -431,6 +431,11 @@ raptor_new_term_from_counted_string(raptor_world* world,
  *
  * Copy constructor - get a copy of a statement term
  *
+ * Terms that are not usage counted, such as those passed to a
+ * statement handler by a parser with #RAPTOR_OPTION_STATEMENT_ARENA
+ * set, are only valid until the handler returns.  For those a new
+ * term is constructed with copies of the values.
+ *
  * Return value: new term object or NULL on failure
  */
 raptor_term*
@@ -439,7 +444,32 @@ raptor_term_copy(raptor_term* term)
   if(!term)
     return NULL;
 
-  term->usage++;
+  /* static - not usage counted */
+  if(term->usage < 0) {
+    switch(term->type) {
+      case RAPTOR_TERM_TYPE_URI:
+        return raptor_new_term_from_uri(term->world, term->value.uri);
+
+      case RAPTOR_TERM_TYPE_LITERAL:
+        return raptor_new_term_from_counted_literal(term->world,
+                                                    term->value.literal.string,
+                                                    term->value.literal.string_len,
+                                                    term->value.literal.datatype,
+                                                    term->value.literal.language,
+                                                    term->value.literal.language_len);
+
+      case RAPTOR_TERM_TYPE_BLANK:
+        return raptor_new_term_from_counted_blank(term->world,
+                                                  term->value.blank.string,
+                                                  term->value.blank.string_len);
+
+      case RAPTOR_TERM_TYPE_UNKNOWN:
+      default:
+        return NULL;
+    }
+  }
+
+  RAPTOR_WORLD_INCREMENT(term->world, &term->usage);
   return term;
 }
 
@@ -457,7 +487,11 @@ raptor_free_term(raptor_term *term)
   if(!term)
     return;
   
-  if(--term->usage)
+  /* static - not usage counted and owned elsewhere */
+  if(term->usage < 0)
+    return;
+
+  if(RAPTOR_WORLD_DECREMENT(term->world, &term->usage))
     return;
   
   switch(term->type) {
@@ -501,6 +535,373 @@ raptor_free_term(raptor_term *term)
 }
 
 
+/*
+ * Term arena
+ *
+ * Terms and their strings are allocated by bumping a pointer through
+ * a list of blocks.  raptor_term_arena_reset() makes all the memory
+ * available again at once; the blocks are kept for reuse so a parser
+ * that resets after every statement stops allocating once the blocks
+ * are large enough.
+ *
+ * Arena terms have usage -1 so raptor_free_term() ignores them and
+ * raptor_term_copy() makes heap copies of them.  The URI references
+ * they hold are released on reset.
+ */
+
+typedef struct raptor_term_arena_block_s raptor_term_arena_block;
+
+struct raptor_term_arena_block_s {
+  raptor_term_arena_block* next;
+  /* size of data area */
+  size_t size;
+  /* bytes of data area used */
+  size_t used;
+};
+
+struct raptor_term_arena_s {
+  raptor_world* world;
+
+  /* all blocks */
+  raptor_term_arena_block* blocks;
+  /* block currently allocated from or NULL */
+  raptor_term_arena_block* current;
+
+  /* URI references held by arena terms */
+  raptor_uri** uris;
+  int uris_count;
+  int uris_size;
+};
+
+#define RAPTOR_TERM_ARENA_ALIGN(n) (((n) + 7) & ~RAPTOR_GOOD_CAST(size_t, 7))
+#define RAPTOR_TERM_ARENA_BLOCK_SIZE 16384
+#define RAPTOR_TERM_ARENA_BLOCK_DATA(block) \
+  ((unsigned char*)(block) + RAPTOR_TERM_ARENA_ALIGN(sizeof(raptor_term_arena_block)))
+
+
+/*
+ * raptor_new_term_arena:
+ * @world: raptor world
+ *
+ * INTERNAL - Constructor - create a new term arena
+ *
+ * Return value: new arena or NULL on failure
+ */
+raptor_term_arena*
+raptor_new_term_arena(raptor_world* world)
+{
+  raptor_term_arena* arena;
+
+  arena = RAPTOR_CALLOC(raptor_term_arena*, 1, sizeof(*arena));
+  if(!arena)
+    return NULL;
+
+  arena->world = world;
+
+  return arena;
+}
+
+
+/*
+ * raptor_free_term_arena:
+ * @arena: term arena
+ *
+ * INTERNAL - Destructor - destroy a term arena and all terms in it
+ */
+void
+raptor_free_term_arena(raptor_term_arena* arena)
+{
+  raptor_term_arena_block* block;
+
+  if(!arena)
+    return;
+
+  raptor_term_arena_reset(arena);
+
+  while((block = arena->blocks)) {
+    arena->blocks = block->next;
+    RAPTOR_FREE(raptor_term_arena_block, block);
+  }
+
+  if(arena->uris)
+    RAPTOR_FREE(raptor_uri**, arena->uris);
+
+  RAPTOR_FREE(raptor_term_arena, arena);
+}
+
+
+/*
+ * raptor_term_arena_reset:
+ * @arena: term arena
+ *
+ * INTERNAL - Free all terms in the arena, keeping the memory for reuse
+ */
+void
+raptor_term_arena_reset(raptor_term_arena* arena)
+{
+  int i;
+
+  for(i = 0; i < arena->uris_count; i++)
+    raptor_free_uri(arena->uris[i]);
+  arena->uris_count = 0;
+
+  arena->current = arena->blocks;
+  if(arena->current)
+    arena->current->used = 0;
+}
+
+
+static void*
+raptor_term_arena_alloc(raptor_term_arena* arena, size_t size)
+{
+  raptor_term_arena_block* block = arena->current;
+  void* p;
+
+  size = RAPTOR_TERM_ARENA_ALIGN(size);
+
+  /* blocks after the current one are unused since the last reset */
+  while(block && block->used + size > block->size) {
+    block = block->next;
+    if(block)
+      block->used = 0;
+  }
+
+  if(!block) {
+    size_t block_size = RAPTOR_TERM_ARENA_BLOCK_SIZE;
+
+    if(size > block_size)
+      block_size = size;
+
+    block = (raptor_term_arena_block*)RAPTOR_MALLOC(void*, RAPTOR_TERM_ARENA_ALIGN(sizeof(*block)) + block_size);
+    if(!block)
+      return NULL;
+
+    block->size = block_size;
+    block->used = 0;
+    if(arena->current) {
+      block->next = arena->current->next;
+      arena->current->next = block;
+    } else {
+      block->next = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  arena->current = block;
+
+  p = RAPTOR_TERM_ARENA_BLOCK_DATA(block) + block->used;
+  block->used += size;
+
+  return p;
+}
+
+
+static unsigned char*
+raptor_term_arena_strdup(raptor_term_arena* arena,
+                         const unsigned char* string, size_t length)
+{
+  unsigned char* new_string;
+
+  new_string = (unsigned char*)raptor_term_arena_alloc(arena, length + 1);
+  if(!new_string)
+    return NULL;
+
+  if(length)
+    memcpy(new_string, string, length);
+  new_string[length] = '\0';
+
+  return new_string;
+}
+
+
+/* hold a reference to @uri until the arena is reset */
+static raptor_uri*
+raptor_term_arena_hold_uri(raptor_term_arena* arena, raptor_uri* uri)
+{
+  if(arena->uris_count == arena->uris_size) {
+    int new_size = arena->uris_size ? (arena->uris_size << 1) : 16;
+    raptor_uri** new_uris;
+
+    new_uris = RAPTOR_CALLOC(raptor_uri**, RAPTOR_GOOD_CAST(size_t, new_size),
+                             sizeof(raptor_uri*));
+    if(!new_uris)
+      return NULL;
+
+    if(arena->uris) {
+      memcpy(new_uris, arena->uris, sizeof(raptor_uri*) * RAPTOR_GOOD_CAST(size_t, arena->uris_count));
+      RAPTOR_FREE(raptor_uri**, arena->uris);
+    }
+    arena->uris = new_uris;
+    arena->uris_size = new_size;
+  }
+
+  uri = raptor_uri_copy(uri);
+  arena->uris[arena->uris_count++] = uri;
+
+  return uri;
+}
+
+
+static raptor_term*
+raptor_term_arena_new_term(raptor_term_arena* arena, raptor_term_type type)
+{
+  raptor_term* t;
+
+  t = (raptor_term*)raptor_term_arena_alloc(arena, sizeof(*t));
+  if(!t)
+    return NULL;
+
+  memset(t, '\0', sizeof(*t));
+  /* static - not usage counted */
+  t->usage = -1;
+  t->world = arena->world;
+  t->type = type;
+
+  return t;
+}
+
+
+/*
+ * raptor_term_arena_new_uri:
+ * @arena: term arena
+ * @uri: uri
+ *
+ * INTERNAL - Constructor - create a URI term in an arena
+ *
+ * Return value: new term or NULL on failure
+ */
+raptor_term*
+raptor_term_arena_new_uri(raptor_term_arena* arena, raptor_uri* uri)
+{
+  raptor_term* t;
+
+  if(!uri)
+    return NULL;
+
+  t = raptor_term_arena_new_term(arena, RAPTOR_TERM_TYPE_URI);
+  if(!t)
+    return NULL;
+
+  t->value.uri = raptor_term_arena_hold_uri(arena, uri);
+  if(!t->value.uri)
+    return NULL;
+
+  return t;
+}
+
+
+/*
+ * raptor_term_arena_new_literal:
+ * @arena: term arena
+ * @literal: UTF-8 encoded literal string (or NULL for empty literal)
+ * @literal_len: length of literal
+ * @datatype: literal datatype URI (or NULL)
+ * @language: literal language (or NULL for no language)
+ * @language_len: literal language length
+ *
+ * INTERNAL - Constructor - create a literal term in an arena
+ *
+ * Same arguments and checks as raptor_new_term_from_counted_literal()
+ *
+ * Return value: new term or NULL on failure
+ */
+raptor_term*
+raptor_term_arena_new_literal(raptor_term_arena* arena,
+                              const unsigned char* literal,
+                              size_t literal_len,
+                              raptor_uri* datatype,
+                              const unsigned char* language,
+                              unsigned char language_len)
+{
+  raptor_term* t;
+
+  if(language && !*language)
+    language = NULL;
+
+  if(language && datatype)
+    return NULL;
+
+  if(!literal || !*literal)
+    literal_len = 0;
+
+  t = raptor_term_arena_new_term(arena, RAPTOR_TERM_TYPE_LITERAL);
+  if(!t)
+    return NULL;
+
+  t->value.literal.string = raptor_term_arena_strdup(arena, literal,
+                                                     literal_len);
+  if(!t->value.literal.string)
+    return NULL;
+  t->value.literal.string_len = RAPTOR_LANG_LEN_FROM_INT(literal_len);
+
+  if(language) {
+    unsigned char* l;
+
+    l = raptor_term_arena_strdup(arena, language, language_len);
+    if(!l)
+      return NULL;
+    t->value.literal.language = l;
+    t->value.literal.language_len = language_len;
+
+    for(; *l; l++) {
+      if(*l == '_')
+        *l = '-';
+    }
+  }
+
+  if(datatype) {
+    t->value.literal.datatype = raptor_term_arena_hold_uri(arena, datatype);
+    if(!t->value.literal.datatype)
+      return NULL;
+  }
+
+  return t;
+}
+
+
+/*
+ * raptor_term_arena_new_blank:
+ * @arena: term arena
+ * @blank: UTF-8 encoded blank node identifier (or NULL)
+ * @length: length of identifier (or 0)
+ *
+ * INTERNAL - Constructor - create a blank node term in an arena
+ *
+ * If @blank is NULL, creates a new internal identifier as
+ * raptor_new_term_from_counted_blank() does.
+ *
+ * Return value: new term or NULL on failure
+ */
+raptor_term*
+raptor_term_arena_new_blank(raptor_term_arena* arena,
+                            const unsigned char* blank, size_t length)
+{
+  raptor_term* t;
+  unsigned char* new_id = NULL;
+
+  if(!blank) {
+    new_id = raptor_world_generate_bnodeid(arena->world);
+    if(!new_id)
+      return NULL;
+    blank = new_id;
+    length = strlen((const char*)new_id);
+  }
+
+  t = raptor_term_arena_new_term(arena, RAPTOR_TERM_TYPE_BLANK);
+  if(t) {
+    t->value.blank.string = raptor_term_arena_strdup(arena, blank, length);
+    t->value.blank.string_len = RAPTOR_BAD_CAST(int, length);
+    if(!t->value.blank.string)
+      t = NULL;
+  }
+
+  if(new_id)
+    RAPTOR_FREE(char*, new_id);
+
+  return t;
+}
+
+
 /**
  * raptor_term_to_counted_string:
  * @term: #raptor_term
@@ -791,9 +1192,12 @@ main(int argc, char *argv[])
   raptor_term* term3 = NULL; /* blank node 1 */
   raptor_term* term4 = NULL; /* URI string 2 */
   raptor_term* term5 = NULL; /* URI string 1 again */
+  raptor_term_arena* arena = NULL;
+  raptor_term* copies[3] = { NULL, NULL, NULL };
   raptor_uri* uri1;
   unsigned char* uri_str;
   size_t uri_len;
+  int i;
   
   
   world = raptor_new_world();
@@ -1017,9 +1421,63 @@ main(int argc, char *argv[])
     rc = 1;
     goto tidy;
   }
-  
+
+
+  /* check arena terms are promoted to the heap when copied */
+  arena = raptor_new_term_arena(world);
+  if(!arena) {
+    fprintf(stderr, "%s: raptor_new_term_arena() failed\n", program);
+    rc = 1;
+    goto tidy;
+  }
+  copies[0] = raptor_term_arena_new_uri(arena, term1->value.uri);
+  copies[1] = raptor_term_arena_new_literal(arena, literal_string1,
+                                            literal_string1_len, NULL,
+                                            language1, 2);
+  copies[2] = raptor_term_arena_new_blank(arena, bnodeid1, bnodeid1_len);
+  for(i = 0; i < 3; i++) {
+    raptor_term* arena_term = copies[i];
+
+    if(!arena_term || arena_term->usage >= 0) {
+      fprintf(stderr, "%s: arena term %d was not created unowned\n",
+              program, i);
+      copies[i] = NULL;
+      rc = 1;
+      continue;
+    }
+    copies[i] = raptor_term_copy(arena_term);
+    if(!copies[i] || copies[i] == arena_term || copies[i]->usage != 1 ||
+       !raptor_term_equals(copies[i], arena_term)) {
+      fprintf(stderr, "%s: copy of arena term %d was not a new equal term\n",
+              program, i);
+      rc = 1;
+    }
+    /* no-op for arena terms */
+    raptor_free_term(arena_term);
+  }
+  raptor_term_arena_reset(arena);
+  if(rc)
+    goto tidy;
+
+  /* copies must outlive the arena contents */
+  if(!raptor_term_equals(copies[0], term1) ||
+     copies[1]->value.literal.language_len != 2 ||
+     strcmp((const char*)copies[2]->value.blank.string,
+            (const char*)bnodeid1)) {
+    fprintf(stderr, "%s: copied arena terms changed after arena reset\n",
+            program);
+    rc = 1;
+    goto tidy;
+  }
+
 
   tidy:
+  for(i = 0; i < 3; i++) {
+    if(copies[i])
+      raptor_free_term(copies[i]);
+  }
+  if(arena)
+    raptor_free_term_arena(arena);
   if(term1)
     raptor_free_term(term1);
   if(term2)
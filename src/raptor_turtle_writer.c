@@ -603,11 +603,18 @@ raptor_turtle_writer_set_option(raptor_turtle_writer *turtle_writer,
     case RAPTOR_OPTION_NON_NFC_FATAL:
     case RAPTOR_OPTION_WARN_OTHER_PARSETYPES:
     case RAPTOR_OPTION_CHECK_RDF_ID:
+    case RAPTOR_OPTION_RDF_ID_FILTER_SIZE:
     case RAPTOR_OPTION_HTML_TAG_SOUP:
     case RAPTOR_OPTION_MICROFORMATS:
     case RAPTOR_OPTION_HTML_LINK:
     case RAPTOR_OPTION_WWW_TIMEOUT:
     case RAPTOR_OPTION_STRICT:
+    case RAPTOR_OPTION_STATEMENT_ARENA:
+    case RAPTOR_OPTION_PARSE_THREADS:
+    case RAPTOR_OPTION_PARSE_UNORDERED:
+    case RAPTOR_OPTION_WRITE_GROUPED:
+    case RAPTOR_OPTION_MEMORY_LIMIT:
+    case RAPTOR_OPTION_WRITE_THREADS:
       
     /* Shared */
     case RAPTOR_OPTION_NO_NET:
@@ -727,11 +734,18 @@ raptor_turtle_writer_get_option(raptor_turtle_writer *turtle_writer,
     case RAPTOR_OPTION_NON_NFC_FATAL:
     case RAPTOR_OPTION_WARN_OTHER_PARSETYPES:
     case RAPTOR_OPTION_CHECK_RDF_ID:
+    case RAPTOR_OPTION_RDF_ID_FILTER_SIZE:
     case RAPTOR_OPTION_HTML_TAG_SOUP:
     case RAPTOR_OPTION_MICROFORMATS:
     case RAPTOR_OPTION_HTML_LINK:
     case RAPTOR_OPTION_WWW_TIMEOUT:
     case RAPTOR_OPTION_STRICT:
+    case RAPTOR_OPTION_STATEMENT_ARENA:
+    case RAPTOR_OPTION_PARSE_THREADS:
+    case RAPTOR_OPTION_PARSE_UNORDERED:
+    case RAPTOR_OPTION_WRITE_GROUPED:
+    case RAPTOR_OPTION_MEMORY_LIMIT:
+    case RAPTOR_OPTION_WRITE_THREADS:
 
     /* Shared */
     case RAPTOR_OPTION_NO_NET:
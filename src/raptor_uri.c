@@ -82,11 +82,317 @@ struct raptor_uri_s {
   unsigned int length;
   /* usage count */
   int usage;
+  /* hash of string used by the world URI intern table */
+  unsigned int hash;
+  /* parsed string made when first used as a base URI or NULL */
+  raptor_uri_detail *detail;
 };
 
 
 #ifndef STANDALONE
 
+/*
+ * URI intern table
+ *
+ * Open addressing hash table with linear probing, keyed by the URI
+ * string.  Deletions in the current table shift later entries of the
+ * probe sequence back so no tombstones are left.
+ *
+ * When the table is 3/4 full a table of twice the size is allocated
+ * and the entries of the old table are moved across a few at a time
+ * on each insert or delete rather than all at once.  Entries already
+ * moved or deleted from the old table are marked with
+ * RAPTOR_URI_TABLE_MOVED so probe sequences in it are not broken.
+ *
+ * A thread-safe world has RAPTOR_URI_TABLE_SHARDS tables, chosen by
+ * the top bits of the URI hash, each with its own lock.  A URI's
+ * usage count only drops to 0 with the lock of its table held, so a
+ * lookup never returns a URI that is being freed.
+ */
+struct raptor_uri_table_s {
+  /* current table; size is a power of 2 */
+  raptor_uri **entries;
+  size_t size;
+  size_t count;
+
+  /* previous table being emptied into the current one or NULL */
+  raptor_uri **old_entries;
+  size_t old_size;
+  size_t old_count;
+  /* next index in old_entries to move */
+  size_t old_index;
+
+#ifdef RAPTOR_THREADS
+  /* held for all table use when the world is thread_safe */
+  pthread_mutex_t lock;
+#endif
+};
+
+#define RAPTOR_URI_TABLE_INITIAL_SIZE 256
+
+/* number of tables in a thread-safe world; a power of 2 up to 256 */
+#define RAPTOR_URI_TABLE_SHARDS 64
+
+/* number of old table buckets moved per insert/delete */
+#define RAPTOR_URI_TABLE_MOVE_STEP 8
+
+static raptor_uri raptor_uri_table_moved_marker;
+#define RAPTOR_URI_TABLE_MOVED (&raptor_uri_table_moved_marker)
+
+
+/*
+ * raptor_uri_hash_string:
+ * @string: string
+ * @length: length of string
+ *
+ * INTERNAL - Hash a URI string with FNV-1a
+ *
+ * URIs typically share long prefixes so every byte is mixed in.
+ *
+ * Return value: hash value
+ */
+static unsigned int
+raptor_uri_hash_string(const unsigned char *string, size_t length)
+{
+  unsigned int hash = 2166136261U;
+
+  while(length--) {
+    hash ^= *string++;
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+
+static raptor_uri_table*
+raptor_new_uri_tables(unsigned int count)
+{
+  raptor_uri_table* tables;
+  unsigned int i;
+
+  tables = RAPTOR_CALLOC(raptor_uri_table*, count, sizeof(*tables));
+  if(!tables)
+    return NULL;
+
+  for(i = 0; i < count; i++) {
+    raptor_uri_table* table = &tables[i];
+
+    table->size = RAPTOR_URI_TABLE_INITIAL_SIZE;
+    table->entries = RAPTOR_CALLOC(raptor_uri**, table->size,
+                                   sizeof(raptor_uri*));
+    if(!table->entries) {
+      while(i--)
+        RAPTOR_FREE(raptor_uri**, tables[i].entries);
+      RAPTOR_FREE(raptor_uri_table, tables);
+      return NULL;
+    }
+#ifdef RAPTOR_THREADS
+    pthread_mutex_init(&table->lock, NULL);
+#endif
+  }
+
+  return tables;
+}
+
+
+static void
+raptor_free_uri_tables(raptor_uri_table* tables, unsigned int count)
+{
+  unsigned int i;
+
+  for(i = 0; i < count; i++) {
+    raptor_uri_table* table = &tables[i];
+
+    if(table->old_entries)
+      RAPTOR_FREE(raptor_uri**, table->old_entries);
+    RAPTOR_FREE(raptor_uri**, table->entries);
+#ifdef RAPTOR_THREADS
+    pthread_mutex_destroy(&table->lock);
+#endif
+  }
+  RAPTOR_FREE(raptor_uri_table, tables);
+}
+
+
+/* intern table for a URI hash */
+#define RAPTOR_URI_TABLE(world, hash) \
+  (&(world)->uris_tables[((hash) >> 24) & ((world)->uris_tables_count - 1)])
+
+#ifdef RAPTOR_THREADS
+#define RAPTOR_URI_TABLE_LOCK(world, table) \
+  do { if((world)->thread_safe) pthread_mutex_lock(&(table)->lock); } while(0)
+#define RAPTOR_URI_TABLE_UNLOCK(world, table) \
+  do { if((world)->thread_safe) pthread_mutex_unlock(&(table)->lock); } while(0)
+#else
+#define RAPTOR_URI_TABLE_LOCK(world, table) do { } while(0)
+#define RAPTOR_URI_TABLE_UNLOCK(world, table) do { } while(0)
+#endif
+
+
+/* add a URI known not to be present to the current table */
+static void
+raptor_uri_table_store(raptor_uri_table* table, raptor_uri* uri)
+{
+  size_t mask = table->size - 1;
+  size_t i;
+
+  for(i = uri->hash & mask; table->entries[i]; i = (i + 1) & mask)
+    ;
+  table->entries[i] = uri;
+  table->count++;
+}
+
+
+/* move a few entries from the old table to the current table */
+static void
+raptor_uri_table_move_old(raptor_uri_table* table, size_t steps)
+{
+  while(table->old_entries && steps--) {
+    raptor_uri* uri = table->old_entries[table->old_index];
+
+    if(uri && uri != RAPTOR_URI_TABLE_MOVED) {
+      table->old_entries[table->old_index] = RAPTOR_URI_TABLE_MOVED;
+      table->old_count--;
+      raptor_uri_table_store(table, uri);
+    }
+
+    if(++table->old_index == table->old_size || !table->old_count) {
+      RAPTOR_FREE(raptor_uri**, table->old_entries);
+      table->old_entries = NULL;
+      table->old_size = 0;
+      table->old_count = 0;
+      table->old_index = 0;
+    }
+  }
+}
+
+
+static raptor_uri*
+raptor_uri_table_find(raptor_uri_table* table,
+                      const unsigned char *string, unsigned int length,
+                      unsigned int hash)
+{
+  raptor_uri* uri;
+  size_t mask = table->size - 1;
+  size_t i;
+
+  for(i = hash & mask; (uri = table->entries[i]); i = (i + 1) & mask) {
+    if(uri->hash == hash && uri->length == length &&
+       !memcmp(uri->string, string, length))
+      return uri;
+  }
+
+  if(table->old_entries) {
+    mask = table->old_size - 1;
+    for(i = hash & mask; (uri = table->old_entries[i]); i = (i + 1) & mask) {
+      if(uri != RAPTOR_URI_TABLE_MOVED &&
+         uri->hash == hash && uri->length == length &&
+         !memcmp(uri->string, string, length))
+        return uri;
+    }
+  }
+
+  return NULL;
+}
+
+
+/*
+ * raptor_uri_table_add:
+ * @table: URI table
+ * @uri: URI not already in table
+ *
+ * INTERNAL - Add a URI to the intern table, growing it if needed
+ *
+ * Return value: non-0 on failure
+ */
+static int
+raptor_uri_table_add(raptor_uri_table* table, raptor_uri* uri)
+{
+  raptor_uri_table_move_old(table, RAPTOR_URI_TABLE_MOVE_STEP);
+
+  if((table->count + table->old_count + 1) * 4 > table->size * 3) {
+    raptor_uri** new_entries;
+    size_t new_size = table->size << 1;
+
+    /* cannot normally happen: moving finishes long before the next grow */
+    raptor_uri_table_move_old(table, table->old_size);
+
+    new_entries = RAPTOR_CALLOC(raptor_uri**, new_size, sizeof(raptor_uri*));
+    if(!new_entries)
+      return 1;
+
+    table->old_entries = table->entries;
+    table->old_size = table->size;
+    table->old_count = table->count;
+    table->old_index = 0;
+
+    table->entries = new_entries;
+    table->size = new_size;
+    table->count = 0;
+  }
+
+  raptor_uri_table_store(table, uri);
+
+  return 0;
+}
+
+
+/*
+ * raptor_uri_table_delete:
+ * @table: URI table
+ * @uri: URI
+ *
+ * INTERNAL - Remove a URI from the intern table (does not free it)
+ */
+static void
+raptor_uri_table_delete(raptor_uri_table* table, raptor_uri* uri)
+{
+  size_t mask = table->size - 1;
+  size_t i;
+
+  for(i = uri->hash & mask; table->entries[i]; i = (i + 1) & mask) {
+    if(table->entries[i] == uri) {
+      size_t j = i;
+
+      /* shift back following entries that probed past the hole */
+      while(1) {
+        size_t k;
+
+        j = (j + 1) & mask;
+        if(!table->entries[j])
+          break;
+
+        k = table->entries[j]->hash & mask;
+        if((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+          continue;
+
+        table->entries[i] = table->entries[j];
+        i = j;
+      }
+      table->entries[i] = NULL;
+      table->count--;
+
+      raptor_uri_table_move_old(table, RAPTOR_URI_TABLE_MOVE_STEP);
+      return;
+    }
+  }
+
+  if(table->old_entries) {
+    mask = table->old_size - 1;
+    for(i = uri->hash & mask; table->old_entries[i]; i = (i + 1) & mask) {
+      if(table->old_entries[i] == uri) {
+        table->old_entries[i] = RAPTOR_URI_TABLE_MOVED;
+        table->old_count--;
+        break;
+      }
+    }
+
+    raptor_uri_table_move_old(table, RAPTOR_URI_TABLE_MOVE_STEP);
+  }
+}
+
+
 /**
  * raptor_new_uri_from_counted_string:
  * @world: raptor_world object
@@ -107,6 +413,8 @@ raptor_new_uri_from_counted_string(raptor_world* world,
 {
   raptor_uri* new_uri;
   unsigned char *new_string;
+  unsigned int hash;
+  raptor_uri_table* table = NULL;
   
   RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
 
@@ -115,24 +423,22 @@ raptor_new_uri_from_counted_string(raptor_world* world,
 
   raptor_world_open(world);
 
-  if(world->uris_tree) {
-    raptor_uri key; /* on stack - not allocated */
-
-    /* just to be safe */
-    memset(&key, 0, sizeof(key));
+  hash = raptor_uri_hash_string(uri_string, length);
 
-    key.string = (unsigned char*)uri_string;
-    key.length = (unsigned int)length;
+  if(world->uris_tables) {
+    table = RAPTOR_URI_TABLE(world, hash);
+    RAPTOR_URI_TABLE_LOCK(world, table);
 
-    /* if existing URI found in tree, return it */
-    new_uri = (raptor_uri*)raptor_avltree_search(world->uris_tree, &key);
+    /* if existing URI found in table, return it */
+    new_uri = raptor_uri_table_find(table, uri_string,
+                                    (unsigned int)length, hash);
     if(new_uri) {
 #if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
       RAPTOR_DEBUG3("Found existing URI %s with current usage %d\n",
                     uri_string, new_uri->usage);
 #endif
       
-      new_uri->usage++;
+      RAPTOR_WORLD_INCREMENT(world, &new_uri->usage);
       
       goto unlock;
     }
@@ -153,6 +459,7 @@ raptor_new_uri_from_counted_string(raptor_world* world,
 
   new_uri->world = world;
   new_uri->length = (unsigned int)length;
+  new_uri->hash = hash;
 
   new_string = RAPTOR_MALLOC(unsigned char*, length + 1);
   if(!new_string) {
@@ -167,9 +474,9 @@ raptor_new_uri_from_counted_string(raptor_world* world,
 
   new_uri->usage = 1; /* for user */
 
-  /* store in tree */
-  if(world->uris_tree) {
-    if(raptor_avltree_add(world->uris_tree, new_uri)) {
+  /* store in table */
+  if(table) {
+    if(raptor_uri_table_add(table, new_uri)) {
       RAPTOR_FREE(char*, new_string);
       RAPTOR_FREE(raptor_uri, new_uri);
       new_uri = NULL;
@@ -177,6 +484,8 @@ raptor_new_uri_from_counted_string(raptor_world* world,
   }
 
  unlock:
+  if(table)
+    RAPTOR_URI_TABLE_UNLOCK(world, table);
 
   return new_uri;
 }
@@ -254,6 +563,54 @@ raptor_new_uri_from_uri_local_name(raptor_world* world, raptor_uri *uri,
 }
 
 
+/* resolved URIs up to this length are built on the stack */
+#define RAPTOR_URI_RESOLVE_BUFFER_SIZE 1024
+
+/*
+ * raptor_uri_get_detail:
+ * @uri: URI
+ *
+ * INTERNAL - get the parsed form of a URI, parsing it on first use
+ *
+ * The same #raptor_uri may be used as a base URI by several threads
+ * of a thread-safe world; the first parsed form stored is kept.
+ *
+ * Return value: shared #raptor_uri_detail or NULL on failure
+ */
+static raptor_uri_detail*
+raptor_uri_get_detail(raptor_uri* uri)
+{
+  raptor_uri_detail* detail;
+
+#ifdef RAPTOR_THREADS
+  if(uri->world->thread_safe) {
+    raptor_uri_detail* expected = NULL;
+
+    detail = RAPTOR_ATOMIC_LOAD(&uri->detail);
+    if(detail)
+      return detail;
+
+    detail = raptor_new_uri_detail(uri->string);
+    /* the CAS may fail spuriously with expected still NULL */
+    while(detail && !RAPTOR_ATOMIC_CAS(&uri->detail, &expected, detail)) {
+      if(expected) {
+        raptor_free_uri_detail(detail);
+        detail = expected;
+        break;
+      }
+    }
+    return detail;
+  }
+#endif
+
+  if(!uri->detail)
+    uri->detail = raptor_new_uri_detail(uri->string);
+  detail = uri->detail;
+
+  return detail;
+}
+
+
 /**
  * raptor_new_uri_relative_to_base_counted:
  * @world: raptor_world object
@@ -271,7 +628,8 @@ raptor_new_uri_relative_to_base_counted(raptor_world* world,
                                         const unsigned char *uri_string,
                                         size_t uri_len)
 {
-  unsigned char *buffer;
+  unsigned char stack_buffer[RAPTOR_URI_RESOLVE_BUFFER_SIZE];
+  unsigned char *buffer = stack_buffer;
   size_t buffer_length;
   raptor_uri* new_uri;
   size_t actual_length;
@@ -292,15 +650,20 @@ raptor_new_uri_relative_to_base_counted(raptor_world* world,
   
   /* +1 for adding any missing URI path '/' */
   buffer_length = base_uri->length + uri_len + 1;
-  buffer = RAPTOR_MALLOC(unsigned char*, buffer_length + 1);
-  if(!buffer)
-    return NULL;
+  if(buffer_length >= RAPTOR_URI_RESOLVE_BUFFER_SIZE) {
+    buffer = RAPTOR_MALLOC(unsigned char*, buffer_length + 1);
+    if(!buffer)
+      return NULL;
+  }
   
-  actual_length = raptor_uri_resolve_uri_reference(base_uri->string, uri_string,
-                                                   buffer, buffer_length);
+  actual_length = raptor_uri_resolve_uri_reference_detail(base_uri->string,
+                                                          raptor_uri_get_detail(base_uri),
+                                                          uri_string, uri_len,
+                                                          buffer, buffer_length);
 
   new_uri = raptor_new_uri_from_counted_string(world, buffer, actual_length);
-  RAPTOR_FREE(char*, buffer);
+  if(buffer != stack_buffer)
+    RAPTOR_FREE(char*, buffer);
   return new_uri;
 }
 
@@ -344,8 +707,9 @@ raptor_uri*
 raptor_new_uri_from_id(raptor_world *world, raptor_uri *base_uri,
                        const unsigned char *id) 
 {
+  unsigned char stack_buffer[RAPTOR_URI_RESOLVE_BUFFER_SIZE];
   raptor_uri *new_uri;
-  unsigned char *local_name;
+  unsigned char *local_name = stack_buffer;
   size_t len;
 
   RAPTOR_CHECK_CONSTRUCTOR_WORLD(world);
@@ -361,15 +725,19 @@ raptor_new_uri_from_id(raptor_world *world, raptor_uri *base_uri,
 
   len = strlen((char*)id);
   /* "#id\0" */
-  local_name = RAPTOR_MALLOC(unsigned char*, len + 1 + 1);
-  if(!local_name)
-    return NULL;
+  if(len + 1 + 1 > RAPTOR_URI_RESOLVE_BUFFER_SIZE) {
+    local_name = RAPTOR_MALLOC(unsigned char*, len + 1 + 1);
+    if(!local_name)
+      return NULL;
+  }
 
   *local_name = '#';
   memcpy(local_name + 1, id, len + 1); /* len+1 to copy NUL */
 
-  new_uri = raptor_new_uri_relative_to_base(world, base_uri, local_name);
-  RAPTOR_FREE(char*, local_name);
+  new_uri = raptor_new_uri_relative_to_base_counted(world, base_uri,
+                                                    local_name, len + 1);
+  if(local_name != stack_buffer)
+    RAPTOR_FREE(char*, local_name);
   return new_uri;
 }
 
@@ -481,24 +849,49 @@ raptor_new_uri_from_uri_or_file_string(raptor_world* world,
 void
 raptor_free_uri(raptor_uri *uri)
 {
+  raptor_world* world;
+  raptor_uri_table* table = NULL;
+
   if(!uri)
     return;
 
-  uri->usage--;
-  
-#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-  RAPTOR_DEBUG3("URI %s usage count now %d\n", uri->string, uri->usage);
+  world = uri->world;
+
+#ifdef RAPTOR_THREADS
+  if(world->thread_safe) {
+    int usage = RAPTOR_ATOMIC_LOAD(&uri->usage);
+
+    /* drop a reference that is not the last without locking */
+    while(usage > 1) {
+      if(RAPTOR_ATOMIC_CAS(&uri->usage, &usage, usage - 1))
+        return;
+    }
+  }
 #endif
 
+  if(world->uris_tables) {
+    table = RAPTOR_URI_TABLE(world, uri->hash);
+    RAPTOR_URI_TABLE_LOCK(world, table);
+  }
+
   /* decrement usage, don't free if not 0 yet*/
-  if(uri->usage > 0) {
+  if(RAPTOR_WORLD_DECREMENT(world, &uri->usage) > 0) {
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+    RAPTOR_DEBUG3("URI %s usage count now %d\n", uri->string, uri->usage);
+#endif
+    if(table)
+      RAPTOR_URI_TABLE_UNLOCK(world, table);
     return;
   }
 
   /* this does not free the uri */
-  if(uri->world->uris_tree)
-    raptor_avltree_delete(uri->world->uris_tree, uri);
+  if(table) {
+    raptor_uri_table_delete(table, uri);
+    RAPTOR_URI_TABLE_UNLOCK(world, table);
+  }
 
+  if(uri->detail)
+    raptor_free_uri_detail(uri->detail);
   if(uri->string)
     RAPTOR_FREE(char*, uri->string);
   RAPTOR_FREE(raptor_uri, uri);
@@ -588,7 +981,7 @@ raptor_uri_copy(raptor_uri *uri)
 {
   RAPTOR_ASSERT_OBJECT_POINTER_RETURN_VALUE(uri, raptor_uri, NULL);
   
-  uri->usage++;
+  RAPTOR_WORLD_INCREMENT(uri->world, &uri->usage);
   return uri;
 }
 
@@ -1171,15 +1564,18 @@ raptor_new_uri_for_retrieval(raptor_uri* old_uri)
 int
 raptor_uri_init(raptor_world* world)
 {
-  if(world->uri_interning && !world->uris_tree) {
-    world->uris_tree = raptor_new_avltree((raptor_data_compare_handler)raptor_uri_compare,
-                                          /* free */ NULL, 0);
-    if(!world->uris_tree) {
+  if(world->uri_interning && !world->uris_tables) {
+    unsigned int count = world->thread_safe ? RAPTOR_URI_TABLE_SHARDS : 1;
+
+    world->uris_tables = raptor_new_uri_tables(count);
+    if(world->uris_tables)
+      world->uris_tables_count = count;
+    else {
 #ifdef RAPTOR_DEBUG
-      RAPTOR_FATAL1("Failed to create raptor URI avltree");
+      RAPTOR_FATAL1("Failed to create raptor URI table");
 #else
       raptor_log_error(world, RAPTOR_LOG_LEVEL_ERROR, NULL,
-                       "Failed to create raptor URI avltree");
+                       "Failed to create raptor URI table");
 #endif
     }
     
@@ -1192,9 +1588,10 @@ raptor_uri_init(raptor_world* world)
 void
 raptor_uri_finish(raptor_world* world)
 {
-  if(world->uris_tree) {
-    raptor_free_avltree(world->uris_tree);
-    world->uris_tree = NULL;
+  if(world->uris_tables) {
+    raptor_free_uri_tables(world->uris_tables, world->uris_tables_count);
+    world->uris_tables = NULL;
+    world->uris_tables_count = 0;
   }
 }
 
@@ -1667,6 +2064,21 @@ raptor_uri_get_world(raptor_uri *uri)
 }
 
 
+/*
+ * raptor_uri_get_hash:
+ * @uri: #raptor_uri object
+ *
+ * INTERNAL - Get the FNV-1a hash of the URI string computed at construction
+ *
+ * Return value: hash value
+ */
+unsigned int
+raptor_uri_get_hash(raptor_uri *uri)
+{
+  return uri->hash;
+}
+
+
 /**
  * raptor_uri_filename_exists:
  * @path: file path
@@ -1920,6 +2332,123 @@ assert_uri_to_relative(raptor_world *world, const char *base, const char *uri, c
 }
 
 
+#ifdef RAPTOR_THREADS
+#define THREAD_TEST_THREADS 8
+#define THREAD_TEST_URIS 2000
+#define THREAD_TEST_ROUNDS 20
+
+typedef struct {
+  raptor_world* world;
+  /* URIs for even numbers held for the whole test */
+  raptor_uri** pinned;
+  int failures;
+} thread_test_state;
+
+
+/* Intern, copy and free URIs and terms shared with the other threads.
+ * URIs for odd numbers are only held briefly so their usage counts
+ * keep dropping to 0 while other threads are looking them up.
+ */
+static void*
+thread_test_run(void* arg)
+{
+  thread_test_state* state = (thread_test_state*)arg;
+  char buffer[40];
+  int round;
+  int j;
+
+  for(round = 0; round < THREAD_TEST_ROUNDS; round++) {
+    for(j = 0; j < THREAD_TEST_URIS; j++) {
+      raptor_uri* u;
+      raptor_uri* u2;
+      raptor_term* t;
+      raptor_term* t2;
+
+      snprintf(buffer, sizeof(buffer), "http://example.org/thread/%d", j);
+      u = raptor_new_uri(state->world, (const unsigned char*)buffer);
+      if(!u || strcmp((const char*)raptor_uri_as_string(u), buffer) ||
+         (!(j & 1) && u != state->pinned[j])) {
+        state->failures++;
+        if(u)
+          raptor_free_uri(u);
+        continue;
+      }
+
+      u2 = raptor_uri_copy(u);
+      t = raptor_new_term_from_uri(state->world, u2);
+      t2 = raptor_term_copy(t);
+      raptor_free_uri(u);
+      raptor_free_uri(u2);
+      raptor_free_term(t);
+      raptor_free_term(t2);
+    }
+  }
+
+  return NULL;
+}
+
+
+static int
+thread_test(void)
+{
+  raptor_world *world;
+  thread_test_state states[THREAD_TEST_THREADS];
+  pthread_t threads[THREAD_TEST_THREADS];
+  raptor_uri** pinned;
+  char buffer[40];
+  int failures = 0;
+  int i;
+
+  world = raptor_new_world();
+  if(!world ||
+     raptor_world_set_flag(world, RAPTOR_WORLD_FLAG_THREAD_SAFE, 1) ||
+     raptor_world_open(world))
+    return 1;
+
+  pinned = RAPTOR_CALLOC(raptor_uri**, THREAD_TEST_URIS, sizeof(raptor_uri*));
+  if(!pinned)
+    return 1;
+
+  for(i = 0; i < THREAD_TEST_URIS; i += 2) {
+    snprintf(buffer, sizeof(buffer), "http://example.org/thread/%d", i);
+    pinned[i] = raptor_new_uri(world, (const unsigned char*)buffer);
+  }
+
+  for(i = 0; i < THREAD_TEST_THREADS; i++) {
+    states[i].world = world;
+    states[i].pinned = pinned;
+    states[i].failures = 0;
+    if(pthread_create(&threads[i], NULL, thread_test_run, &states[i]))
+      return 1;
+  }
+
+  for(i = 0; i < THREAD_TEST_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    if(states[i].failures) {
+      fprintf(stderr, "%s: thread %d FAILED to intern %d URIs\n",
+              program, i, states[i].failures);
+      failures++;
+    }
+  }
+
+  for(i = 0; i < THREAD_TEST_URIS; i += 2) {
+    /* only the pinned reference should be left */
+    if(pinned[i]->usage != 1) {
+      fprintf(stderr, "%s: URI %s FAILED with usage %d after threads\n",
+              program, raptor_uri_as_string(pinned[i]), pinned[i]->usage);
+      failures++;
+    }
+    raptor_free_uri(pinned[i]);
+  }
+  RAPTOR_FREE(raptor_uri**, pinned);
+
+  raptor_free_world(world);
+
+  return failures;
+}
+#endif
+
+
 int
 main(int argc, char *argv[]) 
 {
@@ -2091,8 +2620,58 @@ main(int argc, char *argv[])
     raptor_free_uri(u2);
   }
 
+  if(1) {
+    /* Enough URIs to grow the intern table several times, freeing
+     * some while it is being resized */
+#define INTERN_URI_COUNT 5000
+    raptor_uri** uris;
+    char buffer[40];
+    int j;
+
+    uris = RAPTOR_CALLOC(raptor_uri**, INTERN_URI_COUNT, sizeof(raptor_uri*));
+    if(!uris)
+      exit(1);
+
+    for(j = 0; j < INTERN_URI_COUNT; j++) {
+      snprintf(buffer, sizeof(buffer), "http://example.org/intern/%d", j);
+      uris[j] = raptor_new_uri(world, (const unsigned char*)buffer);
+      if(j && !(j % 3)) {
+        raptor_free_uri(uris[j - 1]);
+        uris[j - 1] = NULL;
+      }
+    }
+
+    for(j = 0; j < INTERN_URI_COUNT; j++) {
+      raptor_uri* u;
+
+      snprintf(buffer, sizeof(buffer), "http://example.org/intern/%d", j);
+      u = raptor_new_uri(world, (const unsigned char*)buffer);
+      if(uris[j] && u != uris[j]) {
+        fprintf(stderr, "%s: interned URI %s FAILED to return same object\n",
+                program, buffer);
+        failures++;
+      }
+      if(strcmp((const char*)raptor_uri_as_string(u), buffer)) {
+        fprintf(stderr, "%s: interned URI %s FAILED gave %s\n",
+                program, buffer, raptor_uri_as_string(u));
+        failures++;
+      }
+      raptor_free_uri(u);
+    }
+
+    for(j = 0; j < INTERN_URI_COUNT; j++) {
+      if(uris[j])
+        raptor_free_uri(uris[j]);
+    }
+    RAPTOR_FREE(raptor_uri**, uris);
+  }
+
   raptor_free_world(world);
 
+#ifdef RAPTOR_THREADS
+  failures += thread_test();
+#endif
+
   return failures ;
 }
 
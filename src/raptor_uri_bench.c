@@ -0,0 +1,454 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_uri_bench.c - Raptor URI interning benchmark
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Compares the world URI intern table against an AVL tree keyed on
+ * the URI string, the way URIs were interned before.  For each count
+ * of distinct URIs it times adding them all, looking them all up
+ * again in a scattered order and releasing them.
+ *
+ * When raptor is built with thread support it then measures how a
+ * thread-safe world scales with 1, 2, 4 and 8 threads: all threads
+ * looking up and copying the same interned URIs, and all threads
+ * adding and freeing URIs of their own.
+ *
+ * Usage: raptor_uri_bench [COUNT...]
+ * Default counts are 1000000 10000000 50000000 - the largest needs
+ * several gigabytes of memory.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+#ifdef RAPTOR_THREADS
+#include <sys/time.h>
+#endif
+
+
+int main(int argc, char *argv[]);
+
+
+static const char *program;
+
+#define BENCH_URI_BUFFER_LEN 64
+
+
+/* AVL tree key: same ordering as raptor_uri_compare() */
+typedef struct {
+  unsigned char *string;
+  size_t length;
+  int usage;
+} bench_key;
+
+
+static int
+bench_key_compare(const void* a, const void* b)
+{
+  const bench_key* k1 = (const bench_key*)a;
+  const bench_key* k2 = (const bench_key*)b;
+  size_t len = (k1->length > k2->length) ? k2->length : k1->length;
+  int result = memcmp(k1->string, k2->string, len);
+
+  if(!result)
+    result = (k1->length > k2->length) - (k1->length < k2->length);
+  return result;
+}
+
+
+static void
+bench_free_key(void* data)
+{
+  bench_key* key = (bench_key*)data;
+
+  RAPTOR_FREE(char*, key->string);
+  RAPTOR_FREE(bench_key, key);
+}
+
+
+static size_t
+bench_uri_string(unsigned char *buffer, unsigned long i)
+{
+  return (size_t)snprintf((char*)buffer, BENCH_URI_BUFFER_LEN,
+                          "http://example.org/resource/%lu", i);
+}
+
+
+/* visit 0..count-1 in a scattered order; BENCH_STRIDE is prime */
+#define BENCH_STRIDE 2654435761UL
+#define BENCH_SCATTER(i, count) \
+  ((unsigned long)(((unsigned long long)(i) * BENCH_STRIDE) % (count)))
+
+
+static double
+bench_seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+static int
+bench_table(unsigned long count)
+{
+  raptor_world* world;
+  raptor_uri** uris;
+  unsigned char buffer[BENCH_URI_BUFFER_LEN];
+  unsigned long i;
+  clock_t start;
+  double add_time, find_time, free_time;
+
+  uris = RAPTOR_CALLOC(raptor_uri**, count, sizeof(raptor_uri*));
+  if(!uris)
+    return 1;
+
+  world = raptor_new_world();
+  if(!world || raptor_world_open(world))
+    return 1;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    size_t len = bench_uri_string(buffer, i);
+    uris[i] = raptor_new_uri_from_counted_string(world, buffer, len);
+    if(!uris[i])
+      return 1;
+  }
+  add_time = bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    unsigned long j = BENCH_SCATTER(i, count);
+    size_t len = bench_uri_string(buffer, j);
+    raptor_uri* uri = raptor_new_uri_from_counted_string(world, buffer, len);
+    if(uri != uris[j]) {
+      fprintf(stderr, "%s: URI %s was not interned\n", program, buffer);
+      return 1;
+    }
+    raptor_free_uri(uri);
+  }
+  find_time = bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++)
+    raptor_free_uri(uris[i]);
+  free_time = bench_seconds(start);
+
+  raptor_free_world(world);
+  RAPTOR_FREE(raptor_uri**, uris);
+
+  fprintf(stdout, "%-6s %10lu  add %8.3fs  find %8.3fs  free %8.3fs\n",
+          "hash", count, add_time, find_time, free_time);
+  return 0;
+}
+
+
+static int
+bench_avltree(unsigned long count)
+{
+  raptor_avltree* tree;
+  bench_key** keys;
+  bench_key search;
+  unsigned char buffer[BENCH_URI_BUFFER_LEN];
+  unsigned long i;
+  clock_t start;
+  double add_time, find_time, free_time;
+
+  keys = RAPTOR_CALLOC(bench_key**, count, sizeof(bench_key*));
+  if(!keys)
+    return 1;
+
+  tree = raptor_new_avltree(bench_key_compare, NULL, 0);
+  if(!tree)
+    return 1;
+
+  search.string = buffer;
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    bench_key* key;
+
+    search.length = bench_uri_string(buffer, i);
+    key = (bench_key*)raptor_avltree_search(tree, &search);
+    if(key) {
+      key->usage++;
+    } else {
+      key = RAPTOR_MALLOC(bench_key*, sizeof(*key));
+      if(!key)
+        return 1;
+      key->string = RAPTOR_MALLOC(unsigned char*, search.length + 1);
+      if(!key->string)
+        return 1;
+      memcpy(key->string, buffer, search.length + 1);
+      key->length = search.length;
+      key->usage = 1;
+      if(raptor_avltree_add(tree, key))
+        return 1;
+    }
+    keys[i] = key;
+  }
+  add_time = bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    unsigned long j = BENCH_SCATTER(i, count);
+    bench_key* key;
+
+    search.length = bench_uri_string(buffer, j);
+    key = (bench_key*)raptor_avltree_search(tree, &search);
+    if(key != keys[j]) {
+      fprintf(stderr, "%s: URI %s was not found\n", program, buffer);
+      return 1;
+    }
+  }
+  find_time = bench_seconds(start);
+
+  start = clock();
+  for(i = 0; i < count; i++) {
+    if(!--keys[i]->usage) {
+      raptor_avltree_delete(tree, keys[i]);
+      bench_free_key(keys[i]);
+    }
+  }
+  free_time = bench_seconds(start);
+
+  raptor_free_avltree(tree);
+  RAPTOR_FREE(bench_key**, keys);
+
+  fprintf(stdout, "%-6s %10lu  add %8.3fs  find %8.3fs  free %8.3fs\n",
+          "avl", count, add_time, find_time, free_time);
+  return 0;
+}
+
+
+#ifdef RAPTOR_THREADS
+#define BENCH_MAX_THREADS 8
+
+typedef struct {
+  raptor_world* world;
+  raptor_uri** uris;
+  unsigned long count;
+  unsigned long first;
+  unsigned long last;
+  int id;
+  int failed;
+} bench_thread_state;
+
+
+static double
+bench_wall_seconds(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
+
+
+/* look up and copy shared URIs as a parser making terms would */
+static void*
+bench_thread_find(void* arg)
+{
+  bench_thread_state* state = (bench_thread_state*)arg;
+  unsigned char buffer[BENCH_URI_BUFFER_LEN];
+  unsigned long i;
+
+  for(i = state->first; i < state->last; i++) {
+    unsigned long j = BENCH_SCATTER(i, state->count);
+    size_t len = bench_uri_string(buffer, j);
+    raptor_uri* uri;
+    raptor_term* term;
+
+    uri = raptor_new_uri_from_counted_string(state->world, buffer, len);
+    if(uri != state->uris[j]) {
+      state->failed = 1;
+      break;
+    }
+    term = raptor_new_term_from_uri(state->world, uri);
+    raptor_free_term(raptor_term_copy(term));
+    raptor_free_term(term);
+    raptor_free_uri(uri);
+  }
+
+  return NULL;
+}
+
+
+/* add and free URIs that no other thread uses */
+static void*
+bench_thread_add(void* arg)
+{
+  bench_thread_state* state = (bench_thread_state*)arg;
+  unsigned char buffer[BENCH_URI_BUFFER_LEN];
+  unsigned long i;
+
+  for(i = state->first; i < state->last; i++) {
+    size_t len;
+    raptor_uri* uri;
+
+    len = (size_t)snprintf((char*)buffer, BENCH_URI_BUFFER_LEN,
+                           "http://example.org/thread/%d/%lu",
+                           state->id, i);
+    uri = raptor_new_uri_from_counted_string(state->world, buffer, len);
+    if(!uri) {
+      state->failed = 1;
+      break;
+    }
+    raptor_free_uri(uri);
+  }
+
+  return NULL;
+}
+
+
+static int
+bench_threads_run(raptor_world* world, raptor_uri** uris,
+                  unsigned long count, int threads_count,
+                  void* (*run)(void*), double* seconds)
+{
+  bench_thread_state states[BENCH_MAX_THREADS];
+  pthread_t threads[BENCH_MAX_THREADS];
+  double start;
+  int failed = 0;
+  int i;
+
+  start = bench_wall_seconds();
+  for(i = 0; i < threads_count; i++) {
+    states[i].world = world;
+    states[i].uris = uris;
+    states[i].count = count;
+    states[i].first = count * (unsigned long)i / (unsigned long)threads_count;
+    states[i].last = count * (unsigned long)(i + 1) / (unsigned long)threads_count;
+    states[i].id = i;
+    states[i].failed = 0;
+    if(pthread_create(&threads[i], NULL, run, &states[i]))
+      return 1;
+  }
+
+  for(i = 0; i < threads_count; i++) {
+    pthread_join(threads[i], NULL);
+    failed |= states[i].failed;
+  }
+  *seconds = bench_wall_seconds() - start;
+
+  return failed;
+}
+
+
+static int
+bench_threads(unsigned long count)
+{
+  raptor_world* world;
+  raptor_uri** uris;
+  unsigned char buffer[BENCH_URI_BUFFER_LEN];
+  unsigned long i;
+  int threads_count;
+
+  uris = RAPTOR_CALLOC(raptor_uri**, count, sizeof(raptor_uri*));
+  if(!uris)
+    return 1;
+
+  world = raptor_new_world();
+  if(!world ||
+     raptor_world_set_flag(world, RAPTOR_WORLD_FLAG_THREAD_SAFE, 1) ||
+     raptor_world_open(world))
+    return 1;
+
+  for(i = 0; i < count; i++) {
+    size_t len = bench_uri_string(buffer, i);
+    uris[i] = raptor_new_uri_from_counted_string(world, buffer, len);
+    if(!uris[i])
+      return 1;
+  }
+
+  for(threads_count = 1; threads_count <= BENCH_MAX_THREADS;
+      threads_count <<= 1) {
+    double find_time, add_time;
+
+    if(bench_threads_run(world, uris, count, threads_count,
+                         bench_thread_find, &find_time) ||
+       bench_threads_run(world, uris, count, threads_count,
+                         bench_thread_add, &add_time))
+      return 1;
+
+    fprintf(stdout,
+            "%-6s %10lu  threads %d  find %8.2f Mops/s  add %8.2f Mops/s\n",
+            "shared", count, threads_count,
+            (double)count / find_time / 1000000.0,
+            (double)count / add_time / 1000000.0);
+  }
+
+  for(i = 0; i < count; i++)
+    raptor_free_uri(uris[i]);
+
+  raptor_free_world(world);
+  RAPTOR_FREE(raptor_uri**, uris);
+
+  return 0;
+}
+#endif
+
+
+int
+main(int argc, char *argv[])
+{
+  static const char* default_counts[4] = {
+    "1000000", "10000000", "50000000", NULL
+  };
+  const char* const* counts;
+  int i;
+
+  program = raptor_basename(argv[0]);
+
+  counts = (argc > 1) ? (const char* const*)&argv[1] : default_counts;
+
+  for(i = 0; counts[i]; i++) {
+    unsigned long count = strtoul(counts[i], NULL, 10);
+
+    if(!count) {
+      fprintf(stderr, "%s: Bad count '%s'\n", program, counts[i]);
+      return 1;
+    }
+
+    if(bench_table(count) || bench_avltree(count)) {
+      fprintf(stderr, "%s: Benchmark failed for %lu URIs\n", program, count);
+      return 1;
+    }
+
+#ifdef RAPTOR_THREADS
+    if(bench_threads(count)) {
+      fprintf(stderr, "%s: Thread benchmark failed for %lu URIs\n",
+              program, count);
+      return 1;
+    }
+#endif
+  }
+
+  return 0;
+}
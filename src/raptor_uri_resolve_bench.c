@@ -0,0 +1,189 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * raptor_uri_resolve_bench.c - Raptor relative URI resolution benchmark
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Measures how many relative URI references per second are resolved
+ * against one base URI, for each of the common forms of reference.
+ *
+ * "string" resolves against the base URI string with
+ * raptor_uri_resolve_uri_reference() into an allocated buffer which
+ * is then interned, the way raptor_new_uri_relative_to_base() used to
+ * work.  "uri" calls raptor_new_uri_relative_to_base_counted() which
+ * uses the parsed form kept with the base #raptor_uri.
+ *
+ * Usage: raptor_uri_resolve_bench [COUNT]
+ * Default count is 1000000 resolutions of each form.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+int main(int argc, char *argv[]);
+
+
+static const char *program;
+
+#define BENCH_BASE_URI "http://example.org/data/2013/graph/doc.rdf"
+
+#define BENCH_REFERENCE_BUFFER_LEN 64
+
+/* reference forms; %lu is replaced by the iteration number */
+static const char* const bench_forms[] = {
+  "#id%lu",
+  "item%lu",
+  "../item%lu",
+  "../../other/item%lu#x",
+  "?page=%lu",
+  "/root/item%lu",
+  "http://example.com/item%lu",
+  NULL
+};
+
+
+static double
+bench_seconds(clock_t start)
+{
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+
+static raptor_uri*
+bench_resolve_string(raptor_world* world, raptor_uri* base_uri,
+                     const unsigned char* reference, size_t reference_len)
+{
+  const unsigned char* base_string;
+  size_t base_len;
+  unsigned char* buffer;
+  size_t buffer_length;
+  size_t len;
+  raptor_uri* uri;
+
+  base_string = raptor_uri_as_counted_string(base_uri, &base_len);
+
+  buffer_length = base_len + reference_len + 1;
+  buffer = RAPTOR_MALLOC(unsigned char*, buffer_length + 1);
+  if(!buffer)
+    return NULL;
+
+  len = raptor_uri_resolve_uri_reference(base_string, reference,
+                                         buffer, buffer_length);
+  uri = raptor_new_uri_from_counted_string(world, buffer, len);
+  RAPTOR_FREE(char*, buffer);
+
+  return uri;
+}
+
+
+static int
+bench_form(raptor_world* world, raptor_uri* base_uri, const char* form,
+           unsigned long count)
+{
+  unsigned char reference[BENCH_REFERENCE_BUFFER_LEN];
+  unsigned long i;
+  clock_t start;
+  double string_time, uri_time;
+  int pass;
+
+  string_time = uri_time = 0.0;
+
+  for(pass = 0; pass < 2; pass++) {
+    start = clock();
+    for(i = 0; i < count; i++) {
+      size_t len;
+      raptor_uri* uri;
+
+      len = (size_t)snprintf((char*)reference, BENCH_REFERENCE_BUFFER_LEN,
+                             form, i);
+      if(pass)
+        uri = raptor_new_uri_relative_to_base_counted(world, base_uri,
+                                                      reference, len);
+      else
+        uri = bench_resolve_string(world, base_uri, reference, len);
+
+      if(!uri) {
+        fprintf(stderr, "%s: Failed to resolve %s\n", program, reference);
+        return 1;
+      }
+      raptor_free_uri(uri);
+    }
+    if(pass)
+      uri_time = bench_seconds(start);
+    else
+      string_time = bench_seconds(start);
+  }
+
+  fprintf(stdout, "%-28s string %8.3fs %10.0f/s  uri %8.3fs %10.0f/s\n",
+          form,
+          string_time, string_time > 0.0 ? count / string_time : 0.0,
+          uri_time, uri_time > 0.0 ? count / uri_time : 0.0);
+  return 0;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  raptor_world* world;
+  raptor_uri* base_uri;
+  unsigned long count = 1000000;
+  int i;
+  int rc = 0;
+
+  program = raptor_basename(argv[0]);
+
+  if(argc > 2) {
+    fprintf(stderr, "USAGE: %s [COUNT]\n", program);
+    return 1;
+  }
+  if(argc == 2)
+    count = strtoul(argv[1], NULL, 10);
+
+  world = raptor_new_world();
+  if(!world || raptor_world_open(world))
+    return 1;
+
+  base_uri = raptor_new_uri(world, (const unsigned char*)BENCH_BASE_URI);
+  if(!base_uri)
+    return 1;
+
+  fprintf(stdout, "%s: resolving %lu references of each form against %s\n",
+          program, count, BENCH_BASE_URI);
+
+  for(i = 0; bench_forms[i] && !rc; i++)
+    rc = bench_form(world, base_uri, bench_forms[i], count);
+
+  raptor_free_uri(base_uri);
+  raptor_free_world(world);
+
+  return rc;
+}
@@ -578,8 +578,44 @@ raptor_www_error(raptor_www* www, const char *message, ...)
 static int 
 raptor_www_file_handle_fetch(raptor_www* www, FILE* fh) 
 {
-  while(!feof(fh)) {
-    size_t len = fread(www->buffer, 1, RAPTOR_WWW_BUFFER_SIZE, fh);
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+  raptor_iostream* iostr = NULL;
+
+  /* gzip or zstd content is detected by its magic number */
+  if(raptor_compression_file_handle_peek(fh)) {
+    iostr = raptor_new_iostream_from_compressed_file_handle(www->world, fh);
+    if(!iostr) {
+      raptor_www_error(www,
+                       "Cannot read compressed content - compression not supported");
+      www->failed = 1;
+      return www->failed;
+    }
+  }
+#endif
+
+  while(1) {
+    size_t len;
+    int is_end;
+
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+    if(iostr) {
+      int ilen = raptor_iostream_read_bytes(www->buffer, 1,
+                                            RAPTOR_WWW_BUFFER_SIZE, iostr);
+      if(ilen < 0) {
+        raptor_www_error(www,
+                         "Failed to read compressed content - corrupt or truncated");
+        www->failed = 1;
+        break;
+      }
+      len = RAPTOR_GOOD_CAST(size_t, ilen);
+      is_end = raptor_iostream_read_eof(iostr);
+    } else
+#endif
+    {
+      len = fread(www->buffer, 1, RAPTOR_WWW_BUFFER_SIZE, fh);
+      is_end = feof(fh);
+    }
+
     if(len > 0) {
       www->total_bytes += len;
       www->buffer[len]='\0';
@@ -588,9 +624,14 @@ raptor_www_file_handle_fetch(raptor_www* www, FILE* fh)
         www->write_bytes(www, www->write_bytes_userdata, www->buffer, len, 1);
     }
 
-    if(feof(fh) || www->failed)
+    if(is_end || www->failed)
       break;
   }
+
+#ifdef RAPTOR_IOSTREAM_COMPRESSION
+  if(iostr)
+    raptor_free_iostream(iostr);
+#endif
   
   if(!www->failed)
     www->status_code = 200;
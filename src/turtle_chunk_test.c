@@ -0,0 +1,416 @@
+/* -*- Mode: c; c-basic-offset: 2 -*-
+ *
+ * turtle_chunk_test.c - Raptor Turtle parser chunked input test
+ *
+ * Copyright (C) 2013, David Beckett http://www.dajobe.org/
+ *
+ * This package is Free Software and part of Redland http://librdf.org/
+ *
+ * It is licensed under the following three licenses as alternatives:
+ *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
+ *   2. GNU General Public License (GPL) V2 or any newer version
+ *   3. Apache License, V2.0 or any newer version
+ *
+ * You may not use this file except in compliance with at least one of
+ * the above three licenses.
+ *
+ * See LICENSE.html or LICENSE.txt at the top of this package for the
+ * complete terms and further detail along with the license texts for
+ * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
+ *
+ * Parses Turtle and TriG documents passed to the parser in chunks of
+ * 1 to TURTLE_CHUNK_TEST_MAX_CHUNK bytes and checks that the
+ * statements, or the line of the first error, are the same as when the
+ * whole document is passed in one chunk.  This checks tokens that are
+ * split across chunks: long literals, prefixed names and numbers at
+ * the end of a chunk and \r\n line endings.  Statements are not
+ * compared after an error since parsing stops when a chunk fails.
+ *
+ * Usage: turtle_chunk_test [FILE...]
+ * Files ending in .trig are parsed as TriG, others as Turtle.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <raptor_config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/* Raptor includes */
+#include "raptor2.h"
+#include "raptor_internal.h"
+
+
+int main(int argc, char *argv[]);
+
+
+static const char *program;
+
+#define TURTLE_CHUNK_TEST_MAX_CHUNK 7
+
+#define TURTLE_CHUNK_TEST_BASE_URI "http://example.org/chunk-test/"
+
+
+typedef struct
+{
+  char *output;
+  size_t output_length;
+  int errors;
+  int error_line;
+} turtle_chunk_test_result;
+
+
+typedef struct
+{
+  const char *name;
+  const char *syntax;
+  const char *data;
+  /* line of the first error or 0 if there should be none */
+  int error_line;
+} turtle_chunk_test_case;
+
+
+static const turtle_chunk_test_case turtle_chunk_test_cases[] = {
+  { "long literals", "turtle",
+    "@prefix ex: <http://example.org/> .\n"
+    "ex:s ex:p \"\"\"a long literal with \"quotes\", ''single'' quotes\n"
+    "and \\\"\"\"escaped\\\"\"\" delimiters\n"
+    "over three lines\"\"\" .\n"
+    "ex:s ex:p '''single quoted\n"
+    "long literal ending in a quote\"''' .\n"
+    "ex:s ex:p \"\"\"\"\"\" , \"\"\"x\"\"\"@en , \"\"\"1\"\"\"^^ex:t .\n",
+    0 },
+  { "prefixed names and numbers", "turtle",
+    "@prefix ex: <http://example.org/> .\n"
+    "@prefix : <http://example.org/empty#> .\n"
+    "ex:a.b.c ex:with.dots :local.name.\n"
+    "ex:n ex:p 12, -7, +3, 12.5, -.5, 0.25e-3, 1E10, 6.02e+23.\n"
+    "ex:n ex:p 1 ;ex:q 2;ex:r 3.\n"
+    "ex:esc ex:p ex:a%20b\\~c , _:b1.\n"
+    "_:b1.2 a ex:Blank.\n",
+    0 },
+  { "CRLF line endings", "turtle",
+    "@prefix ex: <http://example.org/> .\r\n"
+    "ex:s ex:p ex:o .\r\n"
+    "\r\n"
+    "# comment\r\n"
+    "ex:s ex:p \"\"\"two\r\n"
+    "lines\"\"\" .\r\n"
+    "ex:s ex:p ex:o .\r\n"
+    "ex:s ex:p ? .\r\n",
+    8 },
+  { "CR line endings", "turtle",
+    "@prefix ex: <http://example.org/> .\r"
+    "ex:s ex:p ex:o .\r"
+    "\r"
+    "ex:s ex:p ? .\r",
+    4 },
+  { "TriG graph names", "trig",
+    "@prefix ex: <http://example.org/> .\n"
+    "<http://example.org/g1>\n"
+    "{ ex:s ex:p ex:o . }\n"
+    "ex:g2 = \r\n"
+    "  {\n"
+    "  ex:s ex:p \"\"\"in\n"
+    "a graph\"\"\" .\n"
+    "}\n",
+    0 },
+  { NULL, NULL, NULL, 0 }
+};
+
+
+static void
+turtle_chunk_test_log_handler(void *user_data, raptor_log_message *message)
+{
+  turtle_chunk_test_result* result = (turtle_chunk_test_result*)user_data;
+
+  if(message->level < RAPTOR_LOG_LEVEL_ERROR)
+    return;
+
+  if(!result->errors)
+    result->error_line = message->locator ? message->locator->line : -1;
+  result->errors++;
+}
+
+
+static void
+turtle_chunk_test_statement_handler(void *user_data,
+                                    raptor_statement *statement)
+{
+  raptor_iostream* iostr = (raptor_iostream*)user_data;
+
+  raptor_statement_ntriples_write(statement, iostr, 1);
+}
+
+
+/*
+ * turtle_chunk_test_parse:
+ * @syntax: parser name
+ * @data: document
+ * @length: length of @data
+ * @chunk_size: bytes per chunk or 0 to pass the document in one chunk
+ * @result: result to fill in
+ *
+ * Parse a document with a new world so generated blank node
+ * identifiers do not depend on earlier parses.
+ *
+ * Return value: non-0 on failure to set up the parse
+ */
+static int
+turtle_chunk_test_parse(const char *syntax,
+                        const unsigned char *data, size_t length,
+                        size_t chunk_size,
+                        turtle_chunk_test_result* result)
+{
+  raptor_world *world;
+  raptor_parser* parser = NULL;
+  raptor_uri* base_uri = NULL;
+  raptor_iostream* iostr = NULL;
+  int rc = 1;
+
+  memset(result, '\0', sizeof(*result));
+
+  world = raptor_new_world();
+  if(!world)
+    return 1;
+  raptor_world_set_log_handler(world, result, turtle_chunk_test_log_handler);
+  if(raptor_world_open(world))
+    goto tidy;
+
+  parser = raptor_new_parser(world, syntax);
+  base_uri = raptor_new_uri(world,
+                            (const unsigned char*)TURTLE_CHUNK_TEST_BASE_URI);
+  iostr = raptor_new_iostream_to_string(world, (void**)&result->output,
+                                        &result->output_length, malloc);
+  if(!parser || !base_uri || !iostr)
+    goto tidy;
+
+  raptor_parser_set_statement_handler(parser, iostr,
+                                      turtle_chunk_test_statement_handler);
+
+  if(raptor_parser_parse_start(parser, base_uri))
+    goto tidy;
+
+  if(chunk_size) {
+    size_t offset;
+
+    for(offset = 0; offset < length; offset += chunk_size) {
+      size_t len = length - offset;
+
+      if(len > chunk_size)
+        len = chunk_size;
+      if(raptor_parser_parse_chunk(parser, data + offset, len, 0))
+        break;
+    }
+    if(offset >= length)
+      raptor_parser_parse_chunk(parser, NULL, 0, 1);
+  } else
+    raptor_parser_parse_chunk(parser, data, length, 1);
+
+  rc = 0;
+
+  tidy:
+  if(parser)
+    raptor_free_parser(parser);
+  /* writes the output string */
+  if(iostr)
+    raptor_free_iostream(iostr);
+  if(base_uri)
+    raptor_free_uri(base_uri);
+  raptor_free_world(world);
+
+  return rc;
+}
+
+
+/*
+ * turtle_chunk_test_document:
+ * @name: name for messages
+ * @syntax: parser name
+ * @data: document
+ * @length: length of @data
+ * @error_line: expected line of the first error, 0 for none or -1
+ *   if not known
+ *
+ * Return value: number of chunk sizes that failed
+ */
+static int
+turtle_chunk_test_document(const char *name, const char *syntax,
+                           const unsigned char *data, size_t length,
+                           int error_line)
+{
+  turtle_chunk_test_result expected;
+  size_t chunk_size;
+  int failures = 0;
+
+  if(turtle_chunk_test_parse(syntax, data, length, 0, &expected)) {
+    fprintf(stderr, "%s: %s: parse setup failed\n", program, name);
+    return 1;
+  }
+
+  if(error_line >= 0 &&
+     (expected.errors ? expected.error_line : 0) != error_line) {
+    fprintf(stderr,
+            "%s: %s: first error at line %d in one chunk, expected %d\n",
+            program, name, expected.errors ? expected.error_line : 0,
+            error_line);
+    failures++;
+  }
+
+  for(chunk_size = 1; chunk_size <= TURTLE_CHUNK_TEST_MAX_CHUNK; chunk_size++) {
+    turtle_chunk_test_result result;
+
+    if(turtle_chunk_test_parse(syntax, data, length, chunk_size, &result)) {
+      fprintf(stderr, "%s: %s: parse setup failed\n", program, name);
+      failures++;
+      continue;
+    }
+
+    if(!result.errors != !expected.errors) {
+      fprintf(stderr,
+              "%s: %s: %d errors with %d byte chunks, %d in one chunk\n",
+              program, name, result.errors, (int)chunk_size,
+              expected.errors);
+      failures++;
+    } else if(result.errors && result.error_line != expected.error_line) {
+      fprintf(stderr,
+              "%s: %s: first error at line %d with %d byte chunks, line %d in one chunk\n",
+              program, name, result.error_line, (int)chunk_size,
+              expected.error_line);
+      failures++;
+    } else if(!result.errors &&
+              (result.output_length != expected.output_length ||
+               memcmp(result.output, expected.output,
+                      expected.output_length))) {
+      fprintf(stderr,
+              "%s: %s: statements with %d byte chunks differ from one chunk\n"
+              "One chunk:\n%s%d byte chunks:\n%s",
+              program, name, (int)chunk_size, expected.output,
+              (int)chunk_size, result.output);
+      failures++;
+    }
+
+    if(result.output)
+      free(result.output);
+  }
+
+  if(expected.output)
+    free(expected.output);
+
+  return failures;
+}
+
+
+static unsigned char*
+turtle_chunk_test_read_file(const char *filename, size_t *length_p)
+{
+  FILE *fh;
+  unsigned char *data = NULL;
+  size_t size = 0;
+  size_t length = 0;
+
+  fh = fopen(filename, "rb");
+  if(!fh) {
+    fprintf(stderr, "%s: Cannot open file %s - %s\n", program, filename,
+            strerror(errno));
+    return NULL;
+  }
+
+  while(1) {
+    size_t n;
+
+    if(length == size) {
+      unsigned char *new_data;
+
+      size = size ? size << 1 : 4096;
+      new_data = (unsigned char*)realloc(data, size);
+      if(!new_data) {
+        free(data);
+        data = NULL;
+        break;
+      }
+      data = new_data;
+    }
+
+    n = fread(data + length, 1, size - length, fh);
+    if(!n)
+      break;
+    length += n;
+  }
+
+  if(data && ferror(fh)) {
+    fprintf(stderr, "%s: file '%s' read failed - %s\n", program, filename,
+            strerror(errno));
+    free(data);
+    data = NULL;
+  }
+  fclose(fh);
+
+  *length_p = length;
+  return data;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+  raptor_world *world;
+  const turtle_chunk_test_case* test_case;
+  int failures = 0;
+  int i;
+
+  program = raptor_basename(argv[0]);
+
+  world = raptor_new_world();
+  if(!world || raptor_world_open(world)) {
+    fprintf(stderr, "%s: raptor_new_world() failed\n", program);
+    return 1;
+  }
+
+  for(test_case = turtle_chunk_test_cases; test_case->name; test_case++) {
+    /* TriG may be configured out */
+    if(!raptor_world_is_parser_name(world, test_case->syntax))
+      continue;
+
+    failures += turtle_chunk_test_document(test_case->name, test_case->syntax,
+                                           (const unsigned char*)test_case->data,
+                                           strlen(test_case->data),
+                                           test_case->error_line);
+  }
+
+  raptor_free_world(world);
+
+  for(i = 1; i < argc; i++) {
+    const char *filename = argv[i];
+    size_t len = strlen(filename);
+    const char *syntax = "turtle";
+    unsigned char *data;
+    size_t length;
+
+    if(len > 5 && !strcmp(filename + len - 5, ".trig"))
+      syntax = "trig";
+
+    data = turtle_chunk_test_read_file(filename, &length);
+    if(!data) {
+      failures++;
+      continue;
+    }
+
+    failures += turtle_chunk_test_document(filename, syntax, data, length, -1);
+
+    free(data);
+  }
+
+  if(failures)
+    fprintf(stderr, "%s: %d FAILED\n", program, failures);
+
+  return failures ? 1 : 0;
+}
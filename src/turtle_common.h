@@ -37,13 +37,15 @@ RAPTOR_INTERNAL_API size_t raptor_turtle_expand_qname_escapes(unsigned char *nam
 
 /* turtle_lexer.l */
 extern void turtle_token_free(raptor_world* world, int token, YYSTYPE *lval);
+extern int turtle_lexer_get_start_condition(yyscan_t yyscanner);
+extern void turtle_lexer_set_start_condition(int condition, yyscan_t yyscanner);
 
 
 /*
  * Turtle parser object
  */
 struct raptor_turtle_parser_s {
-  /* buffer */
+  /* buffer of input not yet lexed */
   char *buffer;
 
   /* buffer length */
@@ -54,22 +56,24 @@ struct raptor_turtle_parser_s {
   /* for lexer to store result in */
   YYSTYPE lval;
 
-  /* STATIC lexer */
+  /* STATIC lexer - kept across chunks along with its start condition */
   yyscan_t scanner;
 
   int scanner_set;
 
+  /* push parser state kept across chunks */
+  turtle_parser_pstate *pstate;
+
   int lineno;
-  int lineno_last_good;
 
-  /* for the chunk parser, how much of the input has been consumed */
+  /* for the chunk parser, how much of the lexer window has been consumed */
   size_t consumed;
-  /* likewise, how much of the input has been successfully processed */
-  size_t processed;
-  /* indicates what can be processed at most */
+  /* indicates what can be lexed at most: the window ends at the last newline */
   size_t consumable;
-  /* real end-of-buffer indicator, as we kill the last line */
+  /* number of bytes in the buffer */
   size_t end_of_buffer;
+  /* window size needed before lexing again after no progress was made */
+  size_t lex_retry_length;
 
   /* a sequence holding deferred statements */
   raptor_sequence *deferred;
@@ -88,9 +88,6 @@ const char * turtle_token_print(raptor_world* world, int token, YYSTYPE *lval);
 /* the lexer does not seem to track this */
 #undef RAPTOR_TURTLE_USE_ERROR_COLUMNS
 
-/* set api.push-pull to "push" if this is defined */
-#undef TURTLE_PUSH_PARSE
-
 /* Prototypes */ 
 int turtle_parser_error(raptor_parser* rdf_parser, void* scanner, const char *msg);
 
@@ -131,7 +128,7 @@ static void raptor_turtle_handle_statement(raptor_parser *parser, raptor_stateme
 %define api.pure full
 
 /* Push or pull parser? */
-%define api.push-pull pull
+%define api.push-pull push
 
 /* Pure parser argument: lexer - yylex() and parser - yyparse() */
 %lex-param { yyscan_t yyscanner }
@@ -200,6 +197,7 @@ static void raptor_turtle_handle_statement(raptor_parser *parser, raptor_stateme
   if($$)
     raptor_free_term($$);
 } subject predicate object verb literal resource blankNode collection
+  blankNodePropertyList
 
 %destructor {
   if($$)
@@ -305,15 +303,6 @@ dotTriplesList: triples
 ;
 
 statementList: statementList statement
-{
-  raptor_turtle_parser* turtle_parser;
-
-  turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
-
-  /* sync up consumed/processed so we know what to unwind */
-  turtle_parser->processed = turtle_parser->consumed;
-  turtle_parser->lineno_last_good = turtle_parser->lineno;
-}
 | statementList error
 | %empty
 ;
@@ -1285,14 +1274,6 @@ turtle_parser_error(raptor_parser* rdf_parser, void* scanner, const char *msg)
 
   turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
 
-  if(turtle_parser->consumed == turtle_parser->consumable &&
-     turtle_parser->processed < turtle_parser->consumed &&
-     !turtle_parser->is_end) {
-    /* we encountered an error on or around the last byte of the buffer
-     * sorting it in the next run aye? */
-    return 0;
-  }
-  
   if(turtle_parser->error_count++)
     return 0;
 
@@ -1359,39 +1340,58 @@ turtle_qname_to_uri(raptor_parser *rdf_parser, unsigned char *name, size_t name_
 
 
 
-#ifndef TURTLE_PUSH_PARSE
+/*
+ * turtle_token_may_continue:
+ * @string: input after a token up to the end of the window
+ * @length: length of @string
+ *
+ * INTERNAL - Check if a token may continue past the end of the window
+ *
+ * A window ends before a newline so a token can only be longer in the
+ * whole input if it may span lines.  That is a TriG graph name, where
+ * whitespace and an optional '=' may come before the '{', so check for
+ * nothing but those and comments.
+ *
+ * Return value: non-0 if there are no other tokens in @string
+ */
 static int
-turtle_parse(raptor_parser *rdf_parser, const char *string, size_t length)
+turtle_token_may_continue(const char *string, size_t length)
 {
-  raptor_turtle_parser* turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
-  int rc;
-  
-  if(!string || !*string)
-    return 0;
-  
-  if(turtle_lexer_lex_init(&turtle_parser->scanner))
-    return 1;
-  turtle_parser->scanner_set = 1;
-
-#if defined(YYDEBUG) && YYDEBUG > 0
-  turtle_lexer_set_debug(1 ,&turtle_parser->scanner);
-  turtle_parser_debug = 1;
-#endif
-
-  turtle_lexer_set_extra(rdf_parser, turtle_parser->scanner);
-  (void)turtle_lexer__scan_bytes((char *)string, (int)length, turtle_parser->scanner);
+  const char *end = string + length;
+  int seen_equals = 0;
 
-  rc = turtle_parser_parse(rdf_parser, turtle_parser->scanner);
+  while(string < end) {
+    char c = *string++;
 
-  turtle_lexer_lex_destroy(turtle_parser->scanner);
-  turtle_parser->scanner_set = 0;
+    if(c == '#') {
+      while(string < end && *string != '\n' && *string != '\r')
+        string++;
+    } else if(c == '=' && !seen_equals)
+      seen_equals = 1;
+    else if(c != ' ' && c != '\t' && c != '\v' && c != '\r' && c != '\n')
+      return 0;
+  }
 
-  return rc;
+  return 1;
 }
-#endif
 
 
-#ifdef TURTLE_PUSH_PARSE
+/*
+ * turtle_push_parse:
+ * @rdf_parser: parser
+ * @string: input not yet lexed
+ * @length: length of @string
+ *
+ * INTERNAL - Lex a window of input and push the tokens to the parser
+ *
+ * The scanner and push parser state are kept across calls.  Unless
+ * this is the last chunk, a token that may continue past the end of
+ * the window (see turtle_token_may_continue(), or an unterminated long
+ * literal) is not pushed; turtle_parser->consumed is left at its start
+ * so the caller keeps those bytes for the next window.
+ *
+ * Return value: non-0 on failure
+ */
 static int
 turtle_push_parse(raptor_parser *rdf_parser, 
                   const char *string, size_t length)
@@ -1400,36 +1400,47 @@ turtle_push_parse(raptor_parser *rdf_parser,
   raptor_world* world = rdf_parser->world;
 #endif
   raptor_turtle_parser* turtle_parser;
-  void *buffer;
-  int status;
-  yypstate *ps;
+  YY_BUFFER_STATE buffer;
+  int status = YYPUSH_MORE;
 
   turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
 
-  if(!string || !*string)
-    return 0;
-  
-  if(turtle_lexer_lex_init(&turtle_parser->scanner))
-    return 1;
-  turtle_parser->scanner_set = 1;
+  if(!turtle_parser->scanner_set) {
+    if(turtle_lexer_lex_init(&turtle_parser->scanner))
+      return 1;
+    turtle_parser->scanner_set = 1;
 
 #if defined(YYDEBUG) && YYDEBUG > 0
-  turtle_lexer_set_debug(1 ,&turtle_parser->scanner);
-  turtle_parser_debug = 1;
+    turtle_lexer_set_debug(1 ,&turtle_parser->scanner);
+    turtle_parser_debug = 1;
 #endif
 
-  turtle_lexer_set_extra(rdf_parser, turtle_parser->scanner);
-  buffer = turtle_lexer__scan_bytes(string, length, turtle_parser->scanner);
+    turtle_lexer_set_extra(rdf_parser, turtle_parser->scanner);
+  }
+
+  if(!turtle_parser->pstate) {
+    /* returns a parser instance or 0 on out of memory */
+    turtle_parser->pstate = yypstate_new();
+    if(!turtle_parser->pstate)
+      return 1;
+  }
 
-  /* returns a parser instance or 0 on out of memory */
-  ps = yypstate_new();
-  if(!ps)
+  buffer = turtle_lexer__scan_bytes(string, (int)length,
+                                    turtle_parser->scanner);
+  if(!buffer)
     return 1;
 
-  do {
+  turtle_parser->consumed = 0;
+
+  while(status == YYPUSH_MORE) {
     YYSTYPE lval;
+    size_t start = turtle_parser->consumed;
+    int lineno = turtle_parser->lineno;
+    int condition;
     int token;
 
+    condition = turtle_lexer_get_start_condition(turtle_parser->scanner);
+
     memset(&lval, 0, sizeof(YYSTYPE));
     
     token = turtle_lexer_lex(&lval, turtle_parser->scanner);
@@ -1438,21 +1449,30 @@ turtle_push_parse(raptor_parser *rdf_parser,
     printf("token %s\n", turtle_token_print(world, token, &lval));
 #endif
 
-    status = yypush_parse(ps, token, &lval, rdf_parser, turtle_parser->scanner);
+    if(!turtle_parser->is_end && !turtle_parser->error_count &&
+       (!token || token == EOF ||
+        turtle_token_may_continue(string + turtle_parser->consumed,
+                                  length - turtle_parser->consumed))) {
+      /* the token may continue in the next chunk: rescan it from there */
+      turtle_token_free(rdf_parser->world, token, &lval);
+      turtle_parser->consumed = start;
+      turtle_parser->lineno = lineno;
+      turtle_lexer_set_start_condition(condition, turtle_parser->scanner);
+      break;
+    }
 
-    /* turtle_token_free(world, token, &lval); */
+    status = yypush_parse(turtle_parser->pstate, token, &lval,
+                          rdf_parser, turtle_parser->scanner);
 
-    if(!token || token == EOF || token == ERROR_TOKEN)
+    if(!token || token == EOF)
       break;
-  } while (status == YYPUSH_MORE);
-  yypstate_delete(ps);
+  }
 
-  turtle_lexer_lex_destroy(turtle_parser->scanner);
-  turtle_parser->scanner_set = 0;
+  turtle_lexer__delete_buffer(buffer, turtle_parser->scanner);
 
-  return 0;
+  /* 0 if accepted, otherwise aborted or out of memory */
+  return (status == YYPUSH_MORE) ? 0 : status;
 }
-#endif
 
 
 /**
@@ -1493,6 +1513,16 @@ raptor_turtle_parse_terminate(raptor_parser *rdf_parser) {
     turtle_parser->scanner_set = 0;
   }
 
+  if(turtle_parser->pstate) {
+    yypstate_delete(turtle_parser->pstate);
+    turtle_parser->pstate = NULL;
+  }
+
+  if(turtle_parser->deferred) {
+    raptor_free_sequence(turtle_parser->deferred);
+    turtle_parser->deferred = NULL;
+  }
+
   if(turtle_parser->buffer)
     RAPTOR_FREE(cdata, turtle_parser->buffer);
 
@@ -1570,11 +1600,11 @@ raptor_turtle_handle_statement(raptor_parser *parser, raptor_statement *t)
   if(!t->subject || !t->predicate || !t->object)
     return;
 
-  if(!parser->statement_handler)
+  if(!parser->statement_handler && !parser->statement_batch_handler)
     return;
 
   /* Generate the statement */
-  (*parser->statement_handler)(parser->user_data, t);
+  raptor_parser_emit_statement(parser, t);
 }
 
 static void
@@ -1626,7 +1656,6 @@ raptor_turtle_parse_chunk(raptor_parser* rdf_parser,
                           int is_end)
 {
   raptor_turtle_parser *turtle_parser;
-  char *ptr;
   int rc;
 
   turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
@@ -1640,43 +1669,36 @@ raptor_turtle_parse_chunk(raptor_parser* rdf_parser,
     return 0;
   }
 
-  /* the actual buffer will contained unprocessed characters from
-   * the last run plus the chunk passed here */
-  turtle_parser->end_of_buffer = turtle_parser->consumed + len;
-  if(turtle_parser->end_of_buffer > turtle_parser->buffer_length) {
-    /* resize */
-    size_t new_buffer_length = turtle_parser->end_of_buffer;
-
-    turtle_parser->buffer = RAPTOR_REALLOC(char*, turtle_parser->buffer,
-                                           new_buffer_length + 1);
+  /* the buffer holds the input not yet lexed from the earlier chunks
+   * followed by the chunk passed here */
+  if(!turtle_parser->buffer ||
+     turtle_parser->end_of_buffer + len > turtle_parser->buffer_length) {
+    /* resize geometrically so a long pending token is not copied per chunk */
+    size_t new_buffer_length = turtle_parser->buffer_length << 1;
+    char *new_buffer;
+
+    if(new_buffer_length < turtle_parser->end_of_buffer + len)
+      new_buffer_length = turtle_parser->end_of_buffer + len;
+
+    new_buffer = RAPTOR_REALLOC(char*, turtle_parser->buffer,
+                                new_buffer_length + 1);
+    if(!new_buffer) {
+      /* we tried to alloc a buffer but we failed */
+      raptor_parser_fatal_error(rdf_parser, "Out of memory");
+      return 1;
+    }
+    turtle_parser->buffer = new_buffer;
 
     /* adjust stored length */
     turtle_parser->buffer_length = new_buffer_length;
   }
-  if(!turtle_parser->buffer && turtle_parser->buffer_length) {
-    /* we tried to alloc a buffer but we failed */
-    raptor_parser_fatal_error(rdf_parser, "Out of memory");
-    return 1;
-  }
-  if(is_end && !turtle_parser->end_of_buffer) {
-    /* Nothing to do */
-    return 0;
-  }
-
-  /* move pointer to end of cdata buffer */
-  ptr = turtle_parser->buffer + turtle_parser->consumed;
 
   /* now write new stuff at end of cdata buffer */
-  memcpy(ptr, s, len);
-  ptr += len;
-  *ptr = '\0';
-
-  /* reset processed counter */
-  turtle_parser->processed = 0U;
-  /* unconsume */
-  turtle_parser->consumed = 0U;
-  /* reset line numbers */
-  turtle_parser->lineno = turtle_parser->lineno_last_good;
+  if(len) {
+    memcpy(turtle_parser->buffer + turtle_parser->end_of_buffer, s, len);
+    turtle_parser->end_of_buffer += len;
+  }
+  turtle_parser->buffer[turtle_parser->end_of_buffer] = '\0';
 
   /* let everyone know if this is the last chunk */
   turtle_parser->is_end = is_end;
@@ -1684,9 +1706,25 @@ raptor_turtle_parse_chunk(raptor_parser* rdf_parser,
     /* it's safer not to pass the very last line to the lexer
      * just in case we end up with EOB-in-the-middle-of-X situations */
     size_t i = turtle_parser->end_of_buffer;
-    while(i > 0U && turtle_parser->buffer[--i] != '\n');
-    /* either i == 0U or i points to the last \n before the end-of-buffer */
-    turtle_parser->consumable = i;
+    size_t added = turtle_parser->end_of_buffer - len;
+
+    /* only the bytes added here can end the window at a later line;
+     * scanning the whole buffer would be quadratic on a long line */
+    while(i > added && turtle_parser->buffer[i - 1] != '\n')
+      i--;
+    if(i == added) {
+      /* no new line so the window is the one already lexed */
+      return 0;
+    }
+    /* i - 1 points to the last \n before the end-of-buffer */
+    turtle_parser->consumable = i - 1;
+
+    /* wait for a whole line, and after a window where nothing could
+     * be lexed, for the window to double so that a long token is
+     * rescanned only a logarithmic number of times */
+    if(!turtle_parser->consumable ||
+       turtle_parser->consumable < turtle_parser->lex_retry_length)
+      return 0;
   } else {
     /* otherwise the consumable number of bytes coincides with the EOB */
     turtle_parser->consumable = turtle_parser->end_of_buffer;
@@ -1697,32 +1735,36 @@ raptor_turtle_parse_chunk(raptor_parser* rdf_parser,
                   turtle_parser->buffer, turtle_parser->buffer_length);
 #endif
 
-#ifdef TURTLE_PUSH_PARSE
   rc = turtle_push_parse(rdf_parser, 
                          turtle_parser->buffer, turtle_parser->consumable);
-#else
-  rc = turtle_parse(rdf_parser, turtle_parser->buffer, turtle_parser->consumable);
-#endif  
 
-  if(turtle_parser->error_count) {
+  if(turtle_parser->error_count)
     rc = 1;
-  } else if(!is_end) {
-    /* move stuff to the beginning of the buffer */
-    turtle_parser->consumed = turtle_parser->end_of_buffer - turtle_parser->processed;
-    if(turtle_parser->consumed && turtle_parser->processed) {
-      memmove(turtle_parser->buffer,
-              turtle_parser->buffer + turtle_parser->processed,
-              turtle_parser->consumed);
-      /* cancel all deferred eval's */
-      if(turtle_parser->deferred) {
-        raptor_free_sequence(turtle_parser->deferred);
-        turtle_parser->deferred = NULL;
-      }
+
+  if(!is_end) {
+    /* move the bytes not yet lexed to the beginning of the buffer */
+    size_t lexed = turtle_parser->consumed;
+
+    if(lexed) {
+      turtle_parser->end_of_buffer -= lexed;
+      memmove(turtle_parser->buffer, turtle_parser->buffer + lexed,
+              turtle_parser->end_of_buffer);
+      turtle_parser->lex_retry_length = 0;
+    } else
+      turtle_parser->lex_retry_length = turtle_parser->consumable << 1;
+  } else {
+    turtle_parser->end_of_buffer = 0;
+    turtle_parser->lex_retry_length = 0;
+    if(turtle_parser->pstate) {
+      yypstate_delete(turtle_parser->pstate);
+      turtle_parser->pstate = NULL;
+    }
+
+    if(!rc && rdf_parser->emitted_default_graph) {
+      /* for non-TRIG - end default graph after last triple */
+      raptor_parser_end_graph(rdf_parser, NULL, 0);
+      rdf_parser->emitted_default_graph--;
     }
-  } else if(rdf_parser->emitted_default_graph) {
-    /* for non-TRIG - end default graph after last triple */
-    raptor_parser_end_graph(rdf_parser, NULL, 0);
-    rdf_parser->emitted_default_graph--;
   }
   return rc;
 }
@@ -1747,6 +1789,24 @@ raptor_turtle_parse_start(raptor_parser *rdf_parser)
     turtle_parser->buffer = NULL;
     turtle_parser->buffer_length = 0;
   }
+  turtle_parser->end_of_buffer = 0;
+  turtle_parser->lex_retry_length = 0;
+
+  /* start from a fresh scanner and parser state */
+  if(turtle_parser->scanner_set) {
+    turtle_lexer_lex_destroy(turtle_parser->scanner);
+    turtle_parser->scanner_set = 0;
+  }
+
+  if(turtle_parser->pstate) {
+    yypstate_delete(turtle_parser->pstate);
+    turtle_parser->pstate = NULL;
+  }
+
+  if(turtle_parser->deferred) {
+    raptor_free_sequence(turtle_parser->deferred);
+    turtle_parser->deferred = NULL;
+  }
   
   turtle_parser->lineno = 1;
 
@@ -1807,6 +1867,18 @@ raptor_turtle_get_graph(raptor_parser* rdf_parser)
 }
 
 
+#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
+void
+raptor_turtle_parser_stats_print(raptor_parser* rdf_parser, FILE *stream)
+{
+  raptor_turtle_parser *turtle_parser;
+
+  turtle_parser = (raptor_turtle_parser*)rdf_parser->context;
+  raptor_namespaces_stats_print(&turtle_parser->namespaces, stream);
+}
+#endif
+
+
 #ifdef RAPTOR_PARSER_TRIG
 static int
 raptor_trig_parse_recognise_syntax(raptor_parser_factory* factory, 
@@ -2047,12 +2119,9 @@ main(int argc, char *argv[])
   raptor_turtle_parse_init(&rdf_parser, "turtle");
   
   turtle_parser.error_count = 0;
+  turtle_parser.is_end = 1;
 
-#ifdef TURTLE_PUSH_PARSE
   turtle_push_parse(&rdf_parser, string, strlen(string));
-#else
-  turtle_parse(&rdf_parser, string, strlen(string));
-#endif
 
   raptor_turtle_parse_terminate(&rdf_parser);
   
@@ -0,0 +1,50 @@
+# raptor/tests/ntriples/rdfdiff-patch.cmake
+#
+# Apply the patch written by rdfdiff -p FROM TO to FROM and check that
+# rdfdiff then finds no differences between the result and TO.
+#
+# Run with cmake -DRDFDIFF=... -DFROM=... -DTO=... -DOUTPUT=... -P
+#
+# This file is in the public domain.
+#
+
+EXECUTE_PROCESS(
+	COMMAND ${RDFDIFF} -p -f ntriples -t ntriples ${FROM} ${TO}
+	TIMEOUT 10
+	OUTPUT_VARIABLE patch
+	ERROR_QUIET
+	RESULT_VARIABLE rdfdiff_status
+)
+IF(NOT rdfdiff_status EQUAL 1)
+	MESSAGE(FATAL_ERROR "rdfdiff -p returned ${rdfdiff_status}, expected differences")
+ENDIF(NOT rdfdiff_status EQUAL 1)
+
+FILE(STRINGS ${FROM} lines)
+STRING(REGEX MATCHALL "[^\n]+" patch_lines "${patch}")
+FOREACH(line ${patch_lines})
+	IF(line MATCHES "^D (.*)$")
+		LIST(FIND lines "${CMAKE_MATCH_1}" index)
+		IF(index EQUAL -1)
+			MESSAGE(FATAL_ERROR "Deleted statement not in ${FROM}: ${CMAKE_MATCH_1}")
+		ENDIF(index EQUAL -1)
+		LIST(REMOVE_AT lines ${index})
+	ELSEIF(line MATCHES "^A (.*)$")
+		LIST(APPEND lines "${CMAKE_MATCH_1}")
+	ELSE()
+		MESSAGE(FATAL_ERROR "Bad patch line: ${line}")
+	ENDIF()
+ENDFOREACH(line)
+
+STRING(REPLACE ";" "\n" patched "${lines}")
+FILE(WRITE ${OUTPUT} "${patched}\n")
+
+EXECUTE_PROCESS(
+	COMMAND ${RDFDIFF} -f ntriples -t ntriples ${OUTPUT} ${TO}
+	TIMEOUT 10
+	OUTPUT_QUIET
+	ERROR_VARIABLE rdfdiff_errors
+	RESULT_VARIABLE rdfdiff_status
+)
+IF(NOT rdfdiff_status EQUAL 0)
+	MESSAGE(FATAL_ERROR "Patched ${FROM} differs from ${TO}:\n${rdfdiff_errors}")
+ENDIF(NOT rdfdiff_status EQUAL 0)
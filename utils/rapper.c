@@ -60,6 +60,7 @@ extern char *optarg;
 #endif
 
 static void print_triples(void *user_data, raptor_statement *statement);
+static void print_triple_batch(void *user_data, raptor_statement **statements, int statements_count);
 static void print_graph(void *user_data, raptor_uri *graph, int flags);
 static void print_namespaces(void* user_data, raptor_namespace *nspace);
 static void relay_namespaces(void* user_data, raptor_namespace *nspace);
@@ -80,6 +81,11 @@ static long triple_count = 0;
 
 static raptor_serializer* serializer = NULL;
 
+/* hand statements to the serializer in batches */
+static int serialize_batches = 0;
+
+#define RAPPER_SERIALIZE_BATCH_SIZE 4096
+
 static int guess = 0;
 
 static int reported_guess = 0;
@@ -114,11 +120,23 @@ void print_triples(void *user_data, raptor_statement *triple)
         *s=' ';
   }
 
+  if(serialize_batches)
+    return;
+
   raptor_serializer_serialize_statement(serializer, triple);
   return;
 }
 
 
+static
+void print_triple_batch(void *user_data, raptor_statement **statements,
+                        int statements_count)
+{
+  raptor_serializer_serialize_statements(serializer, statements,
+                                         statements_count);
+}
+
+
 static
 void print_graph(void *user_data, raptor_uri *graph, int flags)
 {
@@ -184,7 +202,7 @@ relay_namespaces(void* user_data, raptor_namespace *nspace)
 #endif
 
 
-#define GETOPT_STRING "cef:ghi:I:o:O:qrtvw"
+#define GETOPT_STRING "cef:ghi:I:o:O:qrtvwz:"
 
 #ifdef HAVE_GETOPT_LONG
 #define SHOW_NAMESPACES_FLAG 0x100
@@ -209,6 +227,7 @@ static const struct option long_options[] =
   {"trace", 0, 0, 't'},
   {"version", 0, 0, 'v'},
   {"ignore-warnings", 0, 0, 'w'},
+  {"compress", 1, 0, 'z'},
   {NULL, 0, 0, 0}
 };
 #endif
@@ -330,6 +349,8 @@ main(int argc, char *argv[])
   raptor_uri *output_base_uri = NULL;
   raptor_sequence* serializer_options = NULL;
   raptor_sequence *namespace_declarations = NULL;
+  raptor_compression_type output_compression = RAPTOR_COMPRESSION_NONE;
+  raptor_iostream* output_iostr = NULL;
 
   /* other variables */
   int rc;
@@ -467,7 +488,9 @@ main(int argc, char *argv[])
               }
 
               name_len = od->name_len;
-              if(!strncmp(optarg, od->name, name_len)) {
+              /* the whole name: one option name may start another */
+              if(!strncmp(optarg, od->name, name_len) &&
+                 (optarg[name_len] == '=' || !optarg[name_len])) {
                 fv = (option_value*)raptor_calloc_memory(sizeof(option_value),
                                                          1);
 
@@ -567,6 +590,32 @@ main(int argc, char *argv[])
         if(optarg)
           output_base_uri_string = (const unsigned char*)optarg;
         break;
+
+      case 'z':
+        if(optarg) {
+          int i;
+
+          for(i = 0; i <= RAPTOR_COMPRESSION_LAST; i++) {
+            if(!strcmp(optarg, raptor_compression_type_get_name((raptor_compression_type)i)))
+              break;
+          }
+          if(i <= RAPTOR_COMPRESSION_LAST &&
+             raptor_compression_type_is_available((raptor_compression_type)i))
+            output_compression = (raptor_compression_type)i;
+          else {
+            fprintf(stderr,
+                    "%s: invalid argument `%s' for `" HELP_ARG(z, compress) "'\n",
+                    program, optarg);
+            fprintf(stderr, "Valid arguments are:\n");
+            for(i = 0; i <= RAPTOR_COMPRESSION_LAST; i++) {
+              if(raptor_compression_type_is_available((raptor_compression_type)i))
+                fprintf(stderr, "  %s\n",
+                        raptor_compression_type_get_name((raptor_compression_type)i));
+            }
+            usage = 1;
+          }
+        }
+        break;
         
       case 'i':
         if(optarg) {
@@ -700,6 +749,13 @@ main(int argc, char *argv[])
         putchar('\n');
     }
     puts(HELP_TEXT("O URI", "output-uri URI  ", "Set the output/serializer base URI. '-' for none.")  HELP_PAD "    Default is input/parser base URI.");
+    puts(HELP_TEXT("z TYPE", "compress TYPE   ", "Compress the output with one of:"));
+    for(i = 1; i <= RAPTOR_COMPRESSION_LAST; i++) {
+      if(raptor_compression_type_is_available((raptor_compression_type)i))
+        printf("    %s\n",
+               raptor_compression_type_get_name((raptor_compression_type)i));
+    }
+    puts("    Compressed input is always detected and read.");
     putchar('\n');
 
     puts("General options:");
@@ -726,6 +782,34 @@ main(int argc, char *argv[])
   }
 
 
+  /* parseThreads workers share URIs so need a thread-safe world, which
+   * gives up routing libxml errors.  Only pay for that when asked and
+   * reopen the world now the options are known. */
+  if(parser_options) {
+    int i;
+    option_value *fv;
+
+    for(i = 0;
+        (fv = (option_value*)raptor_sequence_get_at(parser_options, i));
+        i++) {
+      if(fv->option == RAPTOR_OPTION_PARSE_THREADS && fv->i_value > 1)
+        break;
+    }
+
+    if(fv) {
+      raptor_free_world(world);
+      world = raptor_new_world();
+      if(!world)
+        exit(1);
+      /* fails without thread support, when parseThreads is ignored */
+      (void)raptor_world_set_flag(world, RAPTOR_WORLD_FLAG_THREAD_SAFE, 1);
+      rc = raptor_world_open(world);
+      if(rc)
+        exit(1);
+    }
+  }
+
+
   if(optind == argc-1)
     uri_string = (unsigned char*)argv[optind];
   else {
@@ -900,8 +984,31 @@ main(int argc, char *argv[])
       serializer_options = NULL;
     }
 
-    raptor_serializer_start_to_file_handle(serializer, 
-                                          output_base_uri, stdout);
+    /* serializer threads format whole batches of statements */
+    if(!count &&
+       raptor_serializer_get_option(serializer, RAPTOR_OPTION_WRITE_THREADS,
+                                    NULL, &serialize_batches) == 0 &&
+       serialize_batches > 1)
+      raptor_parser_set_statement_batch_handler(rdf_parser, rdf_parser,
+                                                print_triple_batch,
+                                                RAPPER_SERIALIZE_BATCH_SIZE);
+    else
+      serialize_batches = 0;
+
+    if(output_compression != RAPTOR_COMPRESSION_NONE) {
+      output_iostr = raptor_new_iostream_to_compressed_file_handle(world,
+                                                                   stdout,
+                                                                   output_compression);
+      if(!output_iostr) {
+        fprintf(stderr, "%s: Failed to create %s compressed output\n",
+                program, raptor_compression_type_get_name(output_compression));
+        return(1);
+      }
+      raptor_serializer_start_to_iostream(serializer, output_base_uri,
+                                          output_iostr);
+    } else
+      raptor_serializer_start_to_file_handle(serializer, 
+                                            output_base_uri, stdout);
 
     if(!report_namespace)
       raptor_parser_set_namespace_handler(rdf_parser, serializer,
@@ -933,6 +1040,8 @@ main(int argc, char *argv[])
     raptor_serializer_serialize_end(serializer);
     raptor_free_serializer(serializer);
   }
+  if(output_iostr)
+    raptor_free_iostream(output_iostr);
   
 
   if(!quiet) {
@@ -5,22 +5,38 @@
  * Copyright (C) 2000-2008, David Beckett http://www.dajobe.org/
  * Copyright (C) 2000-2005, University of Bristol, UK http://www.bristol.ac.uk/
  * Copyright (C) 2005, Steve Shepard steveshep@gmail.com
- * 
+ *
  * This package is Free Software and part of Redland http://librdf.org/
- * 
+ *
  * It is licensed under the following three licenses as alternatives:
  *   1. GNU Lesser General Public License (LGPL) V2.1 or any newer version
  *   2. GNU General Public License (GPL) V2 or any newer version
  *   3. Apache License, V2.0 or any newer version
- * 
+ *
  * You may not use this file except in compliance with at least one of
  * the above three licenses.
- * 
+ *
  * See LICENSE.html or LICENSE.txt at the top of this package for the
  * complete terms and further detail along with the license texts for
  * the licenses in COPYING.LIB, COPYING and LICENSE-2.0.txt respectively.
- * 
- * 
+ *
+ * Statements are stored as arrays of term references in hash sets.
+ * URI and literal terms are interned in one table shared by both
+ * files so equal terms have equal references and statements without
+ * blank nodes are compared by a hash lookup.
+ *
+ * Blank nodes are matched between the files by colour refinement:
+ * every blank node starts with the same colour and is repeatedly
+ * given a new colour hashed from its old colour and the multiset of
+ * statements it appears in, with other blank nodes replaced by their
+ * colours, until no colour class splits.  Blank nodes still sharing a
+ * colour are then paired between the files, at most one per connected
+ * group of blank nodes and colour at a time, given a new common colour
+ * and the refinement repeated.  Blank nodes left without an equal
+ * colour in the other file, such as those near a difference, are paired
+ * by the colours of earlier rounds.  Statements are finally compared
+ * with each blank node replaced by the one it is paired with.
+ *
  */
 
 
@@ -61,6 +77,7 @@
 #ifndef RAPTOR_INTERNAL
 #define RAPTOR_MALLOC(type, size)		(type)malloc(size)
 #define RAPTOR_CALLOC(type, nmemb, size)	(type)calloc(nmemb, size)
+#define RAPTOR_REALLOC(type, ptr, size)		(type)realloc(ptr, size)
 #define RAPTOR_FREE(type, ptr)			free((void*)ptr)
 #endif
 
@@ -69,11 +86,7 @@ extern int optind;
 extern char *optarg;
 #endif
 
-#define MAX_ASCII_INT_SIZE 13
-#define RDF_NAMESPACE_URI_LEN 43
-#define ORDINAL_STRING_LEN (RDF_NAMESPACE_URI_LEN + MAX_ASCII_INT_SIZE + 1)
-
-#define GETOPT_STRING "bhf:t:u:"
+#define GETOPT_STRING "bhpf:t:u:"
 
 #ifdef HAVE_GETOPT_LONG
 static const struct option long_options[] =
@@ -81,6 +94,7 @@ static const struct option long_options[] =
   /* name, has_arg, flag, val */
   {"brief"       , 0, 0, 'b'},
   {"help"        , 0, 0, 'h'},
+  {"patch"       , 0, 0, 'p'},
   {"from-format" , 1, 0, 'f'},
   {"to-format"   , 1, 0, 't'},
   {"base-uri"    , 1, 0, 'u'},
@@ -98,36 +112,100 @@ static const struct option long_options[] =
 #define HELP_PAD "\n      "
 #endif
 
-typedef struct rdfdiff_link_s {
-  struct rdfdiff_link_s *next;
-  raptor_statement *statement;
-} rdfdiff_link;
 
-typedef struct rdfdiff_blank_s {
-  struct rdfdiff_blank_s *next;
-  raptor_world *world;
-  char *blank_id;
-  raptor_statement *owner;
-  rdfdiff_link *first;
-  rdfdiff_link *last;
+/* A term reference: an index into the shared term table or, with
+ * RDFDIFF_BLANK set, into the blank nodes of one file */
+typedef unsigned int rdfdiff_ref;
+
+#define RDFDIFF_BLANK 0x80000000U
+#define RDFDIFF_NO_GRAPH 0xFFFFFFFFU
+
+#define RDFDIFF_IS_BLANK(ref) \
+  ((ref) != RDFDIFF_NO_GRAPH && ((ref) & RDFDIFF_BLANK))
+
+typedef unsigned long long rdfdiff_hash;
+
+/* subject, predicate, object and graph references */
+#define RDFDIFF_TERMS 4
+
+/* rounds of colours kept to pair blank nodes whose colours differ */
+#define RDFDIFF_HISTORY 32
+
+typedef struct {
+  rdfdiff_ref refs[RDFDIFF_TERMS];
   int matched;
-} rdfdiff_blank;
+} rdfdiff_statement;
+
+/* An open addressing hash index of items numbered from 0 */
+typedef struct {
+  unsigned int hash;
+  /* item + 1; 0 if the slot is empty */
+  unsigned int item;
+} rdfdiff_slot;
+
+typedef struct {
+  rdfdiff_slot* slots;
+  /* number of slots; a power of 2 */
+  unsigned int size;
+  unsigned int count;
+} rdfdiff_index;
+
+typedef int (*rdfdiff_index_equals)(void* user_data, unsigned int item);
 
 typedef struct {
   raptor_world *world;
   char *name;
   raptor_parser *parser;
-  rdfdiff_link *first;
-  rdfdiff_link *last;
-  rdfdiff_blank *first_blank;
-  rdfdiff_blank *last_blank;
+
+  /* distinct statements in parsing order */
+  rdfdiff_statement* statements;
+  unsigned int statements_size;
+  rdfdiff_index statement_index;
+
+  /* blank nodes */
+  raptor_term** blanks;
+  unsigned int blank_count;
+  unsigned int blanks_size;
+  rdfdiff_index blank_index;
+
+  /* blank node colours; adjacency lists of statement * RDFDIFF_TERMS +
+   * term position for each blank node; connected group of each blank
+   * node */
+  rdfdiff_hash* colours;
+  rdfdiff_hash* new_colours;
+  unsigned int* adjacency_offsets;
+  unsigned int* adjacency;
+  unsigned int* groups;
+
+  /* colours of the first RDFDIFF_HISTORY rounds of the first refinement */
+  rdfdiff_hash* history;
+  unsigned int history_count;
+
+  /* blank node of the other file each blank node is paired with */
+  unsigned int* pairs;
+
+  /* blank nodes written for each blank node in a patch, labelled for
+   * the other file.  Allocated on the first use. */
+  raptor_term** patch_blanks;
+  /* number used for the next new patch blank node label */
+  unsigned int patch_blank_id;
+
   int statement_count;
   int error_count;
   int warning_count;
   int difference_count;
 } rdfdiff_file;
 
+/* URI and literal terms shared by both files */
+typedef struct {
+  raptor_term** terms;
+  unsigned int count;
+  unsigned int size;
+  rdfdiff_index index;
+} rdfdiff_terms;
+
 static int brief = 0;
+static int patch = 0;
 static char *program = NULL;
 static const char * const title_string="Raptor RDF diff utility";
 static int ignore_errors = 0;
@@ -137,17 +215,11 @@ static int emit_to_header = 1;
 
 static rdfdiff_file* from_file = NULL;
 static rdfdiff_file*to_file = NULL;
+static rdfdiff_terms terms;
 
 static rdfdiff_file* rdfdiff_new_file(raptor_world* world, const unsigned char *name, const char *syntax);
 static void rdfdiff_free_file(rdfdiff_file* file);
 
-static rdfdiff_blank *rdfdiff_find_blank(rdfdiff_blank *first, char *blank_id);
-static rdfdiff_blank *rdfdiff_new_blank(raptor_world *world, char *blank_id);
-static void rdfdiff_free_blank(rdfdiff_blank *blank);
-
-static int  rdfdiff_blank_equals(const rdfdiff_blank *b1, const rdfdiff_blank *b2,
-                                 rdfdiff_file*b1_file, rdfdiff_file*b2_file);
-
 static void rdfdiff_log_handler(void *data, raptor_log_message *message);
 
 static void rdfdiff_collect_statements(void *user_data, raptor_statement *statement);
@@ -155,22 +227,196 @@ static void rdfdiff_collect_statements(void *user_data, raptor_statement *statem
 int main(int argc, char *argv[]);
 
 
-/* Version of strcmp that can take NULL parameters. Assume that
- * Non-NULL strings are lexically greater than NULL strings 
+/* Hash constants for terms that are not blank nodes */
+#define RDFDIFF_HASH_SEED      0x9e3779b97f4a7c15ULL
+#define RDFDIFF_HASH_NO_GRAPH  0x2545f4914f6cdd1dULL
+#define RDFDIFF_HASH_SELF      0x4cf5ad432745937fULL
+#define RDFDIFF_HASH_PAIR      0xd6e8feb86659fd93ULL
+
+/* 64 bit finalizer (splitmix64) */
+static rdfdiff_hash
+rdfdiff_mix(rdfdiff_hash h)
+{
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+
+/* FNV-1a over a counted string */
+static rdfdiff_hash
+rdfdiff_hash_bytes(rdfdiff_hash h, const unsigned char* s, size_t len)
+{
+  while(len--) {
+    h ^= *s++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+
+static rdfdiff_hash
+rdfdiff_hash_uri(rdfdiff_hash h, raptor_uri* uri)
+{
+  const unsigned char* s;
+  size_t len;
+
+  if(!uri)
+    return h;
+  s = raptor_uri_as_counted_string(uri, &len);
+  return rdfdiff_hash_bytes(h, s, len);
+}
+
+
+static unsigned int
+rdfdiff_hash_term(raptor_term* term)
+{
+  rdfdiff_hash h = 0xcbf29ce484222325ULL ^ (rdfdiff_hash)term->type;
+
+  if(term->type == RAPTOR_TERM_TYPE_URI)
+    h = rdfdiff_hash_uri(h, term->value.uri);
+  else if(term->type == RAPTOR_TERM_TYPE_LITERAL) {
+    h = rdfdiff_hash_bytes(h, term->value.literal.string,
+                           term->value.literal.string_len);
+    h = rdfdiff_hash_bytes(h ^ 1, term->value.literal.language,
+                           term->value.literal.language_len);
+    h = rdfdiff_hash_uri(h ^ 2, term->value.literal.datatype);
+  } else if(term->type == RAPTOR_TERM_TYPE_BLANK)
+    h = rdfdiff_hash_bytes(h, term->value.blank.string,
+                           term->value.blank.string_len);
+
+  return (unsigned int)rdfdiff_mix(h);
+}
+
+
+static unsigned int
+rdfdiff_hash_refs(const rdfdiff_ref* refs)
+{
+  rdfdiff_hash h = RDFDIFF_HASH_SEED;
+  int i;
+
+  for(i = 0; i < RDFDIFF_TERMS; i++)
+    h = rdfdiff_mix(h ^ refs[i]);
+
+  return (unsigned int)h;
+}
+
+
+static int
+rdfdiff_index_grow(rdfdiff_index* index)
+{
+  unsigned int new_size = index->size ? index->size << 1 : 1024;
+  rdfdiff_slot* slots;
+  unsigned int i;
+
+  slots = RAPTOR_CALLOC(rdfdiff_slot*, new_size, sizeof(*slots));
+  if(!slots)
+    return 1;
+
+  for(i = 0; i < index->size; i++) {
+    rdfdiff_slot* slot = &index->slots[i];
+    unsigned int j;
+
+    if(!slot->item)
+      continue;
+    for(j = slot->hash & (new_size - 1); slots[j].item;
+        j = (j + 1) & (new_size - 1))
+      ;
+    slots[j] = *slot;
+  }
+
+  if(index->slots)
+    RAPTOR_FREE(rdfdiff_slot*, index->slots);
+  index->slots = slots;
+  index->size = new_size;
+
+  return 0;
+}
+
+
+/*
+ * rdfdiff_index_find:
+ * @index: index
+ * @hash: hash of the item to find
+ * @equals: function returning non-0 if an item is the one to find
+ * @user_data: user data for @equals
+ *
+ * Return value: item or -1 if not found
  */
+static long
+rdfdiff_index_find(rdfdiff_index* index, unsigned int hash,
+                   rdfdiff_index_equals equals, void* user_data)
+{
+  unsigned int i;
+
+  if(!index->size)
+    return -1;
+
+  for(i = hash & (index->size - 1); index->slots[i].item;
+      i = (i + 1) & (index->size - 1)) {
+    rdfdiff_slot* slot = &index->slots[i];
+
+    if(slot->hash == hash && equals(user_data, slot->item - 1))
+      return (long)(slot->item - 1);
+  }
+
+  return -1;
+}
+
+
+static int
+rdfdiff_index_add(rdfdiff_index* index, unsigned int hash, unsigned int item)
+{
+  unsigned int i;
+
+  /* keep at most half the slots used */
+  if((index->count + 1) * 2 > index->size && rdfdiff_index_grow(index))
+    return 1;
+
+  for(i = hash & (index->size - 1); index->slots[i].item;
+      i = (i + 1) & (index->size - 1))
+    ;
+  index->slots[i].hash = hash;
+  index->slots[i].item = item + 1;
+  index->count++;
+
+  return 0;
+}
+
+
+static void
+rdfdiff_index_clear(rdfdiff_index* index)
+{
+  if(index->slots)
+    RAPTOR_FREE(rdfdiff_slot*, index->slots);
+  index->slots = NULL;
+  index->size = 0;
+  index->count = 0;
+}
+
+
+/* Grow an array of @item_size items to hold at least @count items */
 static int
-safe_strcmp(const char *s1, const char *s2)
+rdfdiff_reserve(void** array_p, unsigned int* size_p, unsigned int count,
+                size_t item_size)
 {
-  if(s1 == NULL && s2 == NULL) {
+  unsigned int new_size;
+  void* array;
+
+  if(count <= *size_p)
     return 0;
-  } else if(s1 == NULL && s2 != NULL) {
-    return -1;
-  } else if(s1 != NULL && s2 == NULL) {
+
+  new_size = *size_p ? *size_p << 1 : 1024;
+  array = RAPTOR_REALLOC(void*, *array_p, new_size * item_size);
+  if(!array)
     return 1;
-  } else {
-    return strcmp(s1, s2);
-  }
-  
+
+  *array_p = array;
+  *size_p = new_size;
+  return 0;
 }
 
 
@@ -187,11 +433,11 @@ rdfdiff_new_file(raptor_world *world, const unsigned char *name, const char *syn
       return(0);
     }
     memcpy(file->name, name, name_len + 1);
-    
+
     file->parser = raptor_new_parser(world, syntax);
     if(file->parser) {
       raptor_world_set_log_handler(world, file, rdfdiff_log_handler);
-    } else {      
+    } else {
       fprintf(stderr, "%s: Failed to create raptor parser type %s for %s\n",
               program, syntax, name);
       rdfdiff_free_file(file);
@@ -200,523 +446,1325 @@ rdfdiff_new_file(raptor_world *world, const unsigned char *name, const char *syn
 
 
   }
-  
-  return file;  
+
+  return file;
 }
 
 
 static void
-rdfdiff_free_file(rdfdiff_file* file) 
+rdfdiff_free_file(rdfdiff_file* file)
 {
-  rdfdiff_link *cur, *next;
-  rdfdiff_blank *cur1, *next1;
-  
+  unsigned int i;
+
   if(file->name)
     RAPTOR_FREE(char*, file->name);
 
-  if(file->parser)
-    raptor_free_parser(file->parser);
-  
-  for(cur = file->first; cur; cur = next) {
-    next = cur->next;
+  if(file->parser)
+    raptor_free_parser(file->parser);
+
+  if(file->statements)
+    RAPTOR_FREE(rdfdiff_statement*, file->statements);
+  rdfdiff_index_clear(&file->statement_index);
+
+  for(i = 0; i < file->blank_count; i++)
+    raptor_free_term(file->blanks[i]);
+  if(file->blanks)
+    RAPTOR_FREE(raptor_term**, file->blanks);
+  rdfdiff_index_clear(&file->blank_index);
+
+  if(file->patch_blanks) {
+    for(i = 0; i < file->blank_count; i++)
+      raptor_free_term(file->patch_blanks[i]);
+    RAPTOR_FREE(raptor_term**, file->patch_blanks);
+  }
+
+  if(file->colours)
+    RAPTOR_FREE(rdfdiff_hash*, file->colours);
+  if(file->new_colours)
+    RAPTOR_FREE(rdfdiff_hash*, file->new_colours);
+  if(file->adjacency_offsets)
+    RAPTOR_FREE(unsigned int*, file->adjacency_offsets);
+  if(file->adjacency)
+    RAPTOR_FREE(unsigned int*, file->adjacency);
+  if(file->groups)
+    RAPTOR_FREE(unsigned int*, file->groups);
+  if(file->history)
+    RAPTOR_FREE(rdfdiff_hash*, file->history);
+  if(file->pairs)
+    RAPTOR_FREE(unsigned int*, file->pairs);
+
+  RAPTOR_FREE(rdfdiff_file, file);
+
+}
+
+
+static void
+rdfdiff_free_terms(void)
+{
+  unsigned int i;
+
+  for(i = 0; i < terms.count; i++)
+    raptor_free_term(terms.terms[i]);
+  if(terms.terms)
+    RAPTOR_FREE(raptor_term**, terms.terms);
+  rdfdiff_index_clear(&terms.index);
+}
+
+
+static void
+rdfdiff_log_handler(void *data, raptor_log_message *message)
+{
+  rdfdiff_file* file = (rdfdiff_file*)data;
+
+   switch(message->level) {
+    case RAPTOR_LOG_LEVEL_FATAL:
+    case RAPTOR_LOG_LEVEL_ERROR:
+      if(!ignore_errors) {
+        fprintf(stderr, "%s: Error - ", program);
+        raptor_locator_print(message->locator, stderr);
+        fprintf(stderr, " - %s\n", message->text);
+
+        raptor_parser_parse_abort(file->parser);
+      }
+
+      file->error_count++;
+      break;
+
+    case RAPTOR_LOG_LEVEL_WARN:
+      if(!ignore_warnings) {
+        fprintf(stderr, "%s: Warning - ", program);
+        raptor_locator_print(message->locator, stderr);
+        fprintf(stderr, " - %s\n", message->text);
+      }
+
+      file->warning_count++;
+      break;
+
+    case RAPTOR_LOG_LEVEL_NONE:
+    case RAPTOR_LOG_LEVEL_TRACE:
+    case RAPTOR_LOG_LEVEL_DEBUG:
+    case RAPTOR_LOG_LEVEL_INFO:
+
+      fprintf(stderr, "%s: Unexpected %s message - ", program,
+              raptor_log_level_get_label(message->level));
+      raptor_locator_print(message->locator, stderr);
+      fprintf(stderr, " - %s\n", message->text);
+      break;
+  }
+
+}
+
+
+typedef struct {
+  raptor_term* term;
+  raptor_term** terms;
+} rdfdiff_term_key;
+
+static int
+rdfdiff_term_equals(void* user_data, unsigned int item)
+{
+  rdfdiff_term_key* key = (rdfdiff_term_key*)user_data;
+
+  return raptor_term_equals(key->terms[item], key->term);
+}
+
+
+static int
+rdfdiff_blank_equals(void* user_data, unsigned int item)
+{
+  rdfdiff_term_key* key = (rdfdiff_term_key*)user_data;
+  raptor_term* blank = key->terms[item];
+
+  return blank->value.blank.string_len == key->term->value.blank.string_len &&
+         !memcmp(blank->value.blank.string, key->term->value.blank.string,
+                 key->term->value.blank.string_len);
+}
+
+
+/*
+ * rdfdiff_term_ref:
+ * @file: file the term was found in
+ * @term: term or NULL
+ * @ref_p: pointer to store the reference
+ *
+ * Intern a term: URIs and literals in the shared term table, blank
+ * nodes in the blank nodes of @file.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rdfdiff_term_ref(rdfdiff_file* file, raptor_term* term, rdfdiff_ref* ref_p)
+{
+  rdfdiff_term_key key;
+  unsigned int hash;
+  long item;
+
+  if(!term) {
+    *ref_p = RDFDIFF_NO_GRAPH;
+    return 0;
+  }
+
+  hash = rdfdiff_hash_term(term);
+  key.term = term;
+
+  if(term->type == RAPTOR_TERM_TYPE_BLANK) {
+    key.terms = file->blanks;
+    item = rdfdiff_index_find(&file->blank_index, hash, rdfdiff_blank_equals,
+                              &key);
+    if(item < 0) {
+      if(file->blank_count == RDFDIFF_BLANK - 1 ||
+         rdfdiff_reserve((void**)&file->blanks, &file->blanks_size,
+                         file->blank_count + 1, sizeof(raptor_term*)))
+        return 1;
+      item = (long)file->blank_count;
+      if(rdfdiff_index_add(&file->blank_index, hash, (unsigned int)item))
+        return 1;
+      file->blanks[file->blank_count++] = raptor_term_copy(term);
+    }
+    *ref_p = RDFDIFF_BLANK | (rdfdiff_ref)item;
+    return 0;
+  }
+
+  key.terms = terms.terms;
+  item = rdfdiff_index_find(&terms.index, hash, rdfdiff_term_equals, &key);
+  if(item < 0) {
+    if(terms.count == RDFDIFF_BLANK - 1 ||
+       rdfdiff_reserve((void**)&terms.terms, &terms.size, terms.count + 1,
+                       sizeof(raptor_term*)))
+      return 1;
+    item = (long)terms.count;
+    if(rdfdiff_index_add(&terms.index, hash, (unsigned int)item))
+      return 1;
+    terms.terms[terms.count++] = raptor_term_copy(term);
+  }
+  *ref_p = (rdfdiff_ref)item;
+  return 0;
+}
+
+
+typedef struct {
+  const rdfdiff_ref* refs;
+  rdfdiff_statement* statements;
+} rdfdiff_refs_key;
+
+static int
+rdfdiff_refs_equals(void* user_data, unsigned int item)
+{
+  rdfdiff_refs_key* key = (rdfdiff_refs_key*)user_data;
+
+  return !memcmp(key->statements[item].refs, key->refs,
+                 sizeof(rdfdiff_ref) * RDFDIFF_TERMS);
+}
+
+
+/*
+ * rdfdiff_collect_statements - Called when parsing "from" and "to" files
+ * to build a set of statements for comparison.
+ */
+static void
+rdfdiff_collect_statements(void *user_data, raptor_statement *statement)
+{
+  rdfdiff_file* file = (rdfdiff_file*)user_data;
+  rdfdiff_ref refs[RDFDIFF_TERMS];
+  rdfdiff_refs_key key;
+  unsigned int hash;
+  rdfdiff_statement* s;
+
+  if(rdfdiff_term_ref(file, statement->subject, &refs[0]) ||
+     rdfdiff_term_ref(file, statement->predicate, &refs[1]) ||
+     rdfdiff_term_ref(file, statement->object, &refs[2]) ||
+     rdfdiff_term_ref(file, statement->graph, &refs[3]))
+    goto failed;
+
+  hash = rdfdiff_hash_refs(refs);
+  key.refs = refs;
+  key.statements = file->statements;
+  if(rdfdiff_index_find(&file->statement_index, hash, rdfdiff_refs_equals,
+                        &key) >= 0)
+    return;
+
+  if(rdfdiff_reserve((void**)&file->statements, &file->statements_size,
+                     (unsigned int)file->statement_count + 1,
+                     sizeof(rdfdiff_statement)) ||
+     rdfdiff_index_add(&file->statement_index, hash,
+                       (unsigned int)file->statement_count))
+    goto failed;
+
+  s = &file->statements[file->statement_count++];
+  memcpy(s->refs, refs, sizeof(refs));
+  s->matched = 0;
+  return;
+
+  failed:
+  fprintf(stderr, "%s: Internal Error\n", program);
+  raptor_parser_parse_abort(file->parser);
+}
+
+
+static unsigned int
+rdfdiff_find_group(unsigned int* groups, unsigned int blank)
+{
+  while(groups[blank] != blank) {
+    groups[blank] = groups[groups[blank]];
+    blank = groups[blank];
+  }
+  return blank;
+}
+
+
+/*
+ * rdfdiff_prepare_blanks:
+ * @file: file
+ *
+ * Build the blank node adjacency lists and connected groups and give
+ * every blank node the same initial colour.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rdfdiff_prepare_blanks(rdfdiff_file* file)
+{
+  unsigned int nblanks = file->blank_count;
+  unsigned int* offsets;
+  unsigned int total = 0;
+  unsigned int b;
+  int i;
+
+  file->colours = RAPTOR_MALLOC(rdfdiff_hash*,
+                                (nblanks + 1) * sizeof(rdfdiff_hash));
+  file->new_colours = RAPTOR_MALLOC(rdfdiff_hash*,
+                                    (nblanks + 1) * sizeof(rdfdiff_hash));
+  offsets = RAPTOR_CALLOC(unsigned int*, nblanks + 1, sizeof(unsigned int));
+  file->adjacency_offsets = offsets;
+  file->groups = RAPTOR_MALLOC(unsigned int*,
+                               (nblanks + 1) * sizeof(unsigned int));
+  file->history = RAPTOR_MALLOC(rdfdiff_hash*, (RDFDIFF_HISTORY * nblanks + 1) *
+                                sizeof(rdfdiff_hash));
+  file->pairs = RAPTOR_MALLOC(unsigned int*,
+                              (nblanks + 1) * sizeof(unsigned int));
+  if(!file->colours || !file->new_colours || !offsets || !file->groups ||
+     !file->history || !file->pairs)
+    return 1;
+
+  for(b = 0; b < nblanks; b++) {
+    file->colours[b] = RDFDIFF_HASH_SEED;
+    file->groups[b] = b;
+    file->pairs[b] = RDFDIFF_NO_GRAPH;
+  }
+
+  /* count occurrences, then fill in reverse into the counted ranges */
+  for(i = 0; i < file->statement_count; i++) {
+    rdfdiff_statement* s = &file->statements[i];
+    int j;
+
+    for(j = 0; j < RDFDIFF_TERMS; j++) {
+      if(RDFDIFF_IS_BLANK(s->refs[j])) {
+        offsets[s->refs[j] & ~RDFDIFF_BLANK]++;
+        total++;
+      }
+    }
+  }
+  for(b = 0; b < nblanks; b++)
+    offsets[b + 1] += offsets[b];
+
+  file->adjacency = RAPTOR_MALLOC(unsigned int*,
+                                  (total + 1) * sizeof(unsigned int));
+  if(!file->adjacency)
+    return 1;
+
+  for(i = file->statement_count - 1; i >= 0; i--) {
+    rdfdiff_statement* s = &file->statements[i];
+    unsigned int first = RDFDIFF_NO_GRAPH;
+    int j;
+
+    for(j = RDFDIFF_TERMS - 1; j >= 0; j--) {
+      unsigned int blank;
+
+      if(!RDFDIFF_IS_BLANK(s->refs[j]))
+        continue;
+      blank = s->refs[j] & ~RDFDIFF_BLANK;
+      file->adjacency[--offsets[blank]] = (unsigned int)i * RDFDIFF_TERMS +
+                                          (unsigned int)j;
+
+      /* blank nodes in one statement are in one group */
+      if(first == RDFDIFF_NO_GRAPH)
+        first = blank;
+      else
+        file->groups[rdfdiff_find_group(file->groups, blank)] =
+          rdfdiff_find_group(file->groups, first);
+    }
+  }
+
+  for(b = 0; b < nblanks; b++)
+    file->groups[b] = rdfdiff_find_group(file->groups, b);
+
+  return 0;
+}
+
+
+static rdfdiff_hash
+rdfdiff_ref_colour(rdfdiff_file* file, rdfdiff_ref ref)
+{
+  if(ref == RDFDIFF_NO_GRAPH)
+    return RDFDIFF_HASH_NO_GRAPH;
+  if(ref & RDFDIFF_BLANK)
+    return file->colours[ref & ~RDFDIFF_BLANK];
+  return rdfdiff_mix(RDFDIFF_HASH_SEED + ref);
+}
+
+
+/* New colour of a blank node from its colour and its statements */
+static rdfdiff_hash
+rdfdiff_blank_colour(rdfdiff_file* file, unsigned int b)
+{
+  rdfdiff_hash sum = 0;
+  unsigned int a;
+
+  for(a = file->adjacency_offsets[b]; a < file->adjacency_offsets[b + 1];
+      a++) {
+    rdfdiff_statement* s = &file->statements[file->adjacency[a] /
+                                             RDFDIFF_TERMS];
+    unsigned int position = file->adjacency[a] % RDFDIFF_TERMS;
+    rdfdiff_hash h = rdfdiff_mix(RDFDIFF_HASH_SEED * (position + 1));
+    unsigned int j;
+
+    for(j = 0; j < RDFDIFF_TERMS; j++)
+      h = rdfdiff_mix(h ^ (j == position ? RDFDIFF_HASH_SELF :
+                           rdfdiff_ref_colour(file, s->refs[j])));
+    /* order independent sum over the statements */
+    sum += h;
+  }
+
+  return rdfdiff_mix(file->colours[b] ^ rdfdiff_mix(sum));
+}
+
+
+/* Give each blank node a colour from its colour and its statements */
+static void
+rdfdiff_refine_colours(rdfdiff_file* file)
+{
+  unsigned int b;
+  rdfdiff_hash* swap;
+
+  for(b = 0; b < file->blank_count; b++)
+    file->new_colours[b] = rdfdiff_blank_colour(file, b);
+
+  swap = file->colours;
+  file->colours = file->new_colours;
+  file->new_colours = swap;
+}
+
+
+/* Count distinct colours of the blank nodes of a file */
+static long
+rdfdiff_count_colours(rdfdiff_file* file)
+{
+  unsigned int size = 16;
+  rdfdiff_hash* set;
+  long count = 0;
+  unsigned int b;
+
+  while(size < file->blank_count * 2)
+    size <<= 1;
+  set = RAPTOR_CALLOC(rdfdiff_hash*, size, sizeof(rdfdiff_hash));
+  if(!set)
+    return -1;
+
+  for(b = 0; b < file->blank_count; b++) {
+    /* 0 marks an empty slot */
+    rdfdiff_hash colour = file->colours[b] ? file->colours[b] : 1;
+    unsigned int i;
+
+    for(i = (unsigned int)colour & (size - 1); set[i] && set[i] != colour;
+        i = (i + 1) & (size - 1))
+      ;
+    if(!set[i]) {
+      set[i] = colour;
+      count++;
+    }
+  }
+
+  RAPTOR_FREE(rdfdiff_hash*, set);
+  return count;
+}
+
+
+static void
+rdfdiff_record_colours(rdfdiff_file* file)
+{
+  rdfdiff_hash* round;
+
+  /* later rounds depend on more distant statements so are less use */
+  if(file->history_count == RDFDIFF_HISTORY)
+    return;
+
+  round = file->history + file->history_count++ * file->blank_count;
+  memcpy(round, file->colours, file->blank_count * sizeof(rdfdiff_hash));
+}
+
+
+/* Refine colours of both files until no colour class splits in
+ * either file, keeping the colours of each round.
+ * Colours of the two files are not compared: near a difference they
+ * drift apart one statement further each round */
+static int
+rdfdiff_refine_until_stable(rdfdiff_file* f1, rdfdiff_file* f2)
+{
+  long count1 = rdfdiff_count_colours(f1);
+  long count2 = rdfdiff_count_colours(f2);
+
+  while(count1 >= 0 && count2 >= 0) {
+    long new_count1;
+    long new_count2;
+
+    rdfdiff_refine_colours(f1);
+    rdfdiff_refine_colours(f2);
+    rdfdiff_record_colours(f1);
+    rdfdiff_record_colours(f2);
+    new_count1 = rdfdiff_count_colours(f1);
+    new_count2 = rdfdiff_count_colours(f2);
+    if(new_count1 == count1 && new_count2 == count2)
+      return 0;
+    count1 = new_count1;
+    count2 = new_count2;
+  }
+
+  return 1;
+}
+
+
+typedef struct {
+  rdfdiff_hash colour;
+  unsigned int file;
+  unsigned int group;
+  unsigned int blank;
+} rdfdiff_member;
+
+static int
+rdfdiff_member_compare(const void* a, const void* b)
+{
+  const rdfdiff_member* m1 = (const rdfdiff_member*)a;
+  const rdfdiff_member* m2 = (const rdfdiff_member*)b;
+
+  if(m1->colour != m2->colour)
+    return (m1->colour < m2->colour) ? -1 : 1;
+  if(m1->file != m2->file)
+    return (m1->file < m2->file) ? -1 : 1;
+  if(m1->group != m2->group)
+    return (m1->group < m2->group) ? -1 : 1;
+  return (m1->blank > m2->blank) - (m1->blank < m2->blank);
+}
+
+
+static int
+rdfdiff_hash_compare(const void* a, const void* b)
+{
+  rdfdiff_hash h1 = *(const rdfdiff_hash*)a;
+  rdfdiff_hash h2 = *(const rdfdiff_hash*)b;
+
+  return (h1 > h2) - (h1 < h2);
+}
+
+
+/* Sort the colours of @count blank nodes into @sorted and return the
+ * number of distinct colours */
+static unsigned int
+rdfdiff_sort_colours(rdfdiff_file* file, const unsigned int* blanks,
+                     unsigned int count, rdfdiff_hash* sorted)
+{
+  unsigned int distinct = 0;
+  unsigned int i;
+
+  for(i = 0; i < count; i++)
+    sorted[i] = file->colours[blanks[i]];
+  qsort(sorted, count, sizeof(rdfdiff_hash), rdfdiff_hash_compare);
+
+  for(i = 0; i < count; i++) {
+    if(!i || sorted[i] != sorted[i - 1])
+      distinct++;
+  }
+
+  return distinct;
+}
+
+
+/* One round of refinement of the blank nodes of one connected group;
+ * colours of a group depend only on the statements of the group */
+static void
+rdfdiff_refine_group(rdfdiff_file* file, const unsigned int* blanks,
+                     unsigned int count)
+{
+  unsigned int i;
 
-    raptor_free_statement(cur->statement);
-    RAPTOR_FREE(rdfdiff_link, cur);
-  }
+  for(i = 0; i < count; i++)
+    file->new_colours[blanks[i]] = rdfdiff_blank_colour(file, blanks[i]);
+  for(i = 0; i < count; i++)
+    file->colours[blanks[i]] = file->new_colours[blanks[i]];
+}
 
-  for(cur1 = file->first_blank; cur1; cur1 = next1) {
-    next1 = cur1->next;
 
-    rdfdiff_free_blank(cur1);
+/*
+ * rdfdiff_refine_groups:
+ * @f1: file
+ * @blanks1: blank nodes of a connected group of @f1
+ * @f2: other file
+ * @blanks2: blank nodes of a connected group of @f2
+ * @count: number of blank nodes in each group
+ * @sorted1: array of @count colours to use
+ * @sorted2: array of @count colours to use
+ *
+ * Refine the colours of the two groups until no colour class splits in
+ * either of them.
+ *
+ * Return value: non-0 if the two groups then have the same colours
+ */
+static int
+rdfdiff_refine_groups(rdfdiff_file* f1, const unsigned int* blanks1,
+                      rdfdiff_file* f2, const unsigned int* blanks2,
+                      unsigned int count,
+                      rdfdiff_hash* sorted1, rdfdiff_hash* sorted2)
+{
+  unsigned int count1 = rdfdiff_sort_colours(f1, blanks1, count, sorted1);
+  unsigned int count2 = rdfdiff_sort_colours(f2, blanks2, count, sorted2);
+
+  while(1) {
+    unsigned int new_count1;
+    unsigned int new_count2;
+
+    rdfdiff_refine_group(f1, blanks1, count);
+    rdfdiff_refine_group(f2, blanks2, count);
+    new_count1 = rdfdiff_sort_colours(f1, blanks1, count, sorted1);
+    new_count2 = rdfdiff_sort_colours(f2, blanks2, count, sorted2);
+    if(new_count1 == count1 && new_count2 == count2)
+      break;
+    count1 = new_count1;
+    count2 = new_count2;
   }
-  
-  RAPTOR_FREE(rdfdiff_file, file);  
-  
+
+  return !memcmp(sorted1, sorted2, count * sizeof(rdfdiff_hash));
 }
 
 
-static rdfdiff_blank *
-rdfdiff_new_blank(raptor_world* world, char *blank_id) 
+/* Position of the first blank node in a statement */
+static unsigned int
+rdfdiff_first_blank(rdfdiff_statement* s)
 {
-  rdfdiff_blank *blank = RAPTOR_CALLOC(rdfdiff_blank*, 1, sizeof(*blank));
-
-  if(blank) {
-    size_t blank_id_len = strlen(blank_id);
-    blank->world = world;
-    blank->blank_id = RAPTOR_MALLOC(char*, blank_id_len + 1);
-    if(!blank->blank_id) {
-      rdfdiff_free_blank(blank);
-      return NULL;
-    }
+  unsigned int j;
 
-    memcpy(blank->blank_id, blank_id, blank_id_len + 1);
-  }
-  
-  return blank;
+  for(j = 0; j < RDFDIFF_TERMS && !RDFDIFF_IS_BLANK(s->refs[j]); j++)
+    ;
+  return j;
 }
 
 
-static void
-rdfdiff_free_blank(rdfdiff_blank *blank) 
+/*
+ * rdfdiff_group_statements_match:
+ * @f1: file
+ * @blanks1: blank nodes of a connected group of @f1, all paired
+ * @f2: other file
+ * @blanks2: blank nodes of a connected group of @f2
+ * @count: number of blank nodes in each group
+ *
+ * Check that the statements of the two groups are the same with the
+ * blank nodes of @f1 replaced by those they are paired with.
+ *
+ * Return value: non-0 if the statements match
+ */
+static int
+rdfdiff_group_statements_match(rdfdiff_file* f1, const unsigned int* blanks1,
+                               rdfdiff_file* f2, const unsigned int* blanks2,
+                               unsigned int count)
 {
-  rdfdiff_link *cur, *next;
+  rdfdiff_refs_key key;
+  rdfdiff_ref refs[RDFDIFF_TERMS];
+  unsigned int statements1 = 0;
+  unsigned int statements2 = 0;
+  unsigned int i;
+
+  key.statements = f2->statements;
+  key.refs = refs;
+  for(i = 0; i < count; i++) {
+    unsigned int b = blanks1[i];
+    unsigned int a;
+
+    for(a = f1->adjacency_offsets[b]; a < f1->adjacency_offsets[b + 1]; a++) {
+      rdfdiff_statement* s = &f1->statements[f1->adjacency[a] /
+                                             RDFDIFF_TERMS];
+      unsigned int j;
+
+      /* each statement once, from its first blank node */
+      if(rdfdiff_first_blank(s) != f1->adjacency[a] % RDFDIFF_TERMS)
+        continue;
+      statements1++;
+
+      for(j = 0; j < RDFDIFF_TERMS; j++) {
+        refs[j] = s->refs[j];
+        if(RDFDIFF_IS_BLANK(refs[j]))
+          refs[j] = RDFDIFF_BLANK | f1->pairs[refs[j] & ~RDFDIFF_BLANK];
+      }
+      if(rdfdiff_index_find(&f2->statement_index, rdfdiff_hash_refs(refs),
+                            rdfdiff_refs_equals, &key) < 0)
+        return 0;
+    }
+  }
 
-  if(blank->blank_id)
-    RAPTOR_FREE(char*, blank->blank_id);
+  for(i = 0; i < count; i++) {
+    unsigned int b = blanks2[i];
+    unsigned int a;
 
-  if(blank->owner)
-    raptor_free_statement(blank->owner);
-  
-  for(cur = blank->first; cur; cur = next) {
-    next = cur->next;
+    for(a = f2->adjacency_offsets[b]; a < f2->adjacency_offsets[b + 1]; a++) {
+      rdfdiff_statement* s = &f2->statements[f2->adjacency[a] /
+                                             RDFDIFF_TERMS];
 
-    raptor_free_statement(cur->statement);
-    RAPTOR_FREE(rdfdiff_link, cur);
+      if(rdfdiff_first_blank(s) == f2->adjacency[a] % RDFDIFF_TERMS)
+        statements2++;
+    }
   }
 
-  RAPTOR_FREE(rdfdiff_blank, blank);
-  
+  return statements1 == statements2;
 }
 
 
+/* Pair the blank nodes of two groups by their colours, now all
+ * different, and check the statements; returns 1 if they match */
 static int
-rdfdiff_statement_equals(raptor_world *world, const raptor_statement *s1, const raptor_statement *s2)
+rdfdiff_pair_group_colours(rdfdiff_file* f1, const unsigned int* blanks1,
+                           rdfdiff_file* f2, const unsigned int* blanks2,
+                           unsigned int count)
 {
-  int rv = 0;
-  
-  if(!s1 || !s2)
-    return 0;
+  rdfdiff_member* members;
+  unsigned int i;
+  int rc;
 
-#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-  fprintf(stderr, "(rdfdiff_statement_equals) Comparing ");
-  raptor_statement_print_as_ntriples(s1, stderr);
-  fprintf(stderr, " to ");
-  raptor_statement_print_as_ntriples(s2, stderr);
-#endif
+  members = RAPTOR_MALLOC(rdfdiff_member*, 2 * count * sizeof(*members));
+  if(!members)
+    return -1;
 
-  /* normal comparison */
-  if(s1->subject->type != s2->subject->type) {
-    rv = 0;
-    goto done;
+  for(i = 0; i < count; i++) {
+    members[i].colour = f1->colours[blanks1[i]];
+    members[i].file = 0;
+    members[i].group = 0;
+    members[i].blank = blanks1[i];
+    members[count + i].colour = f2->colours[blanks2[i]];
+    members[count + i].file = 1;
+    members[count + i].group = 0;
+    members[count + i].blank = blanks2[i];
   }
+  qsort(members, 2 * count, sizeof(*members), rdfdiff_member_compare);
+  for(i = 0; i < 2 * count; i += 2) {
+    f1->pairs[members[i].blank] = members[i + 1].blank;
+    f2->pairs[members[i + 1].blank] = members[i].blank;
+  }
+  RAPTOR_FREE(rdfdiff_member*, members);
 
-  if(s1->subject->type == RAPTOR_TERM_TYPE_BLANK) {
-    /* Here for completeness. Anonymous nodes are taken care of
-     * elsewhere */
-    /*if(strcmp((const char *)s1->subject, (const char *)s2->subject->value) != 0)
-      return 0;*/
-  } else {
-    if(!raptor_uri_equals(s1->subject->value.uri,
-                          s2->subject->value.uri)) {
-      rv = 0;
-      goto done;
+  rc = rdfdiff_group_statements_match(f1, blanks1, f2, blanks2, count);
+  if(!rc) {
+    for(i = 0; i < count; i++) {
+      f1->pairs[blanks1[i]] = RDFDIFF_NO_GRAPH;
+      f2->pairs[blanks2[i]] = RDFDIFF_NO_GRAPH;
     }
   }
 
-  if(s1->predicate->type != s2->predicate->type) {
-    rv = 0;
-    goto done;
-  }
-  
-  if(!raptor_uri_equals(s1->predicate->value.uri,
-                        s2->predicate->value.uri)) {
-    rv = 0;
-    goto done;
-  }
-  
-  if(s1->object->type != s2->object->type) {
-    rv = 0;
-    goto done;
-  }
-  
-  if(s1->object->type == RAPTOR_TERM_TYPE_LITERAL) {
-    int equal;
-    
-    equal= !safe_strcmp((char *)s1->object->value.literal.string,
-                        (char *)s2->object->value.literal.string);
-
-    if(equal) {
-      if(s1->object->value.literal.language && s2->object->value.literal.language)
-        equal = !strcmp((char *)s1->object->value.literal.language,
-                        (char *)s2->object->value.literal.language);
-      else if(s1->object->value.literal.language || s2->object->value.literal.language)
-        equal = 0;
-      else
-        equal = 1;
+  return rc;
+}
 
-      if(equal)
-        equal = raptor_uri_equals(s1->object->value.literal.datatype, 
-                                  s2->object->value.literal.datatype);
-    }
 
-    rv = equal;
-    goto done;
-  } else if(s1->object->type == RAPTOR_TERM_TYPE_BLANK) {
-    /* Here for completeness. Anonymous nodes are taken care of
-     * elsewhere */
-    /* if(strcmp((const char *)s1->object, (const char *)s2->object->value) != 0)
-       return 0; */
-  } else {
-    if(!raptor_uri_equals(s1->object->value.uri,
-                          s2->object->value.uri)) {
-      rv = 0;
-      goto done;
+/*
+ * rdfdiff_search_group:
+ * @f1: file
+ * @blanks1: blank nodes of a connected group of @f1
+ * @f2: other file
+ * @blanks2: blank nodes of a connected group of @f2
+ * @count: number of blank nodes in each group
+ * @sorted1: sorted colours of @blanks1
+ * @sorted2: sorted colours of @blanks2, the same as @sorted1
+ * @pair: number of pairings made so far
+ *
+ * While blank nodes share a colour, pair the first of them in @f1 with
+ * one of that colour in @f2, give both a new colour and refine the
+ * groups again.  If the colours of the groups then differ, or no
+ * pairing of the rest of the blank nodes matches, the pairing is undone
+ * and the next blank node of @f2 with that colour is tried.
+ *
+ * Return value: 1 if the groups were paired, 0 if not or <0 on failure
+ */
+static int
+rdfdiff_search_group(rdfdiff_file* f1, const unsigned int* blanks1,
+                     rdfdiff_file* f2, const unsigned int* blanks2,
+                     unsigned int count,
+                     rdfdiff_hash* sorted1, rdfdiff_hash* sorted2,
+                     rdfdiff_hash* pair)
+{
+  rdfdiff_hash* step1;
+  rdfdiff_hash* step2;
+  rdfdiff_hash colour;
+  rdfdiff_hash new_colour;
+  unsigned int v;
+  unsigned int i;
+  unsigned int k;
+  int rc = 0;
+
+  /* the first colour shared by blank nodes */
+  for(i = 1; i < count && sorted1[i] != sorted1[i - 1]; i++)
+    ;
+  if(i >= count)
+    return rdfdiff_pair_group_colours(f1, blanks1, f2, blanks2, count);
+  colour = sorted1[i];
+
+  for(i = 0; f1->colours[blanks1[i]] != colour; i++)
+    ;
+  v = blanks1[i];
+
+  step1 = RAPTOR_MALLOC(rdfdiff_hash*, 2 * count * sizeof(rdfdiff_hash));
+  if(!step1)
+    return -1;
+  step2 = step1 + count;
+  for(i = 0; i < count; i++) {
+    step1[i] = f1->colours[blanks1[i]];
+    step2[i] = f2->colours[blanks2[i]];
+  }
+  new_colour = rdfdiff_mix(colour ^ rdfdiff_mix(RDFDIFF_HASH_PAIR + ++*pair));
+
+  for(k = 0; k < count && !rc; k++) {
+    if(step2[k] != colour)
+      continue;
+
+    f1->colours[v] = new_colour;
+    f2->colours[blanks2[k]] = new_colour;
+    if(rdfdiff_refine_groups(f1, blanks1, f2, blanks2, count,
+                             sorted1, sorted2))
+      rc = rdfdiff_search_group(f1, blanks1, f2, blanks2, count,
+                                sorted1, sorted2, pair);
+
+    if(rc <= 0) {
+      for(i = 0; i < count; i++) {
+        f1->colours[blanks1[i]] = step1[i];
+        f2->colours[blanks2[i]] = step2[i];
+      }
     }
   }
 
-  rv = 1;
-  done:
+  RAPTOR_FREE(rdfdiff_hash*, step1);
 
-#if defined(RAPTOR_DEBUG) && RAPTOR_DEBUG > 1
-  fprintf(stderr, " : %s\n", (rv ? "equal" : "not equal"));
-#endif
-  return rv;
+  return rc;
 }
 
 
+/*
+ * rdfdiff_match_group:
+ * @f1: file
+ * @blanks1: blank nodes of a connected group of @f1
+ * @f2: other file
+ * @blanks2: blank nodes of a connected group of @f2
+ * @count: number of blank nodes in each group
+ *
+ * Pair the blank nodes of two connected groups so that their
+ * statements are the same.  The colours of the groups are left as
+ * they were if they cannot be paired.
+ *
+ * Return value: 1 if the groups were paired, 0 if not or <0 on failure
+ */
 static int
-rdfdiff_blank_equals(const rdfdiff_blank *b1, const rdfdiff_blank *b2,
-                     rdfdiff_file *b1_file, rdfdiff_file *b2_file) 
+rdfdiff_match_group(rdfdiff_file* f1, const unsigned int* blanks1,
+                    rdfdiff_file* f2, const unsigned int* blanks2,
+                    unsigned int count)
 {
-  /* first compare "owners". Owners are subject/predicate or arcs
-   * in. */
-  int equal = 0;
-
-  if(b1->owner == NULL && b2->owner == NULL) {
-    /* Both are "top-level" anonymous objects. I.E. Neither is the
-     * object of a statement. Fall through and compare based on their
-     * contents. */
-    equal = 1;
-  } else if(b1->owner == NULL || b2->owner == NULL) {
-    equal = 0;
-  } else if(b1->owner->subject->type != RAPTOR_TERM_TYPE_BLANK &&
-            b2->owner->subject->type != RAPTOR_TERM_TYPE_BLANK) {
-    /* Neither are anonymous. Normal comparison. This will return
-     * false if both the subject and the predicates don't match. We
-     * know the objects are blank nodes. */
-    equal = rdfdiff_statement_equals(b1->world, b1->owner, b2->owner);
-    
-  } else if(b1->owner->subject->type == RAPTOR_TERM_TYPE_BLANK &&
-            b2->owner->subject->type == RAPTOR_TERM_TYPE_BLANK) {
-    rdfdiff_blank *p1;
-    rdfdiff_blank *p2;
-
-    /* Both are anonymous.  Need further testing. Check that the
-     * containing anononymous nodes are eaual. */
-#if 0
-    fprintf(stderr, "b1->owner: ");    
-    raptor_statement_print_as_ntriples(b1->owner, stderr);
-    fprintf(stderr, "\n");
-
-    fprintf(stderr, "b2->owner: ");    
-    raptor_statement_print_as_ntriples(b2->owner, stderr);
-    fprintf(stderr, "\n");
-#endif    
-    p1 = rdfdiff_find_blank(b1_file->first_blank, 
-                            (char *)b1->owner->subject->value.blank.string);
-    p2 = rdfdiff_find_blank(b2_file->first_blank,
-                            (char *)b2->owner->subject->value.blank.string);
-    equal = rdfdiff_blank_equals(p1, p2, b1_file, b2_file);
-  } else {
-    equal = 0;
+  rdfdiff_hash* colours;
+  rdfdiff_hash* saved1;
+  rdfdiff_hash* saved2;
+  rdfdiff_hash* sorted1;
+  rdfdiff_hash* sorted2;
+  rdfdiff_hash pair = 0;
+  unsigned int i;
+  int rc = 0;
+
+  colours = RAPTOR_MALLOC(rdfdiff_hash*, 4 * count * sizeof(rdfdiff_hash));
+  if(!colours)
+    return -1;
+  saved1 = colours;
+  saved2 = saved1 + count;
+  sorted1 = saved2 + count;
+  sorted2 = sorted1 + count;
+
+  for(i = 0; i < count; i++) {
+    saved1[i] = f1->colours[blanks1[i]];
+    saved2[i] = f2->colours[blanks2[i]];
   }
 
-  /* Now compare the contents. This accounts for the case where a
-   * subject has several properties (of the same predicate value) with
-   * different blank nodes as values. */
-  if(equal) {
-    rdfdiff_link *s1 = b1->first;
-    while(s1) {
-
-      rdfdiff_link *s2 = b2->first;
-      while(s2) {
-
-        if(rdfdiff_statement_equals(b1->world, s1->statement, s2->statement))
-          break;
-          
-        s2 = s2->next;
-
-      }
-
-      if(s2 == 0) {
-        equal = 0;
-        break;
-      }
-
-      s1 = s1->next;
+  if(rdfdiff_refine_groups(f1, blanks1, f2, blanks2, count, sorted1, sorted2))
+    rc = rdfdiff_search_group(f1, blanks1, f2, blanks2, count,
+                              sorted1, sorted2, &pair);
 
+  if(rc != 1) {
+    for(i = 0; i < count; i++) {
+      f1->colours[blanks1[i]] = saved1[i];
+      f2->colours[blanks2[i]] = saved2[i];
     }
-    
   }
-  
-  return equal;
+  RAPTOR_FREE(rdfdiff_hash*, colours);
+
+  return rc;
 }
 
 
-static void
-rdfdiff_log_handler(void *data, raptor_log_message *message)
+/* Blank nodes of @file in order of their connected group */
+static unsigned int*
+rdfdiff_blanks_by_group(rdfdiff_file* file)
 {
-  rdfdiff_file* file = (rdfdiff_file*)data;
-  
-   switch(message->level) {
-    case RAPTOR_LOG_LEVEL_FATAL:
-    case RAPTOR_LOG_LEVEL_ERROR:
-      if(!ignore_errors) {
-        fprintf(stderr, "%s: Error - ", program);
-        raptor_locator_print(message->locator, stderr);
-        fprintf(stderr, " - %s\n", message->text);
-        
-        raptor_parser_parse_abort(file->parser);
-      }
-      
-      file->error_count++;
-      break;
-      
-    case RAPTOR_LOG_LEVEL_WARN:
-      if(!ignore_warnings) {
-        fprintf(stderr, "%s: Warning - ", program);
-        raptor_locator_print(message->locator, stderr);
-        fprintf(stderr, " - %s\n", message->text);
-      }
-      
-      file->warning_count++;
-      break;
-      
-    case RAPTOR_LOG_LEVEL_NONE:
-    case RAPTOR_LOG_LEVEL_TRACE:
-    case RAPTOR_LOG_LEVEL_DEBUG:
-    case RAPTOR_LOG_LEVEL_INFO:
+  rdfdiff_member* members;
+  unsigned int* blanks;
+  unsigned int i;
+
+  members = RAPTOR_MALLOC(rdfdiff_member*,
+                          (file->blank_count + 1) * sizeof(*members));
+  blanks = RAPTOR_MALLOC(unsigned int*,
+                         (file->blank_count + 1) * sizeof(unsigned int));
+  if(!members || !blanks) {
+    if(members)
+      RAPTOR_FREE(rdfdiff_member*, members);
+    if(blanks)
+      RAPTOR_FREE(unsigned int*, blanks);
+    return NULL;
+  }
 
-      fprintf(stderr, "%s: Unexpected %s message - ", program,
-              raptor_log_level_get_label(message->level));
-      raptor_locator_print(message->locator, stderr);
-      fprintf(stderr, " - %s\n", message->text);
-      break;
+  for(i = 0; i < file->blank_count; i++) {
+    members[i].colour = 0;
+    members[i].file = 0;
+    members[i].group = file->groups[i];
+    members[i].blank = i;
   }
-  
-}
+  qsort(members, file->blank_count, sizeof(*members), rdfdiff_member_compare);
+  for(i = 0; i < file->blank_count; i++)
+    blanks[i] = members[i].blank;
 
+  RAPTOR_FREE(rdfdiff_member*, members);
+  return blanks;
+}
 
 
-static rdfdiff_blank *
-rdfdiff_find_blank(rdfdiff_blank *first, char *blank_id) 
+/* Add the connected groups of @file to @groups with the sum of their
+ * colours, the offset of their first blank node in @blanks and their
+ * size; returns the new number of groups */
+static unsigned int
+rdfdiff_add_groups(rdfdiff_file* file, const unsigned int* blanks,
+                   unsigned int which, rdfdiff_member* groups, unsigned int n)
 {
-  rdfdiff_blank *rv_blank = 0;
-  rdfdiff_blank *cur = first;
+  unsigned int i;
+  unsigned int end;
 
-  while(cur) {
+  for(i = 0; i < file->blank_count; i = end) {
+    rdfdiff_hash sum = 0;
 
-    if(strcmp(cur->blank_id, blank_id) == 0) {
-      rv_blank = cur;
-      break;
-    }
+    for(end = i; end < file->blank_count &&
+        file->groups[blanks[end]] == file->groups[blanks[i]]; end++)
+      sum += rdfdiff_mix(file->colours[blanks[end]]);
 
-    cur = cur->next;
-    
+    groups[n].colour = rdfdiff_mix(sum ^ (end - i));
+    groups[n].file = which;
+    groups[n].group = i;
+    groups[n].blank = end - i;
+    n++;
   }
-  
-  return rv_blank;
-  
+
+  return n;
 }
 
 
-static rdfdiff_blank *
-rdfdiff_lookup_blank(rdfdiff_file* file, char *blank_id) 
+/*
+ * rdfdiff_pair_groups:
+ * @f1: file
+ * @f2: other file
+ *
+ * Pair the connected groups of blank nodes of the two files that are
+ * the same apart from their blank node labels, and the blank nodes in
+ * them.  Each group of @f1 is tried against the unpaired groups of @f2
+ * with the same colours.
+ *
+ * Return value: non-0 on failure
+ */
+static int
+rdfdiff_pair_groups(rdfdiff_file* f1, rdfdiff_file* f2)
 {
-  rdfdiff_blank *rv_blank = rdfdiff_find_blank(file->first_blank, blank_id);
-  
-  if(!rv_blank) {
-    rv_blank = rdfdiff_new_blank(file->world, blank_id);
-    if(rv_blank) {
-
-      if(!file->first_blank) {
-        file->first_blank = rv_blank;
-        file->last_blank = rv_blank;
-      } else {
-        file->last_blank->next = rv_blank;
-        file->last_blank = rv_blank;
+  unsigned int* blanks1;
+  unsigned int* blanks2;
+  rdfdiff_member* groups;
+  char* used;
+  unsigned int n;
+  unsigned int i;
+  int rc = 1;
+
+  blanks1 = rdfdiff_blanks_by_group(f1);
+  blanks2 = rdfdiff_blanks_by_group(f2);
+  groups = RAPTOR_MALLOC(rdfdiff_member*,
+                         (f1->blank_count + f2->blank_count + 1) *
+                         sizeof(*groups));
+  used = RAPTOR_CALLOC(char*, f1->blank_count + f2->blank_count + 1, 1);
+  if(!blanks1 || !blanks2 || !groups || !used)
+    goto tidy;
+
+  n = rdfdiff_add_groups(f1, blanks1, 0, groups, 0);
+  n = rdfdiff_add_groups(f2, blanks2, 1, groups, n);
+  qsort(groups, n, sizeof(*groups), rdfdiff_member_compare);
+
+  for(i = 0; i < n; ) {
+    unsigned int start2;
+    unsigned int end;
+    unsigned int next;
+    unsigned int j;
+
+    for(start2 = i; start2 < n && groups[start2].colour == groups[i].colour &&
+        !groups[start2].file; start2++)
+      ;
+    for(end = start2; end < n && groups[end].colour == groups[i].colour;
+        end++)
+      ;
+
+    /* first unpaired group of @f2 */
+    next = start2;
+    for(j = i; j < start2 && next < end; j++) {
+      unsigned int k;
+
+      for(k = next; k < end; k++) {
+        int matched;
+
+        if(used[k])
+          continue;
+        matched = rdfdiff_match_group(f1, blanks1 + groups[j].group,
+                                      f2, blanks2 + groups[k].group,
+                                      groups[j].blank);
+        if(matched < 0)
+          goto tidy;
+        if(matched) {
+          used[k] = 1;
+          break;
+        }
       }
-    }    
-  }
+      while(next < end && used[next])
+        next++;
+    }
 
-  return rv_blank;
-  
+    i = end;
+  }
+  rc = 0;
+
+  tidy:
+  if(blanks1)
+    RAPTOR_FREE(unsigned int*, blanks1);
+  if(blanks2)
+    RAPTOR_FREE(unsigned int*, blanks2);
+  if(groups)
+    RAPTOR_FREE(rdfdiff_member*, groups);
+  if(used)
+    RAPTOR_FREE(char*, used);
+
+  return rc;
 }
 
 
+/*
+ * rdfdiff_pair_colours:
+ * @f1: file
+ * @f2: other file
+ * @colours1: colours of the blank nodes of @f1
+ * @colours2: colours of the blank nodes of @f2
+ *
+ * Pair blank nodes of the two files not yet paired that have the same
+ * colour, in the order they were first seen.
+ *
+ * Return value: non-0 on failure
+ */
 static int
-rdfdiff_add_blank_statement(rdfdiff_file* file,
-                            raptor_statement *statement)
+rdfdiff_pair_colours(rdfdiff_file* f1, rdfdiff_file* f2,
+                     const rdfdiff_hash* colours1,
+                     const rdfdiff_hash* colours2)
 {
-  rdfdiff_blank *blank;
-  rdfdiff_link *dlink;
+  unsigned int total = f1->blank_count + f2->blank_count;
+  rdfdiff_member* members;
+  unsigned int i;
+  unsigned int n = 0;
 
-  blank = rdfdiff_lookup_blank(file, (char *)statement->subject->value.blank.string);
-  if(!blank)
-    goto failed;
+  members = RAPTOR_MALLOC(rdfdiff_member*, (total + 1) * sizeof(*members));
+  if(!members)
+    return 1;
 
-  dlink = RAPTOR_MALLOC(rdfdiff_link*, sizeof(*dlink));
-  if(!dlink)
-    goto failed;
-  
-  dlink->statement = raptor_statement_copy(statement);
-  if(!dlink->statement) {
-    RAPTOR_FREE(rdfdiff_link, dlink);
-    goto failed;
+  for(i = 0; i < f1->blank_count; i++) {
+    if(f1->pairs[i] != RDFDIFF_NO_GRAPH)
+      continue;
+    members[n].colour = colours1 ? colours1[i] : 0;
+    members[n].file = 0;
+    members[n].group = 0;
+    members[n++].blank = i;
   }
-  
-  dlink->next = NULL;
-  if(!blank->first) {
-    blank->first = dlink;
-    blank->last = dlink;
-  } else {
-    blank->last->next = dlink;
-    blank->last = dlink;
+  for(i = 0; i < f2->blank_count; i++) {
+    if(f2->pairs[i] != RDFDIFF_NO_GRAPH)
+      continue;
+    members[n].colour = colours2 ? colours2[i] : 0;
+    members[n].file = 1;
+    members[n].group = 0;
+    members[n++].blank = i;
+  }
+  qsort(members, n, sizeof(*members), rdfdiff_member_compare);
+
+  for(i = 0; i < n; ) {
+    unsigned int start2;
+    unsigned int end;
+    unsigned int j;
+
+    for(start2 = i; start2 < n && members[start2].colour == members[i].colour &&
+        !members[start2].file; start2++)
+      ;
+    for(end = start2; end < n && members[end].colour == members[i].colour;
+        end++)
+      ;
+
+    for(j = 0; i + j < start2 && start2 + j < end; j++) {
+      f1->pairs[members[i + j].blank] = members[start2 + j].blank;
+      f2->pairs[members[start2 + j].blank] = members[i + j].blank;
+    }
+    i = end;
   }
-  
-  return 0;
 
-failed:
-  fprintf(stderr, "%s: Internal Error\n", program);
-  return 1;
+  RAPTOR_FREE(rdfdiff_member*, members);
+  return 0;
 }
 
 
+/*
+ * rdfdiff_pair_all_blanks:
+ * @f1: file
+ * @f2: other file
+ *
+ * Pair the blank nodes of the two files: first the connected groups
+ * of blank nodes that are the same in both, then those left over by
+ * their colours after refinement and by the colours of ever earlier
+ * rounds of it so blank nodes near a difference are paired with the
+ * most similar ones.
+ *
+ * Return value: non-0 on failure
+ */
 static int
-rdfdiff_add_blank_statement_owner(rdfdiff_file* file,
-                                  raptor_statement *statement)
+rdfdiff_pair_all_blanks(rdfdiff_file* f1, rdfdiff_file* f2)
 {
-  rdfdiff_blank *blank;
+  unsigned int rounds;
+  unsigned int r;
 
-  blank = rdfdiff_lookup_blank(file,
-                               (char*)statement->object->value.blank.string);
-  if(!blank)
-    goto failed;
+  if(rdfdiff_refine_until_stable(f1, f2))
+    return 1;
+  rounds = f1->history_count;
 
-  if(blank->owner)
-    raptor_free_statement(blank->owner);
+  if(rdfdiff_pair_groups(f1, f2))
+    return 1;
 
-  blank->owner = raptor_statement_copy(statement);
-  if(!blank->owner)
-    goto failed;
+  if(rdfdiff_pair_colours(f1, f2, f1->colours, f2->colours))
+    return 1;
 
-  return 0;
+  for(r = rounds; r-- > 0; ) {
+    if(rdfdiff_pair_colours(f1, f2, f1->history + r * f1->blank_count,
+                            f2->history + r * f2->blank_count))
+      return 1;
+  }
 
-failed:
-  fprintf(stderr, "%s: Internal Error\n", program);
-  return 1;
+  /* anything left */
+  return rdfdiff_pair_colours(f1, f2, NULL, NULL);
 }
 
 
-static int
-rdfdiff_add_statement(rdfdiff_file* file, raptor_statement *statement) 
+/*
+ * rdfdiff_match_statements:
+ * @file: file
+ * @other: other file
+ *
+ * Match the statements of the two files, with blank nodes of @file
+ * replaced by the blank nodes of @other they are paired with.
+ */
+static void
+rdfdiff_match_statements(rdfdiff_file* file, rdfdiff_file* other)
 {
-  int rv = 0;
-  
-  rdfdiff_link *dlink = RAPTOR_MALLOC(rdfdiff_link*, sizeof(*dlink));
-
-  if(dlink) {
-
-    dlink->statement = raptor_statement_copy(statement);
-
-    if(dlink->statement) {
-      
-      dlink->next = NULL;
-
-      if(!file->first) {
-        file->first = dlink;
-        file->last = dlink;
-      } else {
-        file->last->next = dlink;
-        file->last = dlink;
+  rdfdiff_refs_key key;
+  rdfdiff_ref refs[RDFDIFF_TERMS];
+  int i;
+
+  key.statements = other->statements;
+  key.refs = refs;
+  for(i = 0; i < file->statement_count; i++) {
+    rdfdiff_statement* s = &file->statements[i];
+    long item;
+    int j;
+
+    for(j = 0; j < RDFDIFF_TERMS; j++) {
+      refs[j] = s->refs[j];
+      if(RDFDIFF_IS_BLANK(refs[j])) {
+        unsigned int pair = file->pairs[refs[j] & ~RDFDIFF_BLANK];
+
+        if(pair == RDFDIFF_NO_GRAPH)
+          break;
+        refs[j] = RDFDIFF_BLANK | pair;
       }
-      
-    } else {
-      RAPTOR_FREE(rdfdiff_link, dlink);
-      rv = 1;
     }
-    
-  } else {
-    rv = 1;
+    if(j < RDFDIFF_TERMS)
+      continue;
+
+    item = rdfdiff_index_find(&other->statement_index,
+                              rdfdiff_hash_refs(refs),
+                              rdfdiff_refs_equals, &key);
+    if(item >= 0) {
+      s->matched = 1;
+      other->statements[item].matched = 1;
+    }
   }
+}
 
-  if(rv != 0)
-    fprintf(stderr, "%s: Internal Error\n", program);
-
-  return rv;
 
+static raptor_term*
+rdfdiff_ref_term(rdfdiff_file* file, rdfdiff_ref ref)
+{
+  if(ref == RDFDIFF_NO_GRAPH)
+    return NULL;
+  if(ref & RDFDIFF_BLANK)
+    return file->blanks[ref & ~RDFDIFF_BLANK];
+  return terms.terms[ref];
 }
 
 
-static rdfdiff_link*
-rdfdiff_statement_find(rdfdiff_file* file, const raptor_statement *statement,
-                       rdfdiff_link** prev_p)
+/*
+ * rdfdiff_patch_blank:
+ * @file: file
+ * @other: file the patch is applied to
+ * @ref: blank node reference in @file
+ *
+ * Get the blank node to write in a patch for a blank node of @file, so
+ * the lines of both files use the blank node labels of @other.  A
+ * paired blank node is written as the blank node of @other it is
+ * paired with.  Others get a new label not used in @other.
+ *
+ * Return value: shared blank node term or NULL on failure
+ */
+static raptor_term*
+rdfdiff_patch_blank(rdfdiff_file* file, rdfdiff_file* other, rdfdiff_ref ref)
 {
-  rdfdiff_link* prev = NULL;
-  rdfdiff_link* cur = file->first;
-  
-  while(cur) {
-    if(rdfdiff_statement_equals(file->world, cur->statement, statement)) {
-      if(prev_p)
-        *prev_p=prev;
-      return cur;
-    }
-    prev = cur;
-    cur = cur->next;
+  unsigned int blank = ref & ~RDFDIFF_BLANK;
+  unsigned int pair = file->pairs[blank];
+  raptor_term* term;
+
+  if(pair != RDFDIFF_NO_GRAPH)
+    return other->blanks[pair];
+
+  if(!file->patch_blanks) {
+    file->patch_blanks = RAPTOR_CALLOC(raptor_term**, file->blank_count,
+                                       sizeof(raptor_term*));
+    if(!file->patch_blanks)
+      return NULL;
   }
 
-  return NULL;
-}
+  if(file->patch_blanks[blank])
+    return file->patch_blanks[blank];
 
+  while(1) {
+    char label[20];
+    rdfdiff_term_key key;
+    int len;
 
-static int
-rdfdiff_statement_exists(rdfdiff_file* file, const raptor_statement *statement)
-{
-  rdfdiff_link* node;
-  rdfdiff_link* prev = NULL;
-  node = rdfdiff_statement_find(file, statement, &prev);
-  return (node != NULL);
+    len = sprintf(label, "new%u", file->patch_blank_id++);
+    term = raptor_new_term_from_counted_blank(file->world,
+                                              (const unsigned char*)label,
+                                              (size_t)len);
+    if(!term)
+      return NULL;
+
+    key.term = term;
+    key.terms = other->blanks;
+    if(rdfdiff_index_find(&other->blank_index, rdfdiff_hash_term(term),
+                          rdfdiff_blank_equals, &key) < 0)
+      break;
+
+    raptor_free_term(term);
+  }
+
+  file->patch_blanks[blank] = term;
+  return term;
 }
 
 
 /*
- * rdfdiff_collect_statements - Called when parsing "from" file to build a
- * list of statements for comparison with those in the "to" file.
+ * rdfdiff_report_statements:
+ * @file: file
+ * @other: file compared with
+ * @prefix: "<" or ">" for a diff listing, "A" or "D" for a patch
+ * @emit_header_p: pointer to flag to print the diff listing header
+ * @iostr: iostream for a patch
+ *
+ * Report the statements of @file that were not matched in @other.
+ * Patch "A" lines use the blank node labels of @other, the file the
+ * patch is applied to.
  */
-static void
-rdfdiff_collect_statements(void *user_data, raptor_statement *statement)
+static int
+rdfdiff_report_statements(rdfdiff_file* file, rdfdiff_file* other,
+                          const char* prefix, int* emit_header_p,
+                          raptor_iostream* iostr)
 {
-  int rv = 0;
-  rdfdiff_file* file = (rdfdiff_file*)user_data;
+  raptor_statement statement;
+  int i;
 
-  if(rdfdiff_statement_exists(file, statement))
-    return;
-  
-  file->statement_count++;
+  raptor_statement_init(&statement, file->world);
+
+  for(i = 0; i < file->statement_count; i++) {
+    rdfdiff_statement* s = &file->statements[i];
 
-  if(statement->subject->type == RAPTOR_TERM_TYPE_BLANK ||
-     statement->object->type  == RAPTOR_TERM_TYPE_BLANK) {
+    if(s->matched)
+      continue;
 
-    if(statement->subject->type == RAPTOR_TERM_TYPE_BLANK)
-      rv = rdfdiff_add_blank_statement(file, statement);
+    file->difference_count++;
+    if(brief)
+      continue;
+
+    statement.subject = rdfdiff_ref_term(file, s->refs[0]);
+    statement.predicate = rdfdiff_ref_term(file, s->refs[1]);
+    statement.object = rdfdiff_ref_term(file, s->refs[2]);
+    statement.graph = rdfdiff_ref_term(file, s->refs[3]);
+
+    if(patch) {
+      if(*prefix == 'A') {
+        raptor_term** terms_p[RDFDIFF_TERMS];
+        int j;
+
+        terms_p[0] = &statement.subject;
+        terms_p[1] = &statement.predicate;
+        terms_p[2] = &statement.object;
+        terms_p[3] = &statement.graph;
+        for(j = 0; j < RDFDIFF_TERMS; j++) {
+          if(RDFDIFF_IS_BLANK(s->refs[j])) {
+            *terms_p[j] = rdfdiff_patch_blank(file, other, s->refs[j]);
+            if(!*terms_p[j]) {
+              fprintf(stderr, "%s: Out of memory\n", program);
+              return 1;
+            }
+          }
+        }
+      }
 
-    if(rv == 0 && statement->object->type == RAPTOR_TERM_TYPE_BLANK)
-      rv = rdfdiff_add_blank_statement_owner(file, statement);
+      raptor_iostream_string_write(prefix, iostr);
+      raptor_iostream_write_byte(' ', iostr);
+      raptor_statement_ntriples_write(&statement, iostr, 1);
+    } else {
+      if(*emit_header_p) {
+        fprintf(stderr, "Statements in %s but not in %s\n",
+                file->name, other->name);
+        *emit_header_p = 0;
+      }
 
-  } else {
-    rv = rdfdiff_add_statement(file, statement);
+      fprintf(stderr, "%s    ", prefix);
+      raptor_statement_print_as_ntriples(&statement, stderr);
+      fprintf(stderr, "\n");
+    }
   }
 
-  if(rv != 0) {
-    raptor_parser_parse_abort(file->parser);
-  }
-  
+  return 0;
 }
 
 
 
 int
-main(int argc, char *argv[]) 
+main(int argc, char *argv[])
 {
   raptor_world *world = NULL;
   unsigned char *from_string = NULL;
@@ -732,9 +1780,8 @@ main(int argc, char *argv[])
   int help = 0;
   char *p;
   int rv = 0;
-  rdfdiff_blank *b1;
-  rdfdiff_link *cur;
-  
+  raptor_iostream* patch_iostr = NULL;
+
   program = argv[0];
   if((p = strrchr(program, '/')))
     program = p+1;
@@ -767,7 +1814,7 @@ main(int argc, char *argv[])
       case '?': /* getopt() - unknown option */
         usage = 1;
         break;
-        
+
       case 'b':
         brief = 1;
         break;
@@ -776,6 +1823,10 @@ main(int argc, char *argv[])
         help = 1;
         break;
 
+      case 'p':
+        patch = 1;
+        break;
+
       case 'f':
         if(optarg)
           from_syntax = optarg;
@@ -792,13 +1843,13 @@ main(int argc, char *argv[])
         break;
 
     }
-    
+
   }
 
   if(optind != argc-2 && !help && !usage) {
     usage = 2; /* Title and usage */
   }
-  
+
   if(usage) {
     if(usage > 1) {
       fputs(title_string, stderr); putc(' ', stderr); fputs(raptor_version_string, stderr); putc('\n', stderr);
@@ -816,9 +1867,11 @@ main(int argc, char *argv[])
     puts(title_string); putchar(' '); puts(raptor_version_string); putchar('\n');
     puts(raptor_short_copyright_string);
     puts("Find differences between two RDF files.");
+    puts("Blank nodes are matched by the structure of the graphs, not their labels.");
     puts("\nOPTIONS:");
     puts(HELP_TEXT("h", "help                      ", "Print this help, then exit"));
     puts(HELP_TEXT("b", "brief                     ", "Report only whether files differ"));
+    puts(HELP_TEXT("p", "patch                     ", "Write differences to standard output as a patch of" HELP_PAD "'D' (delete) and 'A' (add) N-Triples or N-Quads lines"));
     puts(HELP_TEXT("u BASE-URI", "base-uri BASE-URI  ", "Set the base URI for the files"));
     puts(HELP_TEXT("f FORMAT",   "from-format FORMAT ", "Format of <from URI> (default is rdfxml)"));
     puts(HELP_TEXT("t FORMAT",   "to-format FORMAT   ", "Format of <to URI> (default is rdfxml)"));
@@ -828,7 +1881,7 @@ main(int argc, char *argv[])
 
   from_string = (unsigned char *)argv[optind++];
   to_string = (unsigned char *)argv[optind];
-  
+
   if(!access((const char *)from_string, R_OK)) {
     char *filename = (char *)from_string;
     from_string = raptor_uri_filename_to_uri_string(filename);
@@ -839,7 +1892,7 @@ main(int argc, char *argv[])
     }
     free_from_string = 1;
   }
-  
+
   if(!access((const char *)to_string, R_OK)) {
     char *filename = (char *)to_string;
     to_string = raptor_uri_filename_to_uri_string(filename);
@@ -850,14 +1903,14 @@ main(int argc, char *argv[])
     }
     free_to_string = 1;
   }
-  
+
   from_uri = raptor_new_uri(world, from_string);
   if(!from_uri) {
     fprintf(stderr, "%s: Failed to create URI for %s\n", program, from_string);
     rv = 2;
     goto exit;
   }
-  
+
   to_uri = raptor_new_uri(world, to_string);
   if(!to_uri) {
     fprintf(stderr, "%s: Failed to create URI for %s\n", program, from_string);
@@ -871,7 +1924,7 @@ main(int argc, char *argv[])
     rv = 2;
     goto exit;
   }
-  
+
   /* create and init "to" data structures */
   to_file = rdfdiff_new_file(world, to_string, to_syntax);
   if(!to_file) {
@@ -882,9 +1935,9 @@ main(int argc, char *argv[])
   /* parse the files */
   raptor_parser_set_statement_handler(from_file->parser, from_file,
                                rdfdiff_collect_statements);
-  
+
   if(raptor_parser_parse_uri(from_file->parser, from_uri, base_uri)) {
-    fprintf(stderr, "%s: Failed to parse URI %s as %s content\n", program, 
+    fprintf(stderr, "%s: Failed to parse URI %s as %s content\n", program,
             from_string, from_syntax);
     rv = 1;
     goto exit;
@@ -894,7 +1947,7 @@ main(int argc, char *argv[])
     raptor_parser_set_statement_handler(to_file->parser, to_file,
                                  rdfdiff_collect_statements);
     if(raptor_parser_parse_uri(to_file->parser, to_uri, base_uri ? base_uri: from_uri)) {
-      fprintf(stderr, "%s: Failed to parse URI %s as %s content\n", program, 
+      fprintf(stderr, "%s: Failed to parse URI %s as %s content\n", program,
               to_string, to_syntax);
       rv = 1;
       goto exit;
@@ -902,133 +1955,32 @@ main(int argc, char *argv[])
   }
 
 
-  /* Compare triples with no blank nodes */
-  cur = to_file->first;
-  while(cur) {
-    rdfdiff_link* node;
-    rdfdiff_link* prev;
-    node = rdfdiff_statement_find(from_file, cur->statement, &prev);
-    if(node) {
-      /* exists in from file - remove it from the list */
-      if(from_file->first == node) {
-        from_file->first = node->next;
-      } else {
-        prev->next = node->next;
-      }
-      raptor_free_statement(node->statement);
-      RAPTOR_FREE(rdfdiff_link, node);
-    } else {
-      if(!brief) {
-        if(emit_from_header) {
-          fprintf(stderr, "Statements in %s but not in %s\n",
-                  to_file->name, from_file->name);
-          emit_from_header = 0;
-        }
-        
-        fprintf(stderr, "<    ");
-        raptor_statement_print_as_ntriples(cur->statement, stderr);
-        fprintf(stderr, "\n");
-      }
-      
-      to_file->difference_count++;
-    }
-    cur = cur->next;
+  /* Pair the blank nodes and compare the statements */
+  if(rdfdiff_prepare_blanks(to_file) || rdfdiff_prepare_blanks(from_file) ||
+     rdfdiff_pair_all_blanks(to_file, from_file)) {
+    fprintf(stderr, "%s: Internal Error\n", program);
+    rv = 2;
+    goto exit;
   }
+  rdfdiff_match_statements(to_file, from_file);
 
-  
-  /* Now compare the blank nodes */
-  b1 = to_file->first_blank;
-  while(b1) {
-
-    rdfdiff_blank *b2 = from_file->first_blank;
-
-    while(b2) {
-
-      if(!b2->matched && rdfdiff_blank_equals(b1, b2, to_file, from_file)) {
-        b1->matched = 1;
-        b2->matched = 1;
-        break;
-      }
-      
-      b2 = b2->next;
-      
-    }
-
-    if(b2 == 0) {
-      if(!brief) {        
-#if 0
-        fprintf(stderr, "<    ");
-        raptor_statement_print_as_ntriples(b1->owner, stderr);
-        fprintf(stderr, "\n");
-#else
-        if(emit_from_header) {
-          fprintf(stderr, "Statements in %s but not in %s\n",  to_file->name, from_file->name);
-          emit_from_header = 0;
-        }
-
-        fprintf(stderr, "<    anonymous node %s\n", b1->blank_id);
-#endif        
-      }
-      
-      to_file->difference_count++;
+  if(patch) {
+    patch_iostr = raptor_new_iostream_to_file_handle(world, stdout);
+    if(!patch_iostr) {
+      rv = 2;
+      goto exit;
     }
-    
-    b1 = b1->next;
-
   }
-  
-  if(from_file->first) {
-    /* The entrys left in from_file have not been found in to_file. */
-    if(!brief) {
-
-      if(emit_to_header) {
-        fprintf(stderr, "Statements in %s but not in %s\n",  from_file->name,
-                to_file->name);
-        emit_to_header = 0;
-      }
-      
-      cur = from_file->first;
-      while(cur) {
-        if(!brief) {
-          fprintf(stderr, ">    ");
-          raptor_statement_print_as_ntriples(cur->statement, stderr);
-          fprintf(stderr, "\n");
-        }
-      
-        cur = cur->next;
-        from_file->difference_count++;
-      }
-    }
 
+  /* The statements left in from_file have not been found in to_file. */
+  if(rdfdiff_report_statements(from_file, to_file, patch ? "D" : ">",
+                               &emit_to_header, patch_iostr) ||
+     rdfdiff_report_statements(to_file, from_file, patch ? "A" : "<",
+                               &emit_from_header, patch_iostr)) {
+    rv = 2;
+    goto exit;
   }
 
-  if(from_file->first_blank) {
-    rdfdiff_blank *blank = from_file->first_blank;
-    while(blank) {
-
-      if(!blank->matched) {
-        if(!brief) {
-#if 0          
-          fprintf(stderr, ">    ");
-          raptor_statement_print_as_ntriples(blank->owner, stderr);
-          fprintf(stderr, "\n");
-#else
-          if(emit_to_header) {
-            fprintf(stderr, "Statements in %s but not in %s\n",  from_file->name, to_file->name);
-            emit_to_header = 0;
-          }
-          fprintf(stderr, ">    anonymous node %s\n", blank->blank_id);
-#endif          
-        }
-        from_file->difference_count++;
-      }
-    
-      blank = blank->next;
-      
-    }
-
-  }
-  
   if(!(from_file->difference_count == 0 &&
         to_file->difference_count == 0)) {
 
@@ -1040,18 +1992,23 @@ main(int argc, char *argv[])
 
 exit:
 
+  if(patch_iostr)
+    raptor_free_iostream(patch_iostr);
+
   if(base_uri)
     raptor_free_uri(base_uri);
-  
+
   if(from_file)
     rdfdiff_free_file(from_file);
 
   if(to_file)
     rdfdiff_free_file(to_file);
-  
+
+  rdfdiff_free_terms();
+
   if(free_from_string)
     raptor_free_memory(from_string);
-    
+
   if(free_to_string)
     raptor_free_memory(to_string);
 
@@ -1064,6 +2021,5 @@ exit:
   raptor_free_world(world);
 
   return rv;
-  
-}
 
+}